@@ -0,0 +1,243 @@
+#include <piconaut/piconaut.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client_connection.h"
+#include "load_generator.h"
+#include "report.h"
+#include "scenarios.h"
+
+using namespace piconaut;
+
+namespace {
+
+struct BenchArgs {
+  bench::LoadOptions load;
+  std::vector<std::string> scenarios{"all"};
+  std::vector<std::string> protocols{"all"};
+  // Depth of the pipelined and h2 runs, keep-alive runs always use 1
+  size_t depth = 16;
+  std::string output;
+  bool verbose = false;
+};
+
+const char* kUsage =
+    "Usage: piconaut-bench [options]\n"
+    "Starts a piconaut server on loopback and load tests it, the report\n"
+    "is written as json.\n"
+    "\n"
+    "  --scenario LIST     static,params,json,post or all (default all)\n"
+    "  --protocol LIST     http1,pipeline,h2 or all (default all)\n"
+    "  --mode MODE         closed or open (default closed)\n"
+    "  --rate N            open loop requests per second (default 10000)\n"
+    "  --threads N         load generator threads (default 2)\n"
+    "  --connections N     connections over all threads (default 16)\n"
+    "  --depth N           pipeline depth / h2 streams (default 16)\n"
+    "  --warmup MS         not measured, per run (default 1000)\n"
+    "  --duration MS       measured, per run (default 5000)\n"
+    "  --host HOST         loopback address (default 127.0.0.1)\n"
+    "  --port N            server port (default 18080)\n"
+    "  --output FILE       report file (default stdout)\n"
+    "  --verbose           keep the server logs\n";
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty())
+      items.push_back(item);
+  }
+  return items;
+}
+
+bool Selected(const std::vector<std::string>& list, const std::string& name) {
+  for (const auto& item : list) {
+    if (item == "all" || item == name)
+      return true;
+  }
+  return false;
+}
+
+BenchArgs ParseArgs(int argc, char* argv[]) {
+  BenchArgs args;
+  for (int i = 1; i < argc; ++i) {
+    std::string name = argv[i];
+    if (name == "--help" || name == "-h") {
+      std::cout << kUsage;
+      std::exit(0);
+    }
+    if (name == "--verbose") {
+      args.verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + name);
+    std::string value = argv[++i];
+
+    if (name == "--scenario") {
+      args.scenarios = SplitList(value);
+    } else if (name == "--protocol") {
+      args.protocols = SplitList(value);
+    } else if (name == "--mode") {
+      if (value != "closed" && value != "open")
+        throw std::invalid_argument("Unknown mode: " + value);
+      args.load.mode =
+          value == "open" ? bench::LoadMode::kOpen : bench::LoadMode::kClosed;
+    } else if (name == "--rate") {
+      args.load.rate = std::stod(value);
+    } else if (name == "--threads") {
+      args.load.threads = std::stoul(value);
+    } else if (name == "--connections") {
+      args.load.connections = std::stoul(value);
+    } else if (name == "--depth") {
+      args.depth = std::stoul(value);
+    } else if (name == "--warmup") {
+      args.load.warmup = std::chrono::milliseconds(std::stol(value));
+    } else if (name == "--duration") {
+      args.load.duration = std::chrono::milliseconds(std::stol(value));
+    } else if (name == "--host") {
+      args.load.host = value;
+    } else if (name == "--port") {
+      args.load.port = std::stoi(value);
+    } else if (name == "--output") {
+      args.output = value;
+    } else {
+      throw std::invalid_argument("Unknown option: " + name);
+    }
+  }
+  return args;
+}
+
+// Server under test, its loops run on a thread of their own until Stop.
+class BenchServer {
+ public:
+  BenchServer(const std::string& host, int port)
+      : host_(host), port_(port), server_(host, port) {
+    bench::RegisterScenarioRoutes(server_);
+    thread_ = std::thread([this]() {
+      try {
+        server_.Start();
+      } catch (const std::exception& ex) {
+        std::cerr << "Bench server error: " << ex.what() << std::endl;
+        failed_ = true;
+      }
+    });
+  }
+
+  ~BenchServer() {
+    Stop();
+  }
+
+  void WaitListening() {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (true) {
+      if (failed_)
+        throw std::runtime_error("Bench server failed to start");
+      try {
+        bench::ClientConnection::Connect(bench::Protocol::kHttp1, host_,
+                                         port_);
+        return;
+      } catch (const std::runtime_error&) {
+        if (std::chrono::steady_clock::now() > deadline)
+          throw;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+    }
+  }
+
+  void Stop() {
+    server_.Stop();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+ private:
+  std::string host_;
+  int port_;
+  http::H2OServer server_;
+  std::thread thread_;
+  std::atomic<bool> failed_{false};
+};
+
+int Run(const BenchArgs& args) {
+  // The server logs every request on std::cout, that would be measured
+  // too. The report goes out once the logs are back on.
+  auto log = std::cout.rdbuf();
+  if (!args.verbose)
+    std::cout.rdbuf(nullptr);
+
+  BenchServer server(args.load.host, args.load.port);
+  server.WaitListening();
+
+  struct Variant {
+    const char* name;
+    bench::Protocol protocol;
+    size_t depth;
+  };
+  const Variant variants[] = {
+      {"http1", bench::Protocol::kHttp1, 1},
+      {"pipeline", bench::Protocol::kHttp1, args.depth},
+      {"h2", bench::Protocol::kHttp2, args.depth},
+  };
+
+  std::vector<bench::RunReport> runs;
+  for (const auto& scenario : bench::FixedScenarios()) {
+    if (!Selected(args.scenarios, scenario.name))
+      continue;
+    for (const auto& variant : variants) {
+      if (!Selected(args.protocols, variant.name))
+        continue;
+      auto options = args.load;
+      options.protocol = variant.protocol;
+      options.depth = variant.depth;
+      bench::LoadGenerator generator(options);
+      auto result = generator.Run(scenario);
+
+      std::cerr << scenario.name << " " << variant.name << " "
+                << bench::LoadModeName(options.mode) << ": "
+                << static_cast<uint64_t>(result.rps) << " rps, p99 "
+                << result.latency.ValueAtQuantile(0.99) << "us, "
+                << result.errors << " errors" << std::endl;
+      runs.push_back(
+          bench::RunReport{scenario.name, generator.Options(), result});
+    }
+  }
+  if (runs.empty())
+    throw std::invalid_argument("No scenario / protocol selected");
+
+  auto report = bench::JsonReport(runs);
+  // Before the logs are back on, it says goodbye on std::cout
+  server.Stop();
+  std::cout.rdbuf(log);
+  if (args.output.empty()) {
+    std::cout << report << std::endl;
+  } else {
+    std::ofstream file(args.output);
+    file << report << std::endl;
+    if (!file)
+      throw std::runtime_error("Failed to write " + args.output);
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int code = 1;
+  try {
+    code = Run(ParseArgs(argc, argv));
+  } catch (const std::exception& ex) {
+    std::cerr << "Error: " << ex.what() << std::endl;
+  }
+  return code;
+}
@@ -0,0 +1,537 @@
+#include "client_connection.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(bench)
+
+namespace {
+
+constexpr size_t kMaxHeaderSize = 64 * 1024;
+
+constexpr uint8_t kH2Data = 0x0;
+constexpr uint8_t kH2Headers = 0x1;
+constexpr uint8_t kH2RstStream = 0x3;
+constexpr uint8_t kH2Settings = 0x4;
+constexpr uint8_t kH2Ping = 0x6;
+constexpr uint8_t kH2GoAway = 0x7;
+constexpr uint8_t kH2WindowUpdate = 0x8;
+
+constexpr uint8_t kH2EndStream = 0x1;
+constexpr uint8_t kH2Ack = 0x1;
+constexpr uint8_t kH2EndHeaders = 0x4;
+constexpr uint8_t kH2Padded = 0x8;
+constexpr uint8_t kH2Priority = 0x20;
+
+constexpr size_t kH2MaxFrame = 16384;
+constexpr uint32_t kH2Window = 1u << 30;
+
+// HPACK static table entries 8..14 are :status values
+constexpr int kStaticStatus[] = {200, 204, 206, 304, 400, 404, 500};
+
+void PutUint32(std::string& out, uint32_t value) {
+  out.push_back(static_cast<char>((value >> 24) & 0xff));
+  out.push_back(static_cast<char>((value >> 16) & 0xff));
+  out.push_back(static_cast<char>((value >> 8) & 0xff));
+  out.push_back(static_cast<char>(value & 0xff));
+}
+
+uint32_t GetUint32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void PutSetting(std::string& out, uint16_t id, uint32_t value) {
+  out.push_back(static_cast<char>(id >> 8));
+  out.push_back(static_cast<char>(id & 0xff));
+  PutUint32(out, value);
+}
+
+void HpackInt(std::string& out, uint8_t first, int prefix, uint64_t value) {
+  uint64_t max = (1u << prefix) - 1;
+  if (value < max) {
+    out.push_back(static_cast<char>(first | value));
+    return;
+  }
+  out.push_back(static_cast<char>(first | max));
+  value -= max;
+  while (value >= 128) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Literal without indexing, name from the static table, raw value
+void HpackLiteral(std::string& out, uint64_t name_index,
+                  std::string_view value) {
+  HpackInt(out, 0x00, 4, name_index);
+  HpackInt(out, 0x00, 7, value.size());
+  out.append(value.data(), value.size());
+}
+
+bool HpackReadInt(const uint8_t*& p, const uint8_t* end, int prefix,
+                  uint64_t& value) {
+  if (p >= end)
+    return false;
+  uint64_t max = (1u << prefix) - 1;
+  value = *p++ & max;
+  if (value < max)
+    return true;
+  for (int shift = 0; p < end && shift < 56; shift += 7) {
+    uint8_t byte = *p++;
+    value += static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Huffman code of '0'..'9' (RFC 7541 appendix B), 0 on anything else
+int HuffmanStatus(const uint8_t* p, size_t size) {
+  int status = 0;
+  size_t bits = size * 8;
+  size_t pos = 0;
+  auto bit = [&](size_t i) { return (p[i / 8] >> (7 - i % 8)) & 1; };
+  auto peek = [&](size_t count) {
+    int value = 0;
+    for (size_t i = 0; i < count; ++i)
+      value = (value << 1) | bit(pos + i);
+    return value;
+  };
+
+  while (bits - pos >= 5) {
+    int code = peek(5);
+    if (code <= 0x2) {
+      status = status * 10 + code;
+      pos += 5;
+      continue;
+    }
+    if (bits - pos >= 6) {
+      code = peek(6);
+      if (code >= 0x19 && code <= 0x1f) {
+        status = status * 10 + code - 0x19 + 3;
+        pos += 6;
+        continue;
+      }
+    }
+    break;
+  }
+  // Whatever is left must be EOS padding
+  for (; pos < bits; ++pos) {
+    if (!bit(pos))
+      return 0;
+  }
+  return status;
+}
+
+// :status of a response header block, 0 when it can't be told
+int HpackStatus(const uint8_t* p, const uint8_t* end) {
+  while (p < end) {
+    uint64_t index = 0;
+    if (*p & 0x80) {
+      if (!HpackReadInt(p, end, 7, index))
+        return 0;
+      return index >= 8 && index <= 14 ? kStaticStatus[index - 8] : 0;
+    }
+    if ((*p & 0xe0) == 0x20) {
+      // Dynamic table size update
+      if (!HpackReadInt(p, end, 5, index))
+        return 0;
+      continue;
+    }
+
+    int prefix = (*p & 0xc0) == 0x40 ? 6 : 4;
+    if (!HpackReadInt(p, end, prefix, index) || index < 8 || index > 14 ||
+        p >= end)
+      return 0;
+    bool huffman = (*p & 0x80) != 0;
+    uint64_t size = 0;
+    if (!HpackReadInt(p, end, 7, size) ||
+        size > static_cast<uint64_t>(end - p))
+      return 0;
+    if (huffman)
+      return HuffmanStatus(p, size);
+    int status = 0;
+    for (uint64_t i = 0; i < size; ++i) {
+      if (p[i] < '0' || p[i] > '9')
+        return 0;
+      status = status * 10 + (p[i] - '0');
+    }
+    return status;
+  }
+  return 0;
+}
+
+bool HeaderIs(std::string_view line, std::string_view name) {
+  return line.size() > name.size() && line[name.size()] == ':' &&
+         strncasecmp(line.data(), name.data(), name.size()) == 0;
+}
+
+std::string_view HeaderValue(std::string_view line) {
+  auto value = line.substr(line.find(':') + 1);
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    value.remove_prefix(1);
+  return value;
+}
+
+}  // namespace
+
+const char* ProtocolName(Protocol protocol) {
+  return protocol == Protocol::kHttp2 ? "h2" : "http/1.1";
+}
+
+std::unique_ptr<ClientConnection> ClientConnection::Connect(
+    Protocol protocol, const std::string& host, int port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+    throw std::runtime_error("Invalid bench host: " + host);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    throw std::runtime_error("Failed to create client socket");
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+      0) {
+    close(fd);
+    throw std::runtime_error("Failed to connect to " + host + ":" +
+                             std::to_string(port));
+  }
+
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  auto authority = host + ":" + std::to_string(port);
+  if (protocol == Protocol::kHttp2)
+    return std::make_unique<Http2Connection>(fd, std::move(authority));
+  return std::make_unique<Http1Connection>(fd, std::move(authority));
+}
+
+ClientConnection::ClientConnection(int fd, std::string authority)
+                : fd_(fd),
+                  authority_(std::move(authority)),
+                  out_(),
+                  written_(0),
+                  in_(),
+                  outstanding_(0) {}
+
+ClientConnection::~ClientConnection() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+bool ClientConnection::Flush() {
+  while (written_ < out_.size()) {
+    ssize_t sent = send(fd_, out_.data() + written_, out_.size() - written_,
+                        MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    written_ += static_cast<size_t>(sent);
+  }
+  out_.clear();
+  written_ = 0;
+  return true;
+}
+
+bool ClientConnection::Receive(const OnResponse& on_response) {
+  char buffer[64 * 1024];
+  while (true) {
+    ssize_t size = recv(fd_, buffer, sizeof(buffer), 0);
+    if (size > 0) {
+      in_.append(buffer, static_cast<size_t>(size));
+      if (static_cast<size_t>(size) < sizeof(buffer))
+        break;
+      continue;
+    }
+    if (size == 0)
+      return false;
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+    return false;
+  }
+  return Parse(on_response);
+}
+
+Http1Connection::Http1Connection(int fd, std::string authority)
+                : ClientConnection(fd, std::move(authority)), started_() {}
+
+void Http1Connection::Send(const BenchRequest& request, uint64_t started_ns) {
+  out_ += request.method;
+  out_ += ' ';
+  out_ += request.path;
+  out_ += " HTTP/1.1\r\nHost: ";
+  out_ += authority_;
+  out_ += "\r\n";
+  if (!request.body.empty() || request.method == "POST") {
+    if (!request.content_type.empty()) {
+      out_ += "Content-Type: ";
+      out_ += request.content_type;
+      out_ += "\r\n";
+    }
+    out_ += "Content-Length: ";
+    out_ += std::to_string(request.body.size());
+    out_ += "\r\n";
+  }
+  out_ += "\r\n";
+  out_ += request.body;
+
+  started_.push_back(started_ns);
+  ++outstanding_;
+}
+
+bool Http1Connection::Parse(const OnResponse& on_response) {
+  size_t pos = 0;
+  while (pos < in_.size() && !started_.empty()) {
+    std::string_view view(in_.data() + pos, in_.size() - pos);
+    size_t header_end = view.find("\r\n\r\n");
+    if (header_end == std::string_view::npos) {
+      if (view.size() > kMaxHeaderSize)
+        return false;
+      break;
+    }
+    if (view.size() < 12 || view.compare(0, 5, "HTTP/") != 0)
+      return false;
+
+    int status = 0;
+    for (size_t i = 9; i < 12; ++i) {
+      if (view[i] < '0' || view[i] > '9')
+        return false;
+      status = status * 10 + (view[i] - '0');
+    }
+
+    bool chunked = false;
+    bool has_length = false;
+    size_t length = 0;
+    size_t line_start = view.find("\r\n") + 2;
+    while (line_start < header_end) {
+      size_t line_end = view.find("\r\n", line_start);
+      auto line = view.substr(line_start, line_end - line_start);
+      if (HeaderIs(line, "content-length")) {
+        has_length = true;
+        length = std::stoul(std::string(HeaderValue(line)));
+      } else if (HeaderIs(line, "transfer-encoding")) {
+        chunked = HeaderValue(line).find("chunked") != std::string_view::npos;
+      }
+      line_start = line_end + 2;
+    }
+
+    size_t end = header_end + 4;
+    if (chunked) {
+      // Size line, data and CRLF per chunk, trailers are not expected
+      bool complete = false;
+      while (true) {
+        size_t size_end = view.find("\r\n", end);
+        if (size_end == std::string_view::npos)
+          break;
+        size_t size =
+            std::stoul(std::string(view.substr(end, size_end - end)), nullptr,
+                       16);
+        if (view.size() < size_end + 2 + size + 2)
+          break;
+        end = size_end + 2 + size + 2;
+        if (size == 0) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete)
+        break;
+    } else if (has_length) {
+      if (view.size() < end + length)
+        break;
+      end += length;
+    } else if (status >= 200 && status != 204 && status != 304) {
+      // Close delimited body, can't be kept alive
+      return false;
+    }
+
+    pos += end;
+    if (status < 200)
+      continue;
+    auto started = started_.front();
+    started_.pop_front();
+    --outstanding_;
+    on_response(status, started);
+  }
+
+  in_.erase(0, pos);
+  return true;
+}
+
+Http2Connection::Http2Connection(int fd, std::string authority)
+                : ClientConnection(fd, std::move(authority)),
+                  next_stream_(1),
+                  streams_(),
+                  unacked_(0) {
+  out_ = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+  std::string settings;
+  // No dynamic HPACK table, push off, large stream windows
+  PutSetting(settings, 0x1, 0);
+  PutSetting(settings, 0x2, 0);
+  PutSetting(settings, 0x4, kH2Window);
+  Frame(kH2Settings, 0, 0, settings.data(), settings.size());
+
+  std::string increment;
+  PutUint32(increment, kH2Window - 65535);
+  Frame(kH2WindowUpdate, 0, 0, increment.data(), increment.size());
+}
+
+void Http2Connection::Frame(uint8_t type, uint8_t flags, uint32_t stream,
+                            const char* payload, size_t size) {
+  out_.push_back(static_cast<char>((size >> 16) & 0xff));
+  out_.push_back(static_cast<char>((size >> 8) & 0xff));
+  out_.push_back(static_cast<char>(size & 0xff));
+  out_.push_back(static_cast<char>(type));
+  out_.push_back(static_cast<char>(flags));
+  PutUint32(out_, stream & 0x7fffffff);
+  if (size)
+    out_.append(payload, size);
+}
+
+void Http2Connection::Send(const BenchRequest& request, uint64_t started_ns) {
+  std::string block;
+  if (request.method == "GET")
+    block.push_back(static_cast<char>(0x82));
+  else if (request.method == "POST")
+    block.push_back(static_cast<char>(0x83));
+  else
+    HpackLiteral(block, 2, request.method);
+  block.push_back(static_cast<char>(0x86));  // :scheme http
+  if (request.path == "/")
+    block.push_back(static_cast<char>(0x84));
+  else
+    HpackLiteral(block, 4, request.path);
+  HpackLiteral(block, 1, authority_);
+
+  bool has_body = !request.body.empty() || request.method == "POST";
+  if (has_body) {
+    if (!request.content_type.empty())
+      HpackLiteral(block, 31, request.content_type);
+    HpackLiteral(block, 28, std::to_string(request.body.size()));
+  }
+
+  uint32_t stream = next_stream_;
+  next_stream_ += 2;
+  Frame(kH2Headers, kH2EndHeaders | (has_body ? 0 : kH2EndStream), stream,
+        block.data(), block.size());
+  if (has_body) {
+    size_t offset = 0;
+    do {
+      size_t size = std::min(kH2MaxFrame, request.body.size() - offset);
+      bool last = offset + size == request.body.size();
+      Frame(kH2Data, last ? kH2EndStream : 0, stream,
+            request.body.data() + offset, size);
+      offset += size;
+    } while (offset < request.body.size());
+  }
+
+  streams_[stream] = Stream{started_ns, 0};
+  ++outstanding_;
+}
+
+void Http2Connection::Complete(uint32_t stream,
+                               const OnResponse& on_response) {
+  auto it = streams_.find(stream);
+  if (it == streams_.end())
+    return;
+  auto done = it->second;
+  streams_.erase(it);
+  --outstanding_;
+  on_response(done.status, done.started_ns);
+}
+
+bool Http2Connection::Parse(const OnResponse& on_response) {
+  size_t pos = 0;
+  while (in_.size() - pos >= 9) {
+    auto header = reinterpret_cast<const uint8_t*>(in_.data() + pos);
+    size_t length = (static_cast<size_t>(header[0]) << 16) |
+                    (static_cast<size_t>(header[1]) << 8) | header[2];
+    if (in_.size() - pos < 9 + length)
+      break;
+    uint8_t type = header[3];
+    uint8_t flags = header[4];
+    uint32_t stream = GetUint32(header + 5) & 0x7fffffff;
+    const uint8_t* payload = header + 9;
+    pos += 9 + length;
+
+    switch (type) {
+      case kH2Data:
+        unacked_ += static_cast<uint32_t>(length);
+        if (unacked_ >= (1u << 20)) {
+          std::string increment;
+          PutUint32(increment, unacked_);
+          Frame(kH2WindowUpdate, 0, 0, increment.data(), increment.size());
+          unacked_ = 0;
+        }
+        if (flags & kH2EndStream)
+          Complete(stream, on_response);
+        break;
+      case kH2Headers: {
+        const uint8_t* block = payload;
+        const uint8_t* end = payload + length;
+        if (flags & kH2Padded) {
+          if (length < 1 || block[0] >= length)
+            return false;
+          end -= block[0];
+          block += 1;
+        }
+        if (flags & kH2Priority)
+          block += 5;
+        auto it = streams_.find(stream);
+        if (block <= end && it != streams_.end() && it->second.status == 0)
+          it->second.status = HpackStatus(block, end);
+        if (flags & kH2EndStream)
+          Complete(stream, on_response);
+        break;
+      }
+      case kH2RstStream: {
+        auto it = streams_.find(stream);
+        if (it != streams_.end())
+          it->second.status = 0;
+        Complete(stream, on_response);
+        break;
+      }
+      case kH2Settings:
+        if ((flags & kH2Ack) == 0)
+          Frame(kH2Settings, kH2Ack, 0, nullptr, 0);
+        break;
+      case kH2Ping:
+        if ((flags & kH2Ack) == 0 && length == 8)
+          Frame(kH2Ping, kH2Ack, 0, reinterpret_cast<const char*>(payload),
+                8);
+        break;
+      case kH2GoAway:
+        return false;
+      default:
+        break;
+    }
+  }
+
+  in_.erase(0, pos);
+  return true;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(bench)
+
+enum class Protocol : char { kHttp1, kHttp2 };
+
+const char* ProtocolName(Protocol protocol);
+
+// One request of a scenario, encoded by the connection protocol.
+struct BenchRequest {
+  std::string method = "GET";
+  std::string path = "/";
+  std::string content_type;
+  std::string body;
+};
+
+// Status 0 when the response couldn't be read (reset stream, bad framing).
+using OnResponse = std::function<void(int status, uint64_t started_ns)>;
+
+/// @brief Non-blocking client connection of the load generator, driven
+/// by the poll loop of its thread. Requests are queued with their start
+/// time and written on Flush; HTTP/1.1 pipelines them, h2 multiplexes
+/// them as concurrent streams.
+class ClientConnection {
+ public:
+  static std::unique_ptr<ClientConnection> Connect(Protocol protocol,
+                                                   const std::string& host,
+                                                   int port);
+
+  virtual ~ClientConnection();
+
+  ClientConnection(const ClientConnection&) = delete;
+  ClientConnection& operator=(const ClientConnection&) = delete;
+
+  int Fd() const {
+    return fd_;
+  }
+
+  size_t Outstanding() const {
+    return outstanding_;
+  }
+
+  bool WantWrite() const {
+    return written_ < out_.size();
+  }
+
+  virtual void Send(const BenchRequest& request, uint64_t started_ns) = 0;
+
+  // Write what the socket takes, false on error.
+  bool Flush();
+  // Read what's there, on_response once per complete response. False
+  // when the connection is gone, outstanding requests are then lost.
+  bool Receive(const OnResponse& on_response);
+
+ protected:
+  ClientConnection(int fd, std::string authority);
+
+  int fd_;
+  std::string authority_;
+  std::string out_;
+  size_t written_;
+  std::string in_;
+  size_t outstanding_;
+
+  // Consume complete responses from in_, false on a protocol error.
+  virtual bool Parse(const OnResponse& on_response) = 0;
+};
+
+/// @brief HTTP/1.1 keep-alive, pipelined when more than one request is
+/// outstanding. Responses come back in order.
+class Http1Connection : public ClientConnection {
+ public:
+  Http1Connection(int fd, std::string authority);
+
+  void Send(const BenchRequest& request, uint64_t started_ns) override;
+
+ private:
+  std::deque<uint64_t> started_;
+
+  bool Parse(const OnResponse& on_response) override;
+};
+
+/// @brief Cleartext HTTP/2 with prior knowledge, one stream per request.
+/// The peer is asked for a zero HPACK table so only :status is decoded.
+class Http2Connection : public ClientConnection {
+ public:
+  Http2Connection(int fd, std::string authority);
+
+  void Send(const BenchRequest& request, uint64_t started_ns) override;
+
+ private:
+  struct Stream {
+    uint64_t started_ns;
+    int status;
+  };
+
+  uint32_t next_stream_;
+  std::unordered_map<uint32_t, Stream> streams_;
+  // DATA bytes not given back with WINDOW_UPDATE yet
+  uint32_t unacked_;
+
+  bool Parse(const OnResponse& on_response) override;
+  void Frame(uint8_t type, uint8_t flags, uint32_t stream,
+             const char* payload, size_t size);
+  void Complete(uint32_t stream, const OnResponse& on_response);
+};
+
+PICONAUT_INNER_END_NAMESPACE
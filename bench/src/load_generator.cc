@@ -0,0 +1,275 @@
+#include "load_generator.h"
+
+#include <poll.h>
+#include <time.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(bench)
+
+namespace {
+
+// h2o default SETTINGS_MAX_CONCURRENT_STREAMS
+constexpr size_t kMaxH2Streams = 100;
+// Longest poll, the loop re-checks the clock at least this often
+constexpr uint64_t kMaxPollNs = 50000000;
+
+using Connections = std::vector<std::unique_ptr<ClientConnection>>;
+
+uint64_t NowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+uint64_t ToNs(std::chrono::milliseconds duration) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+struct WorkerResult {
+  WorkerResult() : latency(new metrics::LatencyHistogram()) {}
+
+  std::unique_ptr<metrics::LatencyHistogram> latency;
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  uint64_t unsent = 0;
+  uint64_t lost = 0;
+  std::map<int, uint64_t> statuses;
+};
+
+// Poll loop of one generator thread over its connections.
+class Worker {
+ public:
+  Worker(const LoadOptions& options, const Scenario& scenario, size_t index,
+         Connections connections, uint64_t start_ns, WorkerResult& result)
+                  : options_(options),
+                    scenario_(scenario),
+                    connections_(std::move(connections)),
+                    result_(result),
+                    depth_(std::max<size_t>(options.depth, 1)),
+                    measure_ns_(start_ns + ToNs(options.warmup)),
+                    end_ns_(measure_ns_ + ToNs(options.duration)),
+                    drain_ns_(end_ns_ + ToNs(options.drain)),
+                    interval_ns_(0),
+                    next_send_ns_(start_ns),
+                    next_request_(index),
+                    backlog_() {
+    if (options.protocol == Protocol::kHttp2)
+      depth_ = std::min(depth_, kMaxH2Streams);
+    if (options.mode == LoadMode::kOpen) {
+      double rate = options.rate / std::max<size_t>(options.threads, 1);
+      interval_ns_ = static_cast<uint64_t>(1e9 / std::max(rate, 1e-3));
+      // Threads don't fire in the same instant
+      next_send_ns_ += interval_ns_ * index / std::max<size_t>(options.threads, 1);
+    }
+  }
+
+  void Run();
+
+ private:
+  const LoadOptions& options_;
+  const Scenario& scenario_;
+  Connections connections_;
+  WorkerResult& result_;
+  size_t depth_;
+  uint64_t measure_ns_;
+  uint64_t end_ns_;
+  uint64_t drain_ns_;
+  uint64_t interval_ns_;
+  uint64_t next_send_ns_;
+  size_t next_request_;
+  // Open loop: scheduled start times waiting for a free connection
+  std::deque<uint64_t> backlog_;
+
+  void Fill(uint64_t now);
+  void Record(int status, uint64_t started_ns);
+  void Drop(std::unique_ptr<ClientConnection>& connection);
+  size_t Outstanding() const;
+  uint64_t PollTimeout(uint64_t now) const;
+};
+
+void Worker::Record(int status, uint64_t started_ns) {
+  // Warm-up and drained-late requests are answered but not measured
+  if (started_ns < measure_ns_ || started_ns >= end_ns_)
+    return;
+  result_.latency->Record((NowNs() - started_ns) / 1000);
+  ++result_.requests;
+  ++result_.statuses[status];
+  if (status == 0 || status >= 400)
+    ++result_.errors;
+}
+
+void Worker::Drop(std::unique_ptr<ClientConnection>& connection) {
+  result_.lost += connection->Outstanding();
+  connection.reset();
+}
+
+size_t Worker::Outstanding() const {
+  size_t outstanding = 0;
+  for (const auto& connection : connections_) {
+    if (connection)
+      outstanding += connection->Outstanding();
+  }
+  return outstanding;
+}
+
+void Worker::Fill(uint64_t now) {
+  bool open = options_.mode == LoadMode::kOpen;
+  if (open) {
+    while (next_send_ns_ <= now) {
+      backlog_.push_back(next_send_ns_);
+      next_send_ns_ += interval_ns_;
+    }
+  }
+
+  const auto& requests = scenario_.requests;
+  for (auto& connection : connections_) {
+    if (!connection)
+      continue;
+    while (connection->Outstanding() < depth_) {
+      uint64_t started = now;
+      if (open) {
+        if (backlog_.empty())
+          return;
+        started = backlog_.front();
+        backlog_.pop_front();
+      }
+      connection->Send(requests[next_request_++ % requests.size()], started);
+    }
+  }
+}
+
+uint64_t Worker::PollTimeout(uint64_t now) const {
+  uint64_t until = now < end_ns_ ? end_ns_ : drain_ns_;
+  // Open loop wakes up for the next scheduled request, unless every
+  // connection is full and it would only grow the backlog
+  if (options_.mode == LoadMode::kOpen && now < end_ns_ && backlog_.empty())
+    until = std::min(until, next_send_ns_);
+  return until > now ? std::min(until - now, kMaxPollNs) : 0;
+}
+
+void Worker::Run() {
+  auto on_response = [this](int status, uint64_t started_ns) {
+    Record(status, started_ns);
+  };
+  std::vector<struct pollfd> fds(connections_.size());
+
+  while (true) {
+    auto now = NowNs();
+    if (now < end_ns_) {
+      Fill(now);
+    } else {
+      for (auto scheduled : backlog_) {
+        if (scheduled >= measure_ns_)
+          ++result_.unsent;
+      }
+      backlog_.clear();
+      if (Outstanding() == 0)
+        break;
+      if (now >= drain_ns_) {
+        result_.lost += Outstanding();
+        break;
+      }
+    }
+
+    size_t alive = 0;
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      auto& connection = connections_[i];
+      if (connection && connection->WantWrite() && !connection->Flush())
+        Drop(connection);
+      fds[i].fd = connection ? connection->Fd() : -1;
+      fds[i].events = static_cast<short>(
+          POLLIN | (connection && connection->WantWrite() ? POLLOUT : 0));
+      fds[i].revents = 0;
+      alive += connection ? 1 : 0;
+    }
+    if (alive == 0)
+      break;
+
+    auto timeout_ns = PollTimeout(now);
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(timeout_ns / 1000000000);
+    timeout.tv_nsec = static_cast<long>(timeout_ns % 1000000000);
+    if (ppoll(fds.data(), fds.size(), &timeout, nullptr) <= 0)
+      continue;
+
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      auto& connection = connections_[i];
+      if (!connection || !(fds[i].revents & (POLLIN | POLLERR | POLLHUP)))
+        continue;
+      bool ok = false;
+      try {
+        ok = connection->Receive(on_response);
+      } catch (const std::exception&) {
+        // Malformed response framing
+      }
+      if (!ok)
+        Drop(connection);
+    }
+  }
+}
+
+}  // namespace
+
+const char* LoadModeName(LoadMode mode) {
+  return mode == LoadMode::kOpen ? "open" : "closed";
+}
+
+LoadGenerator::LoadGenerator(LoadOptions options)
+                : options_(std::move(options)) {
+  options_.connections = std::max<size_t>(options_.connections, 1);
+  options_.threads =
+      std::clamp<size_t>(options_.threads, 1, options_.connections);
+}
+
+LoadResult LoadGenerator::Run(const Scenario& scenario) const {
+  if (scenario.requests.empty())
+    throw std::invalid_argument("Scenario without requests: " + scenario.name);
+
+  // Connect everything before the clock starts
+  std::vector<Connections> connections(options_.threads);
+  for (size_t i = 0; i < options_.connections; ++i) {
+    connections[i % options_.threads].push_back(ClientConnection::Connect(
+        options_.protocol, options_.host, options_.port));
+  }
+
+  std::vector<WorkerResult> results(options_.threads);
+  std::vector<std::thread> threads;
+  auto start = NowNs();
+  for (size_t i = 0; i < options_.threads; ++i) {
+    threads.emplace_back(
+        [this, &scenario, &connections, &results, start, i]() {
+          Worker worker(options_, scenario, i, std::move(connections[i]),
+                        start, results[i]);
+          worker.Run();
+        });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  LoadResult result;
+  for (const auto& worker : results) {
+    result.latency.Merge(*worker.latency);
+    result.requests += worker.requests;
+    result.errors += worker.errors;
+    result.unsent += worker.unsent;
+    result.lost += worker.lost;
+    for (const auto& status : worker.statuses)
+      result.statuses[status.first] += status.second;
+  }
+  result.seconds =
+      std::chrono::duration<double>(options_.duration).count();
+  if (result.seconds > 0)
+    result.rps = static_cast<double>(result.requests) / result.seconds;
+  return result;
+}
+
+PICONAUT_INNER_END_NAMESPACE
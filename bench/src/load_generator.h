@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "client_connection.h"
+#include "piconaut/macro.h"
+#include "piconaut/metrics/latency_histogram.h"
+
+PICONAUT_INNER_NAMESPACE(bench)
+
+enum class LoadMode : char {
+  // Every connection keeps `depth` requests in flight
+  kClosed,
+  // Requests are scheduled at a constant rate whatever the server does,
+  // latency counts from the scheduled time (no coordinated omission)
+  kOpen
+};
+
+const char* LoadModeName(LoadMode mode);
+
+struct LoadOptions {
+  std::string host = "127.0.0.1";
+  int port = 18080;
+  Protocol protocol = Protocol::kHttp1;
+  LoadMode mode = LoadMode::kClosed;
+  size_t threads = 2;
+  // Total, spread over the threads
+  size_t connections = 16;
+  // Requests in flight per connection: pipeline depth for HTTP/1.1,
+  // concurrent streams for h2
+  size_t depth = 1;
+  // Open loop only, requests per second over all threads
+  double rate = 10000;
+  std::chrono::milliseconds warmup{1000};
+  std::chrono::milliseconds duration{5000};
+  // How long requests still in flight at the end are waited for
+  std::chrono::milliseconds drain{2000};
+};
+
+// Fixed request mix, sent round robin.
+struct Scenario {
+  std::string name;
+  std::vector<BenchRequest> requests;
+};
+
+struct LoadResult {
+  // Requests started during the measured window and answered
+  uint64_t requests = 0;
+  // Answered with status 0 or >= 400
+  uint64_t errors = 0;
+  // Open loop: scheduled but never sent, the server fell behind
+  uint64_t unsent = 0;
+  // In flight when a connection failed or when draining gave up
+  uint64_t lost = 0;
+  std::map<int, uint64_t> statuses;
+  metrics::HistogramSnapshot latency;
+  double seconds = 0;
+  double rps = 0;
+};
+
+/// @brief Multi-threaded HTTP load generator. Each thread drives its
+/// share of the connections from one poll loop; results are recorded
+/// per thread and merged at the end. Latency is measured in
+/// microseconds with the same HDR histogram as the server metrics.
+class LoadGenerator {
+ public:
+  explicit LoadGenerator(LoadOptions options);
+
+  // Connect, warm up, measure for `duration`, then drain.
+  LoadResult Run(const Scenario& scenario) const;
+
+  const LoadOptions& Options() const {
+    return options_;
+  }
+
+ private:
+  LoadOptions options_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,74 @@
+#include "report.h"
+
+#include <thread>
+
+#include "piconaut/formats/json/json_writer.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(bench)
+
+namespace {
+
+void WriteOptions(formats::json::JsonWriter& json,
+                  const LoadOptions& options) {
+  json.Key("config")
+      .Object()
+      .Member("protocol", ProtocolName(options.protocol))
+      .Member("mode", LoadModeName(options.mode))
+      .Member("threads", static_cast<uint64_t>(options.threads))
+      .Member("connections", static_cast<uint64_t>(options.connections))
+      .Member("depth", static_cast<uint64_t>(options.depth));
+  if (options.mode == LoadMode::kOpen)
+    json.Member("rate", options.rate);
+  json.Member("warmup_ms", static_cast<int64_t>(options.warmup.count()))
+      .Member("duration_ms", static_cast<int64_t>(options.duration.count()))
+      .EndObject();
+}
+
+void WriteResult(formats::json::JsonWriter& json, const LoadResult& result) {
+  const auto& latency = result.latency;
+  json.Member("requests", result.requests)
+      .Member("errors", result.errors)
+      .Member("unsent", result.unsent)
+      .Member("lost", result.lost)
+      .Member("seconds", result.seconds)
+      .Member("rps", result.rps);
+
+  json.Key("latency_us").Object();
+  if (latency.Total() > 0) {
+    json.Member("mean", latency.SumMicros() / latency.Total())
+        .Member("p50", latency.ValueAtQuantile(0.5))
+        .Member("p90", latency.ValueAtQuantile(0.9))
+        .Member("p99", latency.ValueAtQuantile(0.99))
+        .Member("p999", latency.ValueAtQuantile(0.999))
+        .Member("max", latency.ValueAtQuantile(1.0));
+  }
+  json.EndObject();
+
+  json.Key("statuses").Object();
+  for (const auto& status : result.statuses)
+    json.Member(std::to_string(status.first), status.second);
+  json.EndObject();
+}
+
+}  // namespace
+
+std::string JsonReport(const std::vector<RunReport>& runs) {
+  formats::json::JsonWriter json;
+  json.Object()
+      .Member("generator", "piconaut-bench")
+      .Member("hardware_threads",
+              static_cast<uint64_t>(std::thread::hardware_concurrency()))
+      .Key("runs")
+      .Array();
+  for (const auto& run : runs) {
+    json.Object().Member("scenario", run.scenario);
+    WriteOptions(json, run.options);
+    WriteResult(json, run.result);
+    json.EndObject();
+  }
+  json.EndArray().EndObject();
+  return json.Finish().ToString();
+}
+
+PICONAUT_INNER_END_NAMESPACE
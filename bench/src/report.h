@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "load_generator.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(bench)
+
+// One scenario run with the options it ran with.
+struct RunReport {
+  std::string scenario;
+  LoadOptions options;
+  LoadResult result;
+};
+
+/// @brief Machine readable report of a bench session: one entry per run
+/// with its configuration, RPS, error counts, status codes and latency
+/// percentiles (p50, p90, p99, p999, max) in microseconds.
+std::string JsonReport(const std::vector<RunReport>& runs);
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,166 @@
+#include "scenarios.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "piconaut/formats/json/json_writer.h"
+#include "piconaut/formats/json/value.h"
+#include "piconaut/handlers/handler_base.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(bench)
+
+namespace {
+
+using Params = std::unordered_map<std::string, std::string>;
+
+constexpr size_t kUserIds = 64;
+constexpr int kJsonItems = 20;
+constexpr int kOrderItems = 8;
+
+class StaticHandler : public handlers::HandlerBase {
+ public:
+  StaticHandler()
+                  : body_(std::make_shared<const std::string>(
+                        "Hello from piconaut bench\n")) {}
+
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const Params& params) const override {
+    res.Send(body_, "text/plain");
+  }
+
+ private:
+  std::shared_ptr<const std::string> body_;
+};
+
+class UserHandler : public handlers::HandlerBase {
+ public:
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const Params& params) const override {
+    auto it = params.find("id");
+    if (it == params.end()) {
+      res.Send(std::string("missing id"), 400);
+      return;
+    }
+    formats::json::JsonWriter json;
+    json.Object()
+        .Member("id", it->second)
+        .Member("name", "user-" + it->second)
+        .Member("active", true)
+        .EndObject();
+    res.SendJson(json.Finish());
+  }
+};
+
+class ListHandler : public handlers::HandlerBase {
+ public:
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const Params& params) const override {
+    formats::json::JsonWriter json;
+    json.Object().Key("items").Array();
+    for (int i = 0; i < kJsonItems; ++i) {
+      json.Object()
+          .Member("id", i)
+          .Member("sku", "SKU-" + std::to_string(1000 + i))
+          .Member("price", 9.99 + i)
+          .Member("in_stock", i % 3 != 0)
+          .EndObject();
+    }
+    json.EndArray().Member("count", kJsonItems).EndObject();
+    res.SendJson(json.Finish());
+  }
+};
+
+class OrderHandler : public handlers::HandlerBase {
+ public:
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const Params& params) const override {
+    static const formats::json::Path kOrderId("/order_id");
+    static const formats::json::Path kCustomer("/customer/name");
+    static const formats::json::Path kTotal("/total");
+
+    // Malformed json throws ParseError, answered with 400
+    auto body = req.Json();
+    auto order_id = body.GetString(kOrderId);
+    auto customer = body.GetString(kCustomer);
+    if (!order_id || !customer) {
+      res.Send(std::string("missing order_id or customer"), 422);
+      return;
+    }
+
+    formats::json::JsonWriter json;
+    json.Object()
+        .Member("order_id", *order_id)
+        .Member("customer", *customer)
+        .Member("total", body.GetDouble(kTotal).value_or(0.0))
+        .Member("accepted", true)
+        .EndObject();
+    res.SendJson(json.Finish(), 201);
+  }
+};
+
+std::string OrderBody() {
+  formats::json::JsonWriter json;
+  json.Object()
+      .Member("order_id", "ord-000042")
+      .Key("customer")
+      .Object()
+      .Member("name", "Ada Lovelace")
+      .Member("email", "ada@example.com")
+      .EndObject()
+      .Key("items")
+      .Array();
+  double total = 0;
+  for (int i = 0; i < kOrderItems; ++i) {
+    double price = 4.5 + i;
+    total += price * (i + 1);
+    json.Object()
+        .Member("sku", "SKU-" + std::to_string(2000 + i))
+        .Member("quantity", i + 1)
+        .Member("price", price)
+        .EndObject();
+  }
+  json.EndArray()
+      .Member("total", total)
+      .Member("note", "leave at the door")
+      .EndObject();
+  return json.Finish().ToString();
+}
+
+}  // namespace
+
+void RegisterScenarioRoutes(http::H2OServer& server) {
+  server.RegisterHandler("/bench/static", std::make_shared<StaticHandler>());
+  server.RegisterHandler("/bench/users/{id}", std::make_shared<UserHandler>());
+  server.RegisterHandler("/bench/json", std::make_shared<ListHandler>());
+  server.RegisterHandler("/bench/orders", std::make_shared<OrderHandler>());
+}
+
+std::vector<Scenario> FixedScenarios() {
+  std::vector<Scenario> scenarios;
+
+  Scenario fixed{"static", {}};
+  fixed.requests.push_back(BenchRequest{"GET", "/bench/static", "", ""});
+  scenarios.push_back(std::move(fixed));
+
+  Scenario users{"params", {}};
+  for (size_t i = 0; i < kUserIds; ++i) {
+    users.requests.push_back(BenchRequest{
+        "GET", "/bench/users/" + std::to_string(1000 + i), "", ""});
+  }
+  scenarios.push_back(std::move(users));
+
+  Scenario list{"json", {}};
+  list.requests.push_back(BenchRequest{"GET", "/bench/json", "", ""});
+  scenarios.push_back(std::move(list));
+
+  Scenario orders{"post", {}};
+  orders.requests.push_back(
+      BenchRequest{"POST", "/bench/orders", "application/json", OrderBody()});
+  scenarios.push_back(std::move(orders));
+
+  return scenarios;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+#include "load_generator.h"
+#include "piconaut/http/http_single_server.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(bench)
+
+// Handlers behind the fixed scenarios, under /bench.
+void RegisterScenarioRoutes(http::H2OServer& server);
+
+/// @brief Fixed request mixes, identical from run to run so numbers of
+/// two releases compare:
+/// - static: GET of a constant text body
+/// - params: GET /bench/users/{id} over 64 ids, json echo of the id
+/// - json: GET of a 20 item json list serialized per request
+/// - post: POST of a ~600 byte json order, parsed and answered
+std::vector<Scenario> FixedScenarios();
+
+PICONAUT_INNER_END_NAMESPACE
@@ -34,7 +34,9 @@ class HelloWorldHandler : public handlers::HandlerBase {
     auto cache_control = req.GetHeader("cache-control");
     auto pragma = req.GetHeader("pragma");
 
-    formats::json::ValueBuilder json;
+    // Warm builder from the thread pool, returned when out of scope
+    auto pooled_json = formats::json::ValueBuilderPool::Acquire();
+    auto& json = pooled_json.Get();
     std::cout << "Path: " << req.GetPath() << std::endl;
 
     json["server"].CreateJsonObject();
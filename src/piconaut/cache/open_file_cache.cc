@@ -0,0 +1,238 @@
+#include "piconaut/cache/open_file_cache.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(cache)
+
+namespace {
+
+const uint32_t kWatchMask =
+    IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+
+}  // namespace
+
+OpenFile::OpenFile() : fd(-1), st(), content(), size(0) {}
+
+OpenFile::~OpenFile() {
+  if (fd != -1)
+    close(fd);
+}
+
+OpenFileCache::OpenFileCache(size_t capacity)
+                : capacity_(capacity ? capacity : 1),
+                  lru_(),
+                  index_(),
+                  watches_(),
+                  mutex_(),
+                  inotify_fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+                  running_(false) {
+  if (inotify_fd_ != -1) {
+    running_ = true;
+    watcher_ = std::thread(&OpenFileCache::WatchLoop, this);
+  } else {
+    perror("inotify unavailable, open file cache fallback to stat");
+  }
+}
+
+OpenFileCache::~OpenFileCache() {
+  running_ = false;
+  if (watcher_.joinable())
+    watcher_.join();
+
+  Clear();
+  if (inotify_fd_ != -1)
+    close(inotify_fd_);
+}
+
+OpenFilePtr OpenFileCache::Open(const std::string& path) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+      if (!IsStale(*it->second)) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->file;
+      }
+      EraseLocked(it->second);
+    }
+  }
+
+  // Watch before loading, a change while the file is read is not missed
+  int watch = -1;
+  uint64_t events = 0;
+  if (inotify_fd_ != -1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    watch = inotify_add_watch(inotify_fd_, path.c_str(), kWatchMask);
+    if (watch != -1) {
+      auto& watched = watches_[watch];
+      watched.paths.push_back(path);
+      events = watched.events;
+    }
+  }
+
+  // Open & read outside the lock, concurrent loader of the same path
+  // simply race and the last one wins.
+  auto file = Load(path);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!file || (watch != -1 && watches_[watch].events != events)) {
+    // Changed while loading, serve it this once without caching
+    UnwatchLocked(watch, path);
+    return file;
+  }
+
+  auto it = index_.find(path);
+  if (it != index_.end())
+    EraseLocked(it->second);
+
+  lru_.push_front(Entry{path, file, watch});
+  index_[path] = lru_.begin();
+
+  while (lru_.size() > capacity_) {
+    EraseLocked(std::prev(lru_.end()));
+  }
+
+  return file;
+}
+
+OpenFilePtr OpenFileCache::Load(const std::string& path) const {
+  auto file = std::make_shared<OpenFile>();
+
+  file->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file->fd == -1)
+    return nullptr;
+
+  if (fstat(file->fd, &file->st) != 0 || !S_ISREG(file->st.st_mode))
+    return nullptr;
+
+  file->size = static_cast<size_t>(file->st.st_size);
+  if (file->Inline()) {
+    file->content.resize(file->size);
+    size_t read_len = 0;
+    while (read_len < file->size) {
+      ssize_t len = pread(file->fd, &file->content[read_len],
+                          file->size - read_len, read_len);
+      if (len == -1 && errno == EINTR)
+        continue;
+      if (len <= 0)
+        break;
+      read_len += static_cast<size_t>(len);
+    }
+    // Truncated since fstat, keep what was read
+    file->content.resize(read_len);
+    file->size = read_len;
+  }
+
+  char buf[64];
+  snprintf(buf, sizeof(buf), "\"%08x-%zx\"",
+           static_cast<unsigned>(file->st.st_mtime), file->size);
+  file->etag = buf;
+
+  struct tm gmt;
+  gmtime_r(&file->st.st_mtime, &gmt);
+  strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+  file->last_modified = buf;
+
+  return file;
+}
+
+bool OpenFileCache::IsStale(const Entry& entry) const {
+  // inotify watcher already drop the modified entries
+  if (entry.watch != -1)
+    return false;
+
+  struct stat st;
+  if (stat(entry.path.c_str(), &st) != 0)
+    return true;
+
+  const auto& cached = entry.file->st;
+  return st.st_ino != cached.st_ino || st.st_dev != cached.st_dev ||
+         st.st_size != cached.st_size || st.st_mtime != cached.st_mtime;
+}
+
+void OpenFileCache::Invalidate(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(path);
+  if (it != index_.end())
+    EraseLocked(it->second);
+}
+
+void OpenFileCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!lru_.empty()) {
+    EraseLocked(lru_.begin());
+  }
+}
+
+void OpenFileCache::EraseLocked(std::list<Entry>::iterator it) {
+  UnwatchLocked(it->watch, it->path);
+  index_.erase(it->path);
+  lru_.erase(it);
+}
+
+// Drop one registration of the path, a loader of the same path may
+// hold another one.
+void OpenFileCache::UnwatchLocked(int watch, const std::string& path) {
+  if (watch == -1)
+    return;
+
+  auto watch_it = watches_.find(watch);
+  if (watch_it == watches_.end())
+    return;
+
+  auto& paths = watch_it->second.paths;
+  auto path_it = std::find(paths.begin(), paths.end(), path);
+  if (path_it != paths.end())
+    paths.erase(path_it);
+  if (paths.empty()) {
+    inotify_rm_watch(inotify_fd_, watch);
+    watches_.erase(watch_it);
+  }
+}
+
+void OpenFileCache::WatchLoop() {
+  alignas(struct inotify_event) char buf[4096];
+  struct pollfd pfd;
+  pfd.fd = inotify_fd_;
+  pfd.events = POLLIN;
+
+  while (running_) {
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 500) <= 0)
+      continue;
+
+    ssize_t len = read(inotify_fd_, buf, sizeof(buf));
+    if (len <= 0)
+      continue;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (char* ptr = buf; ptr < buf + len;) {
+      auto event = reinterpret_cast<struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + event->len;
+
+      auto watch_it = watches_.find(event->wd);
+      if (watch_it == watches_.end())
+        continue;
+
+      ++watch_it->second.events;
+      // Copy, EraseLocked mutate the watch list
+      auto paths = watch_it->second.paths;
+      for (const auto& path : paths) {
+        auto it = index_.find(path);
+        if (it != index_.end())
+          EraseLocked(it->second);
+      }
+    }
+  }
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "piconaut/macro.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(cache)
+
+/// @brief Opened file with the stat result.
+/// Small file content is read once at open; larger files are read with
+/// pread while sent, no mapping that would fault when the file shrinks.
+/// The fd is closed when the last reference is gone, in-flight responses
+/// keep their reference until h2o done sending.
+struct OpenFile {
+  int fd;
+  struct stat st;
+  // Whole content when size <= kMaxInlineSize, empty otherwise
+  std::string content;
+  size_t size;
+  std::string etag;
+  std::string last_modified;
+
+  OpenFile();
+  ~OpenFile();
+
+  OpenFile(const OpenFile&) = delete;
+  OpenFile& operator=(const OpenFile&) = delete;
+
+  bool Inline() const {
+    return size <= kMaxInlineSize;
+  }
+
+  static constexpr size_t kMaxInlineSize = 64 * 1024;
+};
+
+using OpenFilePtr = std::shared_ptr<const OpenFile>;
+
+/// @brief LRU cache of open file descriptors, stat result and small file
+/// content.
+/// Cached files are watched with inotify and dropped as soon as they are
+/// modified, moved or deleted. When inotify is not available,
+/// the entries are revalidated by stat() on every lookup.
+class OpenFileCache {
+ public:
+  explicit OpenFileCache(size_t capacity = 1024);
+  ~OpenFileCache();
+
+  OpenFileCache(const OpenFileCache&) = delete;
+  OpenFileCache& operator=(const OpenFileCache&) = delete;
+
+  // Return nullptr when the path is not a readable regular file
+  OpenFilePtr Open(const std::string& path);
+  void Invalidate(const std::string& path);
+  void Clear();
+
+ private:
+  struct Entry {
+    std::string path;
+    OpenFilePtr file;
+    int watch;
+  };
+
+  struct Watch {
+    std::vector<std::string> paths;
+    // inotify events seen, a load racing with a change is not cached
+    uint64_t events = 0;
+  };
+
+  size_t capacity_;
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  std::unordered_map<int, Watch> watches_;
+  std::mutex mutex_;
+  int inotify_fd_;
+  std::atomic<bool> running_;
+  std::thread watcher_;
+
+  OpenFilePtr Load(const std::string& path) const;
+  bool IsStale(const Entry& entry) const;
+  void EraseLocked(std::list<Entry>::iterator it);
+  void UnwatchLocked(int watch, const std::string& path);
+  void WatchLoop();
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,224 @@
+#include "piconaut/cache/response_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "piconaut/formats/format.h"
+#include "piconaut/http/compression.h"
+#include "piconaut/utils/hash.h"
+#include "piconaut/utils/worker.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(cache)
+
+namespace {
+
+std::shared_ptr<const std::string> GzipCompress(const std::string& body) {
+  // Compressed once per entry, worth the best level
+  auto& encoder = http::GzipEncoder::ThreadLocal();
+  if (!encoder.Begin(Z_BEST_COMPRESSION))
+    return nullptr;
+
+  auto out = std::make_shared<std::string>();
+  out->reserve(encoder.Bound(body.size()));
+  if (!encoder.Encode(body.data(), body.size(), true, *out))
+    return nullptr;
+  return out;
+}
+
+// Length prefixed, so parts can't run into each other
+void AppendKeyPart(std::string& text, const std::string& part) {
+  auto size = static_cast<uint32_t>(part.size());
+  text.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  text.append(part);
+}
+
+bool AcceptGzip(const http::Request& req) {
+  auto accept_encoding = req.GetHeader("accept-encoding");
+  return accept_encoding.find("gzip") != std::string::npos;
+}
+
+}  // namespace
+
+ResponseCache::ResponseCache(size_t shard_count, size_t max_entries_per_shard)
+                : policies_(),
+                  shards_(),
+                  max_entries_per_shard_(max_entries_per_shard) {
+  if (shard_count == 0)
+    shard_count = 1;
+
+  shards_.reserve(shard_count);
+  for (size_t i = 0; i < shard_count; ++i) {
+    shards_.emplace_back(std::make_unique<Shard>());
+  }
+}
+
+void ResponseCache::EnableRoute(size_t route_key, const CachePolicy& policy) {
+  policies_[route_key] = policy;
+}
+
+const CachePolicy* ResponseCache::Policy(size_t route_key) const {
+  auto it = policies_.find(route_key);
+  if (it == policies_.end())
+    return nullptr;
+  return &it->second;
+}
+
+CacheKey RequestKey(size_t route_key,
+                    const std::unordered_map<std::string, std::string>& params,
+                    const http::Request& req, bool include_query,
+                    const std::vector<std::string>& vary_headers) {
+  CacheKey key;
+  key.text.append(reinterpret_cast<const char*>(&route_key),
+                  sizeof(route_key));
+
+  // Normalize params order, unordered_map iteration order is not stable
+  std::vector<const std::pair<const std::string, std::string>*> sorted;
+  sorted.reserve(params.size());
+  for (const auto& p : params) {
+    sorted.push_back(&p);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<const std::string, std::string>* a,
+               const std::pair<const std::string, std::string>* b) {
+              return a->first < b->first;
+            });
+
+  for (auto p : sorted) {
+    AppendKeyPart(key.text, p->first);
+    AppendKeyPart(key.text, p->second);
+  }
+
+  if (include_query)
+    AppendKeyPart(key.text, req.GetQuery());
+
+  // Same route keyed once per negotiated body format
+  auto accept = req.GetHeader("accept");
+  auto format = formats::NegotiateFormat(accept.data(), accept.size());
+  key.text.push_back(static_cast<char>(format));
+
+  for (const auto& header : vary_headers) {
+    AppendKeyPart(key.text, req.GetHeader(header));
+  }
+
+  key.hash = utils::hash::Hash64(key.text);
+  return key;
+}
+
+CacheKey ResponseCache::MakeKey(
+    size_t route_key,
+    const std::unordered_map<std::string, std::string>& params,
+    const http::Request& req, const CachePolicy& policy) const {
+  return RequestKey(route_key, params, req, policy.include_query,
+                    policy.vary_headers);
+}
+
+ResponseCache::Shard& ResponseCache::WorkerShard() {
+  return *shards_[utils::WorkerSlot() % shards_.size()];
+}
+
+CachedResponsePtr ResponseCache::Find(const CacheKey& key) {
+  auto& shard = WorkerShard();
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end())
+    return nullptr;
+
+  auto node = it->second;
+  if (node->second->expire_at <= std::chrono::steady_clock::now()) {
+    Erase(shard, node);
+    return nullptr;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, node);
+  return node->second;
+}
+
+CachedResponsePtr ResponseCache::Store(const CacheKey& key,
+                                       const CachePolicy& policy,
+                                       http::ResponseCapture& capture) {
+  if (!capture.captured || !capture.cacheable)
+    return nullptr;
+
+  auto entry = std::make_shared<CachedResponse>();
+  entry->status = capture.status;
+  entry->content_type = std::move(capture.content_type);
+  entry->etag = std::move(capture.etag);
+  entry->headers = std::move(capture.headers);
+  auto body = std::make_shared<std::string>(std::move(capture.body));
+  if (policy.precompress) {
+    entry->gzip_body = GzipCompress(*body);
+    if (entry->gzip_body && !entry->etag.empty())
+      entry->gzip_etag = http::EncodingEtag(entry->etag, "gzip");
+  }
+  entry->body = std::move(body);
+  entry->expire_at = std::chrono::steady_clock::now() + policy.ttl;
+
+  auto& shard = WorkerShard();
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    it->second->second = entry;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return entry;
+  }
+
+  if (shard.entries.size() >= max_entries_per_shard_ && !shard.lru.empty())
+    Erase(shard, std::prev(shard.lru.end()));
+  shard.lru.emplace_front(key, entry);
+  shard.entries.emplace(key, shard.lru.begin());
+  return entry;
+}
+
+void ResponseCache::Erase(Shard& shard, LruList::iterator it) {
+  shard.entries.erase(it->first);
+  shard.lru.erase(it);
+}
+
+void ResponseCache::Serve(const CachedResponse& entry,
+                          const http::Request& req,
+                          const http::Response& res) {
+  // AddHeader copies into the request pool, the entry may be evicted
+  // before h2o is done with the response
+  for (const auto& header : entry.headers) {
+    res.AddHeader(header.first, header.second);
+  }
+
+  bool gzip = entry.gzip_body && AcceptGzip(req);
+  const auto& etag = gzip ? entry.gzip_etag : entry.etag;
+  if (!etag.empty()) {
+    res.AddHeader("etag", etag);
+
+    auto if_none_match = req.GetHeader("if-none-match");
+    if (!if_none_match.empty() &&
+        (if_none_match == "*" ||
+         if_none_match.find(etag) != std::string::npos)) {
+      res.SendEmpty(304);
+      return;
+    }
+  }
+
+  if (entry.gzip_body) {
+    res.AddHeader("vary", "accept-encoding");
+    if (gzip) {
+      res.AddHeader("content-encoding", "gzip");
+      res.Send(entry.gzip_body, entry.content_type, entry.status);
+      return;
+    }
+  }
+
+  res.Send(entry.body, entry.content_type, entry.status);
+}
+
+void ResponseCache::Clear() {
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->entries.clear();
+    shard->lru.clear();
+  }
+}
+
+PICONAUT_INNER_END_NAMESPACE
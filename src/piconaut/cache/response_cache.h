@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "piconaut/http/request.h"
+#include "piconaut/http/response.h"
+#include "piconaut/macro.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(cache)
+
+/// @brief Opt-in per route caching policy.
+/// Only use it for handler that is deterministic for the given
+/// route, params, query string & the selected headers.
+struct CachePolicy {
+  std::chrono::milliseconds ttl = std::chrono::milliseconds(1000);
+  // Request headers that take part in the cache key (e.g. accept-language)
+  std::vector<std::string> vary_headers;
+  bool include_query = true;
+  // Store gzip variant along the identity body
+  bool precompress = false;
+};
+
+struct CachedResponse {
+  int status;
+  std::string content_type;
+  std::string etag;
+  // Headers set by the handler, replayed on every hit
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::shared_ptr<const std::string> body;
+  std::shared_ptr<const std::string> gzip_body;
+  // Validator of gzip_body, each encoding has its own
+  std::string gzip_etag;
+  std::chrono::steady_clock::time_point expire_at;
+};
+
+using CachedResponsePtr = std::shared_ptr<const CachedResponse>;
+
+// Normalized request key. The text is compared on lookup, requests with
+// colliding hashes never share a response.
+struct CacheKey {
+  uint64_t hash = 0;
+  std::string text;
+
+  bool operator==(const CacheKey& other) const {
+    return hash == other.hash && text == other.text;
+  }
+};
+
+struct CacheKeyHash {
+  size_t operator()(const CacheKey& key) const {
+    return static_cast<size_t>(key.hash);
+  }
+};
+
+// Key of a request on a route: route key, params (sorted), query string
+// when asked, the negotiated body format and the given request headers.
+CacheKey RequestKey(size_t route_key,
+                    const std::unordered_map<std::string, std::string>& params,
+                    const http::Request& req, bool include_query,
+                    const std::vector<std::string>& vary_headers);
+
+/// @brief Response cache keyed by route key, params, query & headers.
+/// Entries are sharded per worker thread, each worker keep its own copy
+/// so the shard mutex is never contended on the hot path. A full shard
+/// evicts its least recently used entry.
+class ResponseCache {
+ public:
+  explicit ResponseCache(size_t shard_count = 16,
+                         size_t max_entries_per_shard = 1024);
+
+  ResponseCache(const ResponseCache&) = delete;
+  ResponseCache& operator=(const ResponseCache&) = delete;
+
+  // Route registration, must be done before server start.
+  void EnableRoute(size_t route_key, const CachePolicy& policy);
+  const CachePolicy* Policy(size_t route_key) const;
+
+  CacheKey MakeKey(size_t route_key,
+                   const std::unordered_map<std::string, std::string>& params,
+                   const http::Request& req, const CachePolicy& policy) const;
+
+  CachedResponsePtr Find(const CacheKey& key);
+  // nullptr when the response is private (see ResponseCapture::cacheable)
+  CachedResponsePtr Store(const CacheKey& key, const CachePolicy& policy,
+                          http::ResponseCapture& capture);
+
+  // Serve from cache entry, answer 304 when If-None-Match hit.
+  static void Serve(const CachedResponse& entry, const http::Request& req,
+                    const http::Response& res);
+
+  void Clear();
+
+ private:
+  using LruList = std::list<std::pair<CacheKey, CachedResponsePtr>>;
+
+  struct Shard {
+    std::mutex mutex;
+    // Most recently used first
+    LruList lru;
+    std::unordered_map<CacheKey, LruList::iterator, CacheKeyHash> entries;
+  };
+
+  std::unordered_map<size_t, CachePolicy> policies_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t max_entries_per_shard_;
+
+  Shard& WorkerShard();
+  void Erase(Shard& shard, LruList::iterator it);
+};
+
+PICONAUT_INNER_END_NAMESPACE
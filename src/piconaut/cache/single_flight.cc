@@ -0,0 +1,191 @@
+#include "piconaut/cache/single_flight.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(cache)
+
+/// @brief Follower request waiting on its loop. Leader landing, max_wait
+/// and the request disposal all happen on that loop thread, the first
+/// one settles it.
+struct SingleFlight::Parked : std::enable_shared_from_this<Parked> {
+  // First member, the timeout callback gets back to the Parked from it
+  struct Timer {
+    h2o_timeout_entry_t entry;
+    Parked* parked;
+  };
+
+  // Kept in the request pool, released when h2o disposes the request
+  struct Hold {
+    std::shared_ptr<Parked> parked;
+  };
+
+  h2o_req_t* req = nullptr;
+  utils::LoopQueue* queue = nullptr;
+  Resume resume;
+  Timer timer{};
+  bool settled = false;
+
+  void Settle() {
+    settled = true;
+    if (h2o_timeout_is_linked(&timer.entry))
+      h2o_timeout_unlink(&timer.entry);
+  }
+
+  void Finish(CachedResponsePtr result) {
+    if (settled)
+      return;
+    Settle();
+    auto fn = std::move(resume);
+    fn(req, std::move(result));
+  }
+
+  static void OnTimeout(h2o_timeout_entry_t* entry) {
+    auto self = reinterpret_cast<Timer*>(entry)->parked->shared_from_this();
+    self->Finish(nullptr);
+  }
+
+  static void OnDispose(void* ptr) {
+    auto hold = static_cast<Hold*>(ptr);
+    auto& parked = *hold->parked;
+    if (!parked.settled) {
+      parked.Settle();
+      parked.resume = nullptr;
+    }
+    parked.req = nullptr;
+    hold->~Hold();
+  }
+};
+
+void SingleFlight::EnableRoute(size_t route_key,
+                               const SingleFlightPolicy& policy) {
+  policies_[route_key] = policy;
+}
+
+const SingleFlightPolicy* SingleFlight::Policy(size_t route_key) const {
+  auto it = policies_.find(route_key);
+  if (it == policies_.end())
+    return nullptr;
+  return &it->second;
+}
+
+CacheKey SingleFlight::MakeKey(
+    size_t route_key,
+    const std::unordered_map<std::string, std::string>& params,
+    const http::Request& req, const SingleFlightPolicy& policy) const {
+  return RequestKey(route_key, params, req, policy.include_query,
+                    policy.vary_headers);
+}
+
+SingleFlight::Ticket SingleFlight::Join(const CacheKey& key) {
+  auto& shard = KeyShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.flights.find(key);
+  if (it != shard.flights.end())
+    return Ticket(this, key, it->second, false);
+
+  auto flight = std::make_shared<Flight>();
+  shard.flights.emplace(key, flight);
+  return Ticket(this, key, std::move(flight), true);
+}
+
+CachedResponsePtr SingleFlight::FromCapture(http::ResponseCapture& capture) {
+  if (!capture.captured)
+    return nullptr;
+
+  auto response = std::make_shared<CachedResponse>();
+  response->status = capture.status;
+  response->content_type = std::move(capture.content_type);
+  response->etag = std::move(capture.etag);
+  response->headers = std::move(capture.headers);
+  response->body = std::make_shared<std::string>(std::move(capture.body));
+  response->expire_at = std::chrono::steady_clock::now();
+  return response;
+}
+
+void SingleFlight::Land(const CacheKey& key,
+                        const std::shared_ptr<Flight>& flight,
+                        CachedResponsePtr result) {
+  // Off the map first, a request arriving now starts a new flight
+  {
+    auto& shard = KeyShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.flights.find(key);
+    if (it != shard.flights.end() && it->second == flight)
+      shard.flights.erase(it);
+  }
+
+  std::vector<std::shared_ptr<Parked>> waiters;
+  {
+    std::lock_guard<std::mutex> lock(flight->mutex);
+    flight->result = result;
+    flight->done = true;
+    waiters.swap(flight->waiters);
+  }
+
+  // Each follower is answered on its own loop
+  for (auto& parked : waiters) {
+    parked->queue->Post([parked, result]() { parked->Finish(result); });
+  }
+}
+
+SingleFlight::Ticket::Ticket(Ticket&& other) noexcept
+                : owner_(other.owner_),
+                  key_(std::move(other.key_)),
+                  flight_(std::move(other.flight_)),
+                  leader_(other.leader_) {
+  other.leader_ = false;
+}
+
+SingleFlight::Ticket::~Ticket() {
+  if (leader_ && flight_)
+    owner_->Land(key_, flight_, nullptr);
+}
+
+void SingleFlight::Ticket::Publish(CachedResponsePtr result) {
+  if (!leader_ || !flight_)
+    return;
+  owner_->Land(key_, flight_, std::move(result));
+  flight_.reset();
+}
+
+void SingleFlight::Ticket::Park(h2o_req_t* req,
+                                std::chrono::milliseconds max_wait,
+                                Resume resume) {
+  if (leader_ || !flight_) {
+    resume(req, nullptr);
+    return;
+  }
+
+  auto parked = std::make_shared<Parked>();
+  parked->req = req;
+  parked->queue = utils::LoopQueue::ForLoop(req->conn->ctx->loop);
+  parked->resume = std::move(resume);
+  parked->timer.entry.cb = Parked::OnTimeout;
+  parked->timer.parked = parked.get();
+
+  auto hold = h2o_mem_alloc_shared(&req->pool, sizeof(Parked::Hold),
+                                   Parked::OnDispose);
+  new (hold) Parked::Hold{parked};
+  h2o_timeout_link(parked->queue->Loop(),
+                   parked->queue->Timeout(static_cast<uint64_t>(
+                       std::max<int64_t>(max_wait.count(), 0))),
+                   &parked->timer.entry);
+
+  CachedResponsePtr result;
+  {
+    std::lock_guard<std::mutex> lock(flight_->mutex);
+    if (!flight_->done) {
+      flight_->waiters.push_back(parked);
+      return;
+    }
+    result = flight_->result;
+  }
+  // Landed in between Join and Park
+  parked->Finish(std::move(result));
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "piconaut/cache/response_cache.h"
+#include "piconaut/http/request.h"
+#include "piconaut/http/response.h"
+#include "piconaut/macro.h"
+#include "piconaut/utils/loop_queue.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(cache)
+
+/// @brief Opt-in request coalescing of a route, GET only.
+/// Same determinism requirement as CachePolicy: identical key must mean
+/// identical response.
+struct SingleFlightPolicy {
+  // How long a duplicate waits for the first request before running the
+  // handler itself
+  std::chrono::milliseconds max_wait = std::chrono::milliseconds(5000);
+  // Request headers that take part in the key (e.g. accept-language)
+  std::vector<std::string> vary_headers;
+  bool include_query = true;
+};
+
+/// @brief Coalesce identical concurrent requests: the first one (leader)
+/// runs the handler with its response captured, duplicates arriving
+/// meanwhile on other loops are parked and all answered with the same
+/// shared body, no copy per waiter.
+///
+/// Handlers run synchronously on their loop, so a duplicate can only
+/// come from another loop (Config::EventLoops). It doesn't hold its loop
+/// while waiting: the request is parked and resumed on its own loop
+/// through the loop queue once the leader lands, or after max_wait.
+/// Middleware code after next() runs when the request is parked, before
+/// the response is sent.
+class SingleFlight {
+  struct Flight;
+  struct Parked;
+
+ public:
+  // Run on the follower loop with the leader response, nullptr when the
+  // leader published nothing or didn't land within max_wait.
+  using Resume = std::function<void(h2o_req_t* req, CachedResponsePtr result)>;
+
+  /// @brief Membership of one request in a flight. The leader must
+  /// Publish (its destructor publishes nothing when it didn't, e.g. the
+  /// handler threw, so followers never wait past the leader).
+  class Ticket {
+   public:
+    Ticket(Ticket&& other) noexcept;
+    Ticket& operator=(Ticket&&) = delete;
+    ~Ticket();
+
+    bool Leader() const {
+      return leader_;
+    }
+
+    // Leader: hand the response to the followers, nullptr let them run
+    // the handler themselves.
+    void Publish(CachedResponsePtr result);
+    // Follower: park `req` on its loop, `resume` runs once, on the loop
+    // thread, unless h2o disposes the request first (client gone).
+    void Park(h2o_req_t* req, std::chrono::milliseconds max_wait,
+              Resume resume);
+
+   private:
+    friend class SingleFlight;
+
+    Ticket(SingleFlight* owner, CacheKey key, std::shared_ptr<Flight> flight,
+           bool leader)
+                    : owner_(owner),
+                      key_(std::move(key)),
+                      flight_(std::move(flight)),
+                      leader_(leader) {}
+
+    SingleFlight* owner_;
+    CacheKey key_;
+    std::shared_ptr<Flight> flight_;
+    bool leader_;
+  };
+
+  SingleFlight() = default;
+  SingleFlight(const SingleFlight&) = delete;
+  SingleFlight& operator=(const SingleFlight&) = delete;
+
+  // Route registration, must be done before server start.
+  void EnableRoute(size_t route_key, const SingleFlightPolicy& policy);
+  const SingleFlightPolicy* Policy(size_t route_key) const;
+
+  CacheKey MakeKey(size_t route_key,
+                   const std::unordered_map<std::string, std::string>& params,
+                   const http::Request& req,
+                   const SingleFlightPolicy& policy) const;
+
+  // Lead the flight of `key` or follow the one in progress.
+  Ticket Join(const CacheKey& key);
+
+  // Shared response built from a capture, nullptr when nothing was sent.
+  static CachedResponsePtr FromCapture(http::ResponseCapture& capture);
+
+ private:
+  struct Flight {
+    std::mutex mutex;
+    bool done = false;
+    CachedResponsePtr result;
+    std::vector<std::shared_ptr<Parked>> waiters;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<CacheKey, std::shared_ptr<Flight>, CacheKeyHash>
+        flights;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  std::unordered_map<size_t, SingleFlightPolicy> policies_;
+  Shard shards_[kShardCount];
+
+  Shard& KeyShard(const CacheKey& key) {
+    return shards_[key.hash % kShardCount];
+  }
+
+  void Land(const CacheKey& key, const std::shared_ptr<Flight>& flight,
+            CachedResponsePtr result);
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,458 @@
+#include "piconaut/formats/binary/binary_reader.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "piconaut/formats/json/value.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+namespace binary {
+
+namespace {
+
+// CBOR major types (RFC 8949 3.1)
+constexpr uint8_t kCborUnsigned = 0;
+constexpr uint8_t kCborNegative = 1;
+constexpr uint8_t kCborBytes = 2;
+constexpr uint8_t kCborText = 3;
+constexpr uint8_t kCborArray = 4;
+constexpr uint8_t kCborMap = 5;
+constexpr uint8_t kCborTag = 6;
+constexpr uint8_t kCborSimple = 7;
+constexpr uint8_t kCborIndefinite = 31;
+constexpr uint8_t kCborBreak = 0xff;
+
+// rapidjson Document generator, drives the document SAX interface
+// straight from the encoded bytes, no intermediate tree.
+class Decoder {
+ public:
+  Decoder(Format format, const char* data, size_t size)
+                  : format_(format),
+                    data_(reinterpret_cast<const uint8_t*>(data)),
+                    size_(size),
+                    pos_(0),
+                    scratch_() {}
+
+  template <typename Handler>
+  bool operator()(Handler& handler) {
+    if (format_ == Format::kCbor) {
+      ReadCbor(handler, 0);
+    } else {
+      ReadMsgPack(handler, 0);
+    }
+    if (pos_ != size_)
+      Fail("trailing bytes after the root value");
+    return true;
+  }
+
+ private:
+  Format format_;
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_;
+  std::string scratch_;
+
+  [[noreturn]] void Fail(const char* message) const {
+    const char* name = format_ == Format::kCbor ? "CBOR" : "MessagePack";
+    throw json::ParseError(std::string("Invalid ") + name + ": " + message +
+                               " (offset " + std::to_string(pos_) + ")",
+                           pos_);
+  }
+
+  void Need(uint64_t bytes) const {
+    if (bytes > size_ - pos_)
+      Fail("unexpected end of input");
+  }
+
+  uint8_t Byte() {
+    Need(1);
+    return data_[pos_++];
+  }
+
+  uint64_t BigEndian(size_t bytes) {
+    Need(bytes);
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+      value = (value << 8) | data_[pos_ + i];
+    pos_ += bytes;
+    return value;
+  }
+
+  // Element count from the input, every element takes at least one byte.
+  rapidjson::SizeType Count(uint64_t count) const {
+    if (count > size_ - pos_)
+      Fail("container larger than the input");
+    return static_cast<rapidjson::SizeType>(count);
+  }
+
+  std::pair<const char*, rapidjson::SizeType> Bytes(uint64_t length) {
+    Need(length);
+    if (length > std::numeric_limits<rapidjson::SizeType>::max())
+      Fail("string too large");
+    auto data = reinterpret_cast<const char*>(data_ + pos_);
+    pos_ += length;
+    return {data, static_cast<rapidjson::SizeType>(length)};
+  }
+
+  void CheckDepth(size_t depth) const {
+    if (depth >= kMaxDecodeDepth)
+      Fail("nesting too deep");
+  }
+
+  static double FromFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static double FromDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static double FromHalf(uint16_t bits) {
+    int exponent = (bits >> 10) & 0x1f;
+    int mantissa = bits & 0x3ff;
+    double value;
+    if (exponent == 0) {
+      value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+      value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+      value = mantissa == 0 ? std::numeric_limits<double>::infinity()
+                            : std::numeric_limits<double>::quiet_NaN();
+    }
+    return bits & 0x8000 ? -value : value;
+  }
+
+  // MessagePack
+
+  template <typename Handler>
+  void MsgPackString(Handler& handler, uint64_t length, bool is_key) {
+    auto str = Bytes(length);
+    if (is_key) {
+      handler.Key(str.first, str.second, true);
+    } else {
+      handler.String(str.first, str.second, true);
+    }
+  }
+
+  template <typename Handler>
+  void MsgPackKey(Handler& handler) {
+    uint8_t type = Byte();
+    if ((type & 0xe0) == 0xa0) {
+      MsgPackString(handler, type & 0x1f, true);
+    } else if (type == 0xd9 || type == 0xc4) {
+      MsgPackString(handler, BigEndian(1), true);
+    } else if (type == 0xda || type == 0xc5) {
+      MsgPackString(handler, BigEndian(2), true);
+    } else if (type == 0xdb || type == 0xc6) {
+      MsgPackString(handler, BigEndian(4), true);
+    } else {
+      --pos_;
+      Fail("map key must be a string");
+    }
+  }
+
+  template <typename Handler>
+  void MsgPackMap(Handler& handler, uint64_t count, size_t depth) {
+    CheckDepth(depth);
+    auto size = Count(count);
+    handler.StartObject();
+    for (rapidjson::SizeType i = 0; i < size; ++i) {
+      MsgPackKey(handler);
+      ReadMsgPack(handler, depth + 1);
+    }
+    handler.EndObject(size);
+  }
+
+  template <typename Handler>
+  void MsgPackArray(Handler& handler, uint64_t count, size_t depth) {
+    CheckDepth(depth);
+    auto size = Count(count);
+    handler.StartArray();
+    for (rapidjson::SizeType i = 0; i < size; ++i)
+      ReadMsgPack(handler, depth + 1);
+    handler.EndArray(size);
+  }
+
+  template <typename Handler>
+  void ReadMsgPack(Handler& handler, size_t depth) {
+    uint8_t type = Byte();
+    if (type <= 0x7f) {
+      handler.Uint64(type);
+    } else if (type >= 0xe0) {
+      handler.Int64(static_cast<int8_t>(type));
+    } else if ((type & 0xf0) == 0x80) {
+      MsgPackMap(handler, type & 0x0f, depth);
+    } else if ((type & 0xf0) == 0x90) {
+      MsgPackArray(handler, type & 0x0f, depth);
+    } else if ((type & 0xe0) == 0xa0) {
+      MsgPackString(handler, type & 0x1f, false);
+    } else {
+      switch (type) {
+        case 0xc0:
+          handler.Null();
+          break;
+        case 0xc2:
+          handler.Bool(false);
+          break;
+        case 0xc3:
+          handler.Bool(true);
+          break;
+        case 0xc4:
+        case 0xd9:
+          MsgPackString(handler, BigEndian(1), false);
+          break;
+        case 0xc5:
+        case 0xda:
+          MsgPackString(handler, BigEndian(2), false);
+          break;
+        case 0xc6:
+        case 0xdb:
+          MsgPackString(handler, BigEndian(4), false);
+          break;
+        case 0xca:
+          handler.Double(FromFloat(static_cast<uint32_t>(BigEndian(4))));
+          break;
+        case 0xcb:
+          handler.Double(FromDouble(BigEndian(8)));
+          break;
+        case 0xcc:
+          handler.Uint64(BigEndian(1));
+          break;
+        case 0xcd:
+          handler.Uint64(BigEndian(2));
+          break;
+        case 0xce:
+          handler.Uint64(BigEndian(4));
+          break;
+        case 0xcf:
+          handler.Uint64(BigEndian(8));
+          break;
+        case 0xd0:
+          handler.Int64(static_cast<int8_t>(BigEndian(1)));
+          break;
+        case 0xd1:
+          handler.Int64(static_cast<int16_t>(BigEndian(2)));
+          break;
+        case 0xd2:
+          handler.Int64(static_cast<int32_t>(BigEndian(4)));
+          break;
+        case 0xd3:
+          handler.Int64(static_cast<int64_t>(BigEndian(8)));
+          break;
+        case 0xdc:
+          MsgPackArray(handler, BigEndian(2), depth);
+          break;
+        case 0xdd:
+          MsgPackArray(handler, BigEndian(4), depth);
+          break;
+        case 0xde:
+          MsgPackMap(handler, BigEndian(2), depth);
+          break;
+        case 0xdf:
+          MsgPackMap(handler, BigEndian(4), depth);
+          break;
+        default:
+          // 0xc1 never used, ext types have no json equivalent
+          --pos_;
+          Fail("unsupported type");
+      }
+    }
+  }
+
+  // CBOR
+
+  uint64_t CborArgument(uint8_t info) {
+    if (info < 24)
+      return info;
+    switch (info) {
+      case 24:
+        return BigEndian(1);
+      case 25:
+        return BigEndian(2);
+      case 26:
+        return BigEndian(4);
+      case 27:
+        return BigEndian(8);
+      default:
+        Fail("invalid additional information");
+    }
+  }
+
+  // Definite string stays a view into the input, indefinite one is
+  // concatenated into the scratch buffer.
+  std::pair<const char*, rapidjson::SizeType> CborString(uint8_t major,
+                                                         uint8_t info) {
+    if (info != kCborIndefinite)
+      return Bytes(CborArgument(info));
+
+    scratch_.clear();
+    while (true) {
+      uint8_t chunk = Byte();
+      if (chunk == kCborBreak)
+        break;
+      if ((chunk >> 5) != major || (chunk & 0x1f) == kCborIndefinite)
+        Fail("invalid indefinite string chunk");
+      auto str = Bytes(CborArgument(chunk & 0x1f));
+      scratch_.append(str.first, str.second);
+    }
+    if (scratch_.size() > std::numeric_limits<rapidjson::SizeType>::max())
+      Fail("string too large");
+    return {scratch_.data(),
+            static_cast<rapidjson::SizeType>(scratch_.size())};
+  }
+
+  template <typename Handler>
+  void CborKey(Handler& handler) {
+    uint8_t initial = Byte();
+    uint8_t major = initial >> 5;
+    if (major != kCborText && major != kCborBytes) {
+      --pos_;
+      Fail("map key must be a string");
+    }
+    auto str = CborString(major, initial & 0x1f);
+    handler.Key(str.first, str.second, true);
+  }
+
+  bool CborBreak() {
+    Need(1);
+    if (data_[pos_] != kCborBreak)
+      return false;
+    ++pos_;
+    return true;
+  }
+
+  template <typename Handler>
+  void CborMap(Handler& handler, uint8_t info, size_t depth) {
+    CheckDepth(depth);
+    handler.StartObject();
+    rapidjson::SizeType size = 0;
+    if (info == kCborIndefinite) {
+      for (; !CborBreak(); ++size) {
+        CborKey(handler);
+        ReadCbor(handler, depth + 1);
+      }
+    } else {
+      size = Count(CborArgument(info));
+      for (rapidjson::SizeType i = 0; i < size; ++i) {
+        CborKey(handler);
+        ReadCbor(handler, depth + 1);
+      }
+    }
+    handler.EndObject(size);
+  }
+
+  template <typename Handler>
+  void CborArray(Handler& handler, uint8_t info, size_t depth) {
+    CheckDepth(depth);
+    handler.StartArray();
+    rapidjson::SizeType size = 0;
+    if (info == kCborIndefinite) {
+      for (; !CborBreak(); ++size)
+        ReadCbor(handler, depth + 1);
+    } else {
+      size = Count(CborArgument(info));
+      for (rapidjson::SizeType i = 0; i < size; ++i)
+        ReadCbor(handler, depth + 1);
+    }
+    handler.EndArray(size);
+  }
+
+  template <typename Handler>
+  void CborSimple(Handler& handler, uint8_t info) {
+    switch (info) {
+      case 20:
+        handler.Bool(false);
+        break;
+      case 21:
+        handler.Bool(true);
+        break;
+      case 22:  // null
+      case 23:  // undefined
+        handler.Null();
+        break;
+      case 25:
+        handler.Double(FromHalf(static_cast<uint16_t>(BigEndian(2))));
+        break;
+      case 26:
+        handler.Double(FromFloat(static_cast<uint32_t>(BigEndian(4))));
+        break;
+      case 27:
+        handler.Double(FromDouble(BigEndian(8)));
+        break;
+      default:
+        --pos_;
+        Fail("unsupported simple value");
+    }
+  }
+
+  template <typename Handler>
+  void ReadCbor(Handler& handler, size_t depth) {
+    uint8_t initial = Byte();
+    uint8_t major = initial >> 5;
+    uint8_t info = initial & 0x1f;
+
+    switch (major) {
+      case kCborUnsigned:
+        handler.Uint64(CborArgument(info));
+        break;
+      case kCborNegative: {
+        uint64_t value = CborArgument(info);
+        if (value > static_cast<uint64_t>(
+                        std::numeric_limits<int64_t>::max())) {
+          handler.Double(-1.0 - static_cast<double>(value));
+        } else {
+          handler.Int64(-1 - static_cast<int64_t>(value));
+        }
+        break;
+      }
+      case kCborBytes:
+      case kCborText: {
+        auto str = CborString(major, info);
+        handler.String(str.first, str.second, true);
+        break;
+      }
+      case kCborArray:
+        CborArray(handler, info, depth);
+        break;
+      case kCborMap:
+        CborMap(handler, info, depth);
+        break;
+      case kCborTag:
+        // e.g. date/time or bignum tag, the tagged item is kept as is
+        CborArgument(info);
+        CheckDepth(depth);
+        ReadCbor(handler, depth + 1);
+        break;
+      case kCborSimple:
+      default:
+        CborSimple(handler, info);
+        break;
+    }
+  }
+};
+
+}  // namespace
+
+void Decode(Format format, const char* data, size_t size,
+            rapidjson::Document& document) {
+  if (format == Format::kJson)
+    throw std::invalid_argument("binary::Decode: json is not a binary format.");
+  if (!data && size)
+    throw std::invalid_argument("binary::Decode: null data.");
+
+  Decoder decoder(format, data, size);
+  document.Populate(decoder);
+}
+
+}  // namespace binary
+PICONAUT_INNER_END_NAMESPACE
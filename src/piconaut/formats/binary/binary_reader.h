@@ -0,0 +1,24 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <cstddef>
+
+#include "piconaut/formats/format.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace binary {
+
+// Nesting deeper than this is rejected, the decoder is recursive.
+constexpr size_t kMaxDecodeDepth = 128;
+
+// Decode a MessagePack or CBOR body into the document, strings are
+// copied into the document allocator. Maps keys must be strings (json
+// model), binary strings are read as strings, CBOR tags are skipped.
+// Throw json::ParseError with the byte offset on malformed input.
+void Decode(Format format, const char* data, size_t size,
+            rapidjson::Document& document);
+
+}  // namespace binary
+PICONAUT_INNER_END_NAMESPACE
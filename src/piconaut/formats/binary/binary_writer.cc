@@ -0,0 +1,489 @@
+#include "piconaut/formats/binary/binary_writer.h"
+
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/error/en.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "piconaut/formats/json/size_hint.h"
+#include "piconaut/formats/json/value.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+namespace binary {
+
+namespace {
+
+// CBOR major types (RFC 8949 3.1)
+constexpr uint8_t kCborUnsigned = 0;
+constexpr uint8_t kCborNegative = 1;
+constexpr uint8_t kCborText = 3;
+constexpr uint8_t kCborArray = 4;
+constexpr uint8_t kCborMap = 5;
+
+}  // namespace
+
+BinaryWriter::BinaryWriter(Format format, size_t capacity_hint)
+                : format_(format),
+                  buffer_(capacity_hint ? capacity_hint
+                                        : json::CurrentSizeHint()),
+                  frames_(),
+                  has_root_(false),
+                  capacity_hint_(capacity_hint) {
+  if (format_ == Format::kJson)
+    throw std::invalid_argument("BinaryWriter: json is not a binary format.");
+}
+
+void BinaryWriter::BeforeValue() {
+  if (frames_.empty()) {
+    if (has_root_)
+      throw std::logic_error("BinaryWriter: root value already written.");
+    has_root_ = true;
+    return;
+  }
+
+  auto& top = frames_.back();
+  if (!top.is_object) {
+    ++top.count;
+    return;
+  }
+  if (top.expect_key)
+    throw std::logic_error("BinaryWriter: value inside object needs Key().");
+  top.expect_key = true;
+}
+
+void BinaryWriter::BeginContainer(bool is_object, uint64_t count) {
+  BeforeValue();
+
+  Frame frame{0, 0, count, is_object, true};
+  if (count != kUnknownCount && count > 0xffffffff)
+    throw std::length_error("BinaryWriter: container too large.");
+
+  if (count != kUnknownCount) {
+    if (format_ == Format::kCbor) {
+      WriteHead(is_object ? kCborMap : kCborArray, count);
+    } else if (count < 16) {
+      buffer_.Put(static_cast<char>((is_object ? 0x80 : 0x90) | count));
+    } else if (count <= 0xffff) {
+      buffer_.Put(static_cast<char>(is_object ? 0xde : 0xdc));
+      WriteBigEndian(count, 2);
+    } else {
+      buffer_.Put(static_cast<char>(is_object ? 0xdf : 0xdd));
+      WriteBigEndian(count, 4);
+    }
+  } else {
+    if (format_ == Format::kCbor) {
+      uint8_t major = is_object ? kCborMap : kCborArray;
+      buffer_.Put(static_cast<char>((major << 5) | 26));
+    } else {
+      buffer_.Put(static_cast<char>(is_object ? 0xdf : 0xdd));
+    }
+    frame.header = buffer_.Size();
+    WriteBigEndian(0, 4);
+  }
+  frames_.push_back(frame);
+}
+
+void BinaryWriter::EndContainer(bool is_object) {
+  if (frames_.empty())
+    throw std::logic_error("BinaryWriter: nothing to close.");
+
+  const auto& top = frames_.back();
+  if (top.is_object != is_object)
+    throw std::logic_error("BinaryWriter: mismatched EndObject()/EndArray().");
+  if (!top.expect_key)
+    throw std::logic_error("BinaryWriter: Key() without value.");
+
+  if (top.expected != kUnknownCount) {
+    if (top.count != top.expected)
+      throw std::logic_error("BinaryWriter: container size mismatch.");
+  } else {
+    if (top.count > 0xffffffff)
+      throw std::length_error("BinaryWriter: container too large.");
+    auto out = reinterpret_cast<uint8_t*>(buffer_.Data() + top.header);
+    out[0] = static_cast<uint8_t>(top.count >> 24);
+    out[1] = static_cast<uint8_t>(top.count >> 16);
+    out[2] = static_cast<uint8_t>(top.count >> 8);
+    out[3] = static_cast<uint8_t>(top.count);
+  }
+  frames_.pop_back();
+}
+
+void BinaryWriter::WriteBigEndian(uint64_t value, size_t bytes) {
+  PutReserve(buffer_, bytes);
+  for (size_t i = bytes; i > 0; --i)
+    buffer_.PutUnsafe(static_cast<char>(value >> ((i - 1) * 8)));
+}
+
+void BinaryWriter::WriteHead(uint8_t major, uint64_t value) {
+  uint8_t type = static_cast<uint8_t>(major << 5);
+  if (value < 24) {
+    buffer_.Put(static_cast<char>(type | value));
+  } else if (value <= 0xff) {
+    buffer_.Put(static_cast<char>(type | 24));
+    WriteBigEndian(value, 1);
+  } else if (value <= 0xffff) {
+    buffer_.Put(static_cast<char>(type | 25));
+    WriteBigEndian(value, 2);
+  } else if (value <= 0xffffffff) {
+    buffer_.Put(static_cast<char>(type | 26));
+    WriteBigEndian(value, 4);
+  } else {
+    buffer_.Put(static_cast<char>(type | 27));
+    WriteBigEndian(value, 8);
+  }
+}
+
+void BinaryWriter::WriteUint(uint64_t value) {
+  if (format_ == Format::kCbor) {
+    WriteHead(kCborUnsigned, value);
+  } else if (value < 0x80) {
+    buffer_.Put(static_cast<char>(value));
+  } else if (value <= 0xff) {
+    buffer_.Put(static_cast<char>(0xcc));
+    WriteBigEndian(value, 1);
+  } else if (value <= 0xffff) {
+    buffer_.Put(static_cast<char>(0xcd));
+    WriteBigEndian(value, 2);
+  } else if (value <= 0xffffffff) {
+    buffer_.Put(static_cast<char>(0xce));
+    WriteBigEndian(value, 4);
+  } else {
+    buffer_.Put(static_cast<char>(0xcf));
+    WriteBigEndian(value, 8);
+  }
+}
+
+void BinaryWriter::WriteInt(int64_t value) {
+  if (value >= 0) {
+    WriteUint(static_cast<uint64_t>(value));
+  } else if (format_ == Format::kCbor) {
+    // -1 - n, the bitwise complement in two's complement
+    WriteHead(kCborNegative, ~static_cast<uint64_t>(value));
+  } else if (value >= -32) {
+    buffer_.Put(static_cast<char>(value));
+  } else if (value >= std::numeric_limits<int8_t>::min()) {
+    buffer_.Put(static_cast<char>(0xd0));
+    WriteBigEndian(static_cast<uint64_t>(value), 1);
+  } else if (value >= std::numeric_limits<int16_t>::min()) {
+    buffer_.Put(static_cast<char>(0xd1));
+    WriteBigEndian(static_cast<uint64_t>(value), 2);
+  } else if (value >= std::numeric_limits<int32_t>::min()) {
+    buffer_.Put(static_cast<char>(0xd2));
+    WriteBigEndian(static_cast<uint64_t>(value), 4);
+  } else {
+    buffer_.Put(static_cast<char>(0xd3));
+    WriteBigEndian(static_cast<uint64_t>(value), 8);
+  }
+}
+
+void BinaryWriter::WriteDouble(double value) {
+  bool cbor = format_ == Format::kCbor;
+
+  // Single precision when it round trips, e.g. 0.5 or 1e10
+  if (std::isfinite(value) &&
+      std::fabs(value) <= std::numeric_limits<float>::max()) {
+    float single = static_cast<float>(value);
+    if (static_cast<double>(single) == value) {
+      uint32_t bits;
+      memcpy(&bits, &single, sizeof(bits));
+      buffer_.Put(static_cast<char>(cbor ? 0xfa : 0xca));
+      WriteBigEndian(bits, 4);
+      return;
+    }
+  }
+
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  buffer_.Put(static_cast<char>(cbor ? 0xfb : 0xcb));
+  WriteBigEndian(bits, 8);
+}
+
+void BinaryWriter::WriteString(const char* data, size_t size) {
+  if (format_ == Format::kCbor) {
+    WriteHead(kCborText, size);
+  } else if (size < 32) {
+    buffer_.Put(static_cast<char>(0xa0 | size));
+  } else if (size <= 0xff) {
+    buffer_.Put(static_cast<char>(0xd9));
+    WriteBigEndian(size, 1);
+  } else if (size <= 0xffff) {
+    buffer_.Put(static_cast<char>(0xda));
+    WriteBigEndian(size, 2);
+  } else if (size <= 0xffffffff) {
+    buffer_.Put(static_cast<char>(0xdb));
+    WriteBigEndian(size, 4);
+  } else {
+    throw std::length_error("BinaryWriter: string too large.");
+  }
+  buffer_.Append(data, size);
+}
+
+BinaryWriter& BinaryWriter::Object() {
+  BeginContainer(true, kUnknownCount);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Object(size_t member_count) {
+  BeginContainer(true, member_count);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::EndObject() {
+  EndContainer(true);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Array() {
+  BeginContainer(false, kUnknownCount);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Array(size_t size) {
+  BeginContainer(false, size);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::EndArray() {
+  EndContainer(false);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Key(std::string_view key) {
+  if (frames_.empty() || !frames_.back().is_object ||
+      !frames_.back().expect_key)
+    throw std::logic_error("BinaryWriter: Key() is only valid inside object.");
+
+  auto& top = frames_.back();
+  ++top.count;
+  top.expect_key = false;
+  WriteString(key.data(), key.size());
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::RawKey(std::string_view quoted_key) {
+  if (quoted_key.size() >= 2 && quoted_key.front() == '"' &&
+      quoted_key.back() == '"')
+    quoted_key = quoted_key.substr(1, quoted_key.size() - 2);
+  return Key(quoted_key);
+}
+
+BinaryWriter& BinaryWriter::Null() {
+  BeforeValue();
+  buffer_.Put(static_cast<char>(format_ == Format::kCbor ? 0xf6 : 0xc0));
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Value(std::string_view value) {
+  BeforeValue();
+  WriteString(value.data(), value.size());
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Value(const char* value) {
+  if (!value)
+    return Null();
+  return Value(std::string_view(value));
+}
+
+BinaryWriter& BinaryWriter::Value(const std::string& value) {
+  return Value(std::string_view(value));
+}
+
+BinaryWriter& BinaryWriter::Value(bool value) {
+  BeforeValue();
+  if (format_ == Format::kCbor) {
+    buffer_.Put(static_cast<char>(value ? 0xf5 : 0xf4));
+  } else {
+    buffer_.Put(static_cast<char>(value ? 0xc3 : 0xc2));
+  }
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Value(int value) {
+  return Value(static_cast<int64_t>(value));
+}
+
+BinaryWriter& BinaryWriter::Value(unsigned int value) {
+  return Value(static_cast<uint64_t>(value));
+}
+
+BinaryWriter& BinaryWriter::Value(int64_t value) {
+  BeforeValue();
+  WriteInt(value);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Value(uint64_t value) {
+  BeforeValue();
+  WriteUint(value);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Value(double value) {
+  BeforeValue();
+  WriteDouble(value);
+  return *this;
+}
+
+BinaryWriter& BinaryWriter::Value(float value) {
+  return Value(static_cast<double>(value));
+}
+
+BinaryWriter& BinaryWriter::Value(std::nullptr_t) {
+  return Null();
+}
+
+BinaryWriter& BinaryWriter::Value(const rapidjson::Value& value) {
+  switch (value.GetType()) {
+    case rapidjson::kNullType:
+      return Null();
+    case rapidjson::kFalseType:
+      return Value(false);
+    case rapidjson::kTrueType:
+      return Value(true);
+    case rapidjson::kStringType:
+      return Value(
+          std::string_view(value.GetString(), value.GetStringLength()));
+    case rapidjson::kNumberType:
+      if (value.IsUint64())
+        return Value(value.GetUint64());
+      if (value.IsInt64())
+        return Value(value.GetInt64());
+      return Value(value.GetDouble());
+    case rapidjson::kObjectType:
+      Object(value.MemberCount());
+      for (const auto& member : value.GetObject()) {
+        Key(std::string_view(member.name.GetString(),
+                             member.name.GetStringLength()));
+        Value(member.value);
+      }
+      return EndObject();
+    case rapidjson::kArrayType:
+      Array(value.Size());
+      for (const auto& item : value.GetArray())
+        Value(item);
+      return EndArray();
+  }
+  return *this;
+}
+
+bool BinaryWriter::IsComplete() const {
+  return has_root_ && frames_.empty();
+}
+
+JsonBuffer BinaryWriter::Finish() {
+  if (!IsComplete()) {
+    throw std::runtime_error("BinaryWriter: document is not complete.");
+  }
+
+  JsonBuffer buffer(std::move(buffer_));
+  Reset();
+  return buffer;
+}
+
+void BinaryWriter::Reset() {
+  buffer_.Clear();
+  buffer_.Reserve(capacity_hint_ ? capacity_hint_ : json::CurrentSizeHint());
+  frames_.clear();
+  has_root_ = false;
+}
+
+bool BinaryWriter::Handler::Null() {
+  writer_.Null();
+  return true;
+}
+
+bool BinaryWriter::Handler::Bool(bool value) {
+  writer_.Value(value);
+  return true;
+}
+
+bool BinaryWriter::Handler::Int(int value) {
+  writer_.Value(value);
+  return true;
+}
+
+bool BinaryWriter::Handler::Uint(unsigned value) {
+  writer_.Value(value);
+  return true;
+}
+
+bool BinaryWriter::Handler::Int64(int64_t value) {
+  writer_.Value(value);
+  return true;
+}
+
+bool BinaryWriter::Handler::Uint64(uint64_t value) {
+  writer_.Value(value);
+  return true;
+}
+
+bool BinaryWriter::Handler::Double(double value) {
+  writer_.Value(value);
+  return true;
+}
+
+bool BinaryWriter::Handler::RawNumber(const char* str,
+                                      rapidjson::SizeType length, bool copy) {
+  // Only with kParseNumbersAsStringsFlag, which is never used here
+  return false;
+}
+
+bool BinaryWriter::Handler::String(const char* str, rapidjson::SizeType length,
+                                   bool copy) {
+  writer_.Value(std::string_view(str, length));
+  return true;
+}
+
+bool BinaryWriter::Handler::StartObject() {
+  writer_.Object();
+  return true;
+}
+
+bool BinaryWriter::Handler::Key(const char* str, rapidjson::SizeType length,
+                                bool copy) {
+  writer_.Key(std::string_view(str, length));
+  return true;
+}
+
+bool BinaryWriter::Handler::EndObject(rapidjson::SizeType member_count) {
+  writer_.EndObject();
+  return true;
+}
+
+bool BinaryWriter::Handler::StartArray() {
+  writer_.Array();
+  return true;
+}
+
+bool BinaryWriter::Handler::EndArray(rapidjson::SizeType element_count) {
+  writer_.EndArray();
+  return true;
+}
+
+JsonBuffer Transcode(std::string_view json, Format format,
+                     size_t capacity_hint) {
+  // Binary output is usually smaller than the json text
+  BinaryWriter writer(format, capacity_hint ? capacity_hint : json.size());
+  BinaryWriter::Handler handler(writer);
+
+  rapidjson::MemoryStream stream(json.data(), json.size());
+  rapidjson::Reader reader;
+  auto result = reader.Parse(stream, handler);
+  if (result.IsError()) {
+    throw json::ParseError(
+        std::string("Invalid JSON: ") +
+            rapidjson::GetParseError_En(result.Code()) + " (offset " +
+            std::to_string(result.Offset()) + ")",
+        result.Offset());
+  }
+  return writer.Finish();
+}
+
+}  // namespace binary
+PICONAUT_INNER_END_NAMESPACE
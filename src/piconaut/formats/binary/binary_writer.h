@@ -0,0 +1,163 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "piconaut/formats/format.h"
+#include "piconaut/formats/json/json_buffer.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace binary {
+
+using json::JsonBuffer;
+
+/// @brief Streaming MessagePack / CBOR writer with the JsonWriter
+/// interface, so PICONAUT_JSON_FIELDS types serialize through it as is.
+///
+/// ```cpp
+/// formats::binary::BinaryWriter out(formats::Format::kMsgPack);
+/// formats::json::JsonWrite(out, user);
+/// auto bytes = out.Finish();
+/// ```
+///
+/// Object and Array without a count reserve a 32-bit length and patch it
+/// when the container is closed (valid, if not the shortest, encoding).
+/// Pass the count when it is known for the compact header. Misuse throws
+/// std::logic_error, the nesting is needed for the counts anyway.
+class BinaryWriter {
+ public:
+  // capacity_hint 0 use the route size estimate inside a handler.
+  explicit BinaryWriter(Format format, size_t capacity_hint = 0);
+
+  BinaryWriter(const BinaryWriter&) = delete;
+  BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+  BinaryWriter& Object();
+  BinaryWriter& Object(size_t member_count);
+  BinaryWriter& EndObject();
+  BinaryWriter& Array();
+  BinaryWriter& Array(size_t size);
+  BinaryWriter& EndArray();
+  BinaryWriter& Key(std::string_view key);
+  // JsonWriter compatible, e.g. "\"name\"" from PICONAUT_JSON_FIELDS.
+  BinaryWriter& RawKey(std::string_view quoted_key);
+
+  BinaryWriter& Null();
+  BinaryWriter& Value(std::string_view value);
+  BinaryWriter& Value(const char* value);
+  BinaryWriter& Value(const std::string& value);
+  BinaryWriter& Value(bool value);
+  BinaryWriter& Value(int value);
+  BinaryWriter& Value(unsigned int value);
+  BinaryWriter& Value(int64_t value);
+  BinaryWriter& Value(uint64_t value);
+  BinaryWriter& Value(double value);
+  BinaryWriter& Value(float value);
+  BinaryWriter& Value(std::nullptr_t);
+  // Whole DOM subtree, e.g. the ValueBuilder document.
+  BinaryWriter& Value(const rapidjson::Value& value);
+
+  template <typename Iterator>
+  BinaryWriter& Values(Iterator first, Iterator last) {
+    using Category =
+        typename std::iterator_traits<Iterator>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>) {
+      Array(static_cast<size_t>(std::distance(first, last)));
+    } else {
+      Array();
+    }
+    for (; first != last; ++first)
+      Value(*first);
+    return EndArray();
+  }
+
+  template <typename Range>
+  BinaryWriter& Values(const Range& range) {
+    return Values(std::begin(range), std::end(range));
+  }
+
+  template <typename T>
+  BinaryWriter& Member(std::string_view key, const T& value) {
+    return Key(key).Value(value);
+  }
+
+  Format GetFormat() const {
+    return format_;
+  }
+
+  bool IsComplete() const;
+
+  // Take the output, throw when the root value is not closed.
+  // The writer is ready for a new document afterwards.
+  JsonBuffer Finish();
+
+  // Drop the current output and start a new document.
+  void Reset();
+
+  /// @brief rapidjson SAX handler over the writer, for transcoding
+  /// (e.g. rapidjson::Reader over json text).
+  class Handler {
+   public:
+    explicit Handler(BinaryWriter& writer) : writer_(writer) {}
+
+    bool Null();
+    bool Bool(bool value);
+    bool Int(int value);
+    bool Uint(unsigned value);
+    bool Int64(int64_t value);
+    bool Uint64(uint64_t value);
+    bool Double(double value);
+    bool RawNumber(const char* str, rapidjson::SizeType length, bool copy);
+    bool String(const char* str, rapidjson::SizeType length, bool copy);
+    bool StartObject();
+    bool Key(const char* str, rapidjson::SizeType length, bool copy);
+    bool EndObject(rapidjson::SizeType member_count);
+    bool StartArray();
+    bool EndArray(rapidjson::SizeType element_count);
+
+   private:
+    BinaryWriter& writer_;
+  };
+
+ private:
+  static constexpr uint64_t kUnknownCount = ~uint64_t(0);
+
+  struct Frame {
+    size_t header;  // offset of the 32-bit count to patch
+    uint64_t count;
+    uint64_t expected;
+    bool is_object;
+    bool expect_key;
+  };
+
+  Format format_;
+  JsonBuffer buffer_;
+  std::vector<Frame> frames_;
+  bool has_root_;
+  size_t capacity_hint_;
+
+  void BeforeValue();
+  void BeginContainer(bool is_object, uint64_t count);
+  void EndContainer(bool is_object);
+
+  void WriteUint(uint64_t value);
+  void WriteInt(int64_t value);
+  void WriteDouble(double value);
+  void WriteString(const char* data, size_t size);
+  void WriteHead(uint8_t major, uint64_t value);
+  void WriteBigEndian(uint64_t value, size_t bytes);
+};
+
+// Re-encode json text, throw json::ParseError on malformed json.
+JsonBuffer Transcode(std::string_view json, Format format,
+                     size_t capacity_hint = 0);
+
+}  // namespace binary
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,125 @@
+#include "piconaut/formats/format.h"
+
+#include <strings.h>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+
+namespace {
+
+struct MediaType {
+  std::string_view name;
+  Format format;
+  bool wildcard;
+};
+
+constexpr MediaType kMediaTypes[] = {
+    {"application/json", Format::kJson, false},
+    {"application/msgpack", Format::kMsgPack, false},
+    {"application/x-msgpack", Format::kMsgPack, false},
+    {"application/vnd.msgpack", Format::kMsgPack, false},
+    {"application/cbor", Format::kCbor, false},
+    {"*/*", Format::kJson, true},
+    {"application/*", Format::kJson, true},
+};
+
+std::string_view Trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    value.remove_prefix(1);
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    value.remove_suffix(1);
+  return value;
+}
+
+const MediaType* Lookup(std::string_view media, bool allow_wildcard) {
+  media = Trim(media);
+  for (const auto& type : kMediaTypes) {
+    if (type.wildcard && !allow_wildcard)
+      continue;
+    if (type.name.size() == media.size() &&
+        strncasecmp(type.name.data(), media.data(), media.size()) == 0)
+      return &type;
+  }
+  return nullptr;
+}
+
+// q parameter in thousandths, missing or malformed count as 1.
+int QValue(std::string_view params) {
+  while (!params.empty()) {
+    size_t end = params.find(';');
+    auto param = Trim(params.substr(0, end));
+    params = end == std::string_view::npos ? std::string_view()
+                                           : params.substr(end + 1);
+    if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') ||
+        param[1] != '=')
+      continue;
+
+    auto value = param.substr(2);
+    if (value.empty() || value[0] < '0' || value[0] > '9')
+      return 1000;
+
+    int q = (value[0] - '0') * 1000;
+    int scale = 100;
+    for (size_t i = 2; i < value.size() && value[1] == '.' && scale; ++i) {
+      if (value[i] < '0' || value[i] > '9')
+        break;
+      q += (value[i] - '0') * scale;
+      scale /= 10;
+    }
+    return q > 1000 ? 1000 : q;
+  }
+  return 1000;
+}
+
+}  // namespace
+
+std::string_view ContentType(Format format) {
+  switch (format) {
+    case Format::kMsgPack:
+      return "application/msgpack";
+    case Format::kCbor:
+      return "application/cbor";
+    case Format::kJson:
+    default:
+      return "application/json";
+  }
+}
+
+Format FormatFromContentType(const char* content_type, size_t len) {
+  if (!content_type || !len)
+    return Format::kJson;
+
+  std::string_view value(content_type, len);
+  auto type = Lookup(value.substr(0, value.find(';')), false);
+  return type ? type->format : Format::kJson;
+}
+
+Format NegotiateFormat(const char* accept, size_t len) {
+  if (!accept || !len)
+    return Format::kJson;
+
+  Format best = Format::kJson;
+  int best_q = 0;
+  std::string_view ranges(accept, len);
+  while (!ranges.empty()) {
+    size_t end = ranges.find(',');
+    auto range = ranges.substr(0, end);
+    ranges = end == std::string_view::npos ? std::string_view()
+                                           : ranges.substr(end + 1);
+
+    size_t params = range.find(';');
+    auto type = Lookup(range.substr(0, params), true);
+    if (!type)
+      continue;
+
+    int q = params == std::string_view::npos ? 1000
+                                             : QValue(range.substr(params + 1));
+    if (q > best_q) {
+      best = type->format;
+      best_q = q;
+    }
+  }
+  return best;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+
+// Wire format of a structured body, the model (ValueBuilder, Value,
+// PICONAUT_JSON_FIELDS types) is the same for all of them.
+enum class Format : char { kJson, kMsgPack, kCbor };
+
+// Response media type, e.g. "application/msgpack".
+std::string_view ContentType(Format format);
+
+// Request body format from its Content-Type, unknown or missing is json.
+Format FormatFromContentType(const char* content_type, size_t len);
+
+// Best supported format for an Accept header (q-values honoured,
+// ties keep the header order). Missing, wildcard or nothing supported
+// is json.
+Format NegotiateFormat(const char* accept, size_t len);
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,208 @@
+#include "piconaut/formats/json/json_buffer.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+namespace {
+
+// Size classes 4KB, 8KB, ... 1MB, bigger output is malloc-ed as is.
+constexpr size_t kMinChunkSize = 4 * 1024;
+constexpr size_t kChunkClasses = 9;
+constexpr size_t kMaxChunkSize = kMinChunkSize << (kChunkClasses - 1);
+
+std::atomic<size_t> max_idle_chunks{8};
+
+size_t ChunkClass(size_t size) {
+  size_t index = 0;
+  size_t class_size = kMinChunkSize;
+  while (class_size < size) {
+    class_size <<= 1;
+    ++index;
+  }
+  return index;
+}
+
+// Set once the thread free list is destroyed. Trivially destructible,
+// so it is still readable while the other thread_local objects (e.g.
+// pooled builders) release their chunks at thread exit.
+thread_local bool t_free_list_destroyed = false;
+
+struct ChunkFreeList {
+  std::vector<char*> idle[kChunkClasses];
+
+  ~ChunkFreeList() {
+    t_free_list_destroyed = true;
+    for (auto& list : idle) {
+      for (auto chunk : list)
+        free(chunk);
+    }
+  }
+
+  char* Acquire(size_t& capacity) {
+    if (capacity > kMaxChunkSize) {
+      auto chunk = static_cast<char*>(malloc(capacity));
+      if (!chunk)
+        throw std::bad_alloc();
+      return chunk;
+    }
+
+    size_t index = ChunkClass(capacity);
+    capacity = kMinChunkSize << index;
+    auto& list = idle[index];
+    if (!list.empty()) {
+      char* chunk = list.back();
+      list.pop_back();
+      return chunk;
+    }
+
+    auto chunk = static_cast<char*>(malloc(capacity));
+    if (!chunk)
+      throw std::bad_alloc();
+    return chunk;
+  }
+
+  void Release(char* chunk, size_t capacity) {
+    if (capacity <= kMaxChunkSize) {
+      auto& list = idle[ChunkClass(capacity)];
+      if (list.size() < max_idle_chunks.load(std::memory_order_relaxed)) {
+        list.push_back(chunk);
+        return;
+      }
+    }
+    free(chunk);
+  }
+
+  // nullptr once destroyed at thread exit, chunks are malloc-ed and
+  // freed directly from then on.
+  static ChunkFreeList* ThreadLocal() {
+    if (t_free_list_destroyed)
+      return nullptr;
+    thread_local ChunkFreeList free_list;
+    return &free_list;
+  }
+};
+
+char* AcquireChunk(size_t& capacity) {
+  auto free_list = ChunkFreeList::ThreadLocal();
+  if (free_list)
+    return free_list->Acquire(capacity);
+
+  auto chunk = static_cast<char*>(malloc(capacity));
+  if (!chunk)
+    throw std::bad_alloc();
+  return chunk;
+}
+
+void ReleaseToFreeList(char* chunk, size_t capacity) {
+  auto free_list = ChunkFreeList::ThreadLocal();
+  if (free_list) {
+    free_list->Release(chunk, capacity);
+  } else {
+    free(chunk);
+  }
+}
+
+}  // namespace
+
+JsonChunk::JsonChunk(JsonChunk&& other) noexcept
+                : data_(other.data_),
+                  size_(other.size_),
+                  capacity_(other.capacity_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.capacity_ = 0;
+}
+
+JsonChunk::~JsonChunk() {
+  if (data_)
+    ReleaseToFreeList(data_, capacity_);
+}
+
+JsonBuffer::JsonBuffer(JsonBuffer&& other) noexcept
+                : data_(inline_),
+                  size_(other.size_),
+                  capacity_(kInlineCapacity) {
+  if (other.IsInline()) {
+    memcpy(inline_, other.inline_, other.size_);
+  } else {
+    data_ = other.data_;
+    capacity_ = other.capacity_;
+    other.data_ = other.inline_;
+    other.capacity_ = kInlineCapacity;
+  }
+  other.size_ = 0;
+}
+
+JsonBuffer& JsonBuffer::operator=(JsonBuffer&& other) noexcept {
+  if (this == &other)
+    return *this;
+
+  ReleaseChunk();
+  size_ = other.size_;
+  if (other.IsInline()) {
+    data_ = inline_;
+    capacity_ = kInlineCapacity;
+    memcpy(inline_, other.inline_, other.size_);
+  } else {
+    data_ = other.data_;
+    capacity_ = other.capacity_;
+    other.data_ = other.inline_;
+    other.capacity_ = kInlineCapacity;
+  }
+  other.size_ = 0;
+  return *this;
+}
+
+JsonBuffer::~JsonBuffer() {
+  ReleaseChunk();
+}
+
+void JsonBuffer::Grow(size_t min_capacity) {
+  size_t capacity = capacity_ * 2;
+  if (capacity < min_capacity)
+    capacity = min_capacity;
+
+  char* chunk = AcquireChunk(capacity);
+  memcpy(chunk, data_, size_);
+
+  ReleaseChunk();
+  data_ = chunk;
+  capacity_ = capacity;
+}
+
+void JsonBuffer::ReleaseChunk() {
+  if (IsInline())
+    return;
+
+  ReleaseToFreeList(data_, capacity_);
+  data_ = inline_;
+  capacity_ = kInlineCapacity;
+}
+
+JsonChunk JsonBuffer::TakeChunk() {
+  if (IsInline())
+    return JsonChunk();
+
+  JsonChunk chunk(data_, size_, capacity_);
+  data_ = inline_;
+  size_ = 0;
+  capacity_ = kInlineCapacity;
+  return chunk;
+}
+
+size_t JsonBuffer::MaxIdleChunks() {
+  return max_idle_chunks.load(std::memory_order_relaxed);
+}
+
+void JsonBuffer::MaxIdleChunks(size_t max_idle) {
+  max_idle_chunks.store(max_idle, std::memory_order_relaxed);
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
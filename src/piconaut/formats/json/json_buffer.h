@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+/// @brief Chunk detached from a JsonBuffer, a few words to hand over
+/// instead of the whole buffer and its inline storage. The chunk goes
+/// back to the free list of the thread that destroys it.
+class JsonChunk {
+ public:
+  JsonChunk() : data_(nullptr), size_(0), capacity_(0) {}
+  JsonChunk(JsonChunk&& other) noexcept;
+  JsonChunk& operator=(JsonChunk&&) = delete;
+  JsonChunk(const JsonChunk&) = delete;
+  JsonChunk& operator=(const JsonChunk&) = delete;
+  ~JsonChunk();
+
+  const char* Data() const {
+    return data_;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  friend class JsonBuffer;
+
+  JsonChunk(char* data, size_t size, size_t capacity)
+                  : data_(data), size_(size), capacity_(capacity) {}
+
+  char* data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+/// @brief Move-only serialized json output, also a rapidjson output stream.
+/// Output up to kInlineCapacity stays inside the object, larger output
+/// takes pre-sized chunks from a per-thread free list and returns them
+/// there when destroyed, so steady state serialization doesn't malloc.
+class JsonBuffer {
+ public:
+  typedef char Ch;  // rapidjson stream concept
+
+  static constexpr size_t kInlineCapacity = 1024;
+
+  JsonBuffer() : data_(inline_), size_(0), capacity_(kInlineCapacity) {}
+  // Pre-size for the expected output, e.g. from a previous response.
+  explicit JsonBuffer(size_t capacity_hint) : JsonBuffer() {
+    Reserve(capacity_hint);
+  }
+
+  JsonBuffer(JsonBuffer&& other) noexcept;
+  JsonBuffer& operator=(JsonBuffer&& other) noexcept;
+  JsonBuffer(const JsonBuffer&) = delete;
+  JsonBuffer& operator=(const JsonBuffer&) = delete;
+  ~JsonBuffer();
+
+  const char* Data() const {
+    return data_;
+  }
+
+  // In place patching of written bytes, e.g. a length prefix.
+  char* Data() {
+    return data_;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  size_t Capacity() const {
+    return capacity_;
+  }
+
+  bool Empty() const {
+    return size_ == 0;
+  }
+
+  bool IsInline() const {
+    return data_ == inline_;
+  }
+
+  std::string_view View() const {
+    return std::string_view(data_, size_);
+  }
+
+  // Copy of the content, prefer View() on hot path.
+  std::string ToString() const {
+    return std::string(data_, size_);
+  }
+
+  void Reserve(size_t capacity) {
+    if (capacity > capacity_)
+      Grow(capacity);
+  }
+
+  void Clear() {
+    size_ = 0;
+  }
+
+  void Append(const char* data, size_t size) {
+    Reserve(size_ + size);
+    memcpy(data_ + size_, data, size);
+    size_ += size;
+  }
+
+  // rapidjson output stream
+  void Put(char c) {
+    if (size_ == capacity_)
+      Grow(size_ + 1);
+    data_[size_++] = c;
+  }
+
+  // Caller has reserved the room with Reserve().
+  void PutUnsafe(char c) {
+    data_[size_++] = c;
+  }
+
+  void Flush() {}
+
+  // Detach the chunk with the content, the buffer is left empty.
+  // Inline content has no chunk, an empty JsonChunk is returned.
+  JsonChunk TakeChunk();
+
+  // Idle chunks kept per size class on each thread.
+  static size_t MaxIdleChunks();
+  static void MaxIdleChunks(size_t max_idle);
+
+ private:
+  char* data_;
+  size_t size_;
+  size_t capacity_;
+  alignas(alignof(void*)) char inline_[kInlineCapacity];
+
+  void Grow(size_t min_capacity);
+  void ReleaseChunk();
+};
+
+// rapidjson::Writer pick these through ADL, the whole token is reserved
+// once then written without per char capacity checks.
+inline void PutReserve(JsonBuffer& stream, size_t count) {
+  stream.Reserve(stream.Size() + count);
+}
+
+inline void PutUnsafe(JsonBuffer& stream, char c) {
+  stream.PutUnsafe(c);
+}
+
+inline void PutN(JsonBuffer& stream, char c, size_t n) {
+  stream.Reserve(stream.Size() + n);
+  for (size_t i = 0; i < n; ++i)
+    stream.PutUnsafe(c);
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "piconaut/formats/json/json_writer.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+// Compile-time struct to json serialization.
+//
+// ```cpp
+// struct Address {
+//   std::string city;
+//   std::optional<std::string> zip;
+// };
+// PICONAUT_JSON_FIELDS(Address, city, zip)
+//
+// struct User {
+//   int64_t id;
+//   std::string name;
+//   std::vector<std::string> roles;
+//   std::map<std::string, int> quota;
+//   Address address;
+// };
+// PICONAUT_JSON_FIELDS(User, id, name, roles, quota, address)
+//
+// res.SendJson(user);
+// ```
+//
+// PICONAUT_JSON_FIELDS must be used in the namespace of the type, the
+// generated PiconautJsonWrite() overload is found through ADL. Keys are
+// emitted as quoted literals built by the preprocessor, no escaping or
+// lookup at runtime. An empty std::optional member is left out of the
+// object, std::nullopt inside containers is written as null.
+
+namespace detail {
+
+template <typename T, typename = void>
+struct IsMapLike : std::false_type {};
+
+template <typename T>
+struct IsMapLike<T, std::void_t<typename T::key_type, typename T::mapped_type>>
+                : std::true_type {};
+
+template <typename T, typename = void>
+struct IsRangeLike : std::false_type {};
+
+template <typename T>
+struct IsRangeLike<T, std::void_t<decltype(std::begin(std::declval<T&>())),
+                                  decltype(std::end(std::declval<T&>()))>>
+                : std::true_type {};
+
+template <typename T>
+struct IsOptional : std::false_type {};
+
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct AlwaysFalse : std::false_type {};
+
+template <typename T, typename = void>
+struct HasSize : std::false_type {};
+
+template <typename T>
+struct HasSize<T, std::void_t<decltype(std::declval<const T&>().size())>>
+                : std::true_type {};
+
+// Writer taking the element count up front, e.g. binary::BinaryWriter.
+template <typename Writer, typename = void>
+struct HasSizedContainers : std::false_type {};
+
+template <typename Writer>
+struct HasSizedContainers<
+    Writer, std::void_t<decltype(std::declval<Writer&>().Array(size_t{})),
+                        decltype(std::declval<Writer&>().Object(size_t{}))>>
+                : std::true_type {};
+
+}  // namespace detail
+
+template <typename Writer, typename T>
+void JsonWrite(Writer& writer, const T& value);
+
+template <typename Writer, typename T>
+void JsonWriteField(Writer& writer, std::string_view quoted_key,
+                    const T& value) {
+  if constexpr (detail::IsOptional<T>::value) {
+    if (!value)
+      return;
+  }
+  writer.RawKey(quoted_key);
+  JsonWrite(writer, value);
+}
+
+template <typename Writer, typename T>
+void JsonWrite(Writer& writer, const T& value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    writer.Value(value);
+  } else if constexpr (std::is_enum_v<T>) {
+    JsonWrite(writer, static_cast<std::underlying_type_t<T>>(value));
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    writer.Value(static_cast<int64_t>(value));
+  } else if constexpr (std::is_integral_v<T>) {
+    writer.Value(static_cast<uint64_t>(value));
+  } else if constexpr (std::is_floating_point_v<T>) {
+    writer.Value(static_cast<double>(value));
+  } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+    writer.Value(std::string_view(value));
+  } else if constexpr (std::is_same_v<T, std::nullptr_t> ||
+                       std::is_same_v<T, std::nullopt_t>) {
+    writer.Null();
+  } else if constexpr (detail::IsOptional<T>::value) {
+    if (value)
+      JsonWrite(writer, *value);
+    else
+      writer.Null();
+  } else if constexpr (detail::IsMapLike<T>::value) {
+    static_assert(
+        std::is_convertible_v<const typename T::key_type&, std::string_view>,
+        "json object key must be a string");
+    if constexpr (detail::HasSizedContainers<Writer>::value) {
+      writer.Object(value.size());
+    } else {
+      writer.Object();
+    }
+    for (const auto& item : value) {
+      writer.Key(std::string_view(item.first));
+      JsonWrite(writer, item.second);
+    }
+    writer.EndObject();
+  } else if constexpr (detail::IsRangeLike<T>::value) {
+    if constexpr (detail::HasSizedContainers<Writer>::value &&
+                  detail::HasSize<T>::value) {
+      writer.Array(value.size());
+    } else {
+      writer.Array();
+    }
+    for (const auto& item : value) {
+      JsonWrite(writer, item);
+    }
+    writer.EndArray();
+  } else {
+    // user type, generated by PICONAUT_JSON_FIELDS
+    PiconautJsonWrite(writer, value);
+  }
+}
+
+// Serialize any supported value into a JsonBuffer.
+// capacity_hint 0 use the route size estimate inside a handler.
+template <typename T>
+JsonBuffer ToJson(const T& value, size_t capacity_hint = 0) {
+  JsonWriter writer(capacity_hint);
+  JsonWrite(writer, value);
+  return writer.Finish();
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
+
+#define __PCN_JSON_EXPAND(x) x
+#define __PCN_JSON_FE_1(m, x) m(x)
+#define __PCN_JSON_FE_2(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_1(m, __VA_ARGS__))
+#define __PCN_JSON_FE_3(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_2(m, __VA_ARGS__))
+#define __PCN_JSON_FE_4(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_3(m, __VA_ARGS__))
+#define __PCN_JSON_FE_5(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_4(m, __VA_ARGS__))
+#define __PCN_JSON_FE_6(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_5(m, __VA_ARGS__))
+#define __PCN_JSON_FE_7(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_6(m, __VA_ARGS__))
+#define __PCN_JSON_FE_8(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_7(m, __VA_ARGS__))
+#define __PCN_JSON_FE_9(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_8(m, __VA_ARGS__))
+#define __PCN_JSON_FE_10(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_9(m, __VA_ARGS__))
+#define __PCN_JSON_FE_11(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_10(m, __VA_ARGS__))
+#define __PCN_JSON_FE_12(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_11(m, __VA_ARGS__))
+#define __PCN_JSON_FE_13(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_12(m, __VA_ARGS__))
+#define __PCN_JSON_FE_14(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_13(m, __VA_ARGS__))
+#define __PCN_JSON_FE_15(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_14(m, __VA_ARGS__))
+#define __PCN_JSON_FE_16(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_15(m, __VA_ARGS__))
+#define __PCN_JSON_FE_17(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_16(m, __VA_ARGS__))
+#define __PCN_JSON_FE_18(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_17(m, __VA_ARGS__))
+#define __PCN_JSON_FE_19(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_18(m, __VA_ARGS__))
+#define __PCN_JSON_FE_20(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_19(m, __VA_ARGS__))
+#define __PCN_JSON_FE_21(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_20(m, __VA_ARGS__))
+#define __PCN_JSON_FE_22(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_21(m, __VA_ARGS__))
+#define __PCN_JSON_FE_23(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_22(m, __VA_ARGS__))
+#define __PCN_JSON_FE_24(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_23(m, __VA_ARGS__))
+#define __PCN_JSON_FE_25(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_24(m, __VA_ARGS__))
+#define __PCN_JSON_FE_26(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_25(m, __VA_ARGS__))
+#define __PCN_JSON_FE_27(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_26(m, __VA_ARGS__))
+#define __PCN_JSON_FE_28(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_27(m, __VA_ARGS__))
+#define __PCN_JSON_FE_29(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_28(m, __VA_ARGS__))
+#define __PCN_JSON_FE_30(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_29(m, __VA_ARGS__))
+#define __PCN_JSON_FE_31(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_30(m, __VA_ARGS__))
+#define __PCN_JSON_FE_32(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_31(m, __VA_ARGS__))
+#define __PCN_JSON_FE_33(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_32(m, __VA_ARGS__))
+#define __PCN_JSON_FE_34(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_33(m, __VA_ARGS__))
+#define __PCN_JSON_FE_35(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_34(m, __VA_ARGS__))
+#define __PCN_JSON_FE_36(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_35(m, __VA_ARGS__))
+#define __PCN_JSON_FE_37(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_36(m, __VA_ARGS__))
+#define __PCN_JSON_FE_38(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_37(m, __VA_ARGS__))
+#define __PCN_JSON_FE_39(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_38(m, __VA_ARGS__))
+#define __PCN_JSON_FE_40(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_39(m, __VA_ARGS__))
+#define __PCN_JSON_FE_41(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_40(m, __VA_ARGS__))
+#define __PCN_JSON_FE_42(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_41(m, __VA_ARGS__))
+#define __PCN_JSON_FE_43(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_42(m, __VA_ARGS__))
+#define __PCN_JSON_FE_44(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_43(m, __VA_ARGS__))
+#define __PCN_JSON_FE_45(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_44(m, __VA_ARGS__))
+#define __PCN_JSON_FE_46(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_45(m, __VA_ARGS__))
+#define __PCN_JSON_FE_47(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_46(m, __VA_ARGS__))
+#define __PCN_JSON_FE_48(m, x, ...) \
+  m(x) __PCN_JSON_EXPAND(__PCN_JSON_FE_47(m, __VA_ARGS__))
+#define __PCN_JSON_GET_FE(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, \
+  _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, \
+  _28, _29, _30, _31, _32, _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, \
+  _43, _44, _45, _46, _47, _48, NAME, ...) NAME
+#define __PCN_JSON_FOR_EACH(m, ...)                    \
+  __PCN_JSON_EXPAND(__PCN_JSON_GET_FE(__VA_ARGS__, \
+      __PCN_JSON_FE_48, __PCN_JSON_FE_47, __PCN_JSON_FE_46, __PCN_JSON_FE_45, \
+      __PCN_JSON_FE_44, __PCN_JSON_FE_43, __PCN_JSON_FE_42, \
+      __PCN_JSON_FE_41, __PCN_JSON_FE_40, __PCN_JSON_FE_39, \
+      __PCN_JSON_FE_38, __PCN_JSON_FE_37, __PCN_JSON_FE_36, \
+      __PCN_JSON_FE_35, __PCN_JSON_FE_34, __PCN_JSON_FE_33, \
+      __PCN_JSON_FE_32, __PCN_JSON_FE_31, __PCN_JSON_FE_30, \
+      __PCN_JSON_FE_29, __PCN_JSON_FE_28, __PCN_JSON_FE_27, \
+      __PCN_JSON_FE_26, __PCN_JSON_FE_25, __PCN_JSON_FE_24, \
+      __PCN_JSON_FE_23, __PCN_JSON_FE_22, __PCN_JSON_FE_21, \
+      __PCN_JSON_FE_20, __PCN_JSON_FE_19, __PCN_JSON_FE_18, \
+      __PCN_JSON_FE_17, __PCN_JSON_FE_16, __PCN_JSON_FE_15, \
+      __PCN_JSON_FE_14, __PCN_JSON_FE_13, __PCN_JSON_FE_12, \
+      __PCN_JSON_FE_11, __PCN_JSON_FE_10, __PCN_JSON_FE_9, __PCN_JSON_FE_8, \
+      __PCN_JSON_FE_7, __PCN_JSON_FE_6, __PCN_JSON_FE_5, __PCN_JSON_FE_4, \
+      __PCN_JSON_FE_3, __PCN_JSON_FE_2, __PCN_JSON_FE_1)(m, __VA_ARGS__))
+
+#define __PCN_JSON_WRITE_FIELD(field)                          \
+  ::piconaut::formats::json::JsonWriteField(__pcn_writer,      \
+                                            "\"" #field "\"", \
+                                            __pcn_value.field);
+
+// Generate the serializer of `Type` for the listed fields (max 48),
+// for any writer with the JsonWriter interface (json, MessagePack, CBOR).
+#define PICONAUT_JSON_FIELDS(Type, ...)                                 \
+  template <typename __PcnWriter>                                       \
+  inline void PiconautJsonWrite(__PcnWriter& __pcn_writer,              \
+                                const Type& __pcn_value) {              \
+    __pcn_writer.Object();                                              \
+    __PCN_JSON_FOR_EACH(__PCN_JSON_WRITE_FIELD, __VA_ARGS__)            \
+    __pcn_writer.EndObject();                                           \
+  }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "piconaut/macro.h"
+#include "piconaut/utils/hash.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+/// @brief Json object key with length and hash known up front.
+/// The characters are referenced, never copied, so the storage must
+/// outlive the json document (string literal or interned string).
+///
+/// ```cpp
+/// static constexpr formats::json::JsonKey kStatus("status");
+/// json[kStatus] = 200;
+/// json[PICONAUT_JSON_KEY("message")] = "ok";
+/// json["detail"] = "copied";  // plain char array key is copied
+/// ```
+class JsonKey {
+ public:
+  template <size_t N>
+  constexpr JsonKey(const char (&literal)[N])  // NOLINT: implicit
+                  : data_(literal),
+                    size_(N - 1),
+                    hash_(utils::hash::Fnv1a64(literal, N - 1)) {}
+
+  // Key with static or otherwise long lived storage.
+  static constexpr JsonKey Interned(std::string_view key) {
+    return JsonKey(key.data(), key.size());
+  }
+
+  constexpr const char* Data() const {
+    return data_;
+  }
+
+  constexpr size_t Size() const {
+    return size_;
+  }
+
+  constexpr uint64_t Hash() const {
+    return hash_;
+  }
+
+  constexpr std::string_view View() const {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  uint64_t hash_;
+
+  constexpr JsonKey(const char* data, size_t size)
+                  : data_(data),
+                    size_(size),
+                    hash_(utils::hash::Fnv1a64(data, size)) {}
+};
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
+
+// JsonKey of a string literal, anything else fails to compile.
+#define PICONAUT_JSON_KEY(literal) \
+  (::piconaut::formats::json::JsonKey("" literal))
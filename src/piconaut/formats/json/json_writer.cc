@@ -0,0 +1,211 @@
+#include "piconaut/formats/json/json_writer.h"
+
+#include <stdexcept>
+
+#include "piconaut/formats/json/size_hint.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+JsonWriter::JsonWriter() : JsonWriter(0) {}
+
+JsonWriter::JsonWriter(size_t capacity_hint)
+                : buffer_(capacity_hint ? capacity_hint : CurrentSizeHint()),
+                  writer_(buffer_),
+                  capacity_hint_(capacity_hint)
+#ifndef NDEBUG
+                  ,
+                  frames_(),
+                  has_root_(false)
+#endif
+{
+}
+
+#ifndef NDEBUG
+void JsonWriter::CheckValue() {
+  if (frames_.empty()) {
+    if (has_root_)
+      throw std::logic_error("JsonWriter: root value already written.");
+    has_root_ = true;
+    return;
+  }
+
+  auto& top = frames_.back();
+  if (top == Frame::kObjectKey)
+    throw std::logic_error("JsonWriter: value inside object needs Key().");
+  if (top == Frame::kObjectValue)
+    top = Frame::kObjectKey;
+}
+
+void JsonWriter::CheckKey() {
+  if (frames_.empty() || frames_.back() != Frame::kObjectKey)
+    throw std::logic_error("JsonWriter: Key() is only valid inside object.");
+  frames_.back() = Frame::kObjectValue;
+}
+
+void JsonWriter::CheckEnd(Frame expected) {
+  if (frames_.empty())
+    throw std::logic_error("JsonWriter: nothing to close.");
+
+  auto top = frames_.back();
+  if (top == Frame::kObjectValue)
+    throw std::logic_error("JsonWriter: Key() without value.");
+  if (top != expected)
+    throw std::logic_error("JsonWriter: mismatched EndObject()/EndArray().");
+  frames_.pop_back();
+}
+#endif
+
+JsonWriter& JsonWriter::Object() {
+  BeforeValue();
+#ifndef NDEBUG
+  frames_.push_back(Frame::kObjectKey);
+#endif
+  writer_.StartObject();
+  return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+#ifndef NDEBUG
+  CheckEnd(Frame::kObjectKey);
+#endif
+  writer_.EndObject();
+  return *this;
+}
+
+JsonWriter& JsonWriter::Array() {
+  BeforeValue();
+#ifndef NDEBUG
+  frames_.push_back(Frame::kArray);
+#endif
+  writer_.StartArray();
+  return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+#ifndef NDEBUG
+  CheckEnd(Frame::kArray);
+#endif
+  writer_.EndArray();
+  return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+#ifndef NDEBUG
+  CheckKey();
+#endif
+  writer_.Key(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+  return *this;
+}
+
+JsonWriter& JsonWriter::RawKey(std::string_view quoted_key) {
+#ifndef NDEBUG
+  CheckKey();
+#endif
+  // rapidjson prefix a string typed raw value at name position as a key
+  writer_.RawValue(quoted_key.data(), quoted_key.size(),
+                   rapidjson::kStringType);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Null() {
+  BeforeValue();
+  writer_.Null();
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(std::string_view value) {
+  BeforeValue();
+  writer_.String(value.data(), static_cast<rapidjson::SizeType>(value.size()));
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(const char* value) {
+  if (!value)
+    return Null();
+  return Value(std::string_view(value));
+}
+
+JsonWriter& JsonWriter::Value(const std::string& value) {
+  return Value(std::string_view(value));
+}
+
+JsonWriter& JsonWriter::Value(bool value) {
+  BeforeValue();
+  writer_.Bool(value);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(int value) {
+  BeforeValue();
+  writer_.Int(value);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(unsigned int value) {
+  BeforeValue();
+  writer_.Uint(value);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(int64_t value) {
+  BeforeValue();
+  writer_.Int64(value);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(uint64_t value) {
+  BeforeValue();
+  writer_.Uint64(value);
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(double value) {
+  BeforeValue();
+  if (!writer_.Double(value))
+    throw std::runtime_error("JsonWriter: NaN or Inf is not valid json.");
+  return *this;
+}
+
+JsonWriter& JsonWriter::Value(float value) {
+  return Value(static_cast<double>(value));
+}
+
+JsonWriter& JsonWriter::Value(std::nullptr_t) {
+  return Null();
+}
+
+JsonWriter& JsonWriter::Raw(std::string_view json) {
+  BeforeValue();
+  writer_.RawValue(json.data(), json.size(), rapidjson::kObjectType);
+  return *this;
+}
+
+bool JsonWriter::IsComplete() const {
+  return writer_.IsComplete();
+}
+
+JsonBuffer JsonWriter::Finish() {
+  if (!writer_.IsComplete()) {
+    throw std::runtime_error("JsonWriter: document is not complete.");
+  }
+
+  JsonBuffer buffer(std::move(buffer_));
+  RecordSerializedSize(buffer.Size());
+  Reset();
+  return buffer;
+}
+
+void JsonWriter::Reset() {
+  buffer_.Clear();
+  buffer_.Reserve(capacity_hint_ ? capacity_hint_ : CurrentSizeHint());
+  writer_.Reset(buffer_);
+#ifndef NDEBUG
+  frames_.clear();
+  has_root_ = false;
+#endif
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <rapidjson/writer.h>
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "piconaut/formats/json/json_buffer.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+/// @brief Streaming json writer, write straight into the output buffer
+/// without building the DOM first. Use for write-once responses.
+///
+/// ```cpp
+/// formats::json::JsonWriter json;
+/// json.Object()
+///     .Member("status", 200)
+///     .Key("items").Array().Value(1).Value(2).EndArray()
+///     .EndObject();
+/// res.SendJson(json.Finish());
+/// ```
+///
+/// Nesting (key before value inside object, matching End*) is validated
+/// in debug builds only and throws std::logic_error on misuse.
+class JsonWriter {
+ public:
+  // capacity_hint 0 use the route size estimate inside a handler.
+  JsonWriter();
+  explicit JsonWriter(size_t capacity_hint);
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  JsonWriter& Object();
+  JsonWriter& EndObject();
+  JsonWriter& Array();
+  JsonWriter& EndArray();
+  JsonWriter& Key(std::string_view key);
+  // Key already quoted and escaped, e.g. "\"name\"" from a literal.
+  JsonWriter& RawKey(std::string_view quoted_key);
+
+  JsonWriter& Null();
+  JsonWriter& Value(std::string_view value);
+  JsonWriter& Value(const char* value);
+  JsonWriter& Value(const std::string& value);
+  JsonWriter& Value(bool value);
+  JsonWriter& Value(int value);
+  JsonWriter& Value(unsigned int value);
+  JsonWriter& Value(int64_t value);
+  JsonWriter& Value(uint64_t value);
+  JsonWriter& Value(double value);
+  JsonWriter& Value(float value);
+  JsonWriter& Value(std::nullptr_t);
+
+  // Already serialized json fragment, written as is.
+  JsonWriter& Raw(std::string_view json);
+
+  // Stream a range as json array, nothing is materialized on the way.
+  // For list endpoints too large for ValueBuilder::Assign.
+  template <typename Iterator>
+  JsonWriter& Values(Iterator first, Iterator last) {
+    Array();
+    for (; first != last; ++first)
+      Value(*first);
+    return EndArray();
+  }
+
+  template <typename Range>
+  JsonWriter& Values(const Range& range) {
+    return Values(std::begin(range), std::end(range));
+  }
+
+  template <typename T>
+  JsonWriter& Member(std::string_view key, const T& value) {
+    return Key(key).Value(value);
+  }
+
+  bool IsComplete() const;
+
+  // Take the output, throw when the root value is not closed.
+  // The writer is ready for a new document afterwards.
+  JsonBuffer Finish();
+
+  // Drop the current output and start a new document.
+  void Reset();
+
+ private:
+  using WriterType = rapidjson::Writer<JsonBuffer>;
+
+  JsonBuffer buffer_;
+  WriterType writer_;
+  size_t capacity_hint_;
+
+#ifndef NDEBUG
+  enum class Frame : char { kObjectKey, kObjectValue, kArray };
+  std::vector<Frame> frames_;
+  bool has_root_;
+
+  // Validate a value is allowed here and consume its slot.
+  void CheckValue();
+  void CheckKey();
+  void CheckEnd(Frame expected);
+#endif
+
+  void BeforeValue() {
+#ifndef NDEBUG
+    CheckValue();
+#endif
+  }
+};
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,495 @@
+#include "piconaut/formats/json/lazy_reader.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+namespace {
+
+inline bool IsWhitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline const char* SkipWhitespace(const char* p, const char* end) {
+  while (p < end && IsWhitespace(*p))
+    ++p;
+  return p;
+}
+
+[[noreturn]] void ThrowMalformed(const char* what, const char* begin,
+                                 const char* at) {
+  throw ParseError(std::string("Invalid JSON: ") + what,
+                   static_cast<size_t>(at - begin));
+}
+
+// Structural search, 16 bytes per step with SSE2.
+// Inside string only '"' and '\' matter, outside only brackets & quote.
+inline const char* FindQuoteOrEscape(const char* p, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                              _mm_cmpeq_epi8(chunk, escape)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#endif
+  while (p < end && *p != '"' && *p != '\\')
+    ++p;
+  return p;
+}
+
+inline const char* FindContainerChar(const char* p, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i open_object = _mm_set1_epi8('{');
+  const __m128i close_object = _mm_set1_epi8('}');
+  const __m128i open_array = _mm_set1_epi8('[');
+  const __m128i close_array = _mm_set1_epi8(']');
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hit = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, open_object)),
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, close_object),
+                                  _mm_cmpeq_epi8(chunk, open_array)),
+                     _mm_cmpeq_epi8(chunk, close_array)));
+    int mask = _mm_movemask_epi8(hit);
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#endif
+  while (p < end && *p != '"' && *p != '{' && *p != '}' && *p != '[' &&
+         *p != ']')
+    ++p;
+  return p;
+}
+
+// p at the opening quote, return past the closing quote.
+const char* SkipString(const char* begin, const char* p, const char* end) {
+  const char* start = p++;
+  for (;;) {
+    p = FindQuoteOrEscape(p, end);
+    if (p >= end)
+      ThrowMalformed("unterminated string", begin, start);
+    if (*p == '\\') {
+      p += 2;
+      continue;
+    }
+    return p + 1;
+  }
+}
+
+// p at '{' or '[', return past the matching bracket.
+const char* SkipContainer(const char* begin, const char* p, const char* end) {
+  const char* start = p;
+  int depth = 0;
+  for (;;) {
+    p = FindContainerChar(p, end);
+    if (p >= end)
+      ThrowMalformed("unterminated object or array", begin, start);
+
+    switch (*p) {
+      case '"':
+        p = SkipString(begin, p, end);
+        continue;
+      case '{':
+      case '[':
+        ++depth;
+        break;
+      default:
+        if (--depth == 0)
+          return p + 1;
+        break;
+    }
+    ++p;
+  }
+}
+
+const char* SkipScalar(const char* begin, const char* p, const char* end) {
+  const char* start = p;
+  while (p < end && *p != ',' && *p != '}' && *p != ']' && !IsWhitespace(*p))
+    ++p;
+  if (p == start)
+    ThrowMalformed("missing value", begin, start);
+  return p;
+}
+
+const char* SkipValue(const char* begin, const char* p, const char* end) {
+  switch (*p) {
+    case '"':
+      return SkipString(begin, p, end);
+    case '{':
+    case '[':
+      return SkipContainer(begin, p, end);
+    default:
+      return SkipScalar(begin, p, end);
+  }
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+bool ReadHex4(std::string_view s, size_t at, uint32_t& out) {
+  if (at + 4 > s.size())
+    return false;
+  auto result = std::from_chars(s.data() + at, s.data() + at + 4, out, 16);
+  return result.ec == std::errc() && result.ptr == s.data() + at + 4;
+}
+
+std::string Unescape(std::string_view raw) {
+  std::string out;
+  out.reserve(raw.size());
+  for (size_t i = 0; i < raw.size(); ++i) {
+    char c = raw[i];
+    if (c != '\\') {
+      out.push_back(c);
+      continue;
+    }
+
+    if (++i >= raw.size())
+      throw std::runtime_error("JSON string has invalid escape");
+
+    switch (raw[i]) {
+      case '"':
+      case '\\':
+      case '/':
+        out.push_back(raw[i]);
+        break;
+      case 'b':
+        out.push_back('\b');
+        break;
+      case 'f':
+        out.push_back('\f');
+        break;
+      case 'n':
+        out.push_back('\n');
+        break;
+      case 'r':
+        out.push_back('\r');
+        break;
+      case 't':
+        out.push_back('\t');
+        break;
+      case 'u': {
+        uint32_t cp;
+        if (!ReadHex4(raw, i + 1, cp))
+          throw std::runtime_error("JSON string has invalid \\u escape");
+        i += 4;
+        // surrogate pair
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 2 < raw.size() &&
+            raw[i + 1] == '\\' && raw[i + 2] == 'u') {
+          uint32_t low;
+          if (ReadHex4(raw, i + 3, low) && low >= 0xDC00 && low <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            i += 6;
+          }
+        }
+        AppendUtf8(out, cp);
+        break;
+      }
+      default:
+        throw std::runtime_error("JSON string has invalid escape");
+    }
+  }
+  return out;
+}
+
+template <typename T>
+struct IsOptional : std::false_type {};
+
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {
+  using Inner = T;
+};
+
+template <typename T>
+struct IsVector : std::false_type {};
+
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type {
+  using Inner = T;
+};
+
+}  // namespace
+
+bool LazyValue::IsNull() const {
+  return pos_ && *pos_ == 'n';
+}
+
+bool LazyValue::IsObject() const {
+  return pos_ && *pos_ == '{';
+}
+
+bool LazyValue::IsArray() const {
+  return pos_ && *pos_ == '[';
+}
+
+bool LazyValue::IsString() const {
+  return pos_ && *pos_ == '"';
+}
+
+bool LazyValue::IsBool() const {
+  return pos_ && (*pos_ == 't' || *pos_ == 'f');
+}
+
+bool LazyValue::IsNumber() const {
+  return pos_ && (*pos_ == '-' || (*pos_ >= '0' && *pos_ <= '9'));
+}
+
+std::string_view LazyValue::Raw() const {
+  if (!pos_)
+    return std::string_view();
+  return std::string_view(pos_, SkipValue(begin_, pos_, end_) - pos_);
+}
+
+std::string_view LazyValue::ScalarToken() const {
+  return std::string_view(pos_, SkipScalar(begin_, pos_, end_) - pos_);
+}
+
+// cursor == nullptr start at the first member, otherwise cursor is the
+// value of the previous member, which is skipped first.
+bool LazyValue::NextMember(const char*& cursor, std::string_view& key,
+                           LazyValue& value) const {
+  if (!IsObject())
+    return false;
+
+  const char* p;
+  if (!cursor) {
+    p = SkipWhitespace(pos_ + 1, end_);
+    if (p < end_ && *p == '}')
+      return false;
+  } else {
+    p = SkipWhitespace(SkipValue(begin_, cursor, end_), end_);
+    if (p < end_ && *p == '}')
+      return false;
+    if (p >= end_ || *p != ',')
+      ThrowMalformed("expected ',' or '}'", begin_, p);
+    p = SkipWhitespace(p + 1, end_);
+  }
+
+  if (p >= end_ || *p != '"')
+    ThrowMalformed("expected object key", begin_, p);
+  const char* key_end = SkipString(begin_, p, end_);
+  key = std::string_view(p + 1, key_end - p - 2);
+
+  p = SkipWhitespace(key_end, end_);
+  if (p >= end_ || *p != ':')
+    ThrowMalformed("expected ':'", begin_, p);
+  p = SkipWhitespace(p + 1, end_);
+  if (p >= end_)
+    ThrowMalformed("missing value", begin_, p);
+
+  value = LazyValue(begin_, p, end_);
+  cursor = p;
+  return true;
+}
+
+bool LazyValue::NextElement(const char*& cursor, LazyValue& value) const {
+  if (!IsArray())
+    return false;
+
+  const char* p;
+  if (!cursor) {
+    p = SkipWhitespace(pos_ + 1, end_);
+    if (p < end_ && *p == ']')
+      return false;
+  } else {
+    p = SkipWhitespace(SkipValue(begin_, cursor, end_), end_);
+    if (p < end_ && *p == ']')
+      return false;
+    if (p >= end_ || *p != ',')
+      ThrowMalformed("expected ',' or ']'", begin_, p);
+    p = SkipWhitespace(p + 1, end_);
+  }
+
+  if (p >= end_)
+    ThrowMalformed("missing value", begin_, p);
+
+  value = LazyValue(begin_, p, end_);
+  cursor = p;
+  return true;
+}
+
+LazyValue LazyValue::operator[](std::string_view key) const {
+  if (!IsObject())
+    return LazyValue();
+
+  std::string_view member_key;
+  LazyValue value;
+
+  // forward from the last hit
+  const char* cursor = resume_;
+  while (NextMember(cursor, member_key, value)) {
+    if (member_key == key) {
+      resume_ = cursor;
+      return value;
+    }
+  }
+
+  if (!resume_)
+    return LazyValue();
+
+  // wrap around, up to and including the last hit
+  const char* stop = resume_;
+  cursor = nullptr;
+  while (NextMember(cursor, member_key, value)) {
+    if (member_key == key) {
+      resume_ = cursor;
+      return value;
+    }
+    if (cursor == stop)
+      break;
+  }
+  return LazyValue();
+}
+
+LazyValue LazyValue::operator[](size_t index) const {
+  const char* cursor = nullptr;
+  LazyValue value;
+  for (size_t i = 0; NextElement(cursor, value); ++i) {
+    if (i == index)
+      return value;
+  }
+  return LazyValue();
+}
+
+template <typename T>
+T LazyValue::As() const {
+  if constexpr (IsOptional<T>::value) {
+    if (!pos_ || IsNull())
+      return std::nullopt;
+    return As<typename IsOptional<T>::Inner>();
+  } else {
+    if (!pos_) {
+      throw std::runtime_error("JSON value is missing");
+    }
+
+    if constexpr (std::is_same_v<T, std::string_view>) {
+      if (!IsString()) {
+        throw std::runtime_error("JSON value is not a string");
+      }
+      const char* end = SkipString(begin_, pos_, end_);
+      return std::string_view(pos_ + 1, end - pos_ - 2);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      return Unescape(As<std::string_view>());
+    } else if constexpr (std::is_same_v<T, bool>) {
+      auto token = ScalarToken();
+      if (token == "true")
+        return true;
+      if (token == "false")
+        return false;
+      throw std::runtime_error("JSON value is not a boolean");
+    } else if constexpr (std::is_integral_v<T>) {
+      if (!IsNumber()) {
+        throw std::runtime_error("JSON value is not an integer");
+      }
+      auto token = ScalarToken();
+      T result;
+      auto parsed =
+          std::from_chars(token.data(), token.data() + token.size(), result);
+      if (parsed.ec != std::errc() ||
+          parsed.ptr != token.data() + token.size()) {
+        throw std::runtime_error("JSON value is not an integer");
+      }
+      return result;
+    } else if constexpr (std::is_same_v<T, double>) {
+      if (!IsNumber()) {
+        throw std::runtime_error("JSON value is not a double");
+      }
+      // the text isn't null terminated, strtod needs a bounded copy
+      auto token = ScalarToken();
+      char number[64];
+      if (token.size() >= sizeof(number)) {
+        throw std::runtime_error("JSON number is too long");
+      }
+      memcpy(number, token.data(), token.size());
+      number[token.size()] = '\0';
+      char* parsed_end = nullptr;
+      double result = strtod(number, &parsed_end);
+      if (parsed_end != number + token.size()) {
+        throw std::runtime_error("JSON value is not a double");
+      }
+      return result;
+    } else if constexpr (IsVector<T>::value) {
+      if (!IsArray()) {
+        throw std::runtime_error("JSON value is not an array");
+      }
+      T result;
+      ForEach([&result](const LazyValue& element) {
+        result.push_back(element.As<typename IsVector<T>::Inner>());
+      });
+      return result;
+    } else {
+      static_assert(IsVector<T>::value,
+                    "Unsupported type for LazyValue::As");
+    }
+  }
+}
+
+template std::string_view LazyValue::As<std::string_view>() const;
+template std::string LazyValue::As<std::string>() const;
+template bool LazyValue::As<bool>() const;
+template int LazyValue::As<int>() const;
+template int64_t LazyValue::As<int64_t>() const;
+template uint64_t LazyValue::As<uint64_t>() const;
+template double LazyValue::As<double>() const;
+template std::optional<std::string_view>
+LazyValue::As<std::optional<std::string_view>>() const;
+template std::optional<std::string> LazyValue::As<std::optional<std::string>>()
+    const;
+template std::optional<bool> LazyValue::As<std::optional<bool>>() const;
+template std::optional<int> LazyValue::As<std::optional<int>>() const;
+template std::optional<int64_t> LazyValue::As<std::optional<int64_t>>() const;
+template std::optional<double> LazyValue::As<std::optional<double>>() const;
+template std::vector<std::string> LazyValue::As<std::vector<std::string>>()
+    const;
+template std::vector<int> LazyValue::As<std::vector<int>>() const;
+template std::vector<int64_t> LazyValue::As<std::vector<int64_t>>() const;
+template std::vector<double> LazyValue::As<std::vector<double>>() const;
+
+LazyReader::LazyReader(std::string_view text) : root_() {
+  const char* begin = text.data();
+  const char* end = text.data() + text.size();
+  const char* p = SkipWhitespace(begin, end);
+  if (p >= end) {
+    throw ParseError("Invalid JSON: The document is empty.", 0);
+  }
+  root_ = LazyValue(begin, p, end);
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "piconaut/formats/json/value.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+/// @brief View of one value inside a LazyReader document.
+/// Nothing is parsed until asked, lookup skip over the values in between
+/// without building nodes. Object lookup continue from the last found
+/// member, reading fields in document order is a single forward pass.
+///
+/// Keys are compared raw (escaped form), As<std::string_view> return the
+/// raw string content, use As<std::string> to get it unescaped.
+/// Only the parts that are read are validated, malformed json met on the
+/// way throw ParseError.
+class LazyValue {
+ public:
+  LazyValue()
+                  : begin_(nullptr),
+                    pos_(nullptr),
+                    end_(nullptr),
+                    resume_(nullptr) {}
+
+  bool IsMissing() const {
+    return pos_ == nullptr;
+  }
+  bool IsNull() const;
+  bool IsObject() const;
+  bool IsArray() const;
+  bool IsString() const;
+  bool IsBool() const;
+  bool IsNumber() const;
+
+  // Object member, missing value when not found or not an object.
+  LazyValue operator[](std::string_view key) const;
+  // Array element, missing value when out of range or not an array.
+  LazyValue operator[](size_t index) const;
+
+  template <typename T>
+  T As() const;
+
+  // Raw json text of the value.
+  std::string_view Raw() const;
+
+  // fn(const LazyValue& element)
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    const char* cursor = nullptr;
+    LazyValue element;
+    while (NextElement(cursor, element))
+      fn(element);
+  }
+
+  // fn(std::string_view key, const LazyValue& value)
+  template <typename Fn>
+  void ForEachMember(Fn&& fn) const {
+    const char* cursor = nullptr;
+    std::string_view key;
+    LazyValue value;
+    while (NextMember(cursor, key, value))
+      fn(key, value);
+  }
+
+ private:
+  friend class LazyReader;
+
+  const char* begin_;  // document start, for error offsets
+  const char* pos_;
+  const char* end_;
+  // Last found member value, next lookup start after it.
+  mutable const char* resume_;
+
+  LazyValue(const char* begin, const char* pos, const char* end)
+                  : begin_(begin), pos_(pos), end_(end), resume_(nullptr) {}
+
+  bool NextMember(const char*& cursor, std::string_view& key,
+                  LazyValue& value) const;
+  bool NextElement(const char*& cursor, LazyValue& value) const;
+  std::string_view ScalarToken() const;
+};
+
+/// @brief Forward-only on-demand json reader over text it doesn't own.
+/// Use it when only a few fields of a large body are needed, the text
+/// must outlive the reader and every LazyValue taken from it.
+///
+/// ```cpp
+/// auto json = req.LazyJson();
+/// auto event = json["event"].As<std::string_view>();
+/// auto id = json["data"]["object"]["id"].As<int64_t>();
+/// ```
+class LazyReader {
+ public:
+  explicit LazyReader(std::string_view text);
+
+  const LazyValue& Root() const {
+    return root_;
+  }
+
+  LazyValue operator[](std::string_view key) const {
+    return root_[key];
+  }
+
+  LazyValue operator[](size_t index) const {
+    return root_[index];
+  }
+
+ private:
+  LazyValue root_;
+};
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,62 @@
+#include "piconaut/formats/json/size_hint.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+namespace {
+
+thread_local SizeEstimate* t_current_estimate = nullptr;
+
+}  // namespace
+
+void SizeEstimate::Record(size_t size) {
+  // single writer on a loop thread; threads of the shared worker slot
+  // may drop a sample now and then, it's only a hint
+  uint64_t samples = samples_.load(std::memory_order_relaxed);
+  int64_t mean = static_cast<int64_t>(mean_.load(std::memory_order_relaxed));
+  int64_t deviation =
+      static_cast<int64_t>(deviation_.load(std::memory_order_relaxed));
+  int64_t sample = static_cast<int64_t>(size);
+
+  if (samples == 0) {
+    mean = sample;
+    deviation = sample / 2;
+  } else {
+    int64_t error = sample - mean;
+    mean += error / 8;
+    deviation += ((error < 0 ? -error : error) - deviation) / 4;
+  }
+
+  mean_.store(static_cast<uint64_t>(mean), std::memory_order_relaxed);
+  deviation_.store(static_cast<uint64_t>(deviation),
+                   std::memory_order_relaxed);
+  samples_.store(samples + 1, std::memory_order_relaxed);
+}
+
+size_t SizeEstimate::Hint() const {
+  if (Samples() == 0)
+    return 0;
+  return Mean() + 2 * Deviation();
+}
+
+SizeHintScope::SizeHintScope(SizeEstimate* estimate)
+                : previous_(t_current_estimate) {
+  t_current_estimate = estimate;
+}
+
+SizeHintScope::~SizeHintScope() {
+  t_current_estimate = previous_;
+}
+
+size_t CurrentSizeHint() {
+  return t_current_estimate ? t_current_estimate->Hint() : 0;
+}
+
+void RecordSerializedSize(size_t size) {
+  if (t_current_estimate)
+    t_current_estimate->Record(size);
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
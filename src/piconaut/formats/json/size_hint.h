@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+/// @brief Moving estimate of serialized json size, written by one worker.
+/// Same smoothing as TCP RTT estimation: mean with gain 1/8, mean
+/// deviation with gain 1/4, the hint is mean + 2 * deviation.
+/// Fields are relaxed atomics so metrics can read them from any thread.
+class alignas(64) SizeEstimate {
+ public:
+  SizeEstimate() : mean_(0), deviation_(0), samples_(0) {}
+
+  void Record(size_t size);
+
+  // Suggested output capacity, 0 until the first sample.
+  size_t Hint() const;
+
+  size_t Mean() const {
+    return static_cast<size_t>(mean_.load(std::memory_order_relaxed));
+  }
+
+  size_t Deviation() const {
+    return static_cast<size_t>(deviation_.load(std::memory_order_relaxed));
+  }
+
+  uint64_t Samples() const {
+    return samples_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> mean_;
+  std::atomic<uint64_t> deviation_;
+  std::atomic<uint64_t> samples_;
+};
+
+/// @brief Bind an estimate to the calling thread while a handler runs.
+/// ValueBuilder, JsonWriter and ToJson reserve from CurrentSizeHint()
+/// when no capacity is given, and report what they produced.
+class SizeHintScope {
+ public:
+  explicit SizeHintScope(SizeEstimate* estimate);
+  ~SizeHintScope();
+
+  SizeHintScope(const SizeHintScope&) = delete;
+  SizeHintScope& operator=(const SizeHintScope&) = delete;
+
+ private:
+  SizeEstimate* previous_;
+};
+
+// 0 outside a SizeHintScope.
+size_t CurrentSizeHint();
+void RecordSerializedSize(size_t size);
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
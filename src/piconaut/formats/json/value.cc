@@ -1,12 +1,23 @@
 #include "piconaut/formats/json/value.h"
 
+#include <rapidjson/error/en.h>
+
+#include "piconaut/formats/binary/binary_reader.h"
+
 PICONAUT_INNER_NAMESPACE(formats)
 namespace json {
-Value::Value() : allocator_(document_.GetAllocator()), current_value_(&document_), is_empty_(true) {
+Value::Value() : pool_allocator_(), document_(&pool_allocator_), allocator_(document_.GetAllocator()), current_value_(&document_), is_empty_(true) {
   document_.SetObject();
 }
 
-Value::Value(const Value& other) : document_(), allocator_(document_.GetAllocator()), current_value_(&document_), is_empty_(other.is_empty_) {
+Value::Value(void* seed_buffer, size_t seed_capacity)
+                : pool_allocator_(seed_buffer, seed_capacity),
+                  document_(&pool_allocator_),
+                  current_value_(&document_),
+                  allocator_(document_.GetAllocator()),
+                  is_empty_(true) {}
+
+Value::Value(const Value& other) : pool_allocator_(), document_(&pool_allocator_), allocator_(document_.GetAllocator()), current_value_(&document_), is_empty_(other.is_empty_) {
   document_.CopyFrom(other.document_, allocator_);
 }
 
@@ -214,6 +225,13 @@ T Value::As() const {
       throw std::runtime_error("JSON value is not a string");
     }
     return std::string(current_value_->GetString());
+  } else if constexpr (std::is_same_v<T, std::string_view>) {
+    // no copy, view into the parsed text or the document allocator
+    if (!current_value_->IsString()) {
+      throw std::runtime_error("JSON value is not a string");
+    }
+    return std::string_view(current_value_->GetString(),
+                            current_value_->GetStringLength());
   } else if constexpr (std::is_same_v<T, int>) {
     if (!current_value_->IsInt()) {
       throw std::runtime_error("JSON value is not an integer");
@@ -313,6 +331,122 @@ T Value::As() const {
   }
 }
 
+template std::string Value::As<std::string>() const;
+template std::string_view Value::As<std::string_view>() const;
+template int Value::As<int>() const;
+template double Value::As<double>() const;
+template bool Value::As<bool>() const;
+template std::optional<std::string> Value::As<std::optional<std::string>>()
+    const;
+template std::optional<int> Value::As<std::optional<int>>() const;
+template std::optional<double> Value::As<std::optional<double>>() const;
+template std::optional<bool> Value::As<std::optional<bool>>() const;
+template std::vector<Value> Value::As<std::vector<Value>>() const;
+template std::vector<std::string> Value::As<std::vector<std::string>>() const;
+template std::vector<int> Value::As<std::vector<int>>() const;
+template std::vector<double> Value::As<std::vector<double>>() const;
+template std::vector<bool> Value::As<std::vector<bool>>() const;
+
+Value Value::ParseInsitu(char* text, size_t size) {
+  if (!text || text[size] != '\0') {
+    throw std::invalid_argument("Insitu json text must be null terminated");
+  }
+
+  Value value;
+  value.document_.ParseInsitu(text);
+  value.ThrowOnParseError();
+  return value;
+}
+
+Value Value::ParseInsitu(char* text, size_t size, void* seed_buffer,
+                         size_t seed_capacity) {
+  if (!text || text[size] != '\0') {
+    throw std::invalid_argument("Insitu json text must be null terminated");
+  }
+
+  Value value(seed_buffer, seed_capacity);
+  value.document_.ParseInsitu(text);
+  value.ThrowOnParseError();
+  return value;
+}
+
+Value Value::Parse(const std::string& json) {
+  Value value;
+  value.document_.Parse(json.data(), json.size());
+  value.ThrowOnParseError();
+  return value;
+}
+
+Value Value::Decode(Format format, const char* data, size_t size) {
+  Value value;
+  if (format == Format::kJson) {
+    value.document_.Parse(data, size);
+    value.ThrowOnParseError();
+  } else {
+    binary::Decode(format, data, size, value.document_);
+  }
+  return value;
+}
+
+Value Value::Decode(Format format, const char* data, size_t size,
+                    void* seed_buffer, size_t seed_capacity) {
+  Value value(seed_buffer, seed_capacity);
+  if (format == Format::kJson) {
+    value.document_.Parse(data, size);
+    value.ThrowOnParseError();
+  } else {
+    binary::Decode(format, data, size, value.document_);
+  }
+  return value;
+}
+
+void Value::ThrowOnParseError() const {
+  if (!document_.HasParseError())
+    return;
+
+  throw ParseError(
+      std::string("Invalid JSON: ") +
+          rapidjson::GetParseError_En(document_.GetParseError()) +
+          " (offset " + std::to_string(document_.GetErrorOffset()) + ")",
+      document_.GetErrorOffset());
+}
+
+const rapidjson::Value* Value::Find(const Path& path) const {
+  return path.Native().Get(document_);
+}
+
+bool Value::Has(const Path& path) const {
+  return Find(path) != nullptr;
+}
+
+std::optional<std::string_view> Value::GetString(const Path& path) const {
+  auto node = Find(path);
+  if (!node || !node->IsString())
+    return std::nullopt;
+  return std::string_view(node->GetString(), node->GetStringLength());
+}
+
+std::optional<int64_t> Value::GetInt64(const Path& path) const {
+  auto node = Find(path);
+  if (!node || !node->IsInt64())
+    return std::nullopt;
+  return node->GetInt64();
+}
+
+std::optional<double> Value::GetDouble(const Path& path) const {
+  auto node = Find(path);
+  if (!node || !node->IsNumber())
+    return std::nullopt;
+  return node->GetDouble();
+}
+
+std::optional<bool> Value::GetBool(const Path& path) const {
+  auto node = Find(path);
+  if (!node || !node->IsBool())
+    return std::nullopt;
+  return node->GetBool();
+}
+
 std::vector<uint8_t> Value::SerializeToBytes() const {
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
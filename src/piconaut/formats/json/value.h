@@ -2,6 +2,7 @@
 
 
 #include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <iostream>
@@ -9,13 +10,48 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <string_view>
 
+#include "piconaut/formats/format.h"
 #include "piconaut/macro.h"
 
 PICONAUT_INNER_NAMESPACE(formats)
 namespace json {
 
+/// @brief Malformed json text, carry the rapidjson error offset.
+/// Request handlers let it propagate, the handler callback turns it
+/// into 400 Bad Request.
+class ParseError : public std::runtime_error {
+ public:
+  ParseError(const std::string& message, size_t offset)
+                  : std::runtime_error(message), offset_(offset) {}
+
+  size_t Offset() const {
+    return offset_;
+  }
+
+ private:
+  size_t offset_;
+};
+
+/// @brief Precompiled JSON Pointer (RFC 6901), e.g. "/user/address/city".
+/// Tokenized once, keep it static and reuse it across requests.
+class Path {
+ public:
+  explicit Path(const char* pointer) : pointer_(pointer) {
+    if (!pointer_.IsValid()) {
+      throw std::invalid_argument("Invalid JSON pointer: " +
+                                  std::string(pointer));
+    }
+  }
 
+  const rapidjson::Pointer& Native() const {
+    return pointer_;
+  }
+
+ private:
+  rapidjson::Pointer pointer_;
+};
 
 class Value {
  public:
@@ -42,18 +78,45 @@ class Value {
   template <typename T>
   T As() const;
 
+  // Parse json text in place, the text is modified and string values
+  // point into it, so the text must outlive the Value (and its copies).
+  // text[size] must be '\0'. Throw ParseError on malformed json.
+  static Value ParseInsitu(char* text, size_t size);
+  // Same as above with the DOM nodes allocated from caller owned memory
+  // first (e.g. the request pool), must be pointer aligned.
+  static Value ParseInsitu(char* text, size_t size, void* seed_buffer,
+                           size_t seed_capacity);
+  // Parse a copy of the json text. Throw ParseError on malformed json.
+  static Value Parse(const std::string& json);
+  // Decode MessagePack or CBOR (Format::kJson parse a copy of the text),
+  // strings are copied. Throw ParseError on malformed input.
+  static Value Decode(Format format, const char* data, size_t size);
+  static Value Decode(Format format, const char* data, size_t size,
+                      void* seed_buffer, size_t seed_capacity);
+
+  // Lookup by precompiled pointer from the document root, cost O(depth).
+  // Missing path or different type return std::nullopt.
+  bool Has(const Path& path) const;
+  std::optional<std::string_view> GetString(const Path& path) const;
+  std::optional<int64_t> GetInt64(const Path& path) const;
+  std::optional<double> GetDouble(const Path& path) const;
+  std::optional<bool> GetBool(const Path& path) const;
+
   std::vector<uint8_t> SerializeToBytes() const;
 
  private:
+  rapidjson::MemoryPoolAllocator<> pool_allocator_;
   rapidjson::Document document_;
   rapidjson::Value* current_value_;
   rapidjson::Document::AllocatorType& allocator_;
   bool is_empty_;
 
+  Value(void* seed_buffer, size_t seed_capacity);
+
   void Init();
+  void ThrowOnParseError() const;
+  const rapidjson::Value* Find(const Path& path) const;
 };
 
-
-
 }  // namespace json
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
@@ -1,9 +1,34 @@
 #include "piconaut/formats/json/value_builder.h"
 
+#include "piconaut/formats/binary/binary_writer.h"
+#include "piconaut/formats/json/size_hint.h"
+#include "piconaut/utils/hash.h"
+
+#include <cstring>
+#include <new>
+
 PICONAUT_INNER_NAMESPACE(formats)
 namespace json {
 ValueBuilder::ValueBuilder()
-                : allocator_(document_.GetAllocator()),
+                : retained_(),
+                  seed_buffer_(nullptr),
+                  seed_capacity_(0),
+                  pool_allocator_(),
+                  document_(&pool_allocator_),
+                  allocator_(document_.GetAllocator()),
+                  current_value_(&document_),
+                  is_empty_(true),
+                  current_type_(JsonValueType::kUnknown) {
+  document_.SetObject();
+}
+
+ValueBuilder::ValueBuilder(void* seed_buffer, size_t seed_capacity)
+                : retained_(),
+                  seed_buffer_(seed_buffer),
+                  seed_capacity_(seed_capacity),
+                  pool_allocator_(seed_buffer, seed_capacity),
+                  document_(&pool_allocator_),
+                  allocator_(document_.GetAllocator()),
                   current_value_(&document_),
                   is_empty_(true),
                   current_type_(JsonValueType::kUnknown) {
@@ -11,12 +36,17 @@ ValueBuilder::ValueBuilder()
 }
 
 ValueBuilder::ValueBuilder(const ValueBuilder& other)
-                : document_(),
+                : retained_(),
+                  seed_buffer_(nullptr),
+                  seed_capacity_(0),
+                  pool_allocator_(),
+                  document_(&pool_allocator_),
                   allocator_(document_.GetAllocator()),
                   current_value_(&document_),
                   is_empty_(other.is_empty_),
                   current_type_(JsonValueType::kUnknown) {
-  document_.CopyFrom(other.document_, allocator_);
+  // copyConstStrings, adopted strings belong to `other`
+  document_.CopyFrom(other.document_, allocator_, true);
 }
 
 // ValueBuilder::~ValueBuilder() {}
@@ -39,7 +69,7 @@ ValueBuilder& ValueBuilder::operator=(const ValueBuilder& other) {
   }
 
   auto node = GetNodeValue();
-  node->CopyFrom(other.document_, allocator_);
+  node->CopyFrom(other.document_, allocator_, true);
   current_type_ =
       static_cast<JsonValueType>(static_cast<int>(other.document_.GetType()));
   current_value_ = node;
@@ -63,6 +93,20 @@ ValueBuilder& ValueBuilder::operator=(const ValueBuilder& other) {
 //
 // ```
 ValueBuilder& ValueBuilder::operator[](const std::string& key) {
+  return SelectMember(key.data(), key.size(), 0, true);
+}
+
+ValueBuilder& ValueBuilder::operator[](std::string_view key) {
+  return SelectMember(key.data(), key.size(), 0, true);
+}
+
+ValueBuilder& ValueBuilder::operator[](const JsonKey& key) {
+  return SelectMember(key.Data(), key.Size(), key.Hash(), false);
+}
+
+// hash 0 means not computed yet, only needed for wide objects.
+ValueBuilder& ValueBuilder::SelectMember(const char* key, size_t size,
+                                         uint64_t hash, bool copy_key) {
   if (is_empty_) {
     document_.SetObject();
     is_empty_ = false;
@@ -74,20 +118,102 @@ ValueBuilder& ValueBuilder::operator[](const std::string& key) {
   // ```GetNodeValue()``` will determine which node to pointing.
 
   rapidjson::Value* node_value = GetNodeValue();
-  if (!node_value->HasMember(key.c_str())) {
-    rapidjson::Value json_key(key.c_str(), allocator_);
+  if (node_value->MemberCount() >= kMemberIndexThreshold && hash == 0)
+    hash = utils::hash::Fnv1a64(key, size);
+
+  auto member = FindMember(node_value, key, size, hash);
+  if (!member) {
+    auto key_size = static_cast<rapidjson::SizeType>(size);
+    rapidjson::Value json_key =
+        copy_key ? rapidjson::Value(key, key_size, allocator_)
+                 : rapidjson::Value(rapidjson::StringRef(key, key_size));
     node_value->AddMember(json_key, rapidjson::Value(), allocator_);
+
+    auto index = node_value->MemberCount() - 1;
+    member = &*(node_value->MemberBegin() + index);
     current_type_ = JsonValueType::kUnknown;
-    current_value_ = &(*node_value)[key.c_str()];
+
+    if (index + 1 >= kMemberIndexThreshold) {
+      if (hash == 0)
+        hash = utils::hash::Fnv1a64(key, size);
+      member_index_[utils::hash::Combine(
+          reinterpret_cast<uintptr_t>(node_value), hash)] = index;
+    }
   } else {
-    current_value_ = &(*node_value)[key.c_str()];
-    current_type_ = static_cast<JsonValueType>(current_value_->GetType());
+    current_type_ = static_cast<JsonValueType>(member->value.GetType());
   }
 
-  value_nodes_.emplace_back(std::string(key), current_value_);
+  current_value_ = &member->value;
+  value_nodes_.emplace_back(current_value_);
   return *this;
 }
 
+rapidjson::Value::Member* ValueBuilder::FindMember(rapidjson::Value* object,
+                                                   const char* key,
+                                                   size_t size,
+                                                   uint64_t hash) {
+  auto key_size = static_cast<rapidjson::SizeType>(size);
+  if (object->MemberCount() >= kMemberIndexThreshold) {
+    auto slot = member_index_.find(
+        utils::hash::Combine(reinterpret_cast<uintptr_t>(object), hash));
+    if (slot != member_index_.end() && slot->second < object->MemberCount()) {
+      auto member = object->MemberBegin() + slot->second;
+      if (member->name.GetStringLength() == key_size &&
+          memcmp(member->name.GetString(), key, size) == 0)
+        return &*member;
+    }
+  }
+
+  // length is known, rapidjson compare it before the bytes
+  rapidjson::Value name(rapidjson::StringRef(key, key_size));
+  auto member = object->FindMember(name);
+  if (member == object->MemberEnd())
+    return nullptr;
+
+  if (object->MemberCount() >= kMemberIndexThreshold) {
+    member_index_[utils::hash::Combine(reinterpret_cast<uintptr_t>(object),
+                                       hash)] =
+        static_cast<uint32_t>(member - object->MemberBegin());
+  }
+  return &*member;
+}
+
+void ValueBuilder::Reset() {
+  // Retain the high-water mark, only for builder owned memory.
+  // Caller seeded builder (e.g. RequestArena) keep using the caller seed.
+  // The old chunk is still used by the allocator, it is freed on return.
+  std::unique_ptr<char[]> released;
+  size_t capacity = pool_allocator_.Capacity();
+  if (!seed_buffer_ || retained_) {
+    if (capacity > seed_capacity_) {
+      // rapidjson chunk & shared header live inside the buffer too
+      seed_capacity_ = capacity + kRetainedHeaderReserve;
+      released = std::move(retained_);
+      retained_.reset(new char[seed_capacity_]);
+      seed_buffer_ = retained_.get();
+    }
+  }
+
+  // Drop every node before the allocator release the chunks
+  document_.SetNull();
+  value_nodes_.clear();
+  adopted_strings_.clear();
+  member_index_.clear();
+
+  pool_allocator_.~MemoryPoolAllocator<>();
+  if (seed_buffer_) {
+    new (&pool_allocator_)
+        rapidjson::MemoryPoolAllocator<>(seed_buffer_, seed_capacity_);
+  } else {
+    new (&pool_allocator_) rapidjson::MemoryPoolAllocator<>();
+  }
+
+  document_.SetObject();
+  current_value_ = &document_;
+  is_empty_ = true;
+  current_type_ = JsonValueType::kUnknown;
+}
+
 // overload = operators
 
 void ValueBuilder::CreateJsonObject() {
@@ -251,32 +377,153 @@ void ValueBuilder::operator=(const char* value) {
   value_nodes_.clear();
 }
 
-JsonBuffer ValueBuilder::SerializeToBytes() const {
-  JsonBuffer buffer;
-  buffer.buffer = std::move(std::make_shared<rapidjson::StringBuffer>());
+void ValueBuilder::AssignNull() {
+  if (is_empty_) {
+    document_.SetObject();
+    is_empty_ = false;
+  }
+
+  if (!current_value_)
+    return;
+
+  if (current_type_ == JsonValueType::kUnknown ||
+      current_type_ == JsonValueType::kNullType) {
+    current_type_ = JsonValueType::kNullType;
+    current_value_->SetNull();
+  } else {
+    std::cerr << "Can't change the type initialized previously!";
+  }
+
+  // must clear the nodes when do assignment
+  value_nodes_.clear();
+}
+
+void ValueBuilder::operator=(const std::optional<std::string>& value) {
+  if (value.has_value()) {
+    *this = value.value();
+  } else {
+    AssignNull();
+  }
+}
+
+void ValueBuilder::operator=(const std::optional<int>& value) {
+  if (value.has_value()) {
+    *this = value.value();
+  } else {
+    AssignNull();
+  }
+}
+
+void ValueBuilder::operator=(const std::optional<double>& value) {
+  if (value.has_value()) {
+    *this = value.value();
+  } else {
+    AssignNull();
+  }
+}
 
-  rapidjson::Writer<rapidjson::StringBuffer> writer(*buffer.buffer);
+void ValueBuilder::operator=(const std::optional<bool>& value) {
+  if (value.has_value()) {
+    *this = value.value();
+  } else {
+    AssignNull();
+  }
+}
+
+rapidjson::Value* ValueBuilder::BeginArray(size_t reserve) {
+  if (is_empty_) {
+    document_.SetObject();
+    is_empty_ = false;
+  }
+
+  if (!current_value_ || current_value_ == &document_)
+    return nullptr;
+
+  if (current_type_ != JsonValueType::kUnknown &&
+      current_type_ != JsonValueType::kArrayType) {
+    std::cerr << "Can't change the type initialized previously!";
+    return nullptr;
+  }
+
+  current_type_ = JsonValueType::kArrayType;
+  current_value_->SetArray();
+  if (reserve > 0)
+    current_value_->Reserve(static_cast<rapidjson::SizeType>(reserve),
+                            allocator_);
+  return current_value_;
+}
+
+void ValueBuilder::operator=(const std::vector<std::string>& value) {
+  Assign(value);
+}
+
+void ValueBuilder::operator=(std::vector<std::string>&& value) {
+  rapidjson::Value* array = BeginArray(value.size());
+  if (array) {
+    // Moving the vector keep every string (and its SSO bytes) in place,
+    // the document only reference them.
+    adopted_strings_.push_back(std::move(value));
+    for (const auto& item : adopted_strings_.back()) {
+      array->PushBack(
+          rapidjson::Value(rapidjson::StringRef(
+              item.data(), static_cast<rapidjson::SizeType>(item.size()))),
+          allocator_);
+    }
+  }
+
+  // must clear the nodes when do assignment
+  value_nodes_.clear();
+}
+
+void ValueBuilder::operator=(const std::vector<int>& value) {
+  Assign(value);
+}
+
+void ValueBuilder::operator=(const std::vector<int64_t>& value) {
+  Assign(value);
+}
+
+void ValueBuilder::operator=(const std::vector<double>& value) {
+  Assign(value);
+}
+
+void ValueBuilder::operator=(const std::vector<bool>& value) {
+  Assign(value);
+}
+
+JsonBuffer ValueBuilder::SerializeToBytes(size_t capacity_hint) const {
+  JsonBuffer buffer(capacity_hint ? capacity_hint : CurrentSizeHint());
+
+  rapidjson::Writer<JsonBuffer> writer(buffer);
   if (!document_.Accept(writer)) {
     throw std::runtime_error("Failed to serialize JSON document.");
   }
 
-  buffer.data = buffer.buffer->GetString();
-  buffer.size = buffer.buffer->GetSize();
-  return __PCN_RETURN_MOVE(buffer);
+  RecordSerializedSize(buffer.Size());
+  return buffer;
 }
 
-JsonBuffer ValueBuilder::SerializePrettyToBytes() const {
-  JsonBuffer buffer;
-  buffer.buffer = std::move(std::make_shared<rapidjson::StringBuffer>());
+JsonBuffer ValueBuilder::SerializePrettyToBytes(size_t capacity_hint) const {
+  JsonBuffer buffer(capacity_hint ? capacity_hint : CurrentSizeHint());
 
-  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(*buffer.buffer);
+  rapidjson::PrettyWriter<JsonBuffer> writer(buffer);
   if (!document_.Accept(writer)) {
     throw std::runtime_error("Failed to serialize JSON document.");
   }
 
-  buffer.data = buffer.buffer->GetString();
-  buffer.size = buffer.buffer->GetSize();
-  return __PCN_RETURN_MOVE(buffer);
+  RecordSerializedSize(buffer.Size());
+  return buffer;
+}
+
+JsonBuffer ValueBuilder::Serialize(Format format, size_t capacity_hint) const {
+  if (format == Format::kJson)
+    return SerializeToBytes(capacity_hint);
+
+  // Counts are known from the DOM, containers get the compact header
+  binary::BinaryWriter writer(format, capacity_hint);
+  writer.Value(static_cast<const rapidjson::Value&>(document_));
+  return writer.Finish();
 }
+
 }  // namespace json
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
@@ -5,37 +5,29 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include <memory>
+#include "piconaut/formats/format.h"
+#include "piconaut/formats/json/json_buffer.h"
+#include "piconaut/formats/json/json_key.h"
 #include "piconaut/macro.h"
 
 PICONAUT_INNER_NAMESPACE(formats)
 namespace json {
 
-struct JsonBuffer {
-  const char* data;
-  size_t size;
-  std::shared_ptr<rapidjson::StringBuffer> buffer;
-
-  explicit JsonBuffer() : data(nullptr), size(), buffer(nullptr) {}
-
-  std::string ToString() const {
-    if (!buffer)
-      return std::string();
-    return __PCN_RETURN_MOVE(std::string(data, size));
-  }
-};
-
 struct JsonBuilderNode {
-  std::string key;
   rapidjson::Value* value;
 
-  JsonBuilderNode(const std::string& key, rapidjson::Value* value)
-                  : key(key), value(value) {}
+  explicit JsonBuilderNode(rapidjson::Value* value) : value(value) {}
 };
 
 enum class JsonValueType {
@@ -51,10 +43,24 @@ enum class JsonValueType {
 class ValueBuilder {
  public:
   ValueBuilder();
+  // Seed the json allocator with caller owned memory (e.g. RequestArena).
+  // Buffer must outlive the builder and be pointer aligned.
+  ValueBuilder(void* seed_buffer, size_t seed_capacity);
   ValueBuilder(const ValueBuilder& other);  // Copy constructor
   ValueBuilder& operator=(
       const ValueBuilder& other);  // Copy assignment operator
+  // Runtime keys, char arrays included, are copied into the document.
   ValueBuilder& operator[](const std::string& key);
+  ValueBuilder& operator[](std::string_view key);
+  template <typename T, typename = std::enable_if_t<
+                            std::is_same_v<T, const char*> ||
+                            std::is_same_v<T, char*>>>
+  ValueBuilder& operator[](T key) {
+    return (*this)[std::string_view(key)];
+  }
+  // JsonKey (PICONAUT_JSON_KEY for literals) is referenced, never copied,
+  // with length and hash computed at compile time.
+  ValueBuilder& operator[](const JsonKey& key);
 
   void operator=(const std::string& value);
   void operator=(const char* value);
@@ -63,29 +69,116 @@ class ValueBuilder {
   void operator=(float value);
   void operator=(double value);
   void operator=(bool value);
-  // void operator=(const std::optional<std::string>& value);
-  // void operator=(const std::optional<int>& value);
-  // void operator=(const std::optional<double>& value);
-  // void operator=(const std::optional<bool>& value);
+  // std::nullopt is written as null
+  void operator=(const std::optional<std::string>& value);
+  void operator=(const std::optional<int>& value);
+  void operator=(const std::optional<double>& value);
+  void operator=(const std::optional<bool>& value);
   // void operator=(const std::vector<ValueBuilder>& value);
-  // void operator=(const std::vector<std::string>& value);
-  // void operator=(const std::vector<int>& value);
-  // void operator=(const std::vector<double>& value);
-  // void operator=(const std::vector<bool>& value);
+  void operator=(const std::vector<std::string>& value);
+  // Strings are adopted by the builder and referenced, not copied.
+  void operator=(std::vector<std::string>&& value);
+  void operator=(const std::vector<int>& value);
+  void operator=(const std::vector<int64_t>& value);
+  void operator=(const std::vector<double>& value);
+  void operator=(const std::vector<bool>& value);
+
+  // Bulk assign numbers, bools or strings as json array.
+  // Capacity is reserved up front for forward iterators.
+  // ```cpp
+  // json["ids"].Assign(ids.begin(), ids.end());
+  // json["names"].Assign(names);  // any container with begin / end
+  // ```
+  // For arrays too large to materialize, stream them with
+  // JsonWriter::Values() instead.
+  template <typename Iterator>
+  void Assign(Iterator first, Iterator last) {
+    using Category =
+        typename std::iterator_traits<Iterator>::iterator_category;
+    size_t reserve = 0;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>)
+      reserve = static_cast<size_t>(std::distance(first, last));
+
+    rapidjson::Value* array = BeginArray(reserve);
+    if (array) {
+      for (; first != last; ++first)
+        array->PushBack(MakeArrayItem(*first), allocator_);
+    }
+
+    // must clear the nodes when do assignment
+    value_nodes_.clear();
+  }
+
+  template <typename Range>
+  void Assign(const Range& range) {
+    Assign(std::begin(range), std::end(range));
+  }
 
   void CreateJsonObject();
+
+  // Clear the json to empty object for reuse.
+  // Allocator memory & node capacity are kept, when the previous build
+  // spilled over the retained chunk, the chunk grow to the high-water mark
+  // so the next build of similar size doesn't malloc at all.
+  void Reset();
   
-  JsonBuffer SerializeToBytes() const;
-  JsonBuffer SerializePrettyToBytes() const;
+  // capacity_hint pre-size the output, 0 use the route size estimate
+  // when called inside a dispatched handler.
+  JsonBuffer SerializeToBytes(size_t capacity_hint = 0) const;
+  JsonBuffer SerializePrettyToBytes(size_t capacity_hint = 0) const;
+  // Same document as MessagePack or CBOR (json for Format::kJson).
+  JsonBuffer Serialize(Format format, size_t capacity_hint = 0) const;
 
  private:
+  // Seed memory is declared before the allocator using it, so it is
+  // destroyed after the allocator released its chunks.
+  std::unique_ptr<char[]> retained_;
+  void* seed_buffer_;
+  size_t seed_capacity_;
+  rapidjson::MemoryPoolAllocator<> pool_allocator_;
   rapidjson::Document document_;
   rapidjson::Value* current_value_;
   rapidjson::Document::AllocatorType& allocator_;
   bool is_empty_;
   JsonValueType current_type_;
   std::vector<JsonBuilderNode> value_nodes_;
+  // Moved-in strings referenced by the document as const strings
+  std::vector<std::vector<std::string>> adopted_strings_;
+  // (object, key hash) -> member index, only for wide objects.
+  // Entries are verified on use, stale ones fall back to a scan.
+  std::unordered_map<uint64_t, uint32_t> member_index_;
   rapidjson::Value* GetNodeValue();
+  ValueBuilder& SelectMember(const char* key, size_t size, uint64_t hash,
+                             bool copy_key);
+  rapidjson::Value::Member* FindMember(rapidjson::Value* object,
+                                      const char* key, size_t size,
+                                      uint64_t hash);
+  // Turn current node into an empty array, nullptr when typed otherwise.
+  rapidjson::Value* BeginArray(size_t reserve);
+  void AssignNull();
+
+  template <typename T>
+  rapidjson::Value MakeArrayItem(const T& item) {
+    if constexpr (std::is_same_v<T, bool>) {
+      return rapidjson::Value(item);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      return rapidjson::Value(static_cast<int64_t>(item));
+    } else if constexpr (std::is_integral_v<T>) {
+      return rapidjson::Value(static_cast<uint64_t>(item));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return rapidjson::Value(static_cast<double>(item));
+    } else {
+      static_assert(std::is_convertible_v<const T&, std::string_view>,
+                    "json array item must be number, bool or string");
+      std::string_view str(item);
+      return rapidjson::Value(str.data(),
+                              static_cast<rapidjson::SizeType>(str.size()),
+                              allocator_);
+    }
+  }
+
+  static constexpr size_t kRetainedHeaderReserve = 256;
+  static constexpr size_t kMemberIndexThreshold = 16;
 };
 
 }  // namespace json
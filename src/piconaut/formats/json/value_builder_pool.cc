@@ -0,0 +1,72 @@
+#include "piconaut/formats/json/value_builder_pool.h"
+
+#include <atomic>
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+namespace {
+
+std::atomic<size_t> g_max_idle{16};
+
+std::vector<std::unique_ptr<ValueBuilder>>& IdleBuilders() {
+  static thread_local std::vector<std::unique_ptr<ValueBuilder>> idle;
+  return idle;
+}
+
+}  // namespace
+
+PooledValueBuilder::PooledValueBuilder(std::unique_ptr<ValueBuilder> builder)
+                : builder_(std::move(builder)) {}
+
+PooledValueBuilder::PooledValueBuilder(PooledValueBuilder&& other) noexcept
+                : builder_(std::move(other.builder_)) {}
+
+PooledValueBuilder& PooledValueBuilder::operator=(
+    PooledValueBuilder&& other) noexcept {
+  if (this != &other) {
+    if (builder_)
+      ValueBuilderPool::Release(std::move(builder_));
+    builder_ = std::move(other.builder_);
+  }
+  return *this;
+}
+
+PooledValueBuilder::~PooledValueBuilder() {
+  if (builder_)
+    ValueBuilderPool::Release(std::move(builder_));
+}
+
+PooledValueBuilder ValueBuilderPool::Acquire() {
+  auto& idle = IdleBuilders();
+  if (idle.empty())
+    return PooledValueBuilder(std::make_unique<ValueBuilder>());
+
+  auto builder = std::move(idle.back());
+  idle.pop_back();
+  return PooledValueBuilder(std::move(builder));
+}
+
+void ValueBuilderPool::Release(std::unique_ptr<ValueBuilder> builder) {
+  auto& idle = IdleBuilders();
+  if (idle.size() >= g_max_idle.load(std::memory_order_relaxed))
+    return;
+
+  builder->Reset();
+  idle.push_back(std::move(builder));
+}
+
+void ValueBuilderPool::MaxIdle(size_t max_idle) {
+  g_max_idle.store(max_idle, std::memory_order_relaxed);
+}
+
+size_t ValueBuilderPool::MaxIdle() {
+  return g_max_idle.load(std::memory_order_relaxed);
+}
+
+size_t ValueBuilderPool::IdleCount() {
+  return IdleBuilders().size();
+}
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
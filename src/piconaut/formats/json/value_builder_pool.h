@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "piconaut/formats/json/value_builder.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+namespace json {
+
+class ValueBuilderPool;
+
+/// @brief Borrowed builder, go back to the thread pool when destroyed.
+class PooledValueBuilder {
+ public:
+  PooledValueBuilder(PooledValueBuilder&& other) noexcept;
+  PooledValueBuilder& operator=(PooledValueBuilder&& other) noexcept;
+  ~PooledValueBuilder();
+
+  PooledValueBuilder(const PooledValueBuilder&) = delete;
+  PooledValueBuilder& operator=(const PooledValueBuilder&) = delete;
+
+  ValueBuilder& Get() const {
+    return *builder_;
+  }
+
+  ValueBuilder& operator*() const {
+    return *builder_;
+  }
+
+  ValueBuilder* operator->() const {
+    return builder_.get();
+  }
+
+  // Forward every ValueBuilder key overload (literal keys stay uncopied)
+  template <typename Key>
+  ValueBuilder& operator[](Key&& key) const {
+    return (*builder_)[std::forward<Key>(key)];
+  }
+
+ private:
+  explicit PooledValueBuilder(std::unique_ptr<ValueBuilder> builder);
+
+  std::unique_ptr<ValueBuilder> builder_;
+
+  friend class ValueBuilderPool;
+};
+
+/// @brief Thread local pool of warm ValueBuilder.
+/// Borrowed builder already carry the allocator chunk & node capacity
+/// from its previous use.
+/// ```cpp
+/// auto json = formats::json::ValueBuilderPool::Acquire();
+/// json["status"] = 200;
+/// res.SendJson(json->SerializeToBytes());
+/// ```
+class ValueBuilderPool {
+ public:
+  static PooledValueBuilder Acquire();
+
+  // Idle builders kept per thread, default 16
+  static void MaxIdle(size_t max_idle);
+  static size_t MaxIdle();
+  static size_t IdleCount();
+
+ private:
+  static void Release(std::unique_ptr<ValueBuilder> builder);
+
+  friend class PooledValueBuilder;
+};
+
+}  // namespace json
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "piconaut/formats/binary/binary_writer.h"
+#include "piconaut/formats/format.h"
+#include "piconaut/formats/json/json_fields.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(formats)
+
+// Serialize a PICONAUT_JSON_FIELDS type (or container of it) in any
+// supported format. capacity_hint 0 use the route size estimate.
+template <typename T>
+json::JsonBuffer Serialize(const T& value, Format format,
+                           size_t capacity_hint = 0) {
+  if (format == Format::kJson)
+    return json::ToJson(value, capacity_hint);
+
+  binary::BinaryWriter writer(format, capacity_hint);
+  json::JsonWrite(writer, value);
+  return writer.Finish();
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -1,38 +1,285 @@
 #pragma once
 
+#include <algorithm>
+#include <iostream>
 #include <mutex>
+#include <stdexcept>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "piconaut/cache/response_cache.h"
+#include "piconaut/cache/single_flight.h"
 #include "piconaut/handlers/handler_base.h"
+#include "piconaut/http/cors.h"
 #include "piconaut/macro.h"
+#include "piconaut/metrics/loop_monitor.h"
+#include "piconaut/metrics/route_metrics.h"
+#include "piconaut/middleware/middleware_chain.h"
 #include "piconaut/routers/router.h"
 PICONAUT_INNER_NAMESPACE(handlers)
 
+// Serialized json size estimate of a route, merged across workers.
+struct RouteSizeHint {
+  std::string path;
+  size_t hint;
+  size_t mean;
+  uint64_t samples;
+};
+
+// Merged request metrics of a route, path "" for unmatched requests.
+struct RouteMetricsSnapshot {
+  std::string path;
+  metrics::RouteSnapshot stats;
+};
+
+// Adaptive concurrency limit state of a route.
+struct RouteConcurrency {
+  std::string path;
+  size_t limit;
+  size_t in_flight;
+  uint64_t rejected;
+};
+
 class GlobalDispatcherHandler : public HandlerBase {
  public:
-  GlobalDispatcherHandler() : router_(), routes_(), hasher_(), mutex_() {}
+  GlobalDispatcherHandler()
+                  : router_(),
+                    routes_(),
+                    hasher_(),
+                    mutex_(),
+                    cache_(),
+                    flights_(),
+                    compressions_(),
+                    default_compression_(),
+                    global_middlewares_(),
+                    prefix_middlewares_(),
+                    route_middlewares_(),
+                    frozen_(false),
+                    cors_(),
+                    default_cors_(),
+                    limits_(),
+                    default_limit_(),
+                    unmatched_metrics_() {}
   ~GlobalDispatcherHandler(){};
 
   void RegisterRouteHandler(const std::string& path,
                             std::shared_ptr<HandlerBase> handler) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
     auto key = hasher_(path);
     router_.AddRoute(key, path, GlobalDispatcherHandler::Dispatcher);
     routes_.emplace(key, std::make_shared<routers::Route>(key, path, handler));
   }
 
+  // Opt-in response cache for route path registered by RegisterRouteHandler.
+  // Only GET requests are served from the cache.
+  void EnableRouteCache(const std::string& path,
+                        const cache::CachePolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    if (!cache_)
+      cache_ = std::make_unique<cache::ResponseCache>();
+    cache_->EnableRoute(hasher_(path), policy);
+  }
+
+  // Opt-in coalescing of identical concurrent GET on route path, the
+  // duplicates are answered with the first request response.
+  void EnableRouteSingleFlight(const std::string& path,
+                               const cache::SingleFlightPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    if (!flights_)
+      flights_ = std::make_unique<cache::SingleFlight>();
+    flights_->EnableRoute(hasher_(path), policy);
+  }
+
+  // Compression policy for route path, override the default policy.
+  void EnableRouteCompression(const std::string& path,
+                              const http::CompressionPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    compressions_[hasher_(path)] = policy;
+  }
+
+  // Server wide compression policy, nullptr disable it.
+  void DefaultCompression(std::unique_ptr<http::CompressionPolicy> policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    default_compression_ = std::move(policy);
+  }
+
+  // CORS policy for route path, override the default policy.
+  void EnableRouteCors(const std::string& path,
+                       const http::CorsPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    cors_[hasher_(path)] = std::make_unique<http::Cors>(policy);
+  }
+
+  // Server wide CORS policy, nullptr disable it.
+  void DefaultCors(std::unique_ptr<http::CorsPolicy> policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    default_cors_ = policy ? std::make_unique<http::Cors>(*policy) : nullptr;
+  }
+
+  // Adaptive concurrency limit for route path, override the default.
+  void EnableRouteConcurrencyLimit(const std::string& path,
+                                   const routers::ConcurrencyPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    limits_[hasher_(path)] = policy;
+  }
+
+  // Concurrency limit applied to every route, each route get its own
+  // limiter. nullptr disable it.
+  void DefaultConcurrencyLimit(
+      std::unique_ptr<routers::ConcurrencyPolicy> policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    default_limit_ = std::move(policy);
+  }
+
+  // Middleware for every request, unmatched path included.
+  void UseMiddleware(std::shared_ptr<middleware::MiddlewareBase> middleware) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    global_middlewares_.Add(std::move(middleware));
+  }
+
+  // Middleware for routes registered under `prefix`, e.g. "/api".
+  void UsePrefixMiddleware(
+      const std::string& prefix,
+      std::shared_ptr<middleware::MiddlewareBase> middleware) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    auto it = std::find_if(
+        prefix_middlewares_.begin(), prefix_middlewares_.end(),
+        [&](const auto& item) { return item.first == prefix; });
+    if (it == prefix_middlewares_.end()) {
+      prefix_middlewares_.emplace_back(prefix, middleware::MiddlewareChain());
+      it = std::prev(prefix_middlewares_.end());
+    }
+    it->second.Add(std::move(middleware));
+  }
+
+  // Middleware for one route path registered by RegisterRouteHandler.
+  void UseRouteMiddleware(
+      const std::string& path,
+      std::shared_ptr<middleware::MiddlewareBase> middleware) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThrowIfFrozen();
+    route_middlewares_[hasher_(path)].Add(std::move(middleware));
+  }
+
+  // Flatten the middleware stack of every route, called once before the
+  // server accepts requests. Registration is rejected afterwards.
+  void Freeze() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frozen_)
+      return;
+
+    // Outer prefix first, then registration order
+    auto prefixes = prefix_middlewares_;
+    std::stable_sort(prefixes.begin(), prefixes.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.first.size() < b.first.size();
+                     });
+
+    for (auto& item : routes_) {
+      auto& route = item.second;
+      middleware::MiddlewareChain chain;
+      chain.Append(global_middlewares_);
+      for (const auto& prefix : prefixes) {
+        if (middleware::IsUnderPrefix(route->Path(), prefix.first))
+          chain.Append(prefix.second);
+      }
+      auto it = route_middlewares_.find(item.first);
+      if (it != route_middlewares_.end())
+        chain.Append(it->second);
+      route->Middlewares(std::move(chain));
+
+      auto limit = limits_.find(item.first);
+      const routers::ConcurrencyPolicy* policy =
+          limit != limits_.end() ? &limit->second : default_limit_.get();
+      if (policy)
+        route->Limiter(std::make_unique<routers::ConcurrencyLimiter>(*policy));
+    }
+    frozen_ = true;
+  }
+
   routers::Router& Router() {
     return router_;
   }
 
+  // Snapshot for metrics, reads the per worker estimates without locking
+  // the workers.
+  std::vector<RouteSizeHint> SizeHints() const {
+    std::vector<RouteSizeHint> hints;
+    hints.reserve(routes_.size());
+    for (const auto& item : routes_) {
+      const auto& route = item.second;
+      hints.push_back(RouteSizeHint{route->Path(), route->SizeHint(),
+                                    route->SizeMean(), route->SizeSamples()});
+    }
+    return hints;
+  }
+
+  // Merge the per worker request metrics, for the metrics endpoint.
+  std::vector<RouteMetricsSnapshot> RequestMetrics() const {
+    std::vector<RouteMetricsSnapshot> snapshots;
+    snapshots.reserve(routes_.size() + 1);
+    for (const auto& item : routes_) {
+      const auto& route = item.second;
+      snapshots.push_back(
+          RouteMetricsSnapshot{route->Path(), route->Metrics().Snapshot()});
+    }
+    snapshots.push_back(
+        RouteMetricsSnapshot{std::string(), unmatched_metrics_.Snapshot()});
+    return snapshots;
+  }
+
+  std::vector<RouteConcurrency> ConcurrencyLimits() const {
+    std::vector<RouteConcurrency> limits;
+    for (const auto& item : routes_) {
+      const auto& route = item.second;
+      auto limiter = route->Limiter();
+      if (!limiter)
+        continue;
+      limits.push_back(RouteConcurrency{route->Path(), limiter->Limit(),
+                                        limiter->InFlight(),
+                                        limiter->Rejected()});
+    }
+    return limits;
+  }
+
   void __HandleImpl(const http::Request& req,
                     const http::Response& res) const override {
+    // Counted as unmatched until the route is known
+    metrics::RequestScope request_metrics(&unmatched_metrics_, req.Native());
+
+    // Preflight never reach middleware or handler. Without per route
+    // policy it's answered before routing.
+    bool preflight =
+        (default_cors_ || !cors_.empty()) && http::Cors::IsPreflight(req);
+    if (preflight && cors_.empty()) {
+      default_cors_->Preflight(req, res);
+      return;
+    }
+
     std::unordered_map<std::string, std::string> params;
     auto route_result = router_.MatchRoute(req.GetPath(), params);
     if (route_result.IsEmpty()) {
-      // handle 404
-      res.Send("Eror 404: Not found", 404);
+      if (preflight && default_cors_) {
+        default_cors_->Preflight(req, res);
+        return;
+      }
+      // handle 404, global middleware still see the request
+      global_middlewares_.Run(
+          req, res, [](const http::Request&, const http::Response& response) {
+            response.Send("Eror 404: Not found", 404);
+          });
       return;
     }
 
@@ -41,9 +288,52 @@ class GlobalDispatcherHandler : public HandlerBase {
     // If it's crashed, it means our logic in Match Route is flawed
     std::cout << "Dispatch to: " << req.GetPath() << std::endl; 
     auto fn = route_result.executor;
+    auto route_key = *route_result.key;
+
+    const auto& route = routes_.at(route_key);
+    request_metrics.Target(&route->Metrics());
+    metrics::LoopMonitor::Attribute(&route->Path());
+    auto cors = CorsFor(route_key);
+    if (cors) {
+      if (preflight) {
+        cors->Preflight(req, res);
+        return;
+      }
+      cors->Apply(req);
+    }
+
+    // Over the limit is refused before any middleware or handler work
+    routers::ConcurrencyPermit permit(route->Limiter());
+    if (!permit.Granted()) {
+      res.AddHeader("Retry-After", "1");
+      res.Send("Service Unavailable", 503);
+      return;
+    }
+    // In flight until the response is sent, handlers return before that
+    // so requests of one loop overlap as well
+    permit.BindTo(&req.Native()->pool);
+
+    auto req_handler = route->RequestHandler();
+    res.Compress(CompressionFor(route_key));
+
+    // json output of the handler pre-size from this route history
+    formats::json::SizeHintScope size_scope(&route->WorkerSizeEstimate());
 
-    auto req_handler = routes_.at(*route_result.key)->RequestHandler();
-    (*fn)(req, res, req_handler, params);
+    // Cached response is served behind the middleware too (e.g. auth)
+    route->Middlewares().Run(
+        req, res, [&](const http::Request&, const http::Response&) {
+          if ((cache_ || flights_) && req.Method() == "GET") {
+            auto policy = cache_ ? cache_->Policy(route_key) : nullptr;
+            auto flight = flights_ ? flights_->Policy(route_key) : nullptr;
+            if (policy || flight) {
+              DispatchShared(policy, flight, route_key, *fn, req, res,
+                             req_handler, params);
+              return;
+            }
+          }
+
+          (*fn)(req, res, req_handler, params);
+        });
   }
 
   void HandleRequest(const http::Request& req, const http::Response& res,
@@ -58,6 +348,138 @@ class GlobalDispatcherHandler : public HandlerBase {
   std::unordered_map<size_t, std::shared_ptr<routers::Route>> routes_;
   std::hash<std::string> hasher_;
   std::mutex mutex_;
+  std::unique_ptr<cache::ResponseCache> cache_;
+  std::unique_ptr<cache::SingleFlight> flights_;
+  std::unordered_map<size_t, http::CompressionPolicy> compressions_;
+  std::unique_ptr<http::CompressionPolicy> default_compression_;
+  middleware::MiddlewareChain global_middlewares_;
+  std::vector<std::pair<std::string, middleware::MiddlewareChain>>
+      prefix_middlewares_;
+  std::unordered_map<size_t, middleware::MiddlewareChain> route_middlewares_;
+  bool frozen_;
+  std::unordered_map<size_t, std::unique_ptr<http::Cors>> cors_;
+  std::unique_ptr<http::Cors> default_cors_;
+  std::unordered_map<size_t, routers::ConcurrencyPolicy> limits_;
+  std::unique_ptr<routers::ConcurrencyPolicy> default_limit_;
+  metrics::RouteMetrics unmatched_metrics_;
+
+  const http::Cors* CorsFor(size_t route_key) const {
+    auto it = cors_.find(route_key);
+    if (it != cors_.end())
+      return it->second.get();
+    return default_cors_.get();
+  }
+
+  void ThrowIfFrozen() const {
+    if (frozen_)
+      throw std::logic_error(
+          "Routes and middleware can't change once the server started");
+  }
+
+  const http::CompressionPolicy* CompressionFor(size_t route_key) const {
+    auto it = compressions_.find(route_key);
+    if (it != compressions_.end())
+      return &it->second;
+    return default_compression_.get();
+  }
+
+  // Cached and / or coalesced GET. A cache hit is served as is; on a
+  // miss the handler runs once per flight and its response is stored and
+  // handed to the duplicates waiting on it.
+  void DispatchShared(
+      const cache::CachePolicy* policy,
+      const cache::SingleFlightPolicy* flight_policy, size_t route_key,
+      const routers::Route::HandlerFn& fn, const http::Request& req,
+      const http::Response& res, std::shared_ptr<HandlerBase> handler,
+      const std::unordered_map<std::string, std::string>& params) const {
+    cache::CacheKey cache_key;
+    if (policy) {
+      cache_key = cache_->MakeKey(route_key, params, req, *policy);
+      auto entry = cache_->Find(cache_key);
+      if (entry) {
+        cache::ResponseCache::Serve(*entry, req, res);
+        return;
+      }
+    }
+
+    if (flight_policy) {
+      auto ticket = flights_->Join(
+          flights_->MakeKey(route_key, params, req, *flight_policy));
+      if (!ticket.Leader()) {
+        // Parked, the loop goes on with other requests meanwhile
+        ticket.Park(req.Native(), flight_policy->max_wait,
+                    [&fn, handler, params,
+                     route = routes_.at(route_key).get(),
+                     compression = CompressionFor(route_key)](
+                        h2o_req_t* native, cache::CachedResponsePtr result) {
+                      Resume(native, *route, compression, std::move(result),
+                             fn, handler, params);
+                    });
+        return;
+      }
+
+      ticket.Publish(RunCaptured(policy, cache_key, fn, req, res, handler,
+                                 params));
+      return;
+    }
+
+    RunCaptured(policy, cache_key, fn, req, res, handler, params);
+  }
+
+  // Run the handler with the response captured, store a successful
+  // response when the route is cached.
+  cache::CachedResponsePtr RunCaptured(
+      const cache::CachePolicy* policy, const cache::CacheKey& cache_key,
+      const routers::Route::HandlerFn& fn, const http::Request& req,
+      const http::Response& res, std::shared_ptr<HandlerBase> handler,
+      const std::unordered_map<std::string, std::string>& params) const {
+    http::ResponseCapture capture;
+    capture.with_etag = true;
+    res.Capture(&capture);
+    fn(req, res, handler, params);
+    res.Capture(nullptr);
+
+    // Private response (e.g. Set-Cookie) is never shared
+    if (!capture.cacheable)
+      return nullptr;
+    // Only cache the successful response
+    if (policy && capture.captured && capture.status == 200)
+      return cache_->Store(cache_key, *policy, capture);
+    return cache::SingleFlight::FromCapture(capture);
+  }
+
+  // Follower back on its loop: the leader response, or the handler run
+  // here when the leader failed or was too slow. Runs from a loop queue
+  // or timer callback, set up as HandlerCallback does for a request.
+  static void Resume(
+      h2o_req_t* native, const routers::Route& route,
+      const http::CompressionPolicy* compression,
+      cache::CachedResponsePtr result, const routers::Route::HandlerFn& fn,
+      const std::shared_ptr<HandlerBase>& handler,
+      const std::unordered_map<std::string, std::string>& params) {
+    metrics::CallbackScope callback;
+    metrics::LoopMonitor::Attribute(&route.Path());
+    formats::json::SizeHintScope size_scope(&route.WorkerSizeEstimate());
+    http::Request req(native);
+    http::Response res(native);
+    res.Compress(compression);
+    try {
+      if (result) {
+        cache::ResponseCache::Serve(*result, req, res);
+        return;
+      }
+      fn(req, res, handler, params);
+    } catch (const formats::json::ParseError& e) {
+      if (native->_generator == nullptr)
+        h2o_send_error_400(native, "Bad Request", e.what(), 0);
+    } catch (const std::exception& e) {
+      // Nobody up the stack to catch it, this is a loop callback
+      std::cerr << "Single flight follower failed: " << e.what() << std::endl;
+      if (native->_generator == nullptr)
+        h2o_send_error_500(native, "Internal Server Error",
+                           "Internal Server Error", 0);
+    }
+  }
 
   static void Dispatcher(
       const http::Request& request, const http::Response& response,
@@ -6,6 +6,7 @@
 
 #include "piconaut/http/request.h"
 #include "piconaut/http/response.h"
+#include "piconaut/metrics/loop_monitor.h"
 #include "piconaut_handler_t.h"
 
 PICONAUT_INNER_NAMESPACE(handlers)
@@ -33,9 +34,17 @@ class HandlerBase {
 
     piconaut_handler_t* pico_handler = (piconaut_handler_t*)self;
     HandlerBase* handler = static_cast<HandlerBase*>(pico_handler->handler);
+    // Timed for the loop metrics and watched by the loop watchdog
+    metrics::CallbackScope callback;
     http::Request request(req);
     http::Response response(req);
-    handler->__HandleImpl(request, response);
+    try {
+      handler->__HandleImpl(request, response);
+    } catch (const formats::json::ParseError& e) {
+      // Malformed json body, answer before anything else is sent
+      if (req->_generator == nullptr)
+        h2o_send_error_400(req, "Bad Request", e.what(), 0);
+    }
     return 0;
   }
 };
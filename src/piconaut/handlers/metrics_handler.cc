@@ -0,0 +1,243 @@
+#include "piconaut/handlers/metrics_handler.h"
+
+#include <cstdio>
+#include <memory>
+#include <utility>
+
+#include "piconaut/metrics/loop_monitor.h"
+#include "piconaut/metrics/prometheus.h"
+#include "piconaut/metrics/route_metrics.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(handlers)
+
+namespace {
+
+// Histogram buckets in microseconds, exported in seconds
+constexpr uint64_t kLatencyBuckets[] = {
+    100,    250,    500,    1000,    2500,    5000,    10000,   25000,
+    50000,  100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+std::string RouteLabel(const std::string& path) {
+  return path.empty() ? std::string("unmatched") : path;
+}
+
+std::string Seconds(uint64_t micros) {
+  char number[32];
+  int size = snprintf(number, sizeof(number), "%g", micros / 1e6);
+  return std::string(number, static_cast<size_t>(size));
+}
+
+// Buckets, sum and count of one histogram series
+void WriteHistogram(metrics::PrometheusWriter& out, const std::string& name,
+                    metrics::Label label,
+                    const metrics::HistogramSnapshot& latency) {
+  auto bucket = name + "_bucket";
+  for (auto bound : kLatencyBuckets) {
+    out.Sample(bucket, {label, {"le", Seconds(bound)}},
+               latency.CountAtOrBelow(bound));
+  }
+  out.Sample(bucket, {label, {"le", "+Inf"}}, latency.Total());
+  out.Sample(name + "_sum", {label}, latency.SumMicros() / 1e6);
+  out.Sample(name + "_count", {label}, latency.Total());
+}
+
+void WriteRequests(metrics::PrometheusWriter& out,
+                   const std::vector<RouteMetricsSnapshot>& routes) {
+  out.Family("piconaut_http_requests_total", "counter",
+             "Requests handled, by route and status code.");
+  for (const auto& route : routes) {
+    auto label = RouteLabel(route.path);
+    for (const auto& status : route.stats.statuses) {
+      auto code = std::to_string(status.first);
+      out.Sample("piconaut_http_requests_total",
+                 {{"route", label}, {"code", code}}, status.second);
+    }
+  }
+
+  out.Family("piconaut_http_request_duration_seconds", "histogram",
+             "Time spent dispatching the request, middleware included.");
+  for (const auto& route : routes) {
+    const auto& latency = route.stats.latency;
+    if (latency.Total() == 0)
+      continue;
+    WriteHistogram(out, "piconaut_http_request_duration_seconds",
+                   {"route", RouteLabel(route.path)}, latency);
+  }
+
+  out.Family("piconaut_http_request_duration_quantile_seconds", "gauge",
+             "Latency quantiles since start, from the HDR histogram.");
+  for (const auto& route : routes) {
+    const auto& latency = route.stats.latency;
+    if (latency.Total() == 0)
+      continue;
+    auto label = RouteLabel(route.path);
+    for (auto q : kQuantiles) {
+      char quantile[16];
+      snprintf(quantile, sizeof(quantile), "%g", q);
+      out.Sample("piconaut_http_request_duration_quantile_seconds",
+                 {{"route", label}, {"quantile", quantile}},
+                 latency.ValueAtQuantile(q) / 1e6);
+    }
+  }
+
+  out.Family("piconaut_http_response_body_bytes_total", "counter",
+             "Response body bytes handed to h2o, after compression.");
+  for (const auto& route : routes) {
+    if (route.stats.latency.Total() == 0)
+      continue;
+    out.Sample("piconaut_http_response_body_bytes_total",
+               {{"route", RouteLabel(route.path)}}, route.stats.bytes);
+  }
+}
+
+void WriteRouteState(metrics::PrometheusWriter& out,
+                     const GlobalDispatcherHandler& dispatcher) {
+  auto limits = dispatcher.ConcurrencyLimits();
+  if (!limits.empty()) {
+    out.Family("piconaut_route_concurrency_limit", "gauge",
+               "Adaptive concurrency limit of the route.");
+    for (const auto& limit : limits)
+      out.Sample("piconaut_route_concurrency_limit", {{"route", limit.path}},
+                 static_cast<uint64_t>(limit.limit));
+    out.Family("piconaut_route_in_flight", "gauge",
+               "Requests of the route being handled.");
+    for (const auto& limit : limits)
+      out.Sample("piconaut_route_in_flight", {{"route", limit.path}},
+                 static_cast<uint64_t>(limit.in_flight));
+    out.Family("piconaut_route_rejected_total", "counter",
+               "Requests refused with 503 by the concurrency limit.");
+    for (const auto& limit : limits)
+      out.Sample("piconaut_route_rejected_total", {{"route", limit.path}},
+                 limit.rejected);
+  }
+
+  out.Family("piconaut_json_size_hint_bytes", "gauge",
+             "Adaptive json output size estimate of the route.");
+  for (const auto& hint : dispatcher.SizeHints()) {
+    if (hint.samples == 0)
+      continue;
+    out.Sample("piconaut_json_size_hint_bytes", {{"route", hint.path}},
+               static_cast<uint64_t>(hint.hint));
+  }
+}
+
+void WriteConnections(metrics::PrometheusWriter& out,
+                      const std::vector<const h2o_context_t*>& contexts) {
+  out.Family("piconaut_connections_accepted_total", "counter",
+             "Connections accepted by the server loops.");
+  out.Sample("piconaut_connections_accepted_total", {},
+             metrics::ConnectionCounters::Global().TotalAccepted());
+
+  uint64_t read_closed = 0;
+  uint64_t write_closed = 0;
+  uint64_t protocol_errors = 0;
+  for (auto ctx : contexts) {
+    read_closed += ctx->http2.events.read_closed;
+    write_closed += ctx->http2.events.write_closed;
+    for (auto errors : ctx->http2.events.protocol_level_errors)
+      protocol_errors += errors;
+  }
+
+  out.Family("piconaut_http2_connections_closed_total", "counter",
+             "HTTP/2 connections closed, by the side that closed.");
+  out.Sample("piconaut_http2_connections_closed_total", {{"by", "read"}},
+             read_closed);
+  out.Sample("piconaut_http2_connections_closed_total", {{"by", "write"}},
+             write_closed);
+  out.Family("piconaut_http2_protocol_errors_total", "counter",
+             "HTTP/2 protocol level errors sent or received.");
+  out.Sample("piconaut_http2_protocol_errors_total", {}, protocol_errors);
+}
+
+void WriteLoops(metrics::PrometheusWriter& out,
+                const std::vector<metrics::LoopSnapshot>& loops) {
+  if (loops.empty())
+    return;
+
+  std::vector<std::string> workers;
+  workers.reserve(loops.size());
+  for (const auto& loop : loops)
+    workers.push_back(std::to_string(loop.worker));
+
+  out.Family("piconaut_event_loop_busy_seconds_total", "counter",
+             "Time the event loop spent running callbacks and I/O.");
+  for (size_t i = 0; i < loops.size(); ++i)
+    out.Sample("piconaut_event_loop_busy_seconds_total",
+               {{"worker", workers[i]}}, loops[i].busy_ns / 1e9);
+  out.Family("piconaut_event_loop_idle_seconds_total", "counter",
+             "Time the event loop spent blocked waiting for events.");
+  for (size_t i = 0; i < loops.size(); ++i)
+    out.Sample("piconaut_event_loop_idle_seconds_total",
+               {{"worker", workers[i]}}, loops[i].idle_ns / 1e9);
+  out.Family("piconaut_event_loop_iterations_total", "counter",
+             "Event loop iterations.");
+  for (size_t i = 0; i < loops.size(); ++i)
+    out.Sample("piconaut_event_loop_iterations_total",
+               {{"worker", workers[i]}}, loops[i].iterations);
+  out.Family("piconaut_event_loop_callbacks_total", "counter",
+             "Request callbacks run by the event loop.");
+  for (size_t i = 0; i < loops.size(); ++i)
+    out.Sample("piconaut_event_loop_callbacks_total",
+               {{"worker", workers[i]}}, loops[i].callbacks);
+  out.Family("piconaut_event_loop_max_callbacks_per_iteration", "gauge",
+             "Most request callbacks run in one iteration.");
+  for (size_t i = 0; i < loops.size(); ++i)
+    out.Sample("piconaut_event_loop_max_callbacks_per_iteration",
+               {{"worker", workers[i]}}, loops[i].max_callbacks);
+
+  out.Family("piconaut_event_loop_iteration_seconds", "histogram",
+             "Busy time of each iteration, the lag of a ready event.");
+  for (size_t i = 0; i < loops.size(); ++i) {
+    if (loops[i].iteration.Total() == 0)
+      continue;
+    WriteHistogram(out, "piconaut_event_loop_iteration_seconds",
+                   {"worker", workers[i]}, loops[i].iteration);
+  }
+
+  out.Family("piconaut_event_loop_longest_callback_seconds", "gauge",
+             "Longest request callback, with the route it ran for.");
+  for (size_t i = 0; i < loops.size(); ++i) {
+    if (loops[i].callbacks == 0)
+      continue;
+    auto route = RouteLabel(loops[i].longest_route);
+    out.Sample("piconaut_event_loop_longest_callback_seconds",
+               {{"worker", workers[i]}, {"route", route}},
+               loops[i].longest_ns / 1e9);
+  }
+  out.Family("piconaut_event_loop_slow_callbacks_total", "counter",
+             "Request callbacks past the loop watchdog threshold.");
+  for (size_t i = 0; i < loops.size(); ++i)
+    out.Sample("piconaut_event_loop_slow_callbacks_total",
+               {{"worker", workers[i]}}, loops[i].slow_callbacks);
+}
+
+}  // namespace
+
+MetricsHandler::MetricsHandler(
+    const GlobalDispatcherHandler* dispatcher,
+    const std::vector<const h2o_context_t*>* contexts)
+                : dispatcher_(dispatcher), contexts_(contexts) {}
+
+std::string MetricsHandler::Render() const {
+  metrics::PrometheusWriter out;
+  if (dispatcher_) {
+    WriteRequests(out, dispatcher_->RequestMetrics());
+    WriteRouteState(out, *dispatcher_);
+  }
+  WriteLoops(out, metrics::LoopMonitor::Global().Snapshot());
+  static const std::vector<const h2o_context_t*> kNoContexts;
+  WriteConnections(out, contexts_ ? *contexts_ : kNoContexts);
+  return out.Release();
+}
+
+void MetricsHandler::HandleRequest(
+    const http::Request& req, const http::Response& res,
+    const std::unordered_map<std::string, std::string>& params) const {
+  res.Send(std::make_shared<const std::string>(Render()),
+           metrics::PrometheusWriter::kContentType);
+}
+
+PICONAUT_INNER_END_NAMESPACE
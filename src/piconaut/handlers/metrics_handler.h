@@ -0,0 +1,38 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "piconaut/handlers/global_dispatcher_handler.h"
+#include "piconaut/handlers/handler_base.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(handlers)
+
+/// @brief Prometheus scrape endpoint, see H2OServer::EnableMetrics.
+/// Per route request counters, latency histograms and body bytes are
+/// merged from the worker stats at scrape time, along with the
+/// concurrency limits, json size hints, event loop saturation and the
+/// counters of every h2o context. The dispatcher and the context list
+/// belong to the server and must outlive the handler, the list is read
+/// at scrape time so it may be filled when the server starts.
+class MetricsHandler : public HandlerBase {
+ public:
+  MetricsHandler(const GlobalDispatcherHandler* dispatcher,
+                 const std::vector<const h2o_context_t*>* contexts);
+
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const std::unordered_map<std::string, std::string>& params)
+      const override;
+
+  std::string Render() const;
+
+ private:
+  const GlobalDispatcherHandler* dispatcher_;
+  const std::vector<const h2o_context_t*>* contexts_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
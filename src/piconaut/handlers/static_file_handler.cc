@@ -0,0 +1,270 @@
+#include "piconaut/handlers/static_file_handler.h"
+
+#include <time.h>
+
+#include <cstdlib>
+
+#include "piconaut/utils/string_utils.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(handlers)
+
+namespace {
+
+const std::unordered_map<std::string, std::string>& MimeTypes() {
+  static const std::unordered_map<std::string, std::string> mime_types = {
+      {"html", "text/html; charset=utf-8"},
+      {"htm", "text/html; charset=utf-8"},
+      {"css", "text/css; charset=utf-8"},
+      {"js", "application/javascript"},
+      {"mjs", "application/javascript"},
+      {"json", "application/json"},
+      {"map", "application/json"},
+      {"txt", "text/plain; charset=utf-8"},
+      {"xml", "application/xml"},
+      {"svg", "image/svg+xml"},
+      {"png", "image/png"},
+      {"jpg", "image/jpeg"},
+      {"jpeg", "image/jpeg"},
+      {"gif", "image/gif"},
+      {"webp", "image/webp"},
+      {"ico", "image/x-icon"},
+      {"woff", "font/woff"},
+      {"woff2", "font/woff2"},
+      {"wasm", "application/wasm"},
+      {"pdf", "application/pdf"},
+      {"mp4", "video/mp4"},
+  };
+  return mime_types;
+}
+
+std::string MimeType(const std::string& path) {
+  auto dot = path.find_last_of("./");
+  if (dot == std::string::npos || path[dot] != '.')
+    return "application/octet-stream";
+
+  auto it = MimeTypes().find(path.substr(dot + 1));
+  if (it == MimeTypes().end())
+    return "application/octet-stream";
+  return it->second;
+}
+
+}  // namespace
+
+bool IsSafePath(const std::string& path) {
+  if (path.find('\0') != std::string::npos)
+    return false;
+
+  for (const auto& part : utils::string::SplitString(path, '/')) {
+    if (part == "..")
+      return false;
+  }
+  return true;
+}
+
+bool ParseRange(const std::string& header, size_t size, size_t& start,
+                size_t& length) {
+  const std::string prefix = "bytes=";
+  if (header.compare(0, prefix.size(), prefix) != 0 ||
+      header.find(',') != std::string::npos) {
+    start = 0;
+    length = size;
+    return true;
+  }
+
+  auto spec = header.substr(prefix.size());
+  auto dash = spec.find('-');
+  if (dash == std::string::npos)
+    return false;
+
+  auto first = spec.substr(0, dash);
+  auto last = spec.substr(dash + 1);
+
+  if (first.empty()) {
+    // suffix range: last N bytes
+    if (last.empty())
+      return false;
+    size_t suffix = std::strtoull(last.c_str(), nullptr, 10);
+    if (suffix == 0 || size == 0)
+      return false;
+    if (suffix > size)
+      suffix = size;
+    start = size - suffix;
+    length = suffix;
+    return true;
+  }
+
+  start = std::strtoull(first.c_str(), nullptr, 10);
+  if (start >= size)
+    return false;
+
+  size_t end = size - 1;
+  if (!last.empty()) {
+    end = std::strtoull(last.c_str(), nullptr, 10);
+    if (end < start)
+      return false;
+    if (end >= size)
+      end = size - 1;
+  }
+
+  length = end - start + 1;
+  return true;
+}
+
+StaticFileHandler::StaticFileHandler(const std::string& root,
+                                     const StaticFileOptions& options)
+                : root_(root),
+                  options_(options),
+                  files_(std::make_unique<cache::OpenFileCache>(
+                      options.max_open_files)) {
+  while (root_.size() > 1 && root_.back() == '/') {
+    root_.pop_back();
+  }
+}
+
+cache::OpenFilePtr StaticFileHandler::OpenWithIndex(
+    const std::string& path, std::string& resolved) const {
+  if (!path.empty() && path.back() != '/') {
+    auto file = files_->Open(path);
+    if (file) {
+      resolved = path;
+      return file;
+    }
+  }
+
+  auto dir = path.empty() || path.back() == '/' ? path : path + "/";
+  for (const auto& index : options_.index_files) {
+    auto file = files_->Open(dir + index);
+    if (file) {
+      resolved = dir + index;
+      return file;
+    }
+  }
+  return nullptr;
+}
+
+cache::OpenFilePtr StaticFileHandler::OpenVariant(
+    const http::Request& req, const std::string& path,
+    std::string& encoding) const {
+  if (!options_.precompressed)
+    return nullptr;
+
+  auto accept_encoding = req.GetHeader("accept-encoding");
+  if (accept_encoding.find("br") != std::string::npos) {
+    auto file = files_->Open(path + ".br");
+    if (file) {
+      encoding = "br";
+      return file;
+    }
+  }
+
+  if (accept_encoding.find("gzip") != std::string::npos) {
+    auto file = files_->Open(path + ".gz");
+    if (file) {
+      encoding = "gzip";
+      return file;
+    }
+  }
+
+  return nullptr;
+}
+
+bool StaticFileHandler::IsNotModified(const http::Request& req,
+                                      const cache::OpenFile& file) const {
+  auto if_none_match = req.GetHeader("if-none-match");
+  if (!if_none_match.empty()) {
+    return if_none_match == "*" ||
+           if_none_match.find(file.etag) != std::string::npos;
+  }
+
+  auto if_modified_since = req.GetHeader("if-modified-since");
+  if (!if_modified_since.empty()) {
+    struct tm gmt = {};
+    if (strptime(if_modified_since.c_str(), "%a, %d %b %Y %H:%M:%S GMT",
+                 &gmt) != nullptr) {
+      return file.st.st_mtime <= timegm(&gmt);
+    }
+  }
+
+  return false;
+}
+
+void StaticFileHandler::HandleRequest(
+    const http::Request& req, const http::Response& res,
+    const std::unordered_map<std::string, std::string>& params) const {
+  auto method = req.Method();
+  if (method != "GET" && method != "HEAD") {
+    res.AddHeader("allow", "GET, HEAD");
+    res.Send("Error 405: Method not allowed", 405);
+    return;
+  }
+
+  std::string rel_path;
+  auto param_it = params.find(options_.param_name);
+  if (param_it != params.end())
+    rel_path = param_it->second;
+
+  if (!IsSafePath(rel_path)) {
+    res.Send("Error 403: Forbidden", 403);
+    return;
+  }
+
+  std::string path;
+  auto file = OpenWithIndex(root_ + "/" + rel_path, path);
+  if (!file) {
+    res.Send("Error 404: Not found", 404);
+    return;
+  }
+
+  auto content_type = MimeType(path);
+  std::string encoding;
+  auto variant = OpenVariant(req, path, encoding);
+  if (variant) {
+    file = variant;
+    res.AddHeader("content-encoding", encoding);
+  }
+
+  if (options_.precompressed)
+    res.AddHeader("vary", "accept-encoding");
+  res.AddHeader("etag", file->etag);
+  res.AddHeader("last-modified", file->last_modified);
+  res.AddHeader("accept-ranges", "bytes");
+  if (!options_.cache_control.empty())
+    res.AddHeader("cache-control", options_.cache_control);
+
+  if (IsNotModified(req, *file)) {
+    res.SendEmpty(304);
+    return;
+  }
+
+  size_t start = 0;
+  size_t length = file->size;
+  int status = 200;
+
+  auto range = req.GetHeader("range");
+  if (!range.empty()) {
+    if (!ParseRange(range, file->size, start, length)) {
+      res.AddHeader("content-range", "bytes */" + std::to_string(file->size));
+      res.SendEmpty(416);
+      return;
+    }
+
+    if (length != file->size) {
+      status = 206;
+      res.AddHeader("content-range",
+                    "bytes " + std::to_string(start) + "-" +
+                        std::to_string(start + length - 1) + "/" +
+                        std::to_string(file->size));
+    }
+  }
+
+  if (file->Inline()) {
+    res.SendRegion(file, file->content.data() + start, length, content_type,
+                   status, options_.chunk_size);
+  } else {
+    res.SendFile(file, file->fd, start, length, content_type, status,
+                 options_.chunk_size);
+  }
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "piconaut/cache/open_file_cache.h"
+#include "piconaut/handlers/handler_base.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(handlers)
+
+struct StaticFileOptions {
+  // Route catch-all parameter that carry the file path
+  std::string param_name = "path";
+  std::vector<std::string> index_files = {"index.html"};
+  size_t max_open_files = 1024;
+  // Serve .br/.gz sibling when client accept the encoding
+  bool precompressed = true;
+  // Stream chunk size for large files, smaller file is sent in one go
+  size_t chunk_size = 256 * 1024;
+  std::string cache_control;
+};
+
+// Reject traversal outside root
+bool IsSafePath(const std::string& path);
+
+// Parse single `bytes=` range, multiple ranges fallback to full body.
+// Return false when the range is unsatisfiable.
+bool ParseRange(const std::string& header, size_t size, size_t& start,
+                size_t& length);
+
+/// @brief Serve files under root directory.
+/// Register it with catch-all route:
+/// ```cpp
+/// server->RegisterHandler(
+///     "/assets/{path*}",
+///     std::make_shared<handlers::StaticFileHandler>("./public"));
+/// ```
+/// Supports ETag/If-None-Match, If-Modified-Since, single Range request
+/// and precompressed `.br`/`.gz` siblings.
+class StaticFileHandler : public HandlerBase {
+ public:
+  explicit StaticFileHandler(
+      const std::string& root,
+      const StaticFileOptions& options = StaticFileOptions());
+
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const std::unordered_map<std::string, std::string>& params)
+      const override;
+
+ private:
+  std::string root_;
+  StaticFileOptions options_;
+  std::unique_ptr<cache::OpenFileCache> files_;
+
+  // `resolved` is set to the opened path, the index file for directory.
+  cache::OpenFilePtr OpenWithIndex(const std::string& path,
+                                   std::string& resolved) const;
+  cache::OpenFilePtr OpenVariant(const http::Request& req,
+                                 const std::string& path,
+                                 std::string& encoding) const;
+  bool IsNotModified(const http::Request& req,
+                     const cache::OpenFile& file) const;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,204 @@
+#include "piconaut/http/compression.h"
+
+#include <strings.h>
+
+#include <cstring>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(http)
+
+namespace {
+
+// 15 window bits + 16 for gzip wrapper
+const int kGzipWindowBits = 15 + 16;
+const size_t kEncodeStep = 16 * 1024;
+
+bool HasToken(const char* value, size_t len, const char* token) {
+  size_t token_len = strlen(token);
+  if (len < token_len)
+    return false;
+
+  for (size_t i = 0; i + token_len <= len; ++i) {
+    if (strncasecmp(value + i, token, token_len) != 0)
+      continue;
+    bool start_ok = i == 0 || value[i - 1] == ' ' || value[i - 1] == ',';
+    size_t end = i + token_len;
+    bool end_ok = end == len || value[end] == ',' || value[end] == ';' ||
+                  value[end] == ' ';
+    if (start_ok && end_ok)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+bool CompressionPolicy::IsCompressible(const char* content_type,
+                                       size_t len) const {
+  for (const auto& allowed : content_types) {
+    if (len >= allowed.size() &&
+        strncasecmp(content_type, allowed.c_str(), allowed.size()) == 0)
+      return true;
+  }
+  return false;
+}
+
+CompressionType NegotiateCompression(const CompressionPolicy& policy,
+                                     const char* accept_encoding, size_t len) {
+  if (policy.type == CompressionType::NONE || !accept_encoding || !len)
+    return CompressionType::NONE;
+
+#if PICONAUT_USE_BROTLI
+  if (policy.type == CompressionType::BROTLI &&
+      HasToken(accept_encoding, len, "br"))
+    return CompressionType::BROTLI;
+#endif
+
+  if (HasToken(accept_encoding, len, "gzip"))
+    return CompressionType::GZIP;
+
+  return CompressionType::NONE;
+}
+
+std::string EncodingEtag(const std::string& etag, const char* encoding) {
+  if (etag.size() < 2 || etag.back() != '"')
+    return etag;
+
+  std::string tagged(etag, 0, etag.size() - 1);
+  tagged.push_back('-');
+  tagged.append(encoding);
+  tagged.push_back('"');
+  return tagged;
+}
+
+GzipEncoder& GzipEncoder::ThreadLocal() {
+  static thread_local GzipEncoder encoder;
+  return encoder;
+}
+
+GzipEncoder::GzipEncoder() : stream_(), initialized_(false), level_(-1) {}
+
+GzipEncoder::~GzipEncoder() {
+  if (initialized_)
+    deflateEnd(&stream_);
+}
+
+bool GzipEncoder::Begin(int level) {
+  if (!initialized_) {
+    memset(&stream_, 0, sizeof(stream_));
+    if (deflateInit2(&stream_, level, Z_DEFLATED, kGzipWindowBits, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+      return false;
+    initialized_ = true;
+    level_ = level;
+    return true;
+  }
+
+  if (deflateReset(&stream_) != Z_OK)
+    return false;
+
+  // Fresh stream, changing params here doesn't flush anything
+  if (level != level_) {
+    if (deflateParams(&stream_, level, Z_DEFAULT_STRATEGY) != Z_OK)
+      return false;
+    level_ = level;
+  }
+  return true;
+}
+
+size_t GzipEncoder::Bound(size_t len) {
+  // gzip header & trailer is not counted by deflateBound
+  return deflateBound(&stream_, len) + 18;
+}
+
+bool GzipEncoder::Encode(const char* data, size_t len, bool is_final,
+                         std::string& out) {
+  if (!initialized_)
+    return false;
+
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream_.avail_in = static_cast<uInt>(len);
+
+  int flush = is_final ? Z_FINISH : Z_SYNC_FLUSH;
+  int result;
+  do {
+    size_t offset = out.size();
+    out.resize(offset + kEncodeStep);
+    stream_.next_out = reinterpret_cast<Bytef*>(&out[offset]);
+    stream_.avail_out = static_cast<uInt>(kEncodeStep);
+
+    result = deflate(&stream_, flush);
+    out.resize(offset + kEncodeStep - stream_.avail_out);
+    if (result == Z_STREAM_ERROR)
+      return false;
+  } while (stream_.avail_out == 0 && result != Z_STREAM_END);
+
+  return !is_final || result == Z_STREAM_END;
+}
+
+size_t GzipEncoder::EncodeAll(const char* data, size_t len, char* out,
+                              size_t capacity) {
+  if (!initialized_)
+    return 0;
+
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream_.avail_in = static_cast<uInt>(len);
+  stream_.next_out = reinterpret_cast<Bytef*>(out);
+  stream_.avail_out = static_cast<uInt>(capacity);
+
+  if (deflate(&stream_, Z_FINISH) != Z_STREAM_END)
+    return 0;
+
+  return capacity - stream_.avail_out;
+}
+
+#if PICONAUT_USE_BROTLI
+BrotliEncoder::BrotliEncoder() : state_(nullptr) {}
+
+BrotliEncoder::~BrotliEncoder() {
+  if (state_)
+    BrotliEncoderDestroyInstance(state_);
+}
+
+bool BrotliEncoder::Begin(int level, size_t size_hint) {
+  if (state_)
+    BrotliEncoderDestroyInstance(state_);
+
+  state_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+  if (!state_)
+    return false;
+
+  BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, level);
+  if (size_hint)
+    BrotliEncoderSetParameter(state_, BROTLI_PARAM_SIZE_HINT,
+                              static_cast<uint32_t>(size_hint));
+  return true;
+}
+
+bool BrotliEncoder::Encode(const char* data, size_t len, bool is_final,
+                           std::string& out) {
+  if (!state_)
+    return false;
+
+  const uint8_t* next_in = reinterpret_cast<const uint8_t*>(data);
+  size_t avail_in = len;
+  BrotliEncoderOperation op =
+      is_final ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH;
+
+  do {
+    size_t offset = out.size();
+    out.resize(offset + kEncodeStep);
+    uint8_t* next_out = reinterpret_cast<uint8_t*>(&out[offset]);
+    size_t avail_out = kEncodeStep;
+
+    if (!BrotliEncoderCompressStream(state_, op, &avail_in, &next_in,
+                                     &avail_out, &next_out, nullptr))
+      return false;
+    out.resize(offset + kEncodeStep - avail_out);
+  } while (avail_in != 0 || BrotliEncoderHasMoreOutput(state_));
+
+  return !is_final || BrotliEncoderIsFinished(state_);
+}
+#endif
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+
+#include "piconaut/http/declare.h"
+#include "piconaut/macro.h"
+
+#if PICONAUT_USE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(http)
+
+/// @brief Dynamic response compression policy, can be set server wide
+/// (Config::Compression) or per route.
+struct CompressionPolicy {
+  // Preferred encoding, BROTLI fallback to GZIP when the client
+  // or the build doesn't support it.
+  CompressionType type = CompressionType::GZIP;
+  // Compressing small body waste cpu for a few bytes
+  size_t min_size = 1024;
+  // Content-type prefix allowlist
+  std::vector<std::string> content_types = {
+      "application/json", "application/javascript", "application/xml",
+      "image/svg+xml",    "text/"};
+  int gzip_level = 1;
+  int brotli_level = 4;
+
+  bool IsCompressible(const char* content_type, size_t len) const;
+};
+
+/// @brief Streaming gzip encoder.
+/// One encoder live per worker thread and reused for every response,
+/// z_stream is reset between responses instead of reallocated.
+class GzipEncoder {
+ public:
+  static GzipEncoder& ThreadLocal();
+
+  GzipEncoder();
+  ~GzipEncoder();
+
+  GzipEncoder(const GzipEncoder&) = delete;
+  GzipEncoder& operator=(const GzipEncoder&) = delete;
+
+  // Start new gzip stream
+  bool Begin(int level);
+  // Compress chunk and append the output,
+  // non final chunk is sync-flushed so it can go out immediately.
+  bool Encode(const char* data, size_t len, bool is_final, std::string& out);
+  // One shot compression of the whole body into caller buffer,
+  // capacity must be at least Bound(len). Return 0 on failure.
+  size_t EncodeAll(const char* data, size_t len, char* out, size_t capacity);
+  size_t Bound(size_t len);
+
+ private:
+  z_stream stream_;
+  bool initialized_;
+  int level_;
+};
+
+#if PICONAUT_USE_BROTLI
+/// @brief Streaming brotli encoder.
+/// Brotli has no reset api, the encoder state is created per stream.
+class BrotliEncoder {
+ public:
+  BrotliEncoder();
+  ~BrotliEncoder();
+
+  BrotliEncoder(const BrotliEncoder&) = delete;
+  BrotliEncoder& operator=(const BrotliEncoder&) = delete;
+
+  bool Begin(int level, size_t size_hint = 0);
+  bool Encode(const char* data, size_t len, bool is_final, std::string& out);
+
+ private:
+  BrotliEncoderState* state_;
+};
+#endif
+
+// Pick encoding accepted by the client, NONE when there is nothing to do
+CompressionType NegotiateCompression(const CompressionPolicy& policy,
+                                     const char* accept_encoding, size_t len);
+
+// ETag of the `encoding` variant of a representation, each encoding gets
+// its own strong validator: "abc" -> "abc-gzip", W/"abc" -> W/"abc-gzip".
+std::string EncodingEtag(const std::string& etag, const char* encoding);
+
+PICONAUT_INNER_END_NAMESPACE
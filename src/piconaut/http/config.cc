@@ -16,7 +16,8 @@ Config::Config()
                   http2_idle_timeout_(),
                   http2_graceful_shutdown_timeout_(),
                   http2_max_concurrent_requests_per_connection_(),
-                  http2_max_streams_for_priority_() {}
+                  http2_max_streams_for_priority_(),
+                  event_loops_(1) {}
 
 void Config::HttpVersion(HttpVersionMode version) {
   http_version_ = version;
@@ -63,6 +64,9 @@ void Config::Http2MaxConcurrentRequestsPerConnection(size_t max_conn) {
 void Config::Http2MaxStreamsForPriority(size_t max_stream) {
   http2_max_streams_for_priority_ = max_stream;
 }
+void Config::EventLoops(size_t count) {
+  event_loops_ = count == 0 ? 1 : count;
+}
 
 HttpVersionMode Config::HttpVersion() const {
   return http_version_;
@@ -120,4 +124,8 @@ size_t Config::Http2MaxStreamsForPriority() const {
   return http2_max_streams_for_priority_;
 }
 
+size_t Config::EventLoops() const {
+  return event_loops_;
+}
+
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
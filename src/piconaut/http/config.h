@@ -21,6 +21,8 @@ class Config {
   void Http2GracefulShutdownTimeout(uint64_t timeout);
   void Http2MaxConcurrentRequestsPerConnection(size_t max_conn);
   void Http2MaxStreamsForPriority(size_t max_stream);
+  // Event loops sharing the listening socket, one thread each.
+  void EventLoops(size_t count);
 
   HttpVersionMode HttpVersion() const;
   CompressionType Compression() const;
@@ -36,6 +38,7 @@ class Config {
   uint64_t Http2GracefulShutdownTimeout() const;
   size_t Http2MaxConcurrentRequestsPerConnection() const;
   size_t Http2MaxStreamsForPriority() const;
+  size_t EventLoops() const;
 
  private:
   HttpVersionMode http_version_;
@@ -52,6 +55,7 @@ class Config {
   uint64_t http2_graceful_shutdown_timeout_;
   size_t http2_max_concurrent_requests_per_connection_;
   size_t http2_max_streams_for_priority_;
+  size_t event_loops_;
 };
 
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
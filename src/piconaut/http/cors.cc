@@ -0,0 +1,158 @@
+#include "piconaut/http/cors.h"
+
+#include <stdexcept>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(http)
+
+namespace {
+
+std::string Join(const std::vector<std::string>& values) {
+  std::string joined;
+  for (const auto& value : values) {
+    if (!joined.empty())
+      joined += ", ";
+    joined += value;
+  }
+  return joined;
+}
+
+const h2o_iovec_t* FindHeader(const h2o_req_t* req, const char* name,
+                              size_t len) {
+  ssize_t index = h2o_find_header_by_str(&req->headers, name, len, -1);
+  if (index == -1)
+    return nullptr;
+  return &req->headers.entries[index].value;
+}
+
+// h2o keeps the pointers, every value added here outlives the request
+void AddHeader(h2o_req_t* req, const char* name, size_t name_len,
+               const char* value, size_t value_len) {
+  h2o_add_header_by_str(&req->pool, &req->res.headers, name, name_len, 1,
+                        nullptr, value, value_len);
+}
+
+}  // namespace
+
+Cors::Cors(const CorsPolicy& policy)
+                : origins_(),
+                  origin_set_(),
+                  any_origin_(false),
+                  any_header_(false),
+                  allow_credentials_(policy.allow_credentials),
+                  methods_(Join(policy.allowed_methods)),
+                  headers_(Join(policy.allowed_headers)),
+                  exposed_(Join(policy.exposed_headers)),
+                  max_age_(policy.max_age > 0 ? std::to_string(policy.max_age)
+                                              : std::string()) {
+  // Views point into origins_, it must not grow after this
+  origins_.reserve(policy.allowed_origins.size());
+  for (const auto& origin : policy.allowed_origins) {
+    if (origin == "*") {
+      any_origin_ = true;
+      continue;
+    }
+    origins_.push_back(origin);
+  }
+  for (const auto& origin : origins_)
+    origin_set_.insert(std::string_view(origin));
+  // Browsers refuse credentials with "*", echoing any origin instead
+  // would hand credentialed access to every site
+  if (any_origin_ && allow_credentials_)
+    throw std::invalid_argument(
+        "Cors: \"*\" origin can't be combined with allow_credentials");
+
+  for (const auto& header : policy.allowed_headers) {
+    if (header == "*")
+      any_header_ = true;
+  }
+}
+
+bool Cors::IsAllowedOrigin(std::string_view origin) const {
+  return any_origin_ || origin_set_.count(origin) != 0;
+}
+
+bool Cors::IsPreflight(const Request& req) {
+  auto native = req.Native();
+  if (!h2o_memis(native->method.base, native->method.len,
+                 H2O_STRLIT("OPTIONS")))
+    return false;
+
+  return h2o_find_header(&native->headers, H2O_TOKEN_ORIGIN, -1) != -1 &&
+         FindHeader(native,
+                    H2O_STRLIT("access-control-request-method")) != nullptr;
+}
+
+void Cors::AddVary(h2o_req_t* req) const {
+  if (!any_origin_)
+    h2o_set_header_token(&req->pool, &req->res.headers, H2O_TOKEN_VARY,
+                         H2O_STRLIT("origin"));
+}
+
+void Cors::AddOriginHeaders(h2o_req_t* req, h2o_iovec_t origin) const {
+  if (any_origin_) {
+    AddHeader(req, H2O_STRLIT("access-control-allow-origin"), H2O_STRLIT("*"));
+  } else {
+    AddHeader(req, H2O_STRLIT("access-control-allow-origin"), origin.base,
+              origin.len);
+  }
+  if (allow_credentials_)
+    AddHeader(req, H2O_STRLIT("access-control-allow-credentials"),
+              H2O_STRLIT("true"));
+}
+
+void Cors::Preflight(const Request& req, const Response& res) const {
+  res.SendEmpty(PreflightHeaders(req));
+}
+
+int Cors::PreflightHeaders(const Request& req) const {
+  auto native = req.Native();
+  AddVary(native);
+  ssize_t index = h2o_find_header(&native->headers, H2O_TOKEN_ORIGIN, -1);
+  if (index == -1)
+    return 400;
+
+  auto origin = native->headers.entries[index].value;
+  if (!IsAllowedOrigin(std::string_view(origin.base, origin.len)))
+    return 403;
+
+  AddOriginHeaders(native, origin);
+  AddHeader(native, H2O_STRLIT("access-control-allow-methods"),
+            methods_.data(), methods_.size());
+
+  if (any_header_) {
+    auto requested =
+        FindHeader(native, H2O_STRLIT("access-control-request-headers"));
+    if (requested)
+      AddHeader(native, H2O_STRLIT("access-control-allow-headers"),
+                requested->base, requested->len);
+  } else if (!headers_.empty()) {
+    AddHeader(native, H2O_STRLIT("access-control-allow-headers"),
+              headers_.data(), headers_.size());
+  }
+
+  if (!max_age_.empty())
+    AddHeader(native, H2O_STRLIT("access-control-max-age"), max_age_.data(),
+              max_age_.size());
+
+  return 204;
+}
+
+void Cors::Apply(const Request& req) const {
+  auto native = req.Native();
+  AddVary(native);
+  ssize_t index = h2o_find_header(&native->headers, H2O_TOKEN_ORIGIN, -1);
+  if (index == -1)
+    return;
+
+  auto origin = native->headers.entries[index].value;
+  if (!IsAllowedOrigin(std::string_view(origin.base, origin.len)))
+    return;
+
+  AddOriginHeaders(native, origin);
+  if (!exposed_.empty())
+    AddHeader(native, H2O_STRLIT("access-control-expose-headers"),
+              exposed_.data(), exposed_.size());
+}
+
+PICONAUT_INNER_END_NAMESPACE
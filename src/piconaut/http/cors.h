@@ -0,0 +1,76 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "piconaut/http/request.h"
+#include "piconaut/http/response.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(http)
+
+/// @brief Cross-origin policy, can be set server wide (Config::Cors or
+/// H2OServer::EnableCors) or per route.
+struct CorsPolicy {
+  // Exact origins, e.g. "https://app.example.com", "*" allow any origin
+  // (not with allow_credentials, list the origins instead)
+  std::vector<std::string> allowed_origins;
+  std::vector<std::string> allowed_methods = {"GET",   "HEAD",   "POST",
+                                              "PUT",   "PATCH",  "DELETE"};
+  // "*" echo whatever the preflight asks for
+  std::vector<std::string> allowed_headers = {"Content-Type",
+                                              "Authorization"};
+  std::vector<std::string> exposed_headers;
+  bool allow_credentials = false;
+  // Seconds the browser may reuse a preflight answer, 0 omit the header
+  int max_age = 600;
+};
+
+/// @brief Compiled CorsPolicy, built once at registration.
+/// Origins live in a hash set of views over owned strings, so the lookup
+/// doesn't allocate. The header values are joined up front and handed to
+/// h2o by pointer, a preflight answer is a handful of header appends.
+class Cors {
+ public:
+  // Throws std::invalid_argument for "*" with allow_credentials.
+  explicit Cors(const CorsPolicy& policy);
+
+  Cors(const Cors&) = delete;
+  Cors& operator=(const Cors&) = delete;
+
+  bool IsAllowedOrigin(std::string_view origin) const;
+
+  // OPTIONS carrying Origin and Access-Control-Request-Method.
+  static bool IsPreflight(const Request& req);
+
+  // Answer the preflight with 204 (403 for a foreign origin).
+  void Preflight(const Request& req, const Response& res) const;
+  // Preflight answer headers without sending, returns the status.
+  int PreflightHeaders(const Request& req) const;
+  // Allow headers on the actual response, nothing when the request has
+  // no Origin or the origin is not allowed.
+  void Apply(const Request& req) const;
+
+ private:
+  std::vector<std::string> origins_;
+  std::unordered_set<std::string_view> origin_set_;
+  bool any_origin_;
+  bool any_header_;
+  bool allow_credentials_;
+  std::string methods_;
+  std::string headers_;
+  std::string exposed_;
+  std::string max_age_;
+
+  // Vary: Origin, unless the answer is "*" for everyone. Added whether
+  // the origin is allowed or not, a shared cache must not hand one
+  // origin answer to another.
+  void AddVary(h2o_req_t* req) const;
+  void AddOriginHeaders(h2o_req_t* req, h2o_iovec_t origin) const;
+};
+
+PICONAUT_INNER_END_NAMESPACE
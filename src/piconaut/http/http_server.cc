@@ -1,6 +1,10 @@
 #include "piconaut/http/http_server.h"
 
+#include <cerrno>
+
 #include "http_server.h"
+#include "piconaut/metrics/loop_monitor.h"
+#include "piconaut/metrics/route_metrics.h"
 
 // cppcheck-suppress unknownMacro
 PICONAUT_INNER_NAMESPACE(http)
@@ -58,6 +62,7 @@ static void AcceptConnection(h2o_socket_t* listener, const char* err) {
 
   if ((sock = h2o_evloop_socket_accept(listener)) == NULL)
     return;
+  metrics::ConnectionCounters::Global().Accepted();
   h2o_accept_ctx_t* ctx = (h2o_accept_ctx_t*)listener->data;
   h2o_accept(ctx, sock);
 }
@@ -127,8 +132,11 @@ void MultiThreadedH2OServer::Stop() {
 
 void MultiThreadedH2OServer::RunEventLoop(int thread_index) {
   std::cout << "Event Loop #" << std::to_string(thread_index) << std::endl;
-  while (h2o_evloop_run(contexts_[thread_index].loop, INT32_MAX) == 0)
-    ;
+  metrics::LoopProbe probe;
+  // A signal (e.g. the watchdog stack sample) may interrupt epoll_wait
+  while (h2o_evloop_run(contexts_[thread_index].loop, INT32_MAX) == 0 ||
+         errno == EINTR)
+    probe.Iterated();
 }
 
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
@@ -1,6 +1,13 @@
 
 #include "piconaut/http/http_single_server.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <utility>
+
+#include "piconaut/utils/loop_queue.h"
+
 // cppcheck-suppress unknownMacro
 PICONAUT_INNER_NAMESPACE(http)
 
@@ -8,9 +15,12 @@ H2OServer::H2OServer(const std::string& host, int port,
                      const std::string& server_name)
                 : host_(host),
                   port_(port),
+                  stopping_(false),
+                  running_(false),
                   server_name_(server_name),
                   routers_(
-                      std::make_shared<handlers::GlobalDispatcherHandler>()) {
+                      std::make_shared<handlers::GlobalDispatcherHandler>()),
+                  server_config_() {
   memset(&config_, 0, sizeof(config_));
   h2o_config_init(&config_);
 
@@ -32,18 +42,139 @@ H2OServer::~H2OServer() {
   Stop();
   std::cout << "Server stopping..";
 
-  h2o_socket_close(listeners_);
-  h2o_context_dispose(&contexts_);
+  for (auto& loop : loops_) {
+    utils::LoopQueue::Release(loop->loop);
+    // Not started, Start closes them otherwise
+    if (loop->listener)
+      h2o_socket_close(loop->listener);
+    h2o_context_dispose(&loop->context);
+  }
   h2o_config_dispose(&config_);
 }
 
 
+void H2OServer::SetConfig(const Config& config) {
+  server_config_ = config;
+
+  // Server wide compression, route policy registered by EnableCompression
+  // take precedence.
+  if (config.Compression() == CompressionType::NONE) {
+    routers_->DefaultCompression(nullptr);
+  } else {
+    auto policy = std::make_unique<CompressionPolicy>();
+    policy->type = config.Compression();
+    routers_->DefaultCompression(std::move(policy));
+  }
+
+  // Comma separated origin allowlist, default methods and headers
+  if (!config.Cors().empty()) {
+    auto policy = std::make_unique<CorsPolicy>();
+    std::string origins = config.Cors();
+    size_t start = 0;
+    while (start <= origins.size()) {
+      size_t end = origins.find(',', start);
+      if (end == std::string::npos)
+        end = origins.size();
+      auto origin = origins.substr(start, end - start);
+      origin.erase(0, origin.find_first_not_of(' '));
+      origin.erase(origin.find_last_not_of(' ') + 1);
+      if (!origin.empty())
+        policy->allowed_origins.push_back(origin);
+      start = end + 1;
+    }
+    routers_->DefaultCors(std::move(policy));
+  }
+}
+
+const Config& H2OServer::GetConfig() const {
+  return server_config_;
+}
+
 void H2OServer::RegisterHandler(
     const std::string& path, std::shared_ptr<handlers::HandlerBase> handler) {
   routers_->RegisterRouteHandler(path,handler);
   std::cout << "Registered handler for path: " << path << std::endl;
 }
 
+void H2OServer::RegisterMiddleware(
+    std::shared_ptr<middleware::MiddlewareBase> middleware) {
+  routers_->UseMiddleware(std::move(middleware));
+}
+
+void H2OServer::RegisterMiddleware(
+    const std::string& prefix,
+    std::shared_ptr<middleware::MiddlewareBase> middleware) {
+  routers_->UsePrefixMiddleware(prefix, std::move(middleware));
+  std::cout << "Registered middleware for prefix: " << prefix << std::endl;
+}
+
+void H2OServer::RegisterRouteMiddleware(
+    const std::string& path,
+    std::shared_ptr<middleware::MiddlewareBase> middleware) {
+  routers_->UseRouteMiddleware(path, std::move(middleware));
+  std::cout << "Registered middleware for path: " << path << std::endl;
+}
+
+void H2OServer::EnableResponseCache(const std::string& path,
+                                    const cache::CachePolicy& policy) {
+  routers_->EnableRouteCache(path, policy);
+  std::cout << "Enabled response cache for path: " << path << std::endl;
+}
+
+void H2OServer::EnableSingleFlight(const std::string& path,
+                                   const cache::SingleFlightPolicy& policy) {
+  routers_->EnableRouteSingleFlight(path, policy);
+  std::cout << "Enabled single flight for path: " << path << std::endl;
+}
+
+void H2OServer::EnableCompression(const std::string& path,
+                                  const CompressionPolicy& policy) {
+  routers_->EnableRouteCompression(path, policy);
+  std::cout << "Enabled compression for path: " << path << std::endl;
+}
+
+void H2OServer::EnableCors(const CorsPolicy& policy) {
+  routers_->DefaultCors(std::make_unique<CorsPolicy>(policy));
+  std::cout << "Enabled CORS for all paths" << std::endl;
+}
+
+void H2OServer::EnableCors(const std::string& path, const CorsPolicy& policy) {
+  routers_->EnableRouteCors(path, policy);
+  std::cout << "Enabled CORS for path: " << path << std::endl;
+}
+
+void H2OServer::EnableConcurrencyLimit(
+    const routers::ConcurrencyPolicy& policy) {
+  routers_->DefaultConcurrencyLimit(
+      std::make_unique<routers::ConcurrencyPolicy>(policy));
+  std::cout << "Enabled concurrency limit for all paths" << std::endl;
+}
+
+void H2OServer::EnableConcurrencyLimit(
+    const std::string& path, const routers::ConcurrencyPolicy& policy) {
+  routers_->EnableRouteConcurrencyLimit(path, policy);
+  std::cout << "Enabled concurrency limit for path: " << path << std::endl;
+}
+
+std::vector<handlers::RouteConcurrency> H2OServer::RouteConcurrencyLimits()
+    const {
+  return routers_->ConcurrencyLimits();
+}
+
+void H2OServer::EnableMetrics(const std::string& path) {
+  // contexts_ is filled in Start, before the first scrape
+  RegisterHandler(path, std::make_shared<handlers::MetricsHandler>(
+                            routers_.get(), &contexts_));
+}
+
+void H2OServer::EnableLoopWatchdog(std::chrono::milliseconds threshold) {
+  metrics::LoopMonitor::Global().StartWatchdog(threshold);
+}
+
+std::vector<handlers::RouteSizeHint> H2OServer::RouteSizeHints() const {
+  return routers_->SizeHints();
+}
+
 // void H2OServer::RegisterHandler(
 //     const std::string& path, std::shared_ptr<handlers::HandlerBase> handler) {
 //   h2o_pathconf_t* pathconf =
@@ -77,6 +208,7 @@ void H2OServer::AcceptConnection(h2o_socket_t* listener, const char* err) {
 
   if ((sock = h2o_evloop_socket_accept(listener)) == NULL)
     return;
+  metrics::ConnectionCounters::Global().Accepted();
   h2o_accept_ctx_t* ctx = (h2o_accept_ctx_t*)listener->data;
   h2o_accept(ctx, sock);
 }
@@ -84,8 +216,8 @@ void H2OServer::AcceptConnection(h2o_socket_t* listener, const char* err) {
 void H2OServer::Start() {
   std::cout << "Server starting.." << std::endl;
 
-  memset(&accept_ctx_, 0, sizeof(accept_ctx_));
-  accept_ctx_.hosts = config_.hosts;
+  // Per route middleware stacks are final from here
+  routers_->Freeze();
 
   int fd;
   struct sockaddr_in addr;
@@ -111,36 +243,109 @@ void H2OServer::Start() {
     throw std::runtime_error("Failed to listen on socket");
   }
 
-  loops_ = h2o_evloop_create();
-  if (loops_ == nullptr)
-    throw std::runtime_error("Failed to create evloop");
-  h2o_context_init(&contexts_, loops_, &config_);
+  size_t count = server_config_.EventLoops();
+  for (size_t i = 0; i < count; ++i) {
+    // Every loop accepts on its own descriptor of the listening socket
+    int loop_fd = i == 0 ? fd : dup(fd);
+    if (loop_fd < 0) {
+      perror("failed to duplicate listener socket");
+      throw std::runtime_error("Failed to duplicate listener socket");
+    }
 
-  listeners_ = h2o_evloop_socket_create(loops_, fd, H2O_SOCKET_FLAG_DONT_READ);
-  if (listeners_ == nullptr) {
-    perror("failed to create listener socket");
-    close(fd);
-    throw std::runtime_error("Failed to create listener socket");
+    auto loop = std::make_unique<EventLoop>();
+    memset(&loop->accept_ctx, 0, sizeof(loop->accept_ctx));
+    loop->accept_ctx.hosts = config_.hosts;
+
+    loop->loop = h2o_evloop_create();
+    if (loop->loop == nullptr) {
+      close(loop_fd);
+      throw std::runtime_error("Failed to create evloop");
+    }
+    h2o_context_init(&loop->context, loop->loop, &config_);
+
+    loop->listener = h2o_evloop_socket_create(loop->loop, loop_fd,
+                                              H2O_SOCKET_FLAG_DONT_READ);
+    if (loop->listener == nullptr) {
+      perror("failed to create listener socket");
+      close(loop_fd);
+      h2o_context_dispose(&loop->context);
+      throw std::runtime_error("Failed to create listener socket");
+    }
+
+    loop->accept_ctx.ctx = &loop->context;
+    loop->listener->data = &loop->accept_ctx;
+    h2o_socket_read_start(loop->listener, AcceptConnection);
+    // Created before the loop runs, Stop posts to it from any thread
+    utils::LoopQueue::ForLoop(loop->loop);
+
+    contexts_.push_back(&loop->context);
+    loops_.push_back(std::move(loop));
   }
 
-  accept_ctx_.ctx = &contexts_;
-  listeners_->data = &accept_ctx_;
+  std::cout << "Server running on " << host_ << ":" << port_ << " with "
+            << count << " event loop(s)" << std::endl;
 
-  // auto accept_func = [](h2o_socket_t* sock, const char* err) {
-  //   h2o_accept_ctx_t* ctx = (h2o_accept_ctx_t*)sock->data;
-  //   std::cout << "Accepted connection"  << std::endl;
-  //   h2o_accept(ctx, sock);
-  // };
+  // The first loop runs on the calling thread, like a single loop server
+  {
+    std::lock_guard<std::mutex> lock(run_mutex_);
+    if (stopping_.load(std::memory_order_acquire))
+      return;
+    running_ = true;
+    loop_threads_.push_back(std::this_thread::get_id());
+    for (size_t i = 1; i < loops_.size(); ++i) {
+      threads_.emplace_back(&H2OServer::RunEventLoop, this,
+                            std::ref(*loops_[i]));
+      loop_threads_.push_back(threads_.back().get_id());
+    }
+  }
+  RunEventLoop(*loops_.front());
 
-  h2o_socket_read_start(listeners_, AcceptConnection);
-  std::cout << "Server running on " << host_ << ":" << port_ << std::endl;
-  RunEventLoop();
+  // Every loop was asked to leave along with this one
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(run_mutex_);
+    threads.swap(threads_);
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (auto& loop : loops_) {
+    h2o_socket_close(loop->listener);
+    loop->listener = nullptr;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(run_mutex_);
+    running_ = false;
+  }
+  run_done_.notify_all();
+  std::cout << "Server stopped" << std::endl;
 }
 
-void H2OServer::Stop() {}
+void H2OServer::Stop() {
+  std::unique_lock<std::mutex> lock(run_mutex_);
+  stopping_.store(true, std::memory_order_release);
+  if (!running_)
+    return;
+
+  // Wake every loop, each one leaves at the end of its iteration
+  for (auto& loop : loops_)
+    utils::LoopQueue::ForLoop(loop->loop)->Post([]() {});
+  if (OnLoopThread())
+    return;
+  run_done_.wait(lock, [this]() { return !running_; });
+}
+
+bool H2OServer::OnLoopThread() const {
+  auto self = std::this_thread::get_id();
+  return std::find(loop_threads_.begin(), loop_threads_.end(), self) !=
+         loop_threads_.end();
+}
 
-void H2OServer::RunEventLoop() {
-  while (h2o_evloop_run(contexts_.loop, INT32_MAX) == 0)
-    ;
+void H2OServer::RunEventLoop(EventLoop& loop) {
+  metrics::LoopProbe probe;
+  // A signal (e.g. the watchdog stack sample) may interrupt epoll_wait
+  while (!stopping_.load(std::memory_order_acquire) &&
+         (h2o_evloop_run(loop.loop, INT32_MAX) == 0 || errno == EINTR))
+    probe.Iterated();
 }
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
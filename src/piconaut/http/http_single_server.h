@@ -4,8 +4,14 @@
 #include <h2o.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "piconaut/handlers/handler_base.h"
 #include "piconaut/http/config.h"
@@ -14,6 +20,7 @@
 #include "piconaut/routers/router.h"
 #include "piconaut/middleware/middleware_manager.h"
 #include "piconaut/handlers/global_dispatcher_handler.h"
+#include "piconaut/handlers/metrics_handler.h"
 
 PICONAUT_INNER_NAMESPACE(http)
 
@@ -26,27 +33,89 @@ class H2OServer {
   const Config& GetConfig() const;
   bool SetSSL();
   
+  // Middleware stacks, resolved per route when the server starts.
+  // Order: global, path prefix (outer first), then route.
   void RegisterMiddleware(std::shared_ptr<middleware::MiddlewareBase> middleware);
+  void RegisterMiddleware(const std::string& prefix,
+                          std::shared_ptr<middleware::MiddlewareBase> middleware);
+  void RegisterRouteMiddleware(
+      const std::string& path,
+      std::shared_ptr<middleware::MiddlewareBase> middleware);
   void RegisterHandler(const std::string& path,
                        std::shared_ptr<handlers::HandlerBase> handler);
+  void EnableResponseCache(
+      const std::string& path,
+      const cache::CachePolicy& policy = cache::CachePolicy());
+  // Coalesce identical concurrent GET on path, duplicates share the
+  // response of the first one.
+  void EnableSingleFlight(
+      const std::string& path,
+      const cache::SingleFlightPolicy& policy = cache::SingleFlightPolicy());
+  void EnableCompression(const std::string& path,
+                         const CompressionPolicy& policy);
+  // Server wide CORS, same as Config::Cors with the full policy.
+  void EnableCors(const CorsPolicy& policy);
+  // CORS for route path, override the server wide policy.
+  void EnableCors(const std::string& path, const CorsPolicy& policy);
+  // Adaptive concurrency limit on every route, each route is limited on
+  // its own and answers 503 past its limit.
+  void EnableConcurrencyLimit(
+      const routers::ConcurrencyPolicy& policy = routers::ConcurrencyPolicy());
+  // Concurrency limit for route path, override the server wide policy.
+  void EnableConcurrencyLimit(const std::string& path,
+                              const routers::ConcurrencyPolicy& policy);
+  std::vector<handlers::RouteConcurrency> RouteConcurrencyLimits() const;
+  // Prometheus scrape endpoint (request counters and latency histograms
+  // per route, limits, size hints, connection counters). It's a regular
+  // route, middleware registered for it apply.
+  void EnableMetrics(const std::string& path = "/metrics");
+  // Log callbacks blocking the event loop past threshold, with their
+  // route and a stack sample. Also the slow callback metric threshold.
+  void EnableLoopWatchdog(
+      std::chrono::milliseconds threshold = std::chrono::milliseconds(100));
+  // Adaptive json size estimate per route, for metrics.
+  std::vector<handlers::RouteSizeHint> RouteSizeHints() const;
+  // Run every event loop, the first one on the calling thread. Returns
+  // once the server is stopped.
   void Start();
+  // Make every loop leave and wait until Start returned, listeners are
+  // closed by then. From a loop thread (e.g. a handler) it only asks,
+  // Start finishes on its own. A stopped server doesn't start again.
   void Stop();
 
  private:
  void RegisterGlobalHandler(std::shared_ptr<handlers::HandlerBase> handler);
-  void RunEventLoop();
+  // One per Config::EventLoops, each with its own listener on the
+  // shared listening socket.
+  struct EventLoop {
+    h2o_evloop_t* loop;
+    h2o_context_t context;
+    h2o_accept_ctx_t accept_ctx;
+    h2o_socket_t* listener;
+  };
+
+  void RunEventLoop(EventLoop& loop);
+  bool OnLoopThread() const;
   static void AcceptConnection(h2o_socket_t* sock, const char* err);
 
   std::string host_;
   int port_;
   h2o_globalconf_t config_;
-  h2o_context_t contexts_;
-  h2o_evloop_t* loops_;
-  h2o_socket_t* listeners_;
+  std::vector<std::unique_ptr<EventLoop>> loops_;
+  // Contexts of loops_, for the metrics handler
+  std::vector<const h2o_context_t*> contexts_;
+  // Loops past the first one, joined when the server stops
+  std::vector<std::thread> threads_;
+  // Every loop thread, Start caller included
+  std::vector<std::thread::id> loop_threads_;
+  std::atomic<bool> stopping_;
+  std::mutex run_mutex_;
+  std::condition_variable run_done_;
+  bool running_;
   std::vector<std::shared_ptr<handlers::HandlerBase>> handlers_;
   h2o_hostconf_t* hostconf_;
-  h2o_accept_ctx_t accept_ctx_;
   std::string server_name_;
   std::shared_ptr<handlers::GlobalDispatcherHandler> routers_;
+  Config server_config_;
 };
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include <atomic>
+#include <cerrno>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -66,7 +67,7 @@ class H2OServerImpl {
   static void* RunLoop(void* arg) {
     h2o_context_t* ctx = static_cast<h2o_context_t*>(arg);
     h2o_evloop_t* loop = ctx->loop;
-    while (h2o_evloop_run(loop, INT32_MAX) == 0)
+    while (h2o_evloop_run(loop, INT32_MAX) == 0 || errno == EINTR)
       ;
     return nullptr;
   }
@@ -43,6 +43,57 @@ std::string Request::GetBody() const {
   return std::string(req_->entity.base, req_->entity.len);
 }
 
+formats::json::Value Request::Json(size_t seed_capacity) const {
+  auto arena = Arena();
+  auto format = BodyFormat();
+  if (format != formats::Format::kJson) {
+    // Binary body is decoded straight from h2o buffer, strings are
+    // copied into the document allocator.
+    return formats::json::Value::Decode(format, req_->entity.base,
+                                        req_->entity.len,
+                                        arena.Allocate(seed_capacity),
+                                        seed_capacity);
+  }
+
+  // h2o body is neither null terminated nor ours to modify,
+  // one copy into the pool then rapidjson parse it in place.
+  auto text = arena.CopyString(req_->entity.base, req_->entity.len);
+  return formats::json::Value::ParseInsitu(
+      const_cast<char*>(text.data()), text.size(),
+      arena.Allocate(seed_capacity), seed_capacity);
+}
+
+formats::Format Request::BodyFormat() const {
+  ssize_t index = h2o_find_header(&req_->headers, H2O_TOKEN_CONTENT_TYPE, -1);
+  if (index == -1)
+    return formats::Format::kJson;
+
+  const auto& value = req_->headers.entries[index].value;
+  return formats::FormatFromContentType(value.base, value.len);
+}
+
+formats::json::LazyReader Request::LazyJson() const {
+  return formats::json::LazyReader(
+      std::string_view(req_->entity.base, req_->entity.len));
+}
+
+h2o_req_t* Request::Native() const {
+  return req_;
+}
+
+RequestArena Request::Arena() const {
+  return RequestArena(&req_->pool);
+}
+
+std::string Request::GetQuery() const {
+  if (req_->query_at == SIZE_MAX) {
+    return "";
+  }
+
+  return std::string(req_->path.base + req_->query_at + 1,
+                     req_->path.len - req_->query_at - 1);
+}
+
 std::string Request::GetQueryString(const std::string& name) const {
   if (req_->query_at == SIZE_MAX) {
     return "";
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "piconaut/macro.h"
+#include "piconaut/http/request_arena.h"
+#include "piconaut/formats/json/lazy_reader.h"
+#include "piconaut/formats/json/value.h"
 #include <string>
 #include <unordered_map>
 #include <h2o.h>
@@ -18,7 +21,26 @@ class Request {
     std::unordered_map<std::string, std::string> Headers() const;
     std::string GetHeader(const std::string& name) const;
     std::string GetBody() const;
+    // Parse the body as json in place over a request pool copy.
+    // String values are views into the request pool, don't keep them
+    // after the request. MessagePack and CBOR bodies (by Content-Type)
+    // are decoded into the same Value. Throw formats::json::ParseError,
+    // which is answered with 400 when it escapes the handler.
+    formats::json::Value Json(
+        size_t seed_capacity = RequestArena::kDefaultJsonSeedCapacity) const;
+    // Body format from Content-Type, json when missing or unknown.
+    formats::Format BodyFormat() const;
+    // On-demand reader straight over the body, no copy and no DOM.
+    // For large bodies when only a few fields are needed.
+    formats::json::LazyReader LazyJson() const;
     std::string GetQueryString(const std::string& name) const;
+    // Raw query string without the leading '?'
+    std::string GetQuery() const;
+    // Request scoped memory, released when h2o disposes the request
+    RequestArena Arena() const;
+    // Underlying h2o request, for integrations that drive h2o directly
+    // (e.g. websocket upgrade)
+    h2o_req_t* Native() const;
 
  private:
     h2o_req_t* req_;
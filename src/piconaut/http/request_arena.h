@@ -0,0 +1,143 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "piconaut/formats/json/value_builder.h"
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(http)
+
+// h2o pool only bumps an offset (h2o_strdup leaves odd ones), arena
+// allocations are rounded up to this alignment.
+constexpr size_t kArenaAlignment = alignof(std::max_align_t);
+
+// `size` bytes from `pool` aligned on `align`, a power of two.
+inline void* AlignedPoolAlloc(h2o_mem_pool_t* pool, size_t size,
+                              size_t align = kArenaAlignment) {
+  auto raw = reinterpret_cast<uintptr_t>(
+      h2o_mem_alloc_pool(pool, size + align - 1));
+  return reinterpret_cast<void*>((raw + align - 1) & ~uintptr_t(align - 1));
+}
+
+/// @brief Request scoped arena on top of the h2o request memory pool.
+/// Pool allocations are released in one shot when h2o disposes the
+/// request, Free/deallocate is a no-op. Objects with a destructor are
+/// malloc'ed by h2o and destroyed along with the pool.
+/// The arena is only valid inside the request handling.
+class RequestArena {
+ public:
+  explicit RequestArena(h2o_mem_pool_t* pool) : pool_(pool) {
+    if (!pool_) {
+      throw std::invalid_argument("RequestArena pool cannot be null");
+    }
+  }
+
+  h2o_mem_pool_t* Pool() const {
+    return pool_;
+  }
+
+  // Aligned on kArenaAlignment.
+  void* Allocate(size_t size) const {
+    return AlignedPoolAlloc(pool_, size);
+  }
+
+  // Create object inside the arena.
+  // Non trivially destructible object will have the destructor called
+  // when the request pool is released.
+  template <typename T, typename... Args>
+  T* Create(Args&&... args) const {
+    static_assert(alignof(T) <= kArenaAlignment,
+                  "RequestArena can't satisfy the type alignment");
+    void* mem;
+    if (std::is_trivially_destructible<T>::value) {
+      mem = AlignedPoolAlloc(pool_, sizeof(T), alignof(T));
+    } else {
+      // malloc'ed entry, the payload after its two words header keeps
+      // the malloc alignment
+      mem = h2o_mem_alloc_shared(pool_, sizeof(T), &RequestArena::Destroy<T>);
+    }
+    return new (mem) T(std::forward<Args>(args)...);
+  }
+
+  // Copy string into the arena, the result is null terminated.
+  __PCN_STRING_COMPAT CopyString(const char* str, size_t size) const {
+    char* mem = static_cast<char*>(AlignedPoolAlloc(pool_, size + 1, 1));
+    memcpy(mem, str, size);
+    mem[size] = '\0';
+    return __PCN_STRING_COMPAT(mem, size);
+  }
+
+  // Json builder destroyed with the request pool, its rapidjson
+  // allocator is seeded from the arena. The builder itself, its node
+  // and key containers and the rapidjson chunks past the seed capacity
+  // still come from malloc.
+  formats::json::ValueBuilder& NewJsonBuilder(
+      size_t seed_capacity = kDefaultJsonSeedCapacity) const {
+    return *Create<formats::json::ValueBuilder>(Allocate(seed_capacity),
+                                                seed_capacity);
+  }
+
+  static constexpr size_t kDefaultJsonSeedCapacity = 8 * 1024;
+
+ private:
+  h2o_mem_pool_t* pool_;
+
+  template <typename T>
+  static void Destroy(void* obj) {
+    static_cast<T*>(obj)->~T();
+  }
+};
+
+/// @brief STL allocator backed by RequestArena.
+/// ```cpp
+/// auto arena = req.Arena();
+/// std::vector<int, http::ArenaAllocator<int>> ids(
+///     http::ArenaAllocator<int>(arena));
+/// ```
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(const RequestArena& arena) : pool_(arena.Pool()) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : pool_(other.Pool()) {}
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= kArenaAlignment,
+                  "ArenaAllocator can't satisfy the type alignment");
+    return static_cast<T*>(AlignedPoolAlloc(pool_, n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {
+    // released together with the request pool
+  }
+
+  h2o_mem_pool_t* Pool() const {
+    return pool_;
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return pool_ == other.Pool();
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return pool_ != other.Pool();
+  }
+
+ private:
+  h2o_mem_pool_t* pool_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -1,9 +1,148 @@
-
 #include "piconaut/http/response.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <new>
+#include <utility>
+
+#include "piconaut/utils/hash.h"
+
 // cppcheck-suppress unknownMacro
 PICONAUT_INNER_NAMESPACE(http)
-Response::Response(h2o_req_t* req) : req_(req) {
+
+namespace {
+
+template <typename T>
+void DisposeOwned(void* owner) {
+  static_cast<T*>(owner)->~T();
+}
+
+// Move the body owner into the request pool.
+// h2o calls the dispose callback when the request pool is released,
+// so the bytes stay valid until h2o finished writing them to the socket.
+template <typename T>
+T* AdoptToPool(h2o_mem_pool_t* pool, T&& owner) {
+  void* mem = h2o_mem_alloc_shared(pool, sizeof(T), DisposeOwned<T>);
+  return new (mem) T(std::move(owner));
+}
+
+// Strong ETag from 64-bit hash of the body
+std::string MakeEtag(h2o_iovec_t body) {
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%016" PRIx64 "\"",
+           utils::hash::Hash64(body.base, body.len));
+  return std::string(etag);
+}
+
+// Generator for SendRegion, h2o_generator_t must be the first member
+// since h2o hand back the generator pointer on proceed.
+struct RegionGenerator {
+  h2o_generator_t super;
+  std::shared_ptr<const void> owner;
+  const char* cursor;
+  size_t remaining;
+  size_t chunk_size;
+};
+
+void SendNextRegionChunk(RegionGenerator* self, h2o_req_t* req) {
+  size_t len = self->remaining < self->chunk_size ? self->remaining
+                                                  : self->chunk_size;
+  h2o_iovec_t buf = h2o_iovec_init(self->cursor, len);
+  self->cursor += len;
+  self->remaining -= len;
+  h2o_send(req, &buf, 1,
+           self->remaining == 0 ? H2O_SEND_STATE_FINAL
+                                : H2O_SEND_STATE_IN_PROGRESS);
+}
+
+void OnRegionProceed(h2o_generator_t* generator, h2o_req_t* req) {
+  SendNextRegionChunk(reinterpret_cast<RegionGenerator*>(generator), req);
+}
+
+void OnRegionStop(h2o_generator_t* generator, h2o_req_t* req) {
+  // Nothing to do, owner is released when the pool is disposed
+}
+
+// Generator for SendFile, the next chunk is read when h2o proceeds so
+// the buffer is never overwritten while h2o still sends it.
+struct FileGenerator {
+  h2o_generator_t super;
+  std::shared_ptr<const void> owner;
+  int fd;
+  off_t offset;
+  size_t remaining;
+  size_t chunk_size;
+  char* buffer;
+};
+
+void SendNextFileChunk(FileGenerator* self, h2o_req_t* req) {
+  size_t len = std::min(self->remaining, self->chunk_size);
+  ssize_t read_len;
+  do {
+    read_len = pread(self->fd, self->buffer, len, self->offset);
+  } while (read_len == -1 && errno == EINTR);
+
+  if (read_len <= 0) {
+    // File truncated since it was opened, the response can't complete
+    h2o_send(req, nullptr, 0, H2O_SEND_STATE_ERROR);
+    return;
+  }
+
+  h2o_iovec_t buf = h2o_iovec_init(self->buffer, read_len);
+  self->offset += read_len;
+  self->remaining -= static_cast<size_t>(read_len);
+  h2o_send(req, &buf, 1,
+           self->remaining == 0 ? H2O_SEND_STATE_FINAL
+                                : H2O_SEND_STATE_IN_PROGRESS);
+}
+
+void OnFileProceed(h2o_generator_t* generator, h2o_req_t* req) {
+  SendNextFileChunk(reinterpret_cast<FileGenerator*>(generator), req);
+}
+
+// Record the headers the handler set, the content type is kept apart
+// by the capture.
+void CaptureHeaders(ResponseCapture& capture, const h2o_headers_t& headers) {
+  for (size_t i = capture.header_offset; i < headers.size; ++i) {
+    const h2o_header_t& header = headers.entries[i];
+    const auto& name = *header.name;
+    if (h2o_lcstris(name.base, name.len, H2O_STRLIT("content-type")))
+      continue;
+
+    if (h2o_lcstris(name.base, name.len, H2O_STRLIT("set-cookie")) ||
+        (h2o_lcstris(name.base, name.len, H2O_STRLIT("cache-control")) &&
+         (h2o_contains_token(header.value.base, header.value.len,
+                             H2O_STRLIT("private"), ',') ||
+          h2o_contains_token(header.value.base, header.value.len,
+                             H2O_STRLIT("no-store"), ','))))
+      capture.cacheable = false;
+
+    capture.headers.emplace_back(std::string(name.base, name.len),
+                                 std::string(header.value.base,
+                                             header.value.len));
+  }
+}
+
+// Compressed body is another representation, it must not share the
+// strong ETag of the identity body.
+void TagEncoding(h2o_req_t* req, const char* encoding) {
+  ssize_t index = h2o_find_header(&req->res.headers, H2O_TOKEN_ETAG, -1);
+  if (index == -1)
+    return;
+
+  auto& value = req->res.headers.entries[index].value;
+  auto etag = EncodingEtag(std::string(value.base, value.len), encoding);
+  value = h2o_strdup(&req->pool, etag.c_str(), etag.size());
+}
+
+}  // namespace
+
+Response::Response(h2o_req_t* req)
+                : req_(req), capture_(nullptr), compression_(nullptr) {
   if (!req_) {
     throw std::invalid_argument("Response object cannot be null");
   }
@@ -15,40 +154,326 @@ void Response::Status(int status_code) const {
 
 void Response::AddHeader(const std::string& name,
                          const std::string& value) const {
-  h2o_add_header_by_str(&req_->pool, &req_->res.headers, name.c_str(),
-                        name.size(), 1, nullptr, value.c_str(), value.size());
+  // h2o keeps the pointers, the strings must live in the request pool
+  auto name_buf = h2o_strdup(&req_->pool, name.c_str(), name.size());
+  auto value_buf = h2o_strdup(&req_->pool, value.c_str(), value.size());
+  h2o_add_header_by_str(&req_->pool, &req_->res.headers, name_buf.base,
+                        name_buf.len, 1, nullptr, value_buf.base,
+                        value_buf.len);
+}
+
+void Response::Capture(ResponseCapture* capture) const {
+  capture_ = capture;
+  if (capture_)
+    capture_->header_offset = req_->res.headers.size;
+}
+
+void Response::Compress(const CompressionPolicy* policy) const {
+  compression_ = policy;
+}
+
+h2o_iovec_t Response::CompressBody(h2o_iovec_t body,
+                                   h2o_iovec_t content_type) const {
+  const auto& policy = *compression_;
+  int status = req_->res.status;
+  if (status < 200 || status >= 300 || status == 204 || status == 206)
+    return body;
+
+  if (body.len < policy.min_size || !content_type.len ||
+      !policy.IsCompressible(content_type.base, content_type.len))
+    return body;
+
+  // Already encoded, e.g. precompressed cache entry
+  if (h2o_find_header(&req_->res.headers, H2O_TOKEN_CONTENT_ENCODING, -1) !=
+      -1)
+    return body;
+
+  h2o_set_header_token(&req_->pool, &req_->res.headers, H2O_TOKEN_VARY,
+                       H2O_STRLIT("accept-encoding"));
+
+  ssize_t index =
+      h2o_find_header(&req_->headers, H2O_TOKEN_ACCEPT_ENCODING, -1);
+  if (index == -1)
+    return body;
+
+  const auto& accept_encoding = req_->headers.entries[index].value;
+  auto type =
+      NegotiateCompression(policy, accept_encoding.base, accept_encoding.len);
+
+  if (type == CompressionType::GZIP) {
+    auto& encoder = GzipEncoder::ThreadLocal();
+    if (!encoder.Begin(policy.gzip_level))
+      return body;
+
+    size_t capacity = encoder.Bound(body.len);
+    char* out = static_cast<char*>(h2o_mem_alloc_pool(&req_->pool, capacity));
+    size_t len = encoder.EncodeAll(body.base, body.len, out, capacity);
+    if (!len || len >= body.len)
+      return body;
+
+    h2o_add_header(&req_->pool, &req_->res.headers, H2O_TOKEN_CONTENT_ENCODING,
+                   NULL, H2O_STRLIT("gzip"));
+    TagEncoding(req_, "gzip");
+    return h2o_iovec_init(out, len);
+  }
+
+#if PICONAUT_USE_BROTLI
+  if (type == CompressionType::BROTLI) {
+    BrotliEncoder encoder;
+    std::string out;
+    if (!encoder.Begin(policy.brotli_level, body.len) ||
+        !encoder.Encode(body.base, body.len, true, out) ||
+        out.size() >= body.len)
+      return body;
+
+    h2o_add_header(&req_->pool, &req_->res.headers, H2O_TOKEN_CONTENT_ENCODING,
+                   NULL, H2O_STRLIT("br"));
+    TagEncoding(req_, "br");
+    auto owned = AdoptToPool(&req_->pool, std::move(out));
+    return h2o_iovec_init(owned->data(), owned->size());
+  }
+#endif
+
+  return body;
+}
+
+void Response::SendBody(h2o_iovec_t body, h2o_iovec_t content_type) const {
+  static h2o_generator_t generator = {nullptr, nullptr};
+
+  if (content_type.len)
+    h2o_add_header(&req_->pool, &req_->res.headers, H2O_TOKEN_CONTENT_TYPE,
+                   NULL, content_type.base, content_type.len);
+
+  if (capture_) {
+    capture_->captured = true;
+    capture_->status = req_->res.status;
+    capture_->content_type.assign(content_type.base, content_type.len);
+    capture_->body.assign(body.base, body.len);
+    CaptureHeaders(*capture_, req_->res.headers);
+    if (capture_->with_etag && req_->res.status == 200) {
+      capture_->etag = MakeEtag(body);
+      auto etag = h2o_strdup(&req_->pool, capture_->etag.c_str(),
+                             capture_->etag.size());
+      h2o_add_header(&req_->pool, &req_->res.headers, H2O_TOKEN_ETAG, NULL,
+                     etag.base, etag.len);
+    }
+  }
+
+  if (compression_)
+    body = CompressBody(body, content_type);
+
+  req_->res.content_length = body.len;
+  h2o_start_response(req_, &generator);
+  if (h2o_memis(req_->input.method.base, req_->input.method.len,
+                H2O_STRLIT("HEAD"))) {
+    h2o_send(req_, nullptr, 0, H2O_SEND_STATE_FINAL);
+  } else {
+    h2o_send(req_, &body, 1, H2O_SEND_STATE_FINAL);
+  }
 }
 
 void Response::Send(const std::string& body, int status_code) const {
   try {
     Status(status_code);
     req_->res.reason = "OK";
-    h2o_send_inline(req_, body.c_str(), body.size());
+    SendBody(h2o_strdup(&req_->pool, body.c_str(), body.size()),
+             h2o_iovec_init(nullptr, 0));
   } catch (const std::exception& e) {
     Status(H2O_STATUS_ERROR_503);
     h2o_send_error_503(req_, "internal server error", e.what(), 0);
   }
 }
 
-void Response::SendJson(const formats::json::JsonBuffer& json, int status_code) const {
+void Response::Send(std::string&& body, int status_code) const {
   try {
     Status(status_code);
-    h2o_add_header(&req_->pool, &req_->res.headers, H2O_TOKEN_CONTENT_TYPE, NULL, H2O_STRLIT("application/json"));
     req_->res.reason = "OK";
 
-    
+    auto owned = AdoptToPool(&req_->pool, std::move(body));
+    SendBody(h2o_iovec_init(owned->data(), owned->size()),
+             h2o_iovec_init(nullptr, 0));
+  } catch (const std::exception& e) {
+    Status(H2O_STATUS_ERROR_503);
+    h2o_send_error_503(req_, "internal server error", e.what(), 0);
+  }
+}
+
+void Response::Send(std::shared_ptr<const std::string> body,
+                    const std::string& content_type, int status_code) const {
+  try {
+    if (!body)
+      throw std::invalid_argument("Response body cannot be null");
+
+    Status(status_code);
+    req_->res.reason = "OK";
+
+    auto owned = AdoptToPool(&req_->pool, std::move(body));
+    SendBody(h2o_iovec_init((*owned)->data(), (*owned)->size()),
+             h2o_strdup(&req_->pool, content_type.c_str(),
+                        content_type.size()));
+  } catch (const std::exception& e) {
+    Status(H2O_STATUS_ERROR_503);
+    h2o_send_error_503(req_, "internal server error", e.what(), 0);
+  }
+}
+
+formats::Format Response::NegotiatedFormat() const {
+  ssize_t index = h2o_find_header(&req_->headers, H2O_TOKEN_ACCEPT, -1);
+  if (index == -1)
+    return formats::Format::kJson;
+
+  const auto& accept = req_->headers.entries[index].value;
+  return formats::NegotiateFormat(accept.base, accept.len);
+}
+
+void Response::SendJson(const formats::json::JsonBuffer& json,
+                        int status_code) const {
+  auto format = NegotiatedFormat();
+  if (format == formats::Format::kJson) {
+    SendEncoded(json, format, status_code);
+    return;
+  }
+
+  try {
+    SendEncoded(formats::binary::Transcode(json.View(), format), format,
+                status_code);
+  } catch (const std::exception& e) {
+    Status(H2O_STATUS_ERROR_503);
+    h2o_send_error_503(req_, "internal server error", e.what(), 0);
+  }
+}
+
+void Response::SendJson(formats::json::JsonBuffer&& json,
+                        int status_code) const {
+  auto format = NegotiatedFormat();
+  if (format == formats::Format::kJson) {
+    SendEncoded(std::move(json), format, status_code);
+    return;
+  }
+
+  SendJson(static_cast<const formats::json::JsonBuffer&>(json), status_code);
+}
+
+void Response::SendJson(const formats::json::ValueBuilder& json,
+                        int status_code) const {
+  try {
+    auto format = NegotiatedFormat();
+    SendEncoded(json.Serialize(format), format, status_code);
+  } catch (const std::exception& e) {
+    Status(H2O_STATUS_ERROR_503);
+    h2o_send_error_503(req_, "internal server error", e.what(), 0);
+  }
+}
+
+void Response::SendEncoded(const formats::json::JsonBuffer& body,
+                           formats::Format format, int status_code) const {
+  try {
+    Status(status_code);
+    req_->res.reason = "OK";
+    h2o_set_header_token(&req_->pool, &req_->res.headers, H2O_TOKEN_VARY,
+                         H2O_STRLIT("accept"));
+    auto content_type = formats::ContentType(format);
+    SendBody(h2o_strdup(&req_->pool, body.Data(), body.Size()),
+             h2o_iovec_init(content_type.data(), content_type.size()));
+  } catch (const std::exception& e) {
+    Status(H2O_STATUS_ERROR_503);
+    h2o_send_error_503(req_, "internal server error", e.what(), 0);
+  }
+}
+
+void Response::SendEncoded(formats::json::JsonBuffer&& body,
+                           formats::Format format, int status_code) const {
+  if (body.IsInline()) {
+    // Small body lives inline, there is no chunk to hand over, it is
+    // copied into the request pool.
+    SendEncoded(static_cast<const formats::json::JsonBuffer&>(body), format,
+                status_code);
+    return;
+  }
 
-    // Prepare the buffer
-    h2o_iovec_t body;
-    body.base = (char*)json.data;
-    body.len = json.size;
+  try {
+    Status(status_code);
+    req_->res.reason = "OK";
+    h2o_set_header_token(&req_->pool, &req_->res.headers, H2O_TOKEN_VARY,
+                         H2O_STRLIT("accept"));
 
-    // Send the response
-    h2o_send_inline(req_, body.base, body.len);
+    // Only the chunk is handed over to the request pool, it goes back to
+    // the thread free list when h2o disposes the request.
+    auto owned = AdoptToPool(&req_->pool, body.TakeChunk());
+    auto content_type = formats::ContentType(format);
+    SendBody(h2o_iovec_init(owned->Data(), owned->Size()),
+             h2o_iovec_init(content_type.data(), content_type.size()));
   } catch (const std::exception& e) {
     Status(H2O_STATUS_ERROR_503);
     h2o_send_error_503(req_, "internal server error", e.what(), 0);
   }
 }
 
-PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
+bool Response::StartStream(h2o_generator_t* generator, size_t size,
+                           const std::string& content_type,
+                           int status_code) const {
+  Status(status_code);
+  req_->res.reason = "OK";
+  if (!content_type.empty()) {
+    auto value =
+        h2o_strdup(&req_->pool, content_type.c_str(), content_type.size());
+    h2o_add_header(&req_->pool, &req_->res.headers, H2O_TOKEN_CONTENT_TYPE,
+                   NULL, value.base, value.len);
+  }
+
+  req_->res.content_length = size;
+  h2o_start_response(req_, generator);
+  if (size == 0 || h2o_memis(req_->input.method.base, req_->input.method.len,
+                             H2O_STRLIT("HEAD"))) {
+    h2o_send(req_, nullptr, 0, H2O_SEND_STATE_FINAL);
+    return false;
+  }
+  return true;
+}
+
+void Response::SendRegion(std::shared_ptr<const void> owner, const char* data,
+                          size_t size, const std::string& content_type,
+                          int status_code, size_t chunk_size) const {
+  auto generator = static_cast<RegionGenerator*>(h2o_mem_alloc_shared(
+      &req_->pool, sizeof(RegionGenerator), DisposeOwned<RegionGenerator>));
+  new (generator) RegionGenerator();
+  generator->super.proceed = OnRegionProceed;
+  generator->super.stop = OnRegionStop;
+  generator->owner = std::move(owner);
+  generator->cursor = data;
+  generator->remaining = size;
+  generator->chunk_size = chunk_size ? chunk_size : size;
+
+  if (StartStream(&generator->super, size, content_type, status_code))
+    SendNextRegionChunk(generator, req_);
+}
+
+void Response::SendFile(std::shared_ptr<const void> owner, int fd,
+                        size_t offset, size_t size,
+                        const std::string& content_type, int status_code,
+                        size_t chunk_size) const {
+  auto generator = static_cast<FileGenerator*>(h2o_mem_alloc_shared(
+      &req_->pool, sizeof(FileGenerator), DisposeOwned<FileGenerator>));
+  new (generator) FileGenerator();
+  generator->super.proceed = OnFileProceed;
+  generator->super.stop = OnRegionStop;
+  generator->owner = std::move(owner);
+  generator->fd = fd;
+  generator->offset = static_cast<off_t>(offset);
+  generator->remaining = size;
+  generator->chunk_size = chunk_size ? std::min(chunk_size, size) : size;
+  generator->buffer = nullptr;
+
+  if (!StartStream(&generator->super, size, content_type, status_code))
+    return;
+  generator->buffer = static_cast<char*>(
+      h2o_mem_alloc_pool(&req_->pool, generator->chunk_size));
+  SendNextFileChunk(generator, req_);
+}
+
+void Response::SendEmpty(int status_code) const {
+  Status(status_code);
+  h2o_send_inline(req_, "", 0);
+}
+
+PICONAUT_INNER_END_NAMESPACE
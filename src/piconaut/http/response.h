@@ -1,13 +1,39 @@
 #pragma once
 #include <h2o.h>
 
+#include <memory>
 #include <string>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "piconaut/macro.h"
 #include "piconaut/formats/json/value_builder.h"
+#include "piconaut/formats/json/json_fields.h"
+#include "piconaut/formats/serialize.h"
+#include "piconaut/http/compression.h"
 
 PICONAUT_INNER_NAMESPACE(http)
 
+// Record of the body sent through the Response.
+// Used by dispatcher level features (e.g. response cache),
+// the capture copy the body, only attach it when needed.
+struct ResponseCapture {
+  bool captured = false;
+  bool with_etag = false;
+  // false when the handler answered a private response (Set-Cookie,
+  // Cache-Control private / no-store), it must not be shared.
+  bool cacheable = true;
+  int status = 0;
+  // Response headers already set when the capture started (e.g. by
+  // middleware), only the ones added after are recorded.
+  size_t header_offset = 0;
+  std::string content_type;
+  std::string body;
+  std::string etag;
+  std::vector<std::pair<std::string, std::string>> headers;
+};
+
 class Response {
  public:
   explicit Response(h2o_req_t* req);
@@ -15,10 +41,69 @@ class Response {
   void Status(int status_code) const;
   void AddHeader(const std::string& name, const std::string& value) const;
   void Send(const std::string& body, int status_code = 200) const;
+  // Takes ownership of the body, no copy is made on the way to h2o.
+  void Send(std::string&& body, int status_code = 200) const;
+  // Shares the body with the caller (e.g. cached body), no copy is made.
+  void Send(std::shared_ptr<const std::string> body,
+            const std::string& content_type, int status_code = 200) const;
+  // SendJson answers in the format asked by the Accept header: json text
+  // is sent as is or transcoded to MessagePack / CBOR, builders and
+  // reflected types are serialized straight into the negotiated format.
   void SendJson(const formats::json::JsonBuffer& json, int status_code = 200) const;
+  void SendJson(formats::json::JsonBuffer&& json, int status_code = 200) const;
+  void SendJson(const formats::json::ValueBuilder& json,
+                int status_code = 200) const;
+  // Serialize a PICONAUT_JSON_FIELDS type (or container of it) and send.
+  template <typename T,
+            typename = std::enable_if_t<!std::is_same_v<
+                std::decay_t<T>, formats::json::JsonBuffer>>>
+  void SendJson(const T& value, int status_code = 200) const {
+    auto format = NegotiatedFormat();
+    SendEncoded(formats::Serialize(value, format), format, status_code);
+  }
+  // Body already encoded in `format`, sent with its content type.
+  void SendEncoded(const formats::json::JsonBuffer& body,
+                   formats::Format format, int status_code = 200) const;
+  void SendEncoded(formats::json::JsonBuffer&& body, formats::Format format,
+                   int status_code = 200) const;
+  // Response format from the request Accept header.
+  formats::Format NegotiatedFormat() const;
+  // Stream memory region owned by `owner` (e.g. cached file content).
+  // Region larger than chunk_size is sent chunk by chunk as h2o proceed,
+  // the owner is released when h2o disposes the request.
+  void SendRegion(std::shared_ptr<const void> owner, const char* data,
+                  size_t size, const std::string& content_type,
+                  int status_code = 200,
+                  size_t chunk_size = kDefaultRegionChunkSize) const;
+  // Stream `size` bytes of `fd` from `offset`, read with pread chunk by
+  // chunk as h2o proceed. A file truncated meanwhile aborts the response.
+  // `owner` keeps the fd open until h2o disposes the request.
+  void SendFile(std::shared_ptr<const void> owner, int fd, size_t offset,
+                size_t size, const std::string& content_type,
+                int status_code = 200,
+                size_t chunk_size = kDefaultRegionChunkSize) const;
+  // Send headers only response, e.g. 304 Not Modified.
+  void SendEmpty(int status_code) const;
+
+  void Capture(ResponseCapture* capture) const;
+  // Dynamic compression policy for this response, nullptr disable it.
+  // Only bodies sent in one piece are compressed, SendRegion / SendFile
+  // streams go out as is (static files use precompressed siblings).
+  void Compress(const CompressionPolicy* policy) const;
+
+  static constexpr size_t kDefaultRegionChunkSize = 256 * 1024;
 
  private:
   h2o_req_t* req_;
+  mutable ResponseCapture* capture_;
+  mutable const CompressionPolicy* compression_;
+
+  void SendBody(h2o_iovec_t body, h2o_iovec_t content_type) const;
+  // Status, content type & length then start the response. false when
+  // there is no body to stream (empty or HEAD), the response is done.
+  bool StartStream(h2o_generator_t* generator, size_t size,
+                   const std::string& content_type, int status_code) const;
+  h2o_iovec_t CompressBody(h2o_iovec_t body, h2o_iovec_t content_type) const;
 };
 
-PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,93 @@
+#include "piconaut/metrics/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "piconaut/utils/worker.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(metrics)
+
+namespace {
+
+inline int HighestBit(uint64_t value) {
+  return 63 - __builtin_clzll(value);
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() : total_(0), sum_(0) {
+  for (auto& count : counts_)
+    count.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::IndexOf(uint64_t micros) {
+  // Values below 2 * kSubBuckets are exact
+  if (micros < 2 * kSubBuckets)
+    return static_cast<size_t>(micros);
+
+  int shift = HighestBit(micros) - kSubBucketBits;
+  uint64_t sub = micros >> shift;  // in [kSubBuckets, 2 * kSubBuckets)
+  size_t index = static_cast<size_t>(shift + 1) * kSubBuckets +
+                 static_cast<size_t>(sub - kSubBuckets);
+  return std::min(index, kBucketCount - 1);
+}
+
+uint64_t LatencyHistogram::UpperBound(size_t index) {
+  if (index < 2 * kSubBuckets)
+    return index;
+
+  int shift = static_cast<int>(index / kSubBuckets) - 1;
+  uint64_t sub = kSubBuckets + index % kSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+  utils::SlotAdd(counts_[IndexOf(micros)], 1);
+  utils::SlotAdd(total_, 1);
+  utils::SlotAdd(sum_, micros);
+}
+
+HistogramSnapshot::HistogramSnapshot()
+                : counts_(LatencyHistogram::kBucketCount, 0),
+                  total_(0),
+                  sum_(0) {}
+
+void HistogramSnapshot::Merge(const LatencyHistogram& histogram) {
+  for (size_t i = 0; i < counts_.size(); ++i)
+    counts_[i] += histogram.Count(i);
+  total_ += histogram.Total();
+  sum_ += histogram.SumMicros();
+}
+
+uint64_t HistogramSnapshot::CountAtOrBelow(uint64_t micros) const {
+  uint64_t count = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (LatencyHistogram::UpperBound(i) > micros)
+      break;
+    count += counts_[i];
+  }
+  return count;
+}
+
+uint64_t HistogramSnapshot::ValueAtQuantile(double q) const {
+  // Bucket counts are summed on the fly, the total may lag them a little
+  uint64_t total = 0;
+  for (auto count : counts_)
+    total += count;
+  if (total == 0)
+    return 0;
+
+  auto rank = static_cast<uint64_t>(
+      std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank)
+      return LatencyHistogram::UpperBound(i);
+  }
+  return LatencyHistogram::UpperBound(counts_.size() - 1);
+}
+
+PICONAUT_INNER_END_NAMESPACE
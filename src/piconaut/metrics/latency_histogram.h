@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(metrics)
+
+/// @brief HDR style log-linear latency histogram in microseconds.
+/// Each power of two is split in 16 linear sub-buckets, so any recorded
+/// value is known within 1/16 (~6%) from 1us to ~12 days, in 592
+/// counters. Recording is a count-leading-zeros and one counter bump.
+///
+/// Written by one worker: counters are relaxed atomics bumped with
+/// load/store (no locked instruction) from a thread owning its worker
+/// slot, fetch_add from the others. Readable from the scrape thread.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  static constexpr size_t kBucketCount = 37 * kSubBuckets;
+
+  LatencyHistogram();
+
+  void Record(uint64_t micros);
+
+  uint64_t Count(size_t index) const {
+    return counts_[index].load(std::memory_order_relaxed);
+  }
+  uint64_t Total() const {
+    return total_.load(std::memory_order_relaxed);
+  }
+  uint64_t SumMicros() const {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+  static size_t IndexOf(uint64_t micros);
+  // Highest value that lands in bucket `index`.
+  static uint64_t UpperBound(size_t index);
+
+ private:
+  std::atomic<uint64_t> counts_[kBucketCount];
+  std::atomic<uint64_t> total_;
+  std::atomic<uint64_t> sum_;
+};
+
+/// @brief Plain merge of worker histograms, built at scrape time.
+class HistogramSnapshot {
+ public:
+  HistogramSnapshot();
+
+  void Merge(const LatencyHistogram& histogram);
+
+  uint64_t Total() const {
+    return total_;
+  }
+  uint64_t SumMicros() const {
+    return sum_;
+  }
+  // Samples at or below `micros` (bucket granularity).
+  uint64_t CountAtOrBelow(uint64_t micros) const;
+  // Value at quantile q in [0, 1], upper bound of its bucket.
+  uint64_t ValueAtQuantile(double q) const;
+
+ private:
+  std::vector<uint64_t> counts_;
+  uint64_t total_;
+  uint64_t sum_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,327 @@
+#include "piconaut/metrics/loop_monitor.h"
+
+#include <execinfo.h>
+#include <signal.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(metrics)
+
+namespace {
+
+// Loop probed on this thread and what its current iteration did so far
+struct ThreadLoop {
+  LoopStats* stats = nullptr;
+  uint64_t callback_ns = 0;
+  uint64_t callbacks = 0;
+};
+
+thread_local ThreadLoop t_loop;
+
+uint64_t NowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+uint64_t ThreadCpuNs() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    return 0;
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+  utils::SlotAdd(counter, value);
+}
+
+// Own worker slot for the loop thread, then its stats
+LoopStats* ClaimLoopStats() {
+  utils::ClaimWorkerSlot();
+  return &LoopMonitor::Global().Register();
+}
+
+int SampleSignal() {
+  return SIGRTMIN + 1;
+}
+
+void OnSample(int) {
+  // Only backtrace() here, libgcc is loaded before the first signal
+  auto stats = t_loop.stats;
+  if (!stats)
+    return;
+  int count = backtrace(stats->frames, LoopStats::kMaxFrames);
+  stats->frame_count.store(count, std::memory_order_release);
+}
+
+}  // namespace
+
+LoopStats::LoopStats()
+                : iteration(),
+                  iterations(0),
+                  busy_ns(0),
+                  idle_ns(0),
+                  callbacks(0),
+                  max_callbacks(0),
+                  slow_callbacks(0),
+                  longest_ns(0),
+                  longest_route(nullptr),
+                  callback_started_ns(0),
+                  callback_seq(0),
+                  callback_route(nullptr),
+                  registered(false),
+                  thread(),
+                  frames(),
+                  frame_count(0) {}
+
+LoopMonitor& LoopMonitor::Global() {
+  static LoopMonitor monitor;
+  return monitor;
+}
+
+LoopMonitor::LoopMonitor()
+                : slow_ns_(100000000ull),
+                  watchdog_mutex_(),
+                  watchdog_wake_(),
+                  watchdog_stop_(false),
+                  watchdog_() {
+  for (auto& loop : loops_)
+    loop.store(nullptr, std::memory_order_relaxed);
+}
+
+LoopMonitor::~LoopMonitor() {
+  StopWatchdog();
+  for (auto& loop : loops_)
+    delete loop.load(std::memory_order_relaxed);
+}
+
+LoopStats& LoopMonitor::Register() {
+  auto& slot = loops_[utils::WorkerSlot()];
+  LoopStats* stats = slot.load(std::memory_order_acquire);
+  if (!stats) {
+    // Loops past the own slots share one, one of them wins
+    auto fresh = new LoopStats();
+    if (slot.compare_exchange_strong(stats, fresh, std::memory_order_acq_rel))
+      stats = fresh;
+    else
+      delete fresh;
+  }
+  stats->thread = pthread_self();
+  stats->registered.store(true, std::memory_order_release);
+  return *stats;
+}
+
+std::vector<LoopSnapshot> LoopMonitor::Snapshot() const {
+  std::vector<LoopSnapshot> snapshots;
+  for (size_t i = 0; i < utils::kMaxWorkers; ++i) {
+    const LoopStats* stats = loops_[i].load(std::memory_order_acquire);
+    if (!stats)
+      continue;
+    LoopSnapshot snapshot;
+    snapshot.worker = i;
+    snapshot.iterations = stats->iterations.load(std::memory_order_relaxed);
+    snapshot.busy_ns = stats->busy_ns.load(std::memory_order_relaxed);
+    snapshot.idle_ns = stats->idle_ns.load(std::memory_order_relaxed);
+    snapshot.callbacks = stats->callbacks.load(std::memory_order_relaxed);
+    snapshot.max_callbacks =
+        stats->max_callbacks.load(std::memory_order_relaxed);
+    snapshot.slow_callbacks =
+        stats->slow_callbacks.load(std::memory_order_relaxed);
+    snapshot.longest_ns = stats->longest_ns.load(std::memory_order_relaxed);
+    auto route = stats->longest_route.load(std::memory_order_relaxed);
+    if (route)
+      snapshot.longest_route = *route;
+    snapshot.iteration.Merge(stats->iteration);
+    snapshots.push_back(std::move(snapshot));
+  }
+  return snapshots;
+}
+
+void LoopMonitor::SlowThreshold(std::chrono::milliseconds threshold) {
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(threshold);
+  slow_ns_.store(static_cast<uint64_t>(std::max<int64_t>(ns.count(), 1)),
+                 std::memory_order_relaxed);
+}
+
+void LoopMonitor::StartWatchdog(std::chrono::milliseconds threshold) {
+  SlowThreshold(threshold);
+
+  std::lock_guard<std::mutex> lock(watchdog_mutex_);
+  if (watchdog_.joinable())
+    return;
+
+  // First backtrace() loads libgcc, keep that out of the signal handler
+  void* frames[1];
+  backtrace(frames, 1);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = OnSample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SampleSignal(), &action, nullptr) != 0)
+    throw std::runtime_error("Failed to install the loop watchdog signal");
+
+  watchdog_stop_ = false;
+  watchdog_ = std::thread(&LoopMonitor::Watch, this);
+  std::cout << "Loop watchdog started, threshold " << threshold.count()
+            << "ms" << std::endl;
+}
+
+void LoopMonitor::StopWatchdog() {
+  {
+    std::lock_guard<std::mutex> lock(watchdog_mutex_);
+    if (!watchdog_.joinable())
+      return;
+    watchdog_stop_ = true;
+  }
+  watchdog_wake_.notify_all();
+  watchdog_.join();
+}
+
+void LoopMonitor::Attribute(const std::string* route) {
+  if (t_loop.stats)
+    t_loop.stats->callback_route.store(route, std::memory_order_relaxed);
+}
+
+void LoopMonitor::Watch() {
+  // Last callback reported per worker, each one is reported once
+  std::vector<uint64_t> reported(utils::kMaxWorkers, 0);
+
+  std::unique_lock<std::mutex> lock(watchdog_mutex_);
+  while (!watchdog_stop_) {
+    auto threshold = SlowThresholdNs();
+    auto period = std::chrono::nanoseconds(
+        std::clamp<uint64_t>(threshold / 4, 1000000ull, 100000000ull));
+    watchdog_wake_.wait_for(lock, period);
+    if (watchdog_stop_)
+      break;
+
+    lock.unlock();
+    auto now = NowNs();
+    for (size_t i = 0; i < utils::kMaxWorkers; ++i) {
+      LoopStats* stats = loops_[i].load(std::memory_order_acquire);
+      if (!stats || !stats->registered.load(std::memory_order_acquire))
+        continue;
+      auto started = stats->callback_started_ns.load(std::memory_order_relaxed);
+      auto seq = stats->callback_seq.load(std::memory_order_relaxed);
+      if (started == 0 || started > now || now - started < threshold ||
+          reported[i] == seq)
+        continue;
+      reported[i] = seq;
+      Report(i, *stats, now - started);
+    }
+    lock.lock();
+  }
+}
+
+void LoopMonitor::Report(size_t worker, LoopStats& stats,
+                         uint64_t elapsed_ns) {
+  auto seq = stats.callback_seq.load(std::memory_order_relaxed);
+  auto route = stats.callback_route.load(std::memory_order_relaxed);
+
+  // Ask the loop thread for its stack, give it a few ms to answer
+  int count = -1;
+  stats.frame_count.store(-1, std::memory_order_relaxed);
+  if (pthread_kill(stats.thread, SampleSignal()) == 0) {
+    for (int i = 0; i < 50 && count < 0; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      count = stats.frame_count.load(std::memory_order_acquire);
+    }
+  }
+
+  std::cerr << "Event loop #" << worker << " blocked for "
+            << elapsed_ns / 1000000 << "ms in callback on route "
+            << (route ? *route : std::string("unmatched")) << std::endl;
+  if (count <= 0) {
+    std::cerr << "  (no stack sample)" << std::endl;
+    return;
+  }
+  if (stats.callback_seq.load(std::memory_order_relaxed) != seq) {
+    std::cerr << "  (callback returned while sampling)" << std::endl;
+    return;
+  }
+
+  char** symbols = backtrace_symbols(stats.frames, count);
+  // Frame 0 is the signal handler itself
+  for (int i = 1; i < count; ++i) {
+    if (symbols)
+      std::cerr << "  #" << i - 1 << " " << symbols[i] << std::endl;
+    else
+      std::cerr << "  #" << i - 1 << " " << stats.frames[i] << std::endl;
+  }
+  free(symbols);
+}
+
+LoopProbe::LoopProbe()
+                : stats_(ClaimLoopStats()),
+                  wall_ns_(NowNs()),
+                  cpu_ns_(ThreadCpuNs()) {
+  t_loop = ThreadLoop{stats_, 0, 0};
+}
+
+LoopProbe::~LoopProbe() {
+  stats_->registered.store(false, std::memory_order_release);
+  t_loop = ThreadLoop();
+  utils::ReleaseWorkerSlot();
+}
+
+void LoopProbe::Iterated() {
+  auto wall = NowNs();
+  auto cpu = ThreadCpuNs();
+  auto wall_ns = wall - wall_ns_;
+  auto cpu_ns = cpu - cpu_ns_;
+  wall_ns_ = wall;
+  cpu_ns_ = cpu;
+
+  // CPU time misses blocking callbacks, callback time misses h2o's own
+  // work: take the larger, never more than the iteration
+  auto busy = std::min(wall_ns, std::max(cpu_ns, t_loop.callback_ns));
+  Add(stats_->iterations, 1);
+  Add(stats_->busy_ns, busy);
+  Add(stats_->idle_ns, wall_ns - busy);
+  Add(stats_->callbacks, t_loop.callbacks);
+  if (t_loop.callbacks > stats_->max_callbacks.load(std::memory_order_relaxed))
+    stats_->max_callbacks.store(t_loop.callbacks, std::memory_order_relaxed);
+  stats_->iteration.Record(busy / 1000);
+
+  t_loop.callback_ns = 0;
+  t_loop.callbacks = 0;
+}
+
+CallbackScope::CallbackScope() : stats_(t_loop.stats), started_ns_(0) {
+  if (!stats_)
+    return;
+  started_ns_ = std::max<uint64_t>(NowNs(), 1);
+  stats_->callback_route.store(nullptr, std::memory_order_relaxed);
+  Add(stats_->callback_seq, 1);
+  stats_->callback_started_ns.store(started_ns_, std::memory_order_relaxed);
+}
+
+CallbackScope::~CallbackScope() {
+  if (!stats_)
+    return;
+  auto elapsed = NowNs() - started_ns_;
+  stats_->callback_started_ns.store(0, std::memory_order_relaxed);
+
+  t_loop.callback_ns += elapsed;
+  t_loop.callbacks += 1;
+  if (elapsed > stats_->longest_ns.load(std::memory_order_relaxed)) {
+    stats_->longest_ns.store(elapsed, std::memory_order_relaxed);
+    stats_->longest_route.store(
+        stats_->callback_route.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  if (elapsed >= LoopMonitor::Global().SlowThresholdNs())
+    Add(stats_->slow_callbacks, 1);
+}
+
+PICONAUT_INNER_END_NAMESPACE
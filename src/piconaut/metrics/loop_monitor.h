@@ -0,0 +1,163 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "piconaut/macro.h"
+#include "piconaut/metrics/latency_histogram.h"
+#include "piconaut/utils/worker.h"
+
+PICONAUT_INNER_NAMESPACE(metrics)
+
+/// @brief Event loop counters of one worker, written by its loop thread
+/// with relaxed load/store. The callback fields are what the watchdog
+/// reads to spot a callback that doesn't return.
+struct alignas(64) LoopStats {
+  static constexpr int kMaxFrames = 48;
+
+  LoopStats();
+
+  // Busy part of each iteration (wake up to next poll), the lag an
+  // event ready during the iteration waits before it's looked at
+  LatencyHistogram iteration;
+  std::atomic<uint64_t> iterations;
+  std::atomic<uint64_t> busy_ns;
+  // Blocked in epoll waiting for events or timers
+  std::atomic<uint64_t> idle_ns;
+  std::atomic<uint64_t> callbacks;
+  std::atomic<uint64_t> max_callbacks;
+  std::atomic<uint64_t> slow_callbacks;
+  std::atomic<uint64_t> longest_ns;
+  std::atomic<const std::string*> longest_route;
+
+  // Callback running now, started_ns 0 when none
+  std::atomic<uint64_t> callback_started_ns;
+  std::atomic<uint64_t> callback_seq;
+  std::atomic<const std::string*> callback_route;
+
+  // Loop thread, for stack samples
+  std::atomic<bool> registered;
+  pthread_t thread;
+  // Filled by the loop thread in the sampling signal handler
+  void* frames[kMaxFrames];
+  std::atomic<int> frame_count;
+};
+
+// Merged view of a worker loop, for the metrics endpoint.
+struct LoopSnapshot {
+  size_t worker = 0;
+  uint64_t iterations = 0;
+  uint64_t busy_ns = 0;
+  uint64_t idle_ns = 0;
+  uint64_t callbacks = 0;
+  uint64_t max_callbacks = 0;
+  uint64_t slow_callbacks = 0;
+  uint64_t longest_ns = 0;
+  // Route of the longest callback, "" when it wasn't dispatched to one
+  std::string longest_route;
+  HistogramSnapshot iteration;
+};
+
+/// @brief Event loop saturation of every worker.
+///
+/// A LoopProbe on the loop thread splits each h2o_evloop_run in busy and
+/// idle time, and CallbackScope times every request callback h2o hands
+/// to piconaut. Busy is the larger of the thread CPU time and the time
+/// spent in callbacks, so a handler blocked in a syscall counts as busy
+/// while epoll_wait doesn't.
+///
+/// The optional watchdog thread looks at the running callback of every
+/// loop, a callback past the threshold is logged once to std::cerr with
+/// its route and a stack sampled from the loop thread (SIGRTMIN + 1).
+class LoopMonitor {
+ public:
+  static LoopMonitor& Global();
+
+  ~LoopMonitor();
+
+  LoopMonitor(const LoopMonitor&) = delete;
+  LoopMonitor& operator=(const LoopMonitor&) = delete;
+
+  // Stats slot of the calling loop thread, registered for stack samples.
+  LoopStats& Register();
+  std::vector<LoopSnapshot> Snapshot() const;
+
+  // Callbacks at least this long count as slow (default 100ms).
+  void SlowThreshold(std::chrono::milliseconds threshold);
+  uint64_t SlowThresholdNs() const {
+    return slow_ns_.load(std::memory_order_relaxed);
+  }
+
+  // Start the watchdog, sets the slow threshold too. Idempotent, the
+  // latest threshold applies.
+  void StartWatchdog(std::chrono::milliseconds threshold);
+  void StopWatchdog();
+
+  // Route of the callback running on this thread, kept alive by the
+  // caller (route paths live as long as the server).
+  static void Attribute(const std::string* route);
+
+ private:
+  LoopMonitor();
+
+  mutable std::atomic<LoopStats*> loops_[utils::kMaxWorkers];
+  std::atomic<uint64_t> slow_ns_;
+
+  std::mutex watchdog_mutex_;
+  std::condition_variable watchdog_wake_;
+  bool watchdog_stop_;
+  std::thread watchdog_;
+
+  void Watch();
+  void Report(size_t worker, LoopStats& stats, uint64_t elapsed_ns);
+};
+
+/// @brief Measures the iterations of one event loop, created on the loop
+/// thread before it starts running:
+///
+/// ```cpp
+/// metrics::LoopProbe probe;
+/// while (h2o_evloop_run(loop, INT32_MAX) == 0 || errno == EINTR)
+///   probe.Iterated();
+/// ```
+class LoopProbe {
+ public:
+  LoopProbe();
+  ~LoopProbe();
+
+  LoopProbe(const LoopProbe&) = delete;
+  LoopProbe& operator=(const LoopProbe&) = delete;
+
+  void Iterated();
+
+ private:
+  LoopStats* stats_;
+  uint64_t wall_ns_;
+  uint64_t cpu_ns_;
+};
+
+/// @brief Times one callback of the loop probed on this thread, a no-op
+/// on threads without a LoopProbe.
+class CallbackScope {
+ public:
+  CallbackScope();
+  ~CallbackScope();
+
+  CallbackScope(const CallbackScope&) = delete;
+  CallbackScope& operator=(const CallbackScope&) = delete;
+
+ private:
+  LoopStats* stats_;
+  uint64_t started_ns_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,81 @@
+#include "piconaut/metrics/prometheus.h"
+
+#include <cmath>
+#include <cstdio>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(metrics)
+
+void PrometheusWriter::Family(std::string_view name, std::string_view type,
+                              std::string_view help) {
+  text_ += "# HELP ";
+  text_ += name;
+  text_ += ' ';
+  AppendEscaped(help, true);
+  text_ += "\n# TYPE ";
+  text_ += name;
+  text_ += ' ';
+  text_ += type;
+  text_ += '\n';
+}
+
+void PrometheusWriter::Sample(std::string_view name,
+                              std::initializer_list<Label> labels,
+                              uint64_t value) {
+  BeginSample(name, labels);
+  text_ += std::to_string(value);
+  text_ += '\n';
+}
+
+void PrometheusWriter::Sample(std::string_view name,
+                              std::initializer_list<Label> labels,
+                              double value) {
+  BeginSample(name, labels);
+  if (std::isnan(value)) {
+    text_ += "NaN";
+  } else if (std::isinf(value)) {
+    text_ += value > 0 ? "+Inf" : "-Inf";
+  } else {
+    char number[32];
+    int size = snprintf(number, sizeof(number), "%.9g", value);
+    text_.append(number, static_cast<size_t>(size));
+  }
+  text_ += '\n';
+}
+
+void PrometheusWriter::BeginSample(std::string_view name,
+                                   std::initializer_list<Label> labels) {
+  text_ += name;
+  if (labels.size() != 0) {
+    text_ += '{';
+    bool first = true;
+    for (const auto& label : labels) {
+      if (!first)
+        text_ += ',';
+      first = false;
+      text_ += label.first;
+      text_ += "=\"";
+      AppendEscaped(label.second, false);
+      text_ += '"';
+    }
+    text_ += '}';
+  }
+  text_ += ' ';
+}
+
+void PrometheusWriter::AppendEscaped(std::string_view value, bool help) {
+  // HELP escape backslash and newline, label values the quote too
+  for (char c : value) {
+    if (c == '\\') {
+      text_ += "\\\\";
+    } else if (c == '\n') {
+      text_ += "\\n";
+    } else if (c == '"' && !help) {
+      text_ += "\\\"";
+    } else {
+      text_ += c;
+    }
+  }
+}
+
+PICONAUT_INNER_END_NAMESPACE
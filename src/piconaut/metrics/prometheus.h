@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "piconaut/macro.h"
+
+PICONAUT_INNER_NAMESPACE(metrics)
+
+using Label = std::pair<std::string_view, std::string_view>;
+
+/// @brief Prometheus text exposition format (0.0.4) builder.
+///
+/// ```cpp
+/// PrometheusWriter out;
+/// out.Family("app_jobs_total", "counter", "Jobs run.");
+/// out.Sample("app_jobs_total", {{"queue", "mail"}}, 42);
+/// res.Send(std::make_shared<const std::string>(out.Release()),
+///          PrometheusWriter::kContentType);
+/// ```
+class PrometheusWriter {
+ public:
+  static constexpr const char* kContentType =
+      "text/plain; version=0.0.4; charset=utf-8";
+
+  // HELP and TYPE lines, once before the samples of a metric.
+  void Family(std::string_view name, std::string_view type,
+              std::string_view help);
+
+  void Sample(std::string_view name, std::initializer_list<Label> labels,
+              uint64_t value);
+  void Sample(std::string_view name, std::initializer_list<Label> labels,
+              double value);
+
+  const std::string& Text() const {
+    return text_;
+  }
+
+  std::string Release() {
+    return std::move(text_);
+  }
+
+ private:
+  std::string text_;
+
+  void BeginSample(std::string_view name, std::initializer_list<Label> labels);
+  void AppendEscaped(std::string_view value, bool help);
+};
+
+PICONAUT_INNER_END_NAMESPACE
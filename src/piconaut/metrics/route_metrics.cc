@@ -0,0 +1,126 @@
+#include "piconaut/metrics/route_metrics.h"
+
+#include <cstdint>
+#include <new>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(metrics)
+
+WorkerRouteStats::WorkerRouteStats() : latency(), bytes(0) {
+  for (auto& status : statuses)
+    status.store(0, std::memory_order_relaxed);
+}
+
+void WorkerRouteStats::Record(int status, uint64_t micros, uint64_t size) {
+  size_t slot = status >= kMinStatus && status <= kMaxStatus
+                    ? static_cast<size_t>(status - kMinStatus + 1)
+                    : 0;
+  utils::SlotAdd(statuses[slot], 1);
+  utils::SlotAdd(bytes, size);
+  latency.Record(micros);
+}
+
+namespace {
+
+// Request counted at pool disposal, trivially destructible
+struct PendingRequest {
+  const RouteMetrics* target;
+  h2o_req_t* req;
+  std::chrono::steady_clock::time_point started;
+};
+
+void Record(const RouteMetrics* target, const h2o_req_t* req,
+            std::chrono::steady_clock::time_point started) {
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  // Body size as handed to h2o (after compression), unknown when streamed
+  // without a length
+  uint64_t bytes =
+      req->res.content_length != SIZE_MAX ? req->res.content_length : 0;
+  target->Worker().Record(req->res.status, static_cast<uint64_t>(micros),
+                          bytes);
+}
+
+void RecordPending(void* ptr) {
+  auto pending = static_cast<PendingRequest*>(ptr);
+  Record(pending->target, pending->req, pending->started);
+}
+
+}  // namespace
+
+RouteMetrics::RouteMetrics() {
+  for (auto& worker : workers_)
+    worker.store(nullptr, std::memory_order_relaxed);
+}
+
+RouteMetrics::~RouteMetrics() {
+  for (auto& worker : workers_)
+    delete worker.load(std::memory_order_relaxed);
+}
+
+WorkerRouteStats& RouteMetrics::Worker() const {
+  auto& slot = workers_[utils::WorkerSlot()];
+  WorkerRouteStats* stats = slot.load(std::memory_order_acquire);
+  if (stats)
+    return *stats;
+
+  // Threads of the shared slot race for it, one of them wins
+  auto fresh = new WorkerRouteStats();
+  if (slot.compare_exchange_strong(stats, fresh, std::memory_order_acq_rel))
+    return *fresh;
+  delete fresh;
+  return *stats;
+}
+
+RouteSnapshot RouteMetrics::Snapshot() const {
+  RouteSnapshot snapshot;
+  uint64_t statuses[WorkerRouteStats::kStatusSlots] = {};
+  for (const auto& worker : workers_) {
+    const WorkerRouteStats* stats = worker.load(std::memory_order_acquire);
+    if (!stats)
+      continue;
+    for (size_t i = 0; i < WorkerRouteStats::kStatusSlots; ++i)
+      statuses[i] += stats->statuses[i].load(std::memory_order_relaxed);
+    snapshot.latency.Merge(stats->latency);
+    snapshot.bytes += stats->bytes.load(std::memory_order_relaxed);
+  }
+
+  for (size_t i = 0; i < WorkerRouteStats::kStatusSlots; ++i) {
+    if (statuses[i] == 0)
+      continue;
+    int status =
+        i == 0 ? 0 : WorkerRouteStats::kMinStatus + static_cast<int>(i) - 1;
+    snapshot.statuses.emplace_back(status, statuses[i]);
+  }
+  return snapshot;
+}
+
+RequestScope::~RequestScope() {
+  if (!target_)
+    return;
+
+  // Not answered yet (e.g. parked single flight follower), counted when
+  // h2o disposes the request, with its final status
+  if (req_->res.status == 0) {
+    auto pending = h2o_mem_alloc_shared(&req_->pool, sizeof(PendingRequest),
+                                        RecordPending);
+    new (pending) PendingRequest{target_, req_, started_};
+    return;
+  }
+  Record(target_, req_, started_);
+}
+
+ConnectionCounters& ConnectionCounters::Global() {
+  static ConnectionCounters counters;
+  return counters;
+}
+
+uint64_t ConnectionCounters::TotalAccepted() const {
+  uint64_t accepted = 0;
+  for (const auto& slot : slots_)
+    accepted += slot.accepted.load(std::memory_order_relaxed);
+  return accepted;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <h2o.h>
+
+#include "piconaut/macro.h"
+#include "piconaut/metrics/latency_histogram.h"
+#include "piconaut/utils/worker.h"
+
+PICONAUT_INNER_NAMESPACE(metrics)
+
+/// @brief Counters of one route on one worker, own cache lines.
+/// Status 100..599 are counted one by one, anything else as 0.
+struct alignas(64) WorkerRouteStats {
+  static constexpr int kMinStatus = 100;
+  static constexpr int kMaxStatus = 599;
+  static constexpr size_t kStatusSlots = kMaxStatus - kMinStatus + 2;
+
+  WorkerRouteStats();
+
+  void Record(int status, uint64_t micros, uint64_t bytes);
+
+  LatencyHistogram latency;
+  std::atomic<uint64_t> statuses[kStatusSlots];
+  std::atomic<uint64_t> bytes;
+};
+
+// Merge of every worker stats of a route.
+struct RouteSnapshot {
+  // (status, count), non zero only, ascending status
+  std::vector<std::pair<int, uint64_t>> statuses;
+  HistogramSnapshot latency;
+  uint64_t bytes = 0;
+};
+
+/// @brief Request metrics of a route. Each worker writes its own
+/// WorkerRouteStats, allocated the first time it serves the route, so
+/// the hot path of a loop thread has no shared write and no locked
+/// instruction. Snapshot() merges them when metrics are scraped.
+class RouteMetrics {
+ public:
+  RouteMetrics();
+  ~RouteMetrics();
+
+  RouteMetrics(const RouteMetrics&) = delete;
+  RouteMetrics& operator=(const RouteMetrics&) = delete;
+
+  WorkerRouteStats& Worker() const;
+  RouteSnapshot Snapshot() const;
+
+ private:
+  mutable std::atomic<WorkerRouteStats*> workers_[utils::kMaxWorkers];
+};
+
+/// @brief Time one request and count it on the route it was dispatched
+/// to, with the status and body size h2o was handed when it goes out of
+/// scope, or when h2o disposes the request if nothing was sent by then.
+/// The route can be set once it's known, until then the request counts
+/// on the initial target (e.g. unmatched path).
+class RequestScope {
+ public:
+  RequestScope(const RouteMetrics* target, h2o_req_t* req)
+                  : target_(target),
+                    req_(req),
+                    started_(std::chrono::steady_clock::now()) {}
+  ~RequestScope();
+
+  RequestScope(const RequestScope&) = delete;
+  RequestScope& operator=(const RequestScope&) = delete;
+
+  void Target(const RouteMetrics* target) {
+    target_ = target;
+  }
+
+ private:
+  const RouteMetrics* target_;
+  h2o_req_t* req_;
+  std::chrono::steady_clock::time_point started_;
+};
+
+/// @brief Connections accepted by every server loop, per worker.
+class ConnectionCounters {
+ public:
+  static ConnectionCounters& Global();
+
+  void Accepted() {
+    utils::SlotAdd(slots_[utils::WorkerSlot()].accepted, 1);
+  }
+
+  uint64_t TotalAccepted() const;
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> accepted{0};
+  };
+
+  Slot slots_[utils::kMaxWorkers];
+};
+
+PICONAUT_INNER_END_NAMESPACE
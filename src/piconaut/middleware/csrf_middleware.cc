@@ -7,8 +7,8 @@ CsrfMiddleware::CsrfMiddleware() {
   csrf_token_ = GenerateToken();
 }
 
-void CsrfMiddleware::Handle(http::Request& req, http::Response& res,
-                            std::function<void()> next) {
+void CsrfMiddleware::Handle(const http::Request& req,
+                            const http::Response& res, Next next) {
   if (req.Method() == "POST") {
     std::string token = req.GetHeader("X-CSRF-Token");
     if (!ValidateToken(token)) {
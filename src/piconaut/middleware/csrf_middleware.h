@@ -14,8 +14,8 @@ PICONAUT_INNER_NAMESPACE(middleware)
 class CsrfMiddleware : public MiddlewareBase {
  public:
   CsrfMiddleware();
-  void Handle(http::Request& req, http::Response& res,
-              std::function<void()> next) override;
+  void Handle(const http::Request& req, const http::Response& res,
+              Next next) override;
 
  private:
   std::string GenerateToken();
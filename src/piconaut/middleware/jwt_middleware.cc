@@ -0,0 +1,75 @@
+#include "piconaut/middleware/jwt_middleware.h"
+
+#include <h2o.h>
+
+#include <string_view>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(middleware)
+
+namespace {
+
+constexpr std::string_view kBearer = "bearer ";
+
+// Token of `Authorization: Bearer <token>`, empty when absent.
+std::string_view BearerToken(const http::Request& req) {
+  auto native = req.Native();
+  ssize_t index =
+      h2o_find_header(&native->headers, H2O_TOKEN_AUTHORIZATION, -1);
+  if (index == -1)
+    return std::string_view();
+
+  const auto& value = native->headers.entries[index].value;
+  if (value.len <= kBearer.size() ||
+      !h2o_lcstris(value.base, kBearer.size(), kBearer.data(),
+                   kBearer.size()))
+    return std::string_view();
+
+  std::string_view token(value.base + kBearer.size(),
+                         value.len - kBearer.size());
+  while (!token.empty() && token.front() == ' ')
+    token.remove_prefix(1);
+  return token;
+}
+
+}  // namespace
+
+JwtMiddleware::JwtMiddleware(JwtOptions options)
+                : verifier_(std::move(options)) {}
+
+void JwtMiddleware::Handle(const http::Request& req, const http::Response& res,
+                           Next next) {
+  auto token = BearerToken(req);
+  if (token.empty()) {
+    res.AddHeader("WWW-Authenticate", "Bearer");
+    res.Send("Unauthorized", 401);
+    return;
+  }
+
+  auto status = verifier_.Verify(token);
+  if (status != JwtStatus::kOk) {
+    res.AddHeader("WWW-Authenticate",
+                  std::string("Bearer error=\"invalid_token\", "
+                              "error_description=\"") +
+                      JwtStatusText(status) + "\"");
+    res.Send("Unauthorized", 401);
+    return;
+  }
+  next();
+}
+
+std::string JwtMiddleware::Claims(const http::Request& req) {
+  auto token = BearerToken(req);
+  size_t first = token.find('.');
+  size_t second =
+      first == std::string_view::npos ? first : token.find('.', first + 1);
+  if (second == std::string_view::npos)
+    return std::string();
+
+  std::string claims;
+  if (!Base64UrlDecode(token.substr(first + 1, second - first - 1), claims))
+    claims.clear();
+  return claims;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "piconaut/macro.h"
+#include "piconaut/middleware/jwt_verifier.h"
+#include "piconaut/middleware/middleware_base.h"
+
+PICONAUT_INNER_NAMESPACE(middleware)
+
+/// @brief Bearer token authentication, answer 401 unless the request
+/// carries `Authorization: Bearer <jwt>` that JwtVerifier accepts.
+///
+/// ```cpp
+/// middleware::JwtOptions options;
+/// options.jwks_path = "/etc/app/jwks.json";
+/// options.audience = "orders-api";
+/// server.RegisterMiddleware(
+///     "/api", std::make_shared<middleware::JwtMiddleware>(options));
+/// ```
+class JwtMiddleware : public MiddlewareBase {
+ public:
+  explicit JwtMiddleware(JwtOptions options);
+  void Handle(const http::Request& req, const http::Response& res,
+              Next next) override;
+
+  const JwtVerifier& Verifier() const {
+    return verifier_;
+  }
+
+  // Decoded payload (json text) of the request bearer token, empty when
+  // there is none. Trust it only behind this middleware.
+  static std::string Claims(const http::Request& req);
+
+ private:
+  JwtVerifier verifier_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,679 @@
+#include "piconaut/middleware/jwt_verifier.h"
+
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/opensslv.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
+#else
+#include <openssl/rsa.h>
+#endif
+#include <sys/stat.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "piconaut/formats/json/lazy_reader.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(middleware)
+
+namespace {
+
+enum class Algorithm : char { kHs256, kRs256, kEs256 };
+
+// Cache lifetime of a token that carries no exp (require_exp = false).
+constexpr int64_t kNoExpiryCacheSeconds = 60;
+// Smaller RSA modulus are refused, RFC 7518 3.3
+constexpr int kMinRsaBits = 2048;
+
+struct PkeyDeleter {
+  void operator()(EVP_PKEY* pkey) const {
+    EVP_PKEY_free(pkey);
+  }
+};
+using PkeyPtr = std::unique_ptr<EVP_PKEY, PkeyDeleter>;
+
+struct BnDeleter {
+  void operator()(BIGNUM* bn) const {
+    BN_free(bn);
+  }
+};
+using BnPtr = std::unique_ptr<BIGNUM, BnDeleter>;
+
+// EVP_sha256() is looked up again on every use under OpenSSL 3, fetch the
+// implementation once, it lives as long as the process.
+const EVP_MD* Sha256() {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  static const EVP_MD* md = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+  return md;
+#else
+  return EVP_sha256();
+#endif
+}
+
+int Base64UrlValue(unsigned char c) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == '-')
+    return 62;
+  if (c == '_')
+    return 63;
+  return -1;
+}
+
+std::optional<Algorithm> ParseAlgorithm(std::string_view alg) {
+  if (alg == "HS256")
+    return Algorithm::kHs256;
+  if (alg == "RS256")
+    return Algorithm::kRs256;
+  if (alg == "ES256")
+    return Algorithm::kEs256;
+  return std::nullopt;
+}
+
+BnPtr ToBignum(const std::string& bytes) {
+  return BnPtr(BN_bin2bn(reinterpret_cast<const unsigned char*>(bytes.data()),
+                         static_cast<int>(bytes.size()), nullptr));
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+PkeyPtr PublicKeyFromParams(const char* type, const OSSL_PARAM* params) {
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(nullptr, type, nullptr);
+  EVP_PKEY* pkey = nullptr;
+  if (ctx && EVP_PKEY_fromdata_init(ctx) == 1)
+    EVP_PKEY_fromdata(ctx, &pkey, EVP_PKEY_PUBLIC_KEY,
+                      const_cast<OSSL_PARAM*>(params));
+  EVP_PKEY_CTX_free(ctx);
+  return PkeyPtr(pkey);
+}
+#endif
+
+PkeyPtr RsaPublicKey(const std::string& n, const std::string& e) {
+  BnPtr modulus = ToBignum(n);
+  BnPtr exponent = ToBignum(e);
+  if (!modulus || !exponent)
+    return nullptr;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  OSSL_PARAM_BLD* builder = OSSL_PARAM_BLD_new();
+  if (!builder)
+    return nullptr;
+  OSSL_PARAM* params = nullptr;
+  if (OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_N, modulus.get()) &&
+      OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_E, exponent.get()))
+    params = OSSL_PARAM_BLD_to_param(builder);
+  OSSL_PARAM_BLD_free(builder);
+  if (!params)
+    return nullptr;
+
+  PkeyPtr pkey = PublicKeyFromParams("RSA", params);
+  OSSL_PARAM_free(params);
+  return pkey;
+#else
+  RSA* rsa = RSA_new();
+  if (!rsa || RSA_set0_key(rsa, modulus.get(), exponent.get(), nullptr) != 1) {
+    RSA_free(rsa);
+    return nullptr;
+  }
+  modulus.release();
+  exponent.release();
+
+  PkeyPtr pkey(EVP_PKEY_new());
+  if (!pkey || EVP_PKEY_assign_RSA(pkey.get(), rsa) != 1) {
+    RSA_free(rsa);
+    return nullptr;
+  }
+  return pkey;
+#endif
+}
+
+PkeyPtr P256PublicKey(const std::string& x, const std::string& y) {
+  if (x.size() != 32 || y.size() != 32)
+    return nullptr;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  // Uncompressed point, 0x04 || x || y
+  unsigned char point[65];
+  point[0] = 0x04;
+  memcpy(point + 1, x.data(), 32);
+  memcpy(point + 33, y.data(), 32);
+
+  char group[] = "prime256v1";
+  OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_utf8_string(OSSL_PKEY_PARAM_GROUP_NAME, group, 0),
+      OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PUB_KEY, point,
+                                        sizeof(point)),
+      OSSL_PARAM_construct_end()};
+  return PublicKeyFromParams("EC", params);
+#else
+  BnPtr bx = ToBignum(x);
+  BnPtr by = ToBignum(y);
+  EC_KEY* ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+  if (!ec || !bx || !by ||
+      EC_KEY_set_public_key_affine_coordinates(ec, bx.get(), by.get()) != 1) {
+    EC_KEY_free(ec);
+    return nullptr;
+  }
+
+  PkeyPtr pkey(EVP_PKEY_new());
+  if (!pkey || EVP_PKEY_assign_EC_KEY(pkey.get(), ec) != 1) {
+    EC_KEY_free(ec);
+    return nullptr;
+  }
+  return pkey;
+#endif
+}
+
+bool VerifyDigestSignature(EVP_PKEY* pkey, std::string_view input,
+                           const unsigned char* signature, size_t size) {
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  if (!ctx)
+    return false;
+  bool ok =
+      EVP_DigestVerifyInit(ctx, nullptr, Sha256(), nullptr, pkey) == 1 &&
+      EVP_DigestVerify(ctx, signature, size,
+                       reinterpret_cast<const unsigned char*>(input.data()),
+                       input.size()) == 1;
+  EVP_MD_CTX_free(ctx);
+  return ok;
+}
+
+// JWS carries ES256 as raw r || s, OpenSSL wants a DER ECDSA-Sig-Value.
+bool VerifyEs256(EVP_PKEY* pkey, std::string_view input,
+                 const std::string& signature) {
+  if (signature.size() != 64)
+    return false;
+
+  auto raw = reinterpret_cast<const unsigned char*>(signature.data());
+  ECDSA_SIG* sig = ECDSA_SIG_new();
+  BIGNUM* r = BN_bin2bn(raw, 32, nullptr);
+  BIGNUM* s = BN_bin2bn(raw + 32, 32, nullptr);
+  if (!sig || !r || !s || ECDSA_SIG_set0(sig, r, s) != 1) {
+    BN_free(r);
+    BN_free(s);
+    ECDSA_SIG_free(sig);
+    return false;
+  }
+
+  unsigned char der[80];
+  unsigned char* cursor = der;
+  int size = i2d_ECDSA_SIG(sig, nullptr);
+  bool ok = size > 0 && static_cast<size_t>(size) <= sizeof(der) &&
+            i2d_ECDSA_SIG(sig, &cursor) == size &&
+            VerifyDigestSignature(pkey, input, der, static_cast<size_t>(size));
+  ECDSA_SIG_free(sig);
+  return ok;
+}
+
+bool VerifyHs256(const std::string& secret, std::string_view input,
+                 const std::string& signature) {
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+  if (!HMAC(Sha256(), secret.data(), static_cast<int>(secret.size()),
+            reinterpret_cast<const unsigned char*>(input.data()),
+            input.size(), mac, &size))
+    return false;
+  return signature.size() == size &&
+         CRYPTO_memcmp(mac, signature.data(), size) == 0;
+}
+
+// NumericDate claim to seconds, clamped so absurd values can't overflow.
+int64_t ClaimTime(double value) {
+  constexpr double kLimit = 1e15;
+  if (value > kLimit)
+    return static_cast<int64_t>(kLimit);
+  if (value < -kLimit)
+    return static_cast<int64_t>(-kLimit);
+  return static_cast<int64_t>(value);
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("JWKS: cannot open " + path);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+}  // namespace
+
+bool Base64UrlDecode(std::string_view in, std::string& out) {
+  while (!in.empty() && in.back() == '=')
+    in.remove_suffix(1);
+  if (in.size() % 4 == 1)
+    return false;
+
+  out.clear();
+  out.reserve(in.size() * 3 / 4);
+  uint32_t bits = 0;
+  int count = 0;
+  for (unsigned char c : in) {
+    int value = Base64UrlValue(c);
+    if (value < 0)
+      return false;
+    bits = (bits << 6) | static_cast<uint32_t>(value);
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out.push_back(static_cast<char>((bits >> count) & 0xff));
+    }
+  }
+  return true;
+}
+
+/// @brief Immutable key set parsed from a JWKS document, swapped whole on
+/// reload so a verification in flight keeps the keys it started with.
+class JwkSet {
+ public:
+  struct Key {
+    std::string kid;
+    Algorithm alg;
+    std::string secret;  // oct
+    PkeyPtr pkey;        // RSA / EC
+  };
+
+  static std::shared_ptr<const JwkSet> Parse(std::string_view text);
+
+  // By kid, or the first key of the algorithm when the token has no kid.
+  const Key* Find(std::string_view kid, Algorithm alg) const {
+    for (const auto& key : keys_) {
+      if (key.alg != alg)
+        continue;
+      if (kid.empty() || key.kid == kid)
+        return &key;
+    }
+    return nullptr;
+  }
+
+  size_t Size() const {
+    return keys_.size();
+  }
+
+ private:
+  std::vector<Key> keys_;
+};
+
+std::shared_ptr<const JwkSet> JwkSet::Parse(std::string_view text) {
+  auto set = std::make_shared<JwkSet>();
+  formats::json::LazyReader reader(text);
+  auto keys = reader["keys"];
+  if (!keys.IsArray())
+    throw std::runtime_error("JWKS: \"keys\" array missing");
+
+  keys.ForEach([&](const formats::json::LazyValue& jwk) {
+    auto use = jwk["use"].As<std::optional<std::string>>();
+    if (use && *use != "sig")
+      return;
+
+    auto kty = jwk["kty"].As<std::optional<std::string>>().value_or("");
+    auto alg = jwk["alg"].As<std::optional<std::string>>();
+    auto field = [&](std::string_view name) {
+      std::string decoded;
+      auto value = jwk[name].As<std::optional<std::string>>();
+      if (!value || !Base64UrlDecode(*value, decoded))
+        return std::string();
+      return decoded;
+    };
+
+    Key key{jwk["kid"].As<std::optional<std::string>>().value_or(""),
+            Algorithm::kHs256, std::string(), nullptr};
+    if (kty == "oct") {
+      key.alg = Algorithm::kHs256;
+      key.secret = field("k");
+      if (key.secret.empty())
+        return;
+    } else if (kty == "RSA") {
+      key.alg = Algorithm::kRs256;
+      key.pkey = RsaPublicKey(field("n"), field("e"));
+      if (key.pkey && EVP_PKEY_bits(key.pkey.get()) < kMinRsaBits) {
+        std::cerr << "JWKS: RSA key \"" << key.kid << "\" under "
+                  << kMinRsaBits << " bits ignored" << std::endl;
+        return;
+      }
+    } else if (kty == "EC") {
+      if (jwk["crv"].As<std::optional<std::string>>().value_or("") != "P-256")
+        return;
+      key.alg = Algorithm::kEs256;
+      key.pkey = P256PublicKey(field("x"), field("y"));
+    } else {
+      return;
+    }
+
+    // A declared alg must agree with the key type
+    if (alg && ParseAlgorithm(*alg) != key.alg)
+      return;
+    if (kty != "oct" && !key.pkey)
+      return;
+    set->keys_.push_back(std::move(key));
+  });
+
+  if (set->keys_.empty())
+    throw std::runtime_error("JWKS: no usable signing key");
+  return set;
+}
+
+const char* JwtStatusText(JwtStatus status) {
+  switch (status) {
+    case JwtStatus::kOk:
+      return "ok";
+    case JwtStatus::kMalformed:
+      return "malformed token";
+    case JwtStatus::kUnsupportedAlgorithm:
+      return "unsupported algorithm";
+    case JwtStatus::kUnknownKey:
+      return "unknown signing key";
+    case JwtStatus::kBadSignature:
+      return "invalid signature";
+    case JwtStatus::kExpired:
+      return "token expired";
+    case JwtStatus::kNotYetValid:
+      return "token not yet valid";
+    case JwtStatus::kBadIssuer:
+      return "invalid issuer";
+    case JwtStatus::kBadAudience:
+      return "invalid audience";
+  }
+  return "invalid token";
+}
+
+JwtVerifier::JwtVerifier(JwtOptions options)
+                : options_(std::move(options)),
+                  cache_size_(0),
+                  keys_mutex_(),
+                  keys_(),
+                  generation_(0),
+                  file_mtime_(),
+                  reload_mutex_(),
+                  reload_wake_(),
+                  reload_stop_(false),
+                  reloader_() {
+  if (options_.cache_size > 0) {
+    cache_size_ = 1;
+    while (cache_size_ < options_.cache_size)
+      cache_size_ <<= 1;
+  }
+
+  LoadIfChanged(true);
+  if (options_.reload_interval.count() > 0)
+    reloader_ = std::thread(&JwtVerifier::WatchFile, this);
+}
+
+JwtVerifier::~JwtVerifier() {
+  if (reloader_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(reload_mutex_);
+      reload_stop_ = true;
+    }
+    reload_wake_.notify_all();
+    reloader_.join();
+  }
+  for (auto& cache : caches_)
+    delete[] cache.entries.load(std::memory_order_relaxed);
+}
+
+void JwtVerifier::Reload() {
+  LoadIfChanged(true);
+}
+
+size_t JwtVerifier::KeyCount() const {
+  uint64_t generation;
+  return Keys(generation)->Size();
+}
+
+std::shared_ptr<const JwkSet> JwtVerifier::Keys(uint64_t& generation) const {
+  std::lock_guard<std::mutex> lock(keys_mutex_);
+  generation = generation_.load(std::memory_order_relaxed);
+  return keys_;
+}
+
+void JwtVerifier::LoadIfChanged(bool force) {
+  struct stat st;
+  if (stat(options_.jwks_path.c_str(), &st) != 0)
+    throw std::runtime_error("JWKS: cannot stat " + options_.jwks_path);
+
+  {
+    std::lock_guard<std::mutex> lock(keys_mutex_);
+    if (!force && keys_ && st.st_mtim.tv_sec == file_mtime_.tv_sec &&
+        st.st_mtim.tv_nsec == file_mtime_.tv_nsec)
+      return;
+  }
+
+  // Parse outside the lock, verifications keep going on the old keys
+  std::string text = ReadFile(options_.jwks_path);
+  std::shared_ptr<const JwkSet> keys;
+  try {
+    keys = JwkSet::Parse(text);
+  } catch (const formats::json::ParseError& e) {
+    throw std::runtime_error(std::string("JWKS: ") + e.what());
+  }
+
+  std::lock_guard<std::mutex> lock(keys_mutex_);
+  keys_ = std::move(keys);
+  file_mtime_ = st.st_mtim;
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+void JwtVerifier::WatchFile() {
+  std::unique_lock<std::mutex> lock(reload_mutex_);
+  while (!reload_stop_) {
+    reload_wake_.wait_for(lock, options_.reload_interval);
+    if (reload_stop_)
+      break;
+
+    lock.unlock();
+    try {
+      LoadIfChanged(false);
+    } catch (const std::exception& e) {
+      std::cerr << "JWKS reload failed, keeping previous keys: " << e.what()
+                << std::endl;
+    }
+    lock.lock();
+  }
+}
+
+JwtVerifier::CacheEntry* JwtVerifier::CacheSlot(
+    const unsigned char* digest) const {
+  auto& cache = caches_[utils::WorkerSlot()];
+  CacheEntry* entries = cache.entries.load(std::memory_order_acquire);
+  if (!entries) {
+    CacheEntry* fresh = new CacheEntry[cache_size_]();
+    if (cache.entries.compare_exchange_strong(entries, fresh,
+                                              std::memory_order_acq_rel)) {
+      entries = fresh;
+    } else {
+      delete[] fresh;
+    }
+  }
+
+  uint64_t index;
+  memcpy(&index, digest, sizeof(index));
+  return &entries[index & (cache_size_ - 1)];
+}
+
+bool JwtVerifier::CacheHit(const CacheEntry& entry,
+                           const unsigned char* digest, int64_t now,
+                           uint64_t generation) {
+  uint32_t seq = entry.seq.load(std::memory_order_acquire);
+  if (seq & 1)
+    return false;
+
+  bool hit = entry.generation.load(std::memory_order_relaxed) == generation &&
+             now < entry.expires.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < 4 && hit; ++i) {
+    uint64_t word;
+    memcpy(&word, digest + i * 8, sizeof(word));
+    hit = entry.digest[i].load(std::memory_order_relaxed) == word;
+  }
+
+  // A writer came by while reading, the entry may be torn
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return hit && entry.seq.load(std::memory_order_relaxed) == seq;
+}
+
+void JwtVerifier::CacheStore(CacheEntry& entry, const unsigned char* digest,
+                             int64_t expires, uint64_t generation) {
+  // Another writer holds the entry, skip, the token is just not cached
+  uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+  if ((seq & 1) ||
+      !entry.seq.compare_exchange_strong(seq, seq + 1,
+                                         std::memory_order_acquire))
+    return;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (size_t i = 0; i < 4; ++i) {
+    uint64_t word;
+    memcpy(&word, digest + i * 8, sizeof(word));
+    entry.digest[i].store(word, std::memory_order_relaxed);
+  }
+  entry.expires.store(expires, std::memory_order_relaxed);
+  entry.generation.store(generation, std::memory_order_relaxed);
+  entry.seq.store(seq + 2, std::memory_order_release);
+}
+
+JwtStatus JwtVerifier::Verify(std::string_view token) const {
+  return Verify(token, static_cast<int64_t>(std::time(nullptr)));
+}
+
+JwtStatus JwtVerifier::Verify(std::string_view token, int64_t now) const {
+  if (token.empty() || token.size() > kMaxTokenSize)
+    return JwtStatus::kMalformed;
+
+  CacheEntry* slot = nullptr;
+  unsigned char digest[32];
+  if (cache_size_ > 0) {
+    if (EVP_Digest(token.data(), token.size(), digest, nullptr, Sha256(),
+                   nullptr) != 1)
+      return JwtStatus::kMalformed;
+    slot = CacheSlot(digest);
+    if (CacheHit(*slot, digest, now, Generation()))
+      return JwtStatus::kOk;
+  }
+
+  uint64_t generation;
+  auto keys = Keys(generation);
+  int64_t expires = 0;
+  JwtStatus status = VerifyUncached(token, now, *keys, expires);
+  if (status == JwtStatus::kOk && slot)
+    CacheStore(*slot, digest, expires, generation);
+  return status;
+}
+
+JwtStatus JwtVerifier::VerifyUncached(std::string_view token, int64_t now,
+                                      const JwkSet& keys,
+                                      int64_t& expires) const {
+  size_t first = token.find('.');
+  size_t second =
+      first == std::string_view::npos ? first : token.find('.', first + 1);
+  if (second == std::string_view::npos ||
+      token.find('.', second + 1) != std::string_view::npos)
+    return JwtStatus::kMalformed;
+
+  std::string header;
+  std::string payload;
+  std::string signature;
+  if (!Base64UrlDecode(token.substr(0, first), header) ||
+      !Base64UrlDecode(token.substr(first + 1, second - first - 1),
+                       payload) ||
+      !Base64UrlDecode(token.substr(second + 1), signature))
+    return JwtStatus::kMalformed;
+
+  try {
+    formats::json::LazyReader head(header);
+    if (!head.Root().IsObject())
+      return JwtStatus::kMalformed;
+    // No extension is understood, a critical one must be refused
+    if (!head["crit"].IsMissing())
+      return JwtStatus::kUnsupportedAlgorithm;
+
+    auto alg = ParseAlgorithm(
+        head["alg"].As<std::optional<std::string_view>>().value_or(""));
+    if (!alg)
+      return JwtStatus::kUnsupportedAlgorithm;
+
+    auto kid = head["kid"].As<std::optional<std::string>>().value_or("");
+    const JwkSet::Key* key = keys.Find(kid, *alg);
+    if (!key)
+      return JwtStatus::kUnknownKey;
+
+    std::string_view input = token.substr(0, second);
+    bool valid = false;
+    switch (*alg) {
+      case Algorithm::kHs256:
+        valid = VerifyHs256(key->secret, input, signature);
+        break;
+      case Algorithm::kRs256:
+        valid = VerifyDigestSignature(
+            key->pkey.get(), input,
+            reinterpret_cast<const unsigned char*>(signature.data()),
+            signature.size());
+        break;
+      case Algorithm::kEs256:
+        valid = VerifyEs256(key->pkey.get(), input, signature);
+        break;
+    }
+    if (!valid)
+      return JwtStatus::kBadSignature;
+
+    formats::json::LazyReader claims(payload);
+    if (!claims.Root().IsObject())
+      return JwtStatus::kMalformed;
+
+    int64_t leeway = options_.leeway.count();
+    auto exp = claims["exp"].As<std::optional<double>>();
+    if (exp) {
+      expires = ClaimTime(*exp) + leeway;
+      if (now >= expires)
+        return JwtStatus::kExpired;
+    } else if (options_.require_exp) {
+      return JwtStatus::kMalformed;
+    } else {
+      expires = now + kNoExpiryCacheSeconds;
+    }
+
+    auto nbf = claims["nbf"].As<std::optional<double>>();
+    if (nbf && now + leeway < ClaimTime(*nbf))
+      return JwtStatus::kNotYetValid;
+
+    if (!options_.issuer.empty() &&
+        claims["iss"].As<std::optional<std::string>>() != options_.issuer)
+      return JwtStatus::kBadIssuer;
+
+    if (!options_.audience.empty()) {
+      auto aud = claims["aud"];
+      bool matched = false;
+      if (aud.IsString()) {
+        matched = aud.As<std::string>() == options_.audience;
+      } else if (aud.IsArray()) {
+        aud.ForEach([&](const formats::json::LazyValue& value) {
+          if (value.IsString() && value.As<std::string>() == options_.audience)
+            matched = true;
+        });
+      }
+      if (!matched)
+        return JwtStatus::kBadAudience;
+    }
+  } catch (const std::runtime_error&) {
+    // ParseError, or a claim of the wrong type (e.g. string exp)
+    return JwtStatus::kMalformed;
+  }
+
+  return JwtStatus::kOk;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "piconaut/macro.h"
+#include "piconaut/utils/worker.h"
+
+PICONAUT_INNER_NAMESPACE(middleware)
+
+enum class JwtStatus : char {
+  kOk,
+  kMalformed,
+  kUnsupportedAlgorithm,
+  kUnknownKey,
+  kBadSignature,
+  kExpired,
+  kNotYetValid,
+  kBadIssuer,
+  kBadAudience
+};
+
+const char* JwtStatusText(JwtStatus status);
+
+// Unpadded base64url (RFC 7515), trailing '=' tolerated for JWKS files.
+bool Base64UrlDecode(std::string_view in, std::string& out);
+
+struct JwtOptions {
+  // JWKS document ({"keys": [...]}), RSA, EC P-256 and oct keys are used
+  std::string jwks_path;
+  // How often the file mtime is checked (from a background thread), 0
+  // never reload
+  std::chrono::seconds reload_interval{30};
+  // Expected iss / aud claims, empty skip the check
+  std::string issuer;
+  std::string audience;
+  // Clock skew tolerated on exp and nbf
+  std::chrono::seconds leeway{30};
+  // Tokens without exp are rejected unless this is false
+  bool require_exp = true;
+  // Verified tokens remembered per worker, rounded up to a power of two,
+  // 0 disable the cache
+  size_t cache_size = 1024;
+};
+
+class JwkSet;
+
+/// @brief HS256 / RS256 / ES256 verifier for compact JWS tokens.
+/// Keys come from a local JWKS file, picked by kid (or by algorithm when
+/// the token has none). RSA keys under 2048 bits are ignored. A
+/// background thread re-reads the file when its mtime changes, so no
+/// file I/O happens on the event loop; a broken file keeps the previous
+/// keys.
+///
+/// Every accepted token is remembered in a per-worker direct-mapped cache
+/// keyed by the SHA-256 of the whole token, with its expiry and the key
+/// generation it was checked against. A client reusing its token pay one
+/// hash and a compare instead of the signature check; a key reload
+/// invalidates every entry at once. Entries are seqlocked, two threads
+/// sharing a worker slot never read a torn entry as a hit.
+class JwtVerifier {
+ public:
+  explicit JwtVerifier(JwtOptions options);
+  ~JwtVerifier();
+
+  JwtVerifier(const JwtVerifier&) = delete;
+  JwtVerifier& operator=(const JwtVerifier&) = delete;
+
+  // Token without the "Bearer " prefix.
+  JwtStatus Verify(std::string_view token) const;
+  // `now` in unix seconds.
+  JwtStatus Verify(std::string_view token, int64_t now) const;
+
+  // Re-read the JWKS file now, throw std::runtime_error when it can't be
+  // loaded (the previous keys stay in use).
+  void Reload();
+
+  size_t KeyCount() const;
+  uint64_t Generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t kMaxTokenSize = 8192;
+
+ private:
+  struct CacheEntry {
+    // Odd while a writer updates the entry
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint64_t> digest[4]{};
+    std::atomic<int64_t> expires{0};
+    std::atomic<uint64_t> generation{0};
+  };
+
+  // One slot per worker, each worker allocates its own on first use.
+  struct alignas(64) WorkerCache {
+    std::atomic<CacheEntry*> entries{nullptr};
+  };
+
+  JwtOptions options_;
+  size_t cache_size_;  // power of two, 0 when disabled
+
+  // keys_ and file_mtime_ change under keys_mutex_ on reload
+  mutable std::mutex keys_mutex_;
+  std::shared_ptr<const JwkSet> keys_;
+  std::atomic<uint64_t> generation_;
+  struct timespec file_mtime_;
+
+  mutable WorkerCache caches_[utils::kMaxWorkers];
+
+  std::mutex reload_mutex_;
+  std::condition_variable reload_wake_;
+  bool reload_stop_;
+  std::thread reloader_;
+
+  std::shared_ptr<const JwkSet> Keys(uint64_t& generation) const;
+  // Reload thread, check the file every reload_interval.
+  void WatchFile();
+  // Load when the mtime changed (always when forced), throw on failure.
+  void LoadIfChanged(bool force);
+
+  CacheEntry* CacheSlot(const unsigned char* digest) const;
+  static bool CacheHit(const CacheEntry& entry, const unsigned char* digest,
+                       int64_t now, uint64_t generation);
+  static void CacheStore(CacheEntry& entry, const unsigned char* digest,
+                         int64_t expires, uint64_t generation);
+  JwtStatus VerifyUncached(std::string_view token, int64_t now,
+                           const JwkSet& keys, int64_t& expires) const;
+};
+
+PICONAUT_INNER_END_NAMESPACE
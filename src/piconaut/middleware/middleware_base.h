@@ -1,6 +1,6 @@
 #pragma once
 
-#include <functional>
+#include <cstddef>
 #include <memory>
 #include <vector>
 
@@ -10,13 +10,53 @@
 
 PICONAUT_INNER_NAMESPACE(middleware)
 
+class MiddlewareBase;
+
+// Called once the request went through the whole chain (e.g. the route
+// handler), context is passed back as is.
+using Terminal = void (*)(void* context, const http::Request& req,
+                          const http::Response& res);
+
+// Per-request state of a running chain, lives on the caller stack.
+struct ChainFrame {
+  MiddlewareBase* const* items;
+  size_t size;
+  const http::Request* req;
+  const http::Response* res;
+  Terminal terminal;
+  void* context;
+};
+
+/// @brief Continuation handle given to each middleware, two words copied
+/// by value. Calling it runs the rest of the chain (then the terminal)
+/// and returns afterwards, so code after next() sees the handled request.
+/// Not calling it short-circuits the chain, the middleware must have sent
+/// the response. Call it at most once.
+class Next {
+ public:
+  Next(const ChainFrame* frame, size_t index) : frame_(frame), index_(index) {}
+
+  inline void operator()() const;
+
+ private:
+  const ChainFrame* frame_;
+  size_t index_;
+};
+
 class MiddlewareBase {
  public:
   virtual ~MiddlewareBase() = default;
-  virtual void Handle(http::Request& req, http::Response& res,
-                      std::function<void()> next) = 0;
+  virtual void Handle(const http::Request& req, const http::Response& res,
+                      Next next) = 0;
 };
 
+inline void Next::operator()() const {
+  if (index_ < frame_->size) {
+    frame_->items[index_]->Handle(*frame_->req, *frame_->res,
+                                  Next(frame_, index_ + 1));
+  } else if (frame_->terminal) {
+    frame_->terminal(frame_->context, *frame_->req, *frame_->res);
+  }
+}
 
-
-PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,53 @@
+#include "piconaut/middleware/middleware_chain.h"
+
+#include <stdexcept>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(middleware)
+
+bool IsUnderPrefix(const std::string& path, const std::string& prefix) {
+  if (prefix.empty() || prefix == "/")
+    return true;
+  if (path.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  return path.size() == prefix.size() || prefix.back() == '/' ||
+         path[prefix.size()] == '/';
+}
+
+MiddlewareChain::MiddlewareChain(
+    const std::vector<std::shared_ptr<MiddlewareBase>>& middlewares)
+                : owners_(), items_() {
+  owners_.reserve(middlewares.size());
+  items_.reserve(middlewares.size());
+  for (const auto& middleware : middlewares) {
+    Add(middleware);
+  }
+}
+
+void MiddlewareChain::Add(std::shared_ptr<MiddlewareBase> middleware) {
+  if (!middleware)
+    throw std::invalid_argument("Middleware cannot be null");
+
+  items_.push_back(middleware.get());
+  owners_.push_back(std::move(middleware));
+}
+
+void MiddlewareChain::Append(const MiddlewareChain& other) {
+  owners_.insert(owners_.end(), other.owners_.begin(), other.owners_.end());
+  items_.insert(items_.end(), other.items_.begin(), other.items_.end());
+}
+
+void MiddlewareChain::Run(const http::Request& req, const http::Response& res,
+                          Terminal terminal, void* context) const {
+  if (items_.empty()) {
+    if (terminal)
+      terminal(context, req, res);
+    return;
+  }
+
+  ChainFrame frame{items_.data(), items_.size(), &req, &res, terminal,
+                   context};
+  Next(&frame, 0)();
+}
+
+PICONAUT_INNER_END_NAMESPACE
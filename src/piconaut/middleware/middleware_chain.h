@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "piconaut/macro.h"
+#include "piconaut/middleware/middleware_base.h"
+
+PICONAUT_INNER_NAMESPACE(middleware)
+
+// Prefix match on path segment boundary, "/api" match "/api/users"
+// but not "/apix".
+bool IsUnderPrefix(const std::string& path, const std::string& prefix);
+
+/// @brief Middleware stack flattened into one contiguous array at
+/// registration time. Running it allocates nothing: the per-request state
+/// is a ChainFrame on the stack and each middleware get a Next by value.
+///
+/// ```cpp
+/// chain.Run(req, res, [&](const http::Request& req,
+///                         const http::Response& res) { handler(req, res); });
+/// ```
+class MiddlewareChain {
+ public:
+  MiddlewareChain() = default;
+  explicit MiddlewareChain(
+      const std::vector<std::shared_ptr<MiddlewareBase>>& middlewares);
+
+  void Add(std::shared_ptr<MiddlewareBase> middleware);
+  // Append every middleware of `other`, e.g. global stack before route.
+  void Append(const MiddlewareChain& other);
+
+  size_t Size() const {
+    return items_.size();
+  }
+
+  bool Empty() const {
+    return items_.empty();
+  }
+
+  void Run(const http::Request& req, const http::Response& res,
+           Terminal terminal = nullptr, void* context = nullptr) const;
+
+  // Any callable taking (req, res) as terminal, referenced for the run
+  // so the capture is never copied or allocated.
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_convertible_v<F, Terminal>>>
+  void Run(const http::Request& req, const http::Response& res,
+           F&& terminal) const {
+    using Fn = std::remove_reference_t<F>;
+    Run(
+        req, res,
+        [](void* context, const http::Request& request,
+           const http::Response& response) {
+          (*static_cast<Fn*>(context))(request, response);
+        },
+        const_cast<void*>(static_cast<const void*>(std::addressof(terminal))));
+  }
+
+ private:
+  // Owners keep the middlewares alive, the hot path only reads items_.
+  std::vector<std::shared_ptr<MiddlewareBase>> owners_;
+  std::vector<MiddlewareBase*> items_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -4,15 +4,12 @@
 PICONAUT_INNER_NAMESPACE(middleware)
 void MiddlewareManager::Add(
     std::shared_ptr<MiddlewareBase> middleware) {
-  middlewares_.push_back(middleware);
+  chain_.Add(std::move(middleware));
 }
 
-void MiddlewareManager::Handle(http::Request& req, http::Response& res) {
-  std::function<void(size_t)> execute = [&](size_t index) {
-    if (index < middlewares_.size()) {
-      middlewares_[index]->Handle(req, res, [&]() { execute(index + 1); });
-    }
-  };
-  execute(0);
+void MiddlewareManager::Handle(const http::Request& req,
+                               const http::Response& res, Terminal terminal,
+                               void* context) const {
+  chain_.Run(req, res, terminal, context);
 }
-PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
+PICONAUT_INNER_END_NAMESPACE
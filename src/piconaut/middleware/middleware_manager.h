@@ -1,19 +1,25 @@
 #pragma once
 
-#include <functional>
 #include <memory>
 #include <vector>
 
 #include "piconaut/macro.h"
 #include "piconaut/middleware/middleware_base.h"
+#include "piconaut/middleware/middleware_chain.h"
 PICONAUT_INNER_NAMESPACE(middleware)
 
 class MiddlewareManager {
  public:
   void Add(std::shared_ptr<MiddlewareBase> middleware);
-  void Handle(http::Request& req, http::Response& res);
+  // Run the middlewares, then terminal when none of them short-circuits.
+  void Handle(const http::Request& req, const http::Response& res,
+              Terminal terminal = nullptr, void* context = nullptr) const;
+
+  const MiddlewareChain& Chain() const {
+    return chain_;
+  }
 
  private:
-  std::vector<std::shared_ptr<MiddlewareBase>> middlewares_;
+  MiddlewareChain chain_;
 };
-PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
+PICONAUT_INNER_END_NAMESPACE
@@ -1,5 +1,14 @@
 #include "piconaut/formats/json/value_builder.h"
+#include "piconaut/formats/json/value_builder_pool.h"
+#include "piconaut/formats/json/json_writer.h"
+#include "piconaut/formats/json/json_fields.h"
 #include "piconaut/formats/json/value.h"
+#include "piconaut/formats/json/lazy_reader.h"
+#include "piconaut/formats/binary/binary_reader.h"
+#include "piconaut/formats/binary/binary_writer.h"
+#include "piconaut/formats/serialize.h"
 #include "piconaut/sys/signal_handler.h"
 #include "piconaut/http/http_server.h"
-#include "piconaut/http/http_single_server.h"
\ No newline at end of file
+#include "piconaut/http/http_single_server.h"
+#include "piconaut/handlers/static_file_handler.h"
+#include "piconaut/websocket/websocket_handler.h"
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "piconaut/routers/concurrency_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "piconaut/utils/worker.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(routers)
+
+namespace {
+
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point started) {
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+// Slot bound to a request pool, lives in the pool
+struct PoolSlot {
+  ConcurrencyLimiter* limiter;
+  std::chrono::steady_clock::time_point started;
+};
+
+void ReleasePoolSlot(void* ptr) {
+  auto slot = static_cast<PoolSlot*>(ptr);
+  slot->limiter->Release(ElapsedNs(slot->started));
+}
+
+}  // namespace
+
+bool LatencyWindow::Record(uint64_t latency_ns,
+                           const ConcurrencyPolicy& policy, double& short_ns,
+                           double& long_ns) {
+  // single writer, the limiter serializes the shared slot
+  uint64_t sum = sum_ns_.load(std::memory_order_relaxed) + latency_ns;
+  uint32_t count = count_.load(std::memory_order_relaxed) + 1;
+  if (count < std::max<size_t>(policy.window, 1)) {
+    sum_ns_.store(sum, std::memory_order_relaxed);
+    count_.store(count, std::memory_order_relaxed);
+    return false;
+  }
+
+  sum_ns_.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+  short_ns = static_cast<double>(sum) / count;
+
+  // Baseline is an exponential average over long_window samples
+  double baseline = long_ns_.load(std::memory_order_relaxed);
+  if (baseline <= 0) {
+    baseline = short_ns;
+  } else {
+    double windows = std::max(
+        1.0, static_cast<double>(policy.long_window) / count);
+    baseline += (short_ns - baseline) * 2.0 / (windows + 1.0);
+    // Latency dropped for good, don't keep an outdated baseline around
+    if (baseline / short_ns > 2.0)
+      baseline *= 0.95;
+  }
+  long_ns_.store(baseline, std::memory_order_relaxed);
+  long_ns = baseline;
+  return true;
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(const ConcurrencyPolicy& policy)
+                : policy_(policy),
+                  in_flight_(0),
+                  limit_(0),
+                  windows_(new LatencyWindow[utils::kMaxWorkers]) {
+  policy_.min_limit = std::max<size_t>(policy_.min_limit, 1);
+  policy_.max_limit = std::max(policy_.max_limit, policy_.min_limit);
+  limit_.store(static_cast<double>(std::clamp(
+                   policy_.initial_limit, policy_.min_limit, policy_.max_limit)),
+               std::memory_order_relaxed);
+}
+
+bool ConcurrencyLimiter::TryAcquire() {
+  auto limit =
+      static_cast<int64_t>(limit_.load(std::memory_order_relaxed));
+  if (in_flight_.fetch_add(1, std::memory_order_relaxed) < limit)
+    return true;
+
+  in_flight_.fetch_sub(1, std::memory_order_relaxed);
+  windows_[utils::WorkerSlot()].Reject();
+  return false;
+}
+
+void ConcurrencyLimiter::Release(uint64_t latency_ns) {
+  // In flight with this request, what the limit was serving
+  auto in_flight = in_flight_.fetch_sub(1, std::memory_order_relaxed);
+
+  double short_ns = 0;
+  double long_ns = 0;
+  bool full;
+  if (utils::OnSharedSlot()) {
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    full = windows_[utils::kSharedSlot].Record(latency_ns, policy_, short_ns,
+                                               long_ns);
+  } else {
+    full = windows_[utils::WorkerSlot()].Record(latency_ns, policy_,
+                                                short_ns, long_ns);
+  }
+  if (full)
+    Update(short_ns, long_ns, static_cast<double>(in_flight));
+}
+
+void ConcurrencyLimiter::Update(double short_ns, double long_ns,
+                                double in_flight) {
+  double gradient = 1.0;
+  if (short_ns > 0)
+    gradient = std::clamp(policy_.tolerance * long_ns / short_ns, 0.5, 1.0);
+
+  double current = limit_.load(std::memory_order_relaxed);
+  double next;
+  do {
+    double estimate = current * gradient + policy_.queue_size;
+    next = current * (1.0 - policy_.smoothing) + estimate * policy_.smoothing;
+    // Not using half of it, a higher limit would be a guess
+    if (next > current && in_flight < current / 2)
+      return;
+    next = std::clamp(next, static_cast<double>(policy_.min_limit),
+                      static_cast<double>(policy_.max_limit));
+  } while (!limit_.compare_exchange_weak(current, next,
+                                         std::memory_order_relaxed));
+}
+
+size_t ConcurrencyLimiter::Limit() const {
+  return static_cast<size_t>(limit_.load(std::memory_order_relaxed));
+}
+
+size_t ConcurrencyLimiter::InFlight() const {
+  auto in_flight = in_flight_.load(std::memory_order_relaxed);
+  return in_flight > 0 ? static_cast<size_t>(in_flight) : 0;
+}
+
+uint64_t ConcurrencyLimiter::Rejected() const {
+  uint64_t rejected = 0;
+  for (size_t i = 0; i < utils::kMaxWorkers; ++i)
+    rejected += windows_[i].Rejected();
+  return rejected;
+}
+
+ConcurrencyPermit::ConcurrencyPermit(ConcurrencyLimiter* limiter)
+                : limiter_(limiter),
+                  granted_(!limiter || limiter->TryAcquire()),
+                  started_() {
+  if (limiter_ && granted_)
+    started_ = std::chrono::steady_clock::now();
+}
+
+ConcurrencyPermit::~ConcurrencyPermit() {
+  if (!limiter_ || !granted_)
+    return;
+  limiter_->Release(ElapsedNs(started_));
+}
+
+void ConcurrencyPermit::BindTo(h2o_mem_pool_t* pool) {
+  if (!limiter_ || !granted_)
+    return;
+  auto slot = static_cast<PoolSlot*>(
+      h2o_mem_alloc_shared(pool, sizeof(PoolSlot), ReleasePoolSlot));
+  slot->limiter = limiter_;
+  slot->started = started_;
+  limiter_ = nullptr;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "piconaut/macro.h"
+#include "piconaut/utils/worker.h"
+
+PICONAUT_INNER_NAMESPACE(routers)
+
+/// @brief Opt-in adaptive concurrency limit of a route, set per route or
+/// server wide (each route still gets its own limiter).
+struct ConcurrencyPolicy {
+  size_t initial_limit = 16;
+  size_t min_limit = 1;
+  size_t max_limit = 256;
+  // Latency samples a worker collects before it adjusts the limit
+  size_t window = 32;
+  // Samples behind the long-term (baseline) latency average
+  size_t long_window = 600;
+  // Latency growth over the baseline tolerated before the limit shrinks
+  double tolerance = 1.5;
+  // Weight of a new estimate against the current limit
+  double smoothing = 0.2;
+  // Headroom added on each update, the limit grows by about this much
+  // per window while the latency holds
+  double queue_size = 1.0;
+};
+
+/// @brief Latency window of one worker, written by that worker only.
+/// Fields are relaxed atomics so metrics can read them from any thread.
+class alignas(64) LatencyWindow {
+ public:
+  LatencyWindow() : sum_ns_(0), count_(0), long_ns_(0), rejected_(0) {}
+
+  // Add a sample, true once `window` samples are in: `short_ns` get
+  // their mean and `long_ns` the baseline it was folded into.
+  bool Record(uint64_t latency_ns, const ConcurrencyPolicy& policy,
+              double& short_ns, double& long_ns);
+
+  void Reject() {
+    utils::SlotAdd(rejected_, 1);
+  }
+
+  uint64_t Rejected() const {
+    return rejected_.load(std::memory_order_relaxed);
+  }
+
+  double LongNs() const {
+    return long_ns_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> sum_ns_;
+  std::atomic<uint32_t> count_;
+  std::atomic<double> long_ns_;
+  std::atomic<uint64_t> rejected_;
+};
+
+/// @brief Gradient2 style concurrency limiter of one route.
+/// Each worker averages the latency of its own requests over a short
+/// window and against its long-term baseline; the ratio (clamped to
+/// [0.5, 1]) scales the shared limit down when the route slows and lets
+/// it grow by queue_size while it doesn't. Requests over the limit are
+/// rejected right away, so a slow dependency can't hold more than its
+/// share of the workers.
+///
+/// The only shared write per request is the in-flight counter; the
+/// limit is updated with a CAS once per window. Nothing locks on a loop
+/// thread, threads of the shared worker slot take turns on its window.
+class ConcurrencyLimiter {
+ public:
+  explicit ConcurrencyLimiter(const ConcurrencyPolicy& policy);
+
+  ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+  ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+  // Take a slot, false when the route is at its limit.
+  bool TryAcquire();
+  // Give the slot back with the latency of the request.
+  void Release(uint64_t latency_ns);
+
+  size_t Limit() const;
+  size_t InFlight() const;
+  uint64_t Rejected() const;
+
+ private:
+  ConcurrencyPolicy policy_;
+  std::atomic<int64_t> in_flight_;
+  std::atomic<double> limit_;
+  std::unique_ptr<LatencyWindow[]> windows_;
+  std::mutex shared_mutex_;
+
+  void Update(double short_ns, double long_ns, double in_flight);
+};
+
+/// @brief Scoped slot of a ConcurrencyLimiter, nullptr limiter always
+/// granted. The latency is measured until the permit goes out of scope,
+/// or until the request pool is released once bound to it.
+class ConcurrencyPermit {
+ public:
+  explicit ConcurrencyPermit(ConcurrencyLimiter* limiter);
+  ~ConcurrencyPermit();
+
+  ConcurrencyPermit(const ConcurrencyPermit&) = delete;
+  ConcurrencyPermit& operator=(const ConcurrencyPermit&) = delete;
+
+  bool Granted() const {
+    return granted_;
+  }
+
+  // Hand the slot to the request pool, it's released when h2o disposes
+  // the request (response fully sent) instead of at scope exit.
+  void BindTo(h2o_mem_pool_t* pool);
+
+ private:
+  ConcurrencyLimiter* limiter_;
+  bool granted_;
+  std::chrono::steady_clock::time_point started_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -6,7 +6,7 @@
 //cppcheck-suppress unknownMacro
 PICONAUT_INNER_NAMESPACE(routers)
 
-enum class NodeType { kStatic, kParameter };
+enum class NodeType { kStatic, kParameter, kCatchAll };
 
 NVM_ENUM_CLASS_DISPLAY_TRAIT(NodeType)
 
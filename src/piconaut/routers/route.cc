@@ -1,5 +1,9 @@
 #include "piconaut/routers/route.h"
 
+#include <algorithm>
+
+#include "piconaut/utils/worker.h"
+
 // cppcheck-suppress unknownMacro
 PICONAUT_INNER_NAMESPACE(routers)
 
@@ -7,8 +11,12 @@ Route::Route(const size_t key, const std::string& path,
              std::shared_ptr<handlers::HandlerBase> req_handler)
                 : key_(key),
                   path_(std::string(path)),
-                  req_handler_(req_handler)
-                   {}
+                  req_handler_(req_handler),
+                  size_estimates_(
+                      new formats::json::SizeEstimate[utils::kMaxWorkers]),
+                  middlewares_(),
+                  limiter_(),
+                  metrics_(new metrics::RouteMetrics()) {}
 
 const std::size_t& Route::Key() const {
   return key_;
@@ -22,5 +30,54 @@ const std::shared_ptr<handlers::HandlerBase> Route::RequestHandler() const {
   return req_handler_;
 }
 
+formats::json::SizeEstimate& Route::WorkerSizeEstimate() const {
+  return size_estimates_[utils::WorkerSlot()];
+}
+
+size_t Route::SizeHint() const {
+  size_t hint = 0;
+  for (size_t i = 0; i < utils::kMaxWorkers; ++i)
+    hint = std::max(hint, size_estimates_[i].Hint());
+  return hint;
+}
+
+size_t Route::SizeMean() const {
+  // sample weighted mean across workers
+  uint64_t samples = 0;
+  double total = 0;
+  for (size_t i = 0; i < utils::kMaxWorkers; ++i) {
+    auto worker_samples = size_estimates_[i].Samples();
+    samples += worker_samples;
+    total += static_cast<double>(size_estimates_[i].Mean()) * worker_samples;
+  }
+  return samples ? static_cast<size_t>(total / samples) : 0;
+}
+
+uint64_t Route::SizeSamples() const {
+  uint64_t samples = 0;
+  for (size_t i = 0; i < utils::kMaxWorkers; ++i)
+    samples += size_estimates_[i].Samples();
+  return samples;
+}
+
+const middleware::MiddlewareChain& Route::Middlewares() const {
+  return middlewares_;
+}
+
+void Route::Middlewares(middleware::MiddlewareChain chain) {
+  middlewares_ = std::move(chain);
+}
+
+const metrics::RouteMetrics& Route::Metrics() const {
+  return *metrics_;
+}
+
+ConcurrencyLimiter* Route::Limiter() const {
+  return limiter_.get();
+}
+
+void Route::Limiter(std::unique_ptr<ConcurrencyLimiter> limiter) {
+  limiter_ = std::move(limiter);
+}
 
 PICONAUT_INNER_END_NAMESPACE
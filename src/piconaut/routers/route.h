@@ -1,13 +1,18 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "piconaut/formats/json/size_hint.h"
 #include "piconaut/handlers/handler_base.h"
 #include "piconaut/macro.h"
+#include "piconaut/metrics/route_metrics.h"
+#include "piconaut/middleware/middleware_chain.h"
+#include "piconaut/routers/concurrency_limiter.h"
 
 PICONAUT_INNER_NAMESPACE(routers)
 
@@ -27,11 +32,34 @@ class Route {
   const std::shared_ptr<handlers::HandlerBase> RequestHandler() const;
   // const HandlerFn& Handler() const;
 
+  // Response size estimate of the calling worker, lock free.
+  formats::json::SizeEstimate& WorkerSizeEstimate() const;
+  // Merge of every worker estimate, the largest hint wins.
+  size_t SizeHint() const;
+  size_t SizeMean() const;
+  uint64_t SizeSamples() const;
+
+  // Effective middleware stack (global, prefix then route), flattened
+  // once when the router is frozen.
+  const middleware::MiddlewareChain& Middlewares() const;
+  void Middlewares(middleware::MiddlewareChain chain);
+
+  // Request counters and latency histogram, written per worker.
+  const metrics::RouteMetrics& Metrics() const;
+
+  // Adaptive concurrency limit, nullptr when the route has none.
+  ConcurrencyLimiter* Limiter() const;
+  void Limiter(std::unique_ptr<ConcurrencyLimiter> limiter);
+
  private:
   size_t key_;
   std::string path_;
   HandlerFn handler_;
   std::shared_ptr<handlers::HandlerBase> req_handler_;
+  std::unique_ptr<formats::json::SizeEstimate[]> size_estimates_;
+  middleware::MiddlewareChain middlewares_;
+  std::unique_ptr<ConcurrencyLimiter> limiter_;
+  std::unique_ptr<metrics::RouteMetrics> metrics_;
 };
 
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
@@ -27,8 +27,18 @@ void Router::AddRoute(const size_t& key, const std::string& path, Route::Handler
   size_t pos = 0;
   for (auto& part : endpoint_parts) {
     std::string normalized_part = part;
+    pos++;
 
-    if (normalized_part.front() == '{' && normalized_part.back() == '}') {
+    if (IsCatchAllPart(part)) {
+      // Catch-all {name*} capture the rest of the path,
+      // it only make sense as the last part.
+      if (pos != endpoint_parts.size()) {
+        throw std::invalid_argument(
+            "Catch-all parameter must be the last part: " + path);
+      }
+      normalized_part = "{*}";
+    } else if (normalized_part.front() == '{' &&
+               normalized_part.back() == '}') {
       normalized_part = "{}";  // Use a common key for parameters
     }
 
@@ -41,6 +51,9 @@ void Router::AddRoute(const size_t& key, const std::string& path, Route::Handler
       node->param_name = part.substr(1, part.size() - 2);
       node->param_regex = std::regex("^[a-zA-Z0-9_-]+$");
       node->type = NodeType::kParameter;
+    } else if (normalized_part == "{*}") {
+      node->param_name = part.substr(1, part.size() - 3);
+      node->type = NodeType::kCatchAll;
     } else {
       node->type = NodeType::kStatic;
     }
@@ -64,28 +77,55 @@ RouterMatchResult Router::MatchRoute(
       utils::string::SplitString(path, '/');
   const RouterNode* node = root_.get();
 
-  for (const auto& part : endpoint_parts) {
+  for (size_t i = 0; i < endpoint_parts.size(); ++i) {
+    const auto& part = endpoint_parts[i];
     auto it = node->children.find(part);
     if (it != node->children.end() && it->second->type == NodeType::kStatic) {
       node = it->second.get();
     } else {
       auto param_it = node->children.find("{}");
       if (param_it != node->children.end() &&
-          param_it->second->type == NodeType::kParameter) {
+          param_it->second->type == NodeType::kParameter &&
+          std::regex_match(part, param_it->second->param_regex)) {
         node = param_it->second.get();
-        if (!std::regex_match(part, node->param_regex)) {
-          return RouterMatchResult(nullptr,nullptr);  // Part does not match parameter pattern
-        }
         params[node->param_name] = part;
-      } else {
-        return RouterMatchResult(nullptr,nullptr);  // No matching static or dynamic part
+        continue;
+      }
+
+      auto catch_all_it = node->children.find("{*}");
+      if (catch_all_it != node->children.end()) {
+        // Join the rest of the path back
+        std::string rest = part;
+        for (size_t j = i + 1; j < endpoint_parts.size(); ++j) {
+          rest += '/';
+          rest += endpoint_parts[j];
+        }
+        node = catch_all_it->second.get();
+        params[node->param_name] = rest;
+        return RouterMatchResult(&node->key, &node->handler);
       }
+
+      return RouterMatchResult(nullptr,nullptr);  // No matching static or dynamic part
+    }
+  }
+
+  // Path end exactly on catch-all parent, capture empty rest
+  if (!node->handler) {
+    auto catch_all_it = node->children.find("{*}");
+    if (catch_all_it != node->children.end()) {
+      node = catch_all_it->second.get();
+      params[node->param_name] = "";
     }
   }
 
   return RouterMatchResult(&node->key, &node->handler);
 }
 
+bool Router::IsCatchAllPart(const std::string& part) const {
+  return part.size() > 3 && part.front() == '{' &&
+         part[part.size() - 2] == '*' && part.back() == '}';
+}
+
 bool Router::IsValidRoute(const std::string& path) const {
   static const std::regex valid_route_regex(
       R"(^(/[A-Za-z0-9-._~%!$&'()*+,;=:@{}]+)*$)");
@@ -31,6 +31,8 @@ struct RouterMatchResult {
 /// @brief Router class for managing routing endpoint registration and
 /// route-matching. Implementation conform to RFC-6570. This class is
 /// thread-safe and designed for concurrent lock-free MatchRoute executions.
+/// Last part of the route can be catch-all `{name*}`,
+/// e.g. `/assets/{path*}` capture `css/site.css` as `path`.
 class Router {
  public:
   Router();
@@ -56,5 +58,6 @@ class Router {
   mutable std::mutex mutex_;
 
   bool IsValidRoute(const std::string& path) const;
+  bool IsCatchAllPart(const std::string& part) const;
 };
 PICONAUT_INNER_END_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "piconaut/macro.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(utils)
+namespace hash {
+
+// 64-bit MurmurHash2 (MurmurHash64A), consume 8 bytes per round.
+// Fast non-cryptographic hash, use for cache keys and ETag.
+// Do not use it for anything that need collision resistance from attacker.
+inline uint64_t Hash64(const void* data, size_t len, uint64_t seed = 0) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64_t h = seed ^ (len * m);
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  const unsigned char* end = bytes + (len / 8) * 8;
+
+  while (bytes != end) {
+    uint64_t k;
+    memcpy(&k, bytes, sizeof(k));
+    bytes += 8;
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  switch (len & 7) {
+    case 7:
+      h ^= uint64_t(bytes[6]) << 48;
+      [[fallthrough]];
+    case 6:
+      h ^= uint64_t(bytes[5]) << 40;
+      [[fallthrough]];
+    case 5:
+      h ^= uint64_t(bytes[4]) << 32;
+      [[fallthrough]];
+    case 4:
+      h ^= uint64_t(bytes[3]) << 24;
+      [[fallthrough]];
+    case 3:
+      h ^= uint64_t(bytes[2]) << 16;
+      [[fallthrough]];
+    case 2:
+      h ^= uint64_t(bytes[1]) << 8;
+      [[fallthrough]];
+    case 1:
+      h ^= uint64_t(bytes[0]);
+      h *= m;
+  };
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
+
+inline uint64_t Hash64(const std::string& str, uint64_t seed = 0) {
+  return Hash64(str.data(), str.size(), seed);
+}
+
+// 64-bit FNV-1a, constexpr so literal keys are hashed at compile time.
+// Byte at a time, keep it for short strings.
+constexpr uint64_t Fnv1a64(const char* data, size_t len) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// Fold another 64-bit value into running hash
+inline uint64_t Combine(uint64_t seed, uint64_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+}  // namespace hash
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,124 @@
+#include "piconaut/utils/loop_queue.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(utils)
+
+namespace {
+
+// Queues of every loop, looked up by followers parking a request, not a
+// per request path
+std::mutex& RegistryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::unordered_map<h2o_loop_t*, std::unique_ptr<LoopQueue>>& Registry() {
+  static std::unordered_map<h2o_loop_t*, std::unique_ptr<LoopQueue>> queues;
+  return queues;
+}
+
+}  // namespace
+
+LoopQueue* LoopQueue::ForLoop(h2o_loop_t* loop) {
+  std::lock_guard<std::mutex> lock(RegistryMutex());
+  auto& queue = Registry()[loop];
+  if (!queue)
+    queue.reset(new LoopQueue(loop));
+  return queue.get();
+}
+
+void LoopQueue::Release(h2o_loop_t* loop) {
+  // Destroyed out of the lock
+  std::unique_ptr<LoopQueue> queue;
+  {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    auto it = Registry().find(loop);
+    if (it == Registry().end())
+      return;
+    queue = std::move(it->second);
+    Registry().erase(it);
+  }
+}
+
+LoopQueue::LoopQueue(h2o_loop_t* loop)
+                : loop_(loop),
+                  event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+                  wakeup_(nullptr),
+                  signaled_(false),
+                  queue_(),
+                  timeouts_() {
+  if (event_fd_ == -1)
+    throw std::runtime_error("Failed to create loop queue eventfd");
+
+  wakeup_ = h2o_evloop_socket_create(loop_, event_fd_, 0);
+  if (!wakeup_) {
+    close(event_fd_);
+    throw std::runtime_error("Failed to register loop queue eventfd");
+  }
+
+  wakeup_->data = this;
+  h2o_socket_read_start(wakeup_, OnWakeup);
+}
+
+LoopQueue::~LoopQueue() {
+  // Entries still waiting (e.g. parked requests) are unlinked, their
+  // owner sees them as not linked anymore
+  for (auto& item : timeouts_) {
+    auto timeout = item.second.get();
+    while (!h2o_linklist_is_empty(&timeout->_entries)) {
+      h2o_timeout_unlink(H2O_STRUCT_FROM_MEMBER(
+          h2o_timeout_entry_t, _link, timeout->_entries.next));
+    }
+    h2o_timeout_dispose(loop_, timeout);
+  }
+  // Closes event_fd_ too, pending tasks are dropped with the queue
+  h2o_socket_close(wakeup_);
+}
+
+void LoopQueue::Post(Task task) {
+  queue_.Push(std::move(task));
+
+  // Only the first producer after a drain pays for the syscall
+  if (!signaled_.exchange(true, std::memory_order_acq_rel)) {
+    uint64_t one = 1;
+    ssize_t written = write(event_fd_, &one, sizeof(one));
+    (void)written;
+  }
+}
+
+h2o_timeout_t* LoopQueue::Timeout(uint64_t millis) {
+  auto& timeout = timeouts_[millis];
+  if (!timeout) {
+    timeout = std::make_unique<h2o_timeout_t>();
+    h2o_timeout_init(loop_, timeout.get(), millis);
+  }
+  return timeout.get();
+}
+
+void LoopQueue::Drain() {
+  signaled_.store(false, std::memory_order_release);
+
+  Task task;
+  while (queue_.Pop(task)) {
+    task();
+  }
+}
+
+void LoopQueue::OnWakeup(h2o_socket_t* sock, const char* err) {
+  if (err != nullptr)
+    return;
+
+  // eventfd counter was read by h2o into the input buffer
+  h2o_buffer_consume(&sock->input, sock->input->size);
+  static_cast<LoopQueue*>(sock->data)->Drain();
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "piconaut/macro.h"
+#include "piconaut/utils/mpsc_queue.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(utils)
+
+/// @brief Work handed to one event loop from any thread, run on the loop
+/// thread. Tasks arrive through a lock-free MPSC queue and an eventfd
+/// wakeup registered on the loop, as websocket::LoopHub does.
+///
+/// ```cpp
+/// auto queue = utils::LoopQueue::ForLoop(req->conn->ctx->loop);
+/// // later, from another loop thread
+/// queue->Post([req]() { ... });
+/// ```
+class LoopQueue {
+ public:
+  using Task = std::function<void()>;
+
+  // Queue of `loop`, created on first use. Creating it registers a socket
+  // on the loop: first call from the loop thread or before the loop runs.
+  static LoopQueue* ForLoop(h2o_loop_t* loop);
+  // Close and drop the queue of `loop`, once the loop stopped for good
+  // and nothing posts to it anymore.
+  static void Release(h2o_loop_t* loop);
+
+  ~LoopQueue();
+
+  LoopQueue(const LoopQueue&) = delete;
+  LoopQueue& operator=(const LoopQueue&) = delete;
+
+  h2o_loop_t* Loop() const {
+    return loop_;
+  }
+
+  // Any thread
+  void Post(Task task);
+
+  // Loop thread only, timeout list of `millis` on this loop.
+  h2o_timeout_t* Timeout(uint64_t millis);
+
+ private:
+  explicit LoopQueue(h2o_loop_t* loop);
+
+  h2o_loop_t* loop_;
+  int event_fd_;
+  h2o_socket_t* wakeup_;
+  std::atomic<bool> signaled_;
+  MpscQueue<Task> queue_;
+  std::map<uint64_t, std::unique_ptr<h2o_timeout_t>> timeouts_;
+
+  void Drain();
+  static void OnWakeup(h2o_socket_t* sock, const char* err);
+};
+
+PICONAUT_INNER_END_NAMESPACE
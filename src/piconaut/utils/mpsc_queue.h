@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include "piconaut/macro.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(utils)
+
+/// @brief Lock-free multi producer single consumer queue
+/// (Dmitry Vyukov non-intrusive MPSC node based queue).
+/// Push is wait-free and can be called from any thread,
+/// Pop must only be called from the single consumer thread.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(new Node()), tail_(head_.load()) {}
+
+  ~MpscQueue() {
+    T value;
+    while (Pop(value)) {
+    }
+    delete tail_;
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  void Push(T value) {
+    Node* node = new Node(std::move(value));
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  bool Pop(T& value) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (!next)
+      return false;
+
+    value = std::move(next->value);
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+  bool Empty() const {
+    return tail_->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> next;
+    T value;
+
+    Node() : next(nullptr), value() {}
+    explicit Node(T&& v) : next(nullptr), value(std::move(v)) {}
+  };
+
+  std::atomic<Node*> head_;
+  Node* tail_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "piconaut/macro.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(utils)
+
+// Slots preallocated for per-worker state (stats, estimates).
+constexpr size_t kMaxWorkers = 64;
+
+// Slot of every thread without one of its own: threads other than event
+// loops (reloaders, watchdog, user threads) and loops past the others.
+// Several threads write it, counters there use fetch_add (SlotAdd).
+constexpr size_t kSharedSlot = kMaxWorkers - 1;
+
+namespace detail {
+
+inline size_t& ThreadWorkerSlot() {
+  static thread_local size_t slot = kSharedSlot;
+  return slot;
+}
+
+// Bit i set while slot i is owned by a thread
+inline std::atomic<uint64_t>& ClaimedWorkerSlots() {
+  static std::atomic<uint64_t> claimed{0};
+  return claimed;
+}
+
+}  // namespace detail
+
+// Own slot for the calling thread until ReleaseWorkerSlot, kSharedSlot
+// when all are taken. For event loop threads (LoopProbe), the slot is
+// single writer as long as the thread owns it.
+inline size_t ClaimWorkerSlot() {
+  auto& slot = detail::ThreadWorkerSlot();
+  if (slot != kSharedSlot)
+    return slot;
+
+  auto& claimed = detail::ClaimedWorkerSlots();
+  uint64_t current = claimed.load(std::memory_order_relaxed);
+  while (true) {
+    uint64_t free_slots = ~current & ((uint64_t(1) << kSharedSlot) - 1);
+    if (free_slots == 0)
+      return kSharedSlot;
+    size_t index = static_cast<size_t>(__builtin_ctzll(free_slots));
+    // acquire: what the previous owner wrote is seen by the new one
+    if (claimed.compare_exchange_weak(current,
+                                      current | (uint64_t(1) << index),
+                                      std::memory_order_acq_rel)) {
+      slot = index;
+      return slot;
+    }
+  }
+}
+
+// Give the calling thread slot back, it writes the shared slot after.
+inline void ReleaseWorkerSlot() {
+  auto& slot = detail::ThreadWorkerSlot();
+  if (slot == kSharedSlot)
+    return;
+  detail::ClaimedWorkerSlots().fetch_and(~(uint64_t(1) << slot),
+                                         std::memory_order_release);
+  slot = kSharedSlot;
+}
+
+// Index into kMaxWorkers preallocated slots.
+inline size_t WorkerSlot() {
+  return detail::ThreadWorkerSlot();
+}
+
+inline bool OnSharedSlot() {
+  return WorkerSlot() == kSharedSlot;
+}
+
+// Bump a counter of the calling thread slot: load/store is enough for
+// the single writer of an own slot, the shared slot needs fetch_add.
+inline void SlotAdd(std::atomic<uint64_t>& counter, uint64_t value) {
+  if (OnSharedSlot()) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+    return;
+  }
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,151 @@
+#include "piconaut/websocket/connection.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "piconaut/websocket/hub.h"
+#include "piconaut/websocket/websocket_handler.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+WebSocketConnection::WebSocketConnection(h2o_websocket_conn_t* conn,
+                                         LoopHub* hub,
+                                         WebSocketHandler* handler)
+                : user_data(nullptr),
+                  conn_(conn),
+                  hub_(hub),
+                  handler_(handler),
+                  pending_(),
+                  topics_(),
+                  closed_(false),
+                  in_callback_(false) {}
+
+WebSocketConnection::~WebSocketConnection() {
+  for (const auto& topic : topics_) {
+    hub_->Unsubscribe(topic, this);
+  }
+}
+
+void WebSocketConnection::SendText(const std::string& text) {
+  Send(MakeTextMessage(text));
+}
+
+void WebSocketConnection::SendBinary(const std::string& data) {
+  Send(MakeBinaryMessage(data));
+}
+
+void WebSocketConnection::Send(MessagePtr message) {
+  if (closed_ || !message || !conn_)
+    return;
+
+  pending_.push_back(Cursor{std::move(message), 0});
+
+  struct wslay_event_fragmented_msg fragmented;
+  memset(&fragmented, 0, sizeof(fragmented));
+  fragmented.opcode = static_cast<uint8_t>(pending_.back().message->opcode);
+  fragmented.source.data = &pending_.back();
+  fragmented.read_callback = ReadMessage;
+
+  if (wslay_event_queue_fragmented_msg(conn_->ws_ctx, &fragmented) != 0) {
+    pending_.pop_back();
+    return;
+  }
+
+  Proceed();
+}
+
+void WebSocketConnection::Subscribe(const std::string& topic) {
+  if (topics_.insert(topic).second)
+    hub_->Subscribe(topic, this);
+}
+
+void WebSocketConnection::Unsubscribe(const std::string& topic) {
+  if (topics_.erase(topic))
+    hub_->Unsubscribe(topic, this);
+}
+
+const std::unordered_set<std::string>& WebSocketConnection::Topics() const {
+  return topics_;
+}
+
+void WebSocketConnection::Close(uint16_t status_code) {
+  if (closed_ || !conn_)
+    return;
+
+  wslay_event_queue_close(conn_->ws_ctx, status_code, nullptr, 0);
+  Proceed();
+}
+
+bool WebSocketConnection::IsClosed() const {
+  return closed_;
+}
+
+LoopHub* WebSocketConnection::Hub() const {
+  return hub_;
+}
+
+void WebSocketConnection::Proceed() {
+  // Inside message callback h2o proceed by itself after wslay recv,
+  // before the upgrade complete there is no socket yet.
+  if (in_callback_ || closed_ || !conn_->sock)
+    return;
+  h2o_websocket_proceed(conn_);
+}
+
+ssize_t WebSocketConnection::ReadMessage(
+    wslay_event_context_ptr ctx, uint8_t* buf, size_t len,
+    const union wslay_event_msg_source* source, int* eof, void* user_data) {
+  auto conn = static_cast<h2o_websocket_conn_t*>(user_data);
+  auto self = static_cast<WebSocketConnection*>(conn->data);
+  auto cursor = static_cast<Cursor*>(source->data);
+  const auto& payload = cursor->message->payload;
+
+  size_t remaining = payload.size() - cursor->offset;
+  size_t n = remaining < len ? remaining : len;
+  memcpy(buf, payload.data() + cursor->offset, n);
+  cursor->offset += n;
+
+  if (cursor->offset == payload.size()) {
+    *eof = 1;
+    // wslay send the queued messages in order
+    self->pending_.pop_front();
+  }
+
+  return static_cast<ssize_t>(n);
+}
+
+void WebSocketConnection::OnMessage(
+    h2o_websocket_conn_t* conn, const struct wslay_event_on_msg_recv_arg* arg) {
+  auto self = static_cast<WebSocketConnection*>(conn->data);
+
+  if (arg == nullptr) {
+    self->closed_ = true;
+    try {
+      self->handler_->OnClose(*self);
+    } catch (const std::exception& e) {
+      std::cerr << "WebSocket OnClose error: " << e.what() << std::endl;
+    }
+    h2o_websocket_close(conn);
+    delete self;
+    return;
+  }
+
+  if (wslay_is_ctrl_frame(arg->opcode))
+    return;
+
+  self->in_callback_ = true;
+  try {
+    self->handler_->OnMessage(*self, static_cast<OpCode>(arg->opcode),
+                              reinterpret_cast<const char*>(arg->msg),
+                              arg->msg_length);
+  } catch (const std::exception& e) {
+    std::cerr << "WebSocket OnMessage error: " << e.what() << std::endl;
+    // Only queued, h2o sends it after wslay recv returns. Proceeding here
+    // would re-enter wslay, which may close and free the connection.
+    self->Close(1011);
+  }
+  self->in_callback_ = false;
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <h2o.h>
+#include <h2o/websocket.h>
+
+#include <deque>
+#include <string>
+#include <unordered_set>
+
+#include "piconaut/macro.h"
+#include "piconaut/websocket/declare.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+/// @brief Upgraded websocket connection, wslay run on top of h2o socket.
+/// Owned by the event loop, only touch it from the loop thread
+/// (e.g. inside WebSocketHandler callbacks). Use Broadcaster to reach
+/// connections from other threads.
+class WebSocketConnection {
+ public:
+  WebSocketConnection(h2o_websocket_conn_t* conn, LoopHub* hub,
+                      WebSocketHandler* handler);
+  ~WebSocketConnection();
+
+  WebSocketConnection(const WebSocketConnection&) = delete;
+  WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+
+  void SendText(const std::string& text);
+  void SendBinary(const std::string& data);
+  // Queue the shared message, the payload is read straight
+  // from the message into wslay frame buffer.
+  void Send(MessagePtr message);
+
+  void Subscribe(const std::string& topic);
+  void Unsubscribe(const std::string& topic);
+  const std::unordered_set<std::string>& Topics() const;
+
+  // Send close frame, OnClose is called when the close handshake is done.
+  void Close(uint16_t status_code = 1000);
+  bool IsClosed() const;
+
+  LoopHub* Hub() const;
+
+  // Free slot for the application per connection state
+  void* user_data;
+
+ private:
+  struct Cursor {
+    MessagePtr message;
+    size_t offset;
+  };
+
+  h2o_websocket_conn_t* conn_;
+  LoopHub* hub_;
+  WebSocketHandler* handler_;
+  std::deque<Cursor> pending_;
+  std::unordered_set<std::string> topics_;
+  bool closed_;
+  bool in_callback_;
+
+  void Proceed();
+
+  static ssize_t ReadMessage(wslay_event_context_ptr ctx, uint8_t* buf,
+                             size_t len,
+                             const union wslay_event_msg_source* source,
+                             int* eof, void* user_data);
+  static void OnMessage(h2o_websocket_conn_t* conn,
+                        const struct wslay_event_on_msg_recv_arg* arg);
+
+  friend class WebSocketHandler;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "piconaut/macro.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+class WebSocketConnection;
+class WebSocketHandler;
+class LoopHub;
+class Broadcaster;
+
+enum class OpCode : uint8_t {
+  kText = 0x1,    //!< WSLAY_TEXT_FRAME
+  kBinary = 0x2,  //!< WSLAY_BINARY_FRAME
+};
+
+/// @brief Serialized websocket message.
+/// Shared between every subscriber, the payload is never copied
+/// per connection.
+struct Message {
+  OpCode opcode;
+  std::string payload;
+
+  Message(OpCode opcode, std::string payload)
+                  : opcode(opcode), payload(std::move(payload)) {}
+};
+
+using MessagePtr = std::shared_ptr<const Message>;
+
+inline MessagePtr MakeTextMessage(std::string payload) {
+  return std::make_shared<const Message>(OpCode::kText, std::move(payload));
+}
+
+inline MessagePtr MakeBinaryMessage(std::string payload) {
+  return std::make_shared<const Message>(OpCode::kBinary, std::move(payload));
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,154 @@
+#include "piconaut/websocket/hub.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "piconaut/websocket/connection.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+namespace {
+
+// Hub of the loop running on this thread
+thread_local LoopHub* t_current_hub = nullptr;
+
+}  // namespace
+
+LoopHub::LoopHub(h2o_loop_t* loop)
+                : loop_(loop),
+                  event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+                  wakeup_(nullptr),
+                  signaled_(false),
+                  queue_(),
+                  topics_() {
+  if (event_fd_ == -1)
+    throw std::runtime_error("Failed to create websocket hub eventfd");
+
+  wakeup_ = h2o_evloop_socket_create(loop_, event_fd_, 0);
+  if (!wakeup_) {
+    close(event_fd_);
+    throw std::runtime_error("Failed to register websocket hub eventfd");
+  }
+
+  wakeup_->data = this;
+  h2o_socket_read_start(wakeup_, OnWakeup);
+}
+
+LoopHub::~LoopHub() {
+  // eventfd socket is owned by the loop and closed with it
+}
+
+h2o_loop_t* LoopHub::Loop() const {
+  return loop_;
+}
+
+void LoopHub::Subscribe(const std::string& topic, WebSocketConnection* conn) {
+  topics_[topic].insert(conn);
+}
+
+void LoopHub::Unsubscribe(const std::string& topic,
+                          WebSocketConnection* conn) {
+  auto it = topics_.find(topic);
+  if (it == topics_.end())
+    return;
+
+  it->second.erase(conn);
+  if (it->second.empty())
+    topics_.erase(it);
+}
+
+size_t LoopHub::Publish(const std::string& topic, const MessagePtr& message) {
+  auto it = topics_.find(topic);
+  if (it == topics_.end())
+    return 0;
+
+  // Snapshot, subscriber may unsubscribe on failed send
+  std::vector<WebSocketConnection*> subscribers(it->second.begin(),
+                                                it->second.end());
+  for (auto conn : subscribers) {
+    conn->Send(message);
+  }
+  return subscribers.size();
+}
+
+void LoopHub::Post(const std::string& topic, MessagePtr message) {
+  queue_.Push(Publication{topic, std::move(message)});
+
+  // Only the first producer after a drain pays for the syscall
+  if (!signaled_.exchange(true, std::memory_order_acq_rel)) {
+    uint64_t one = 1;
+    ssize_t written = write(event_fd_, &one, sizeof(one));
+    (void)written;
+  }
+}
+
+void LoopHub::Drain() {
+  signaled_.store(false, std::memory_order_release);
+
+  Publication publication;
+  while (queue_.Pop(publication)) {
+    Publish(publication.topic, publication.message);
+  }
+}
+
+void LoopHub::OnWakeup(h2o_socket_t* sock, const char* err) {
+  if (err != nullptr)
+    return;
+
+  // eventfd counter was read by h2o into the input buffer
+  h2o_buffer_consume(&sock->input, sock->input->size);
+  static_cast<LoopHub*>(sock->data)->Drain();
+}
+
+Broadcaster& Broadcaster::Instance() {
+  // Hubs are bound to the loops for the process lifetime
+  static Broadcaster* instance = new Broadcaster();
+  return *instance;
+}
+
+Broadcaster::Broadcaster()
+                : mutex_(),
+                  hubs_(),
+                  snapshot_(std::make_shared<const HubList>()) {}
+
+LoopHub* Broadcaster::HubFor(h2o_loop_t* loop) {
+  if (t_current_hub && t_current_hub->Loop() == loop)
+    return t_current_hub;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& hub : hubs_) {
+    if (hub->Loop() == loop) {
+      t_current_hub = hub.get();
+      return t_current_hub;
+    }
+  }
+
+  hubs_.emplace_back(std::make_unique<LoopHub>(loop));
+  auto snapshot = std::make_shared<HubList>();
+  for (auto& hub : hubs_) {
+    snapshot->push_back(hub.get());
+  }
+  std::atomic_store(&snapshot_, std::shared_ptr<const HubList>(snapshot));
+
+  t_current_hub = hubs_.back().get();
+  return t_current_hub;
+}
+
+void Broadcaster::Publish(const std::string& topic, MessagePtr message) {
+  if (!message)
+    return;
+
+  auto hubs = std::atomic_load(&snapshot_);
+  for (auto hub : *hubs) {
+    if (hub == t_current_hub) {
+      hub->Publish(topic, message);
+    } else {
+      hub->Post(topic, message);
+    }
+  }
+}
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <h2o.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "piconaut/macro.h"
+#include "piconaut/utils/mpsc_queue.h"
+#include "piconaut/websocket/declare.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+/// @brief Per event loop pub/sub fan-out.
+/// Topic subscribers live on the same loop as the hub, publishing write
+/// the same shared message to every subscriber.
+/// Message from other threads arrive through lock-free MPSC queue and
+/// eventfd wakeup registered on the loop.
+class LoopHub {
+ public:
+  explicit LoopHub(h2o_loop_t* loop);
+  ~LoopHub();
+
+  LoopHub(const LoopHub&) = delete;
+  LoopHub& operator=(const LoopHub&) = delete;
+
+  h2o_loop_t* Loop() const;
+
+  // Loop thread only
+  void Subscribe(const std::string& topic, WebSocketConnection* conn);
+  void Unsubscribe(const std::string& topic, WebSocketConnection* conn);
+  size_t Publish(const std::string& topic, const MessagePtr& message);
+
+  // Any thread
+  void Post(const std::string& topic, MessagePtr message);
+
+ private:
+  struct Publication {
+    std::string topic;
+    MessagePtr message;
+  };
+
+  h2o_loop_t* loop_;
+  int event_fd_;
+  h2o_socket_t* wakeup_;
+  std::atomic<bool> signaled_;
+  utils::MpscQueue<Publication> queue_;
+  std::unordered_map<std::string, std::unordered_set<WebSocketConnection*>>
+      topics_;
+
+  void Drain();
+  static void OnWakeup(h2o_socket_t* sock, const char* err);
+};
+
+/// @brief Process wide publisher to every loop hub.
+/// ```cpp
+/// websocket::Broadcaster::Instance().Publish(
+///     "prices", websocket::MakeTextMessage(json.SerializeToBytes().ToString()));
+/// ```
+class Broadcaster {
+ public:
+  static Broadcaster& Instance();
+
+  // Get or create the hub of the loop, must be called on the loop thread.
+  LoopHub* HubFor(h2o_loop_t* loop);
+
+  // Message is serialized once by the caller and shared by all loops.
+  // Subscribers on the calling loop are written directly,
+  // other loops receive it through their queue.
+  void Publish(const std::string& topic, MessagePtr message);
+
+ private:
+  using HubList = std::vector<LoopHub*>;
+
+  Broadcaster();
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<LoopHub>> hubs_;
+  // Copy-on-write snapshot, publisher never take the mutex
+  std::shared_ptr<const HubList> snapshot_;
+};
+
+PICONAUT_INNER_END_NAMESPACE
@@ -0,0 +1,30 @@
+#include "piconaut/websocket/websocket_handler.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+void WebSocketHandler::HandleRequest(
+    const http::Request& req, const http::Response& res,
+    const std::unordered_map<std::string, std::string>& params) const {
+  h2o_req_t* native = req.Native();
+
+  const char* client_key = nullptr;
+  if (native->version >= 0x200 ||
+      h2o_is_websocket_handshake(native, &client_key) != 0 ||
+      client_key == nullptr) {
+    res.Send("Error 400: Websocket upgrade required", 400);
+    return;
+  }
+
+  // Callbacks mutate the application state, handler is registered
+  // as const HandlerBase but owned by the application.
+  auto handler = const_cast<WebSocketHandler*>(this);
+  auto hub = Broadcaster::Instance().HubFor(native->conn->ctx->loop);
+  auto conn = new WebSocketConnection(nullptr, hub, handler);
+
+  conn->conn_ = h2o_upgrade_to_websocket(native, client_key, conn,
+                                         WebSocketConnection::OnMessage);
+  handler->OnOpen(*conn, params);
+}
+
+PICONAUT_INNER_END_NAMESPACE
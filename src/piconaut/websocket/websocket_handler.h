@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "piconaut/handlers/handler_base.h"
+#include "piconaut/macro.h"
+#include "piconaut/websocket/connection.h"
+#include "piconaut/websocket/hub.h"
+
+// cppcheck-suppress unknownMacro
+PICONAUT_INNER_NAMESPACE(websocket)
+
+/// @brief WebSocket upgrade route, register it like any other handler:
+/// ```cpp
+/// server->RegisterHandler("/ws/{room}", std::make_shared<ChatHandler>());
+/// ```
+/// Callbacks run on the event loop thread of the connection.
+/// Only HTTP/1.1 upgrade is supported.
+class WebSocketHandler : public handlers::HandlerBase {
+ public:
+  virtual void OnOpen(
+      WebSocketConnection& conn,
+      const std::unordered_map<std::string, std::string>& params) {}
+  virtual void OnMessage(WebSocketConnection& conn, OpCode opcode,
+                         const char* data, size_t len) = 0;
+  virtual void OnClose(WebSocketConnection& conn) {}
+
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const std::unordered_map<std::string, std::string>& params)
+      const override;
+};
+
+PICONAUT_INNER_END_NAMESPACE
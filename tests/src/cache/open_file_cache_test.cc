@@ -0,0 +1,123 @@
+#include <catch2/catch_all.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "piconaut/cache/open_file_cache.h"
+
+using namespace piconaut;
+
+namespace {
+
+// Scratch directory removed with the files written in it.
+struct TempDir {
+  TempDir() {
+    char pattern[] = "/tmp/piconaut-ofc-XXXXXX";
+    path = mkdtemp(pattern);
+  }
+
+  ~TempDir() {
+    std::error_code ignored;
+    std::filesystem::remove_all(path, ignored);
+  }
+
+  std::string Write(const std::string& name, const std::string& content) {
+    auto file = path + "/" + name;
+    std::ofstream(file, std::ios::binary | std::ios::trunc) << content;
+    return file;
+  }
+
+  std::string path;
+};
+
+// The watcher drops changed entries from its own thread.
+template <typename Predicate>
+bool Eventually(Predicate predicate) {
+  for (int i = 0; i < 200; ++i) {
+    if (predicate())
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST_CASE("[OpenFileCache] Open once, serve from cache", "[OpenFileCache]") {
+  TempDir dir;
+  auto path = dir.Write("index.html", "<h1>hello</h1>");
+  cache::OpenFileCache files;
+
+  auto file = files.Open(path);
+  REQUIRE(file);
+  REQUIRE(file->Inline());
+  REQUIRE(file->content == "<h1>hello</h1>");
+  REQUIRE(file->size == 14);
+  REQUIRE_FALSE(file->etag.empty());
+  REQUIRE_FALSE(file->last_modified.empty());
+  REQUIRE(files.Open(path) == file);
+
+  REQUIRE(files.Open(dir.path + "/missing.html") == nullptr);
+  REQUIRE(files.Open(dir.path) == nullptr);
+}
+
+TEST_CASE("[OpenFileCache] Invalidation", "[OpenFileCache]") {
+  TempDir dir;
+  auto path = dir.Write("app.js", "let a = 1;");
+  cache::OpenFileCache files;
+  auto file = files.Open(path);
+  REQUIRE(file);
+
+  SECTION("Explicit") {
+    files.Invalidate(path);
+    auto reopened = files.Open(path);
+    REQUIRE(reopened != file);
+    REQUIRE(reopened->content == "let a = 1;");
+  }
+
+  SECTION("Modified") {
+    dir.Write("app.js", "let a = 22;");
+    REQUIRE(Eventually(
+        [&]() { return files.Open(path)->content == "let a = 22;"; }));
+    // Still readable by whoever holds the old one
+    REQUIRE(file->content == "let a = 1;");
+  }
+
+  SECTION("Replaced by rename") {
+    auto next = dir.Write("app.js.next", "let b = 2;");
+    REQUIRE(rename(next.c_str(), path.c_str()) == 0);
+    REQUIRE(Eventually([&]() {
+      auto current = files.Open(path);
+      return current && current->content == "let b = 2;";
+    }));
+  }
+
+  SECTION("Deleted") {
+    REQUIRE(unlink(path.c_str()) == 0);
+    REQUIRE(Eventually([&]() { return files.Open(path) == nullptr; }));
+  }
+
+  SECTION("Clear") {
+    files.Clear();
+    REQUIRE(files.Open(path) != file);
+  }
+}
+
+TEST_CASE("[OpenFileCache] Evicts past the capacity", "[OpenFileCache]") {
+  TempDir dir;
+  auto first = dir.Write("a.txt", "a");
+  auto second = dir.Write("b.txt", "b");
+  cache::OpenFileCache files(1);
+
+  auto file = files.Open(first);
+  REQUIRE(files.Open(second));
+  REQUIRE(files.Open(first) != file);
+}
@@ -0,0 +1,362 @@
+#include <catch2/catch_all.hpp>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "piconaut/cache/response_cache.h"
+#include "piconaut/http/compression.h"
+#include "piconaut/http/http_single_server.h"
+
+using namespace piconaut;
+
+namespace {
+
+constexpr int kPort = 18462;
+
+// h2o request with a pool, enough for the key to read the path, query
+// string and headers.
+struct FakeRequest {
+  explicit FakeRequest(const char* path) : native() {
+    h2o_mem_init_pool(&native.pool);
+    native.path = h2o_iovec_init(path, strlen(path));
+    const char* query = strchr(path, '?');
+    native.query_at = query ? static_cast<size_t>(query - path) : SIZE_MAX;
+  }
+
+  ~FakeRequest() {
+    h2o_mem_clear_pool(&native.pool);
+  }
+
+  void Header(const char* name, const char* value) {
+    h2o_add_header_by_str(&native.pool, &native.headers, name, strlen(name),
+                          1, nullptr, value, strlen(value));
+  }
+
+  h2o_req_t native;
+};
+
+cache::CacheKey Key(const char* path,
+                    const std::unordered_map<std::string, std::string>& params,
+                    const cache::CachePolicy& policy) {
+  FakeRequest fake(path);
+  http::Request req(&fake.native);
+  return cache::RequestKey(1, params, req, policy.include_query,
+                           policy.vary_headers);
+}
+
+http::ResponseCapture Captured(const std::string& body) {
+  http::ResponseCapture capture;
+  capture.captured = true;
+  capture.status = 200;
+  capture.content_type = "text/plain";
+  capture.body = body;
+  capture.etag = "\"0123456789abcdef\"";
+  return capture;
+}
+
+cache::CachedResponsePtr StoreBody(cache::ResponseCache& cache,
+                                   const cache::CacheKey& key,
+                                   const cache::CachePolicy& policy,
+                                   const std::string& body) {
+  auto capture = Captured(body);
+  return cache.Store(key, policy, capture);
+}
+
+std::string Gunzip(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    return std::string();
+
+  std::string out;
+  char buffer[4096];
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  int ret;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    ret = inflate(&stream, Z_NO_FLUSH);
+    out.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (ret == Z_OK);
+  inflateEnd(&stream);
+  return ret == Z_STREAM_END ? out : std::string();
+}
+
+class HelloHandler : public handlers::HandlerBase {
+ public:
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const std::unordered_map<std::string, std::string>&
+                         params) const override {
+    res.Send("hello from the cache", 200);
+  }
+};
+
+int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool WaitListening() {
+  for (int i = 0; i < 250; ++i) {
+    int fd = Connect();
+    if (fd >= 0) {
+      close(fd);
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return false;
+}
+
+// Status and header block of a GET, names lowercased.
+struct Reply {
+  int status = 0;
+  std::string head;
+
+  std::string Header(const std::string& name) const {
+    auto at = head.find("\r\n" + name + ": ");
+    if (at == std::string::npos)
+      return std::string();
+    at += name.size() + 4;
+    return head.substr(at, head.find("\r\n", at) - at);
+  }
+};
+
+Reply Get(const std::string& path, const std::string& headers) {
+  Reply reply;
+  int fd = Connect();
+  if (fd < 0)
+    return reply;
+  std::string request = "GET " + path +
+                        " HTTP/1.1\r\nHost: 127.0.0.1\r\n" + headers +
+                        "Connection: close\r\n\r\n";
+  if (write(fd, request.data(), request.size()) !=
+      static_cast<ssize_t>(request.size())) {
+    close(fd);
+    return reply;
+  }
+
+  std::string response;
+  char buffer[1024];
+  ssize_t read_bytes;
+  while ((read_bytes = read(fd, buffer, sizeof(buffer))) > 0)
+    response.append(buffer, static_cast<size_t>(read_bytes));
+  close(fd);
+
+  auto end = response.find("\r\n\r\n");
+  if (response.compare(0, 9, "HTTP/1.1 ") != 0 || end == std::string::npos)
+    return reply;
+  reply.status = std::stoi(response.substr(9, 3));
+  // Names only, values are compared as sent
+  for (size_t line = response.find("\r\n"); line < end;
+       line = response.find("\r\n", line + 2)) {
+    auto colon = response.find(':', line);
+    std::transform(response.begin() + line, response.begin() + colon,
+                   response.begin() + line,
+                   [](unsigned char c) { return std::tolower(c); });
+  }
+  reply.head = response.substr(0, end + 2);
+  return reply;
+}
+
+}  // namespace
+
+TEST_CASE("[ResponseCache] Key normalization", "[ResponseCache]") {
+  cache::CachePolicy policy;
+
+  SECTION("Params order doesn't matter") {
+    std::unordered_map<std::string, std::string> params;
+    params["id"] = "7";
+    params["lang"] = "en";
+    std::unordered_map<std::string, std::string> reversed(16);
+    reversed["lang"] = "en";
+    reversed["id"] = "7";
+    REQUIRE(Key("/items", params, policy) == Key("/items", reversed, policy));
+  }
+
+  SECTION("Params are length prefixed") {
+    REQUIRE_FALSE(Key("/items", {{"a", "bc"}}, policy) ==
+                  Key("/items", {{"ab", "c"}}, policy));
+  }
+
+  SECTION("Query string only when asked") {
+    REQUIRE_FALSE(Key("/items?page=1", {}, policy) ==
+                  Key("/items?page=2", {}, policy));
+    policy.include_query = false;
+    REQUIRE(Key("/items?page=1", {}, policy) ==
+            Key("/items?page=2", {}, policy));
+  }
+
+  SECTION("Vary headers and negotiated format") {
+    policy.vary_headers = {"accept-language"};
+    FakeRequest en("/items");
+    en.Header("accept-language", "en");
+    FakeRequest fr("/items");
+    fr.Header("accept-language", "fr");
+    FakeRequest msgpack("/items");
+    msgpack.Header("accept-language", "en");
+    msgpack.Header("accept", "application/msgpack");
+
+    auto key = [&policy](FakeRequest& fake) {
+      http::Request req(&fake.native);
+      return cache::RequestKey(1, {}, req, policy.include_query,
+                               policy.vary_headers);
+    };
+    REQUIRE_FALSE(key(en) == key(fr));
+    REQUIRE_FALSE(key(en) == key(msgpack));
+    REQUIRE(key(en) == key(en));
+  }
+
+  SECTION("Route key") {
+    FakeRequest fake("/items");
+    http::Request req(&fake.native);
+    REQUIRE_FALSE(cache::RequestKey(1, {}, req, true, {}) ==
+                  cache::RequestKey(2, {}, req, true, {}));
+  }
+}
+
+TEST_CASE("[ResponseCache] Evicts the least recently used entry",
+          "[ResponseCache]") {
+  // One shard, whatever the calling thread
+  cache::ResponseCache cache(1, 2);
+  cache::CachePolicy policy;
+  policy.ttl = std::chrono::hours(1);
+  auto first = Key("/items?id=1", {}, policy);
+  auto second = Key("/items?id=2", {}, policy);
+  auto third = Key("/items?id=3", {}, policy);
+
+  StoreBody(cache, first, policy, "first");
+  StoreBody(cache, second, policy, "second");
+  // Hit moves it to the front, second is the oldest now
+  REQUIRE(cache.Find(first));
+  StoreBody(cache, third, policy, "third");
+
+  REQUIRE(cache.Find(second) == nullptr);
+  REQUIRE(*cache.Find(first)->body == "first");
+  REQUIRE(*cache.Find(third)->body == "third");
+
+  SECTION("Store on a cached key replaces the entry") {
+    StoreBody(cache, first, policy, "again");
+    REQUIRE(*cache.Find(first)->body == "again");
+    REQUIRE(cache.Find(third));
+  }
+
+  SECTION("Clear") {
+    cache.Clear();
+    REQUIRE(cache.Find(first) == nullptr);
+    REQUIRE(cache.Find(third) == nullptr);
+  }
+}
+
+TEST_CASE("[ResponseCache] Expires entries after the ttl", "[ResponseCache]") {
+  cache::ResponseCache cache(1, 16);
+  cache::CachePolicy policy;
+  auto key = Key("/items", {}, policy);
+
+  policy.ttl = std::chrono::milliseconds(0);
+  REQUIRE(StoreBody(cache, key, policy, "stale"));
+  REQUIRE(cache.Find(key) == nullptr);
+
+  policy.ttl = std::chrono::hours(1);
+  StoreBody(cache, key, policy, "fresh");
+  REQUIRE(*cache.Find(key)->body == "fresh");
+}
+
+TEST_CASE("[ResponseCache] Private responses are not stored",
+          "[ResponseCache]") {
+  cache::ResponseCache cache(1, 16);
+  cache::CachePolicy policy;
+  auto key = Key("/items", {}, policy);
+
+  auto capture = Captured("secret");
+  capture.cacheable = false;
+  REQUIRE(cache.Store(key, policy, capture) == nullptr);
+  REQUIRE(cache.Find(key) == nullptr);
+}
+
+TEST_CASE("[ResponseCache] Gzip variant has its own ETag", "[ResponseCache]") {
+  cache::ResponseCache cache(1, 16);
+  cache::CachePolicy policy;
+  policy.precompress = true;
+  std::string body(4096, 'a');
+
+  auto entry = StoreBody(cache, Key("/items", {}, policy), policy, body);
+  REQUIRE(entry->etag == "\"0123456789abcdef\"");
+  REQUIRE(entry->gzip_etag == "\"0123456789abcdef-gzip\"");
+  REQUIRE(entry->gzip_body->size() < body.size());
+  REQUIRE(Gunzip(*entry->gzip_body) == body);
+
+  SECTION("No validator without the identity one") {
+    auto capture = Captured(body);
+    capture.etag.clear();
+    auto untagged = cache.Store(Key("/other", {}, policy), policy, capture);
+    REQUIRE(untagged->gzip_body);
+    REQUIRE(untagged->gzip_etag.empty());
+  }
+}
+
+TEST_CASE("[ResponseCache] Serves 304 on a matching If-None-Match",
+          "[ResponseCache]") {
+  auto server = std::make_unique<http::H2OServer>("127.0.0.1", kPort);
+  server->RegisterHandler("/hello", std::make_shared<HelloHandler>());
+  cache::CachePolicy policy;
+  policy.ttl = std::chrono::hours(1);
+  policy.precompress = true;
+  server->EnableResponseCache("/hello", policy);
+
+  std::thread runner([&server]() { server->Start(); });
+  REQUIRE(WaitListening());
+
+  // Miss, the handler answers and the response is stored
+  auto miss = Get("/hello", "");
+  REQUIRE(miss.status == 200);
+  auto etag = miss.Header("etag");
+  REQUIRE_FALSE(etag.empty());
+
+  auto hit = Get("/hello", "");
+  REQUIRE(hit.status == 200);
+  REQUIRE(hit.Header("etag") == etag);
+
+  REQUIRE(Get("/hello", "If-None-Match: " + etag + "\r\n").status == 304);
+  REQUIRE(Get("/hello", "If-None-Match: *\r\n").status == 304);
+  REQUIRE(Get("/hello", "If-None-Match: \"other\"\r\n").status == 200);
+
+  auto gzip = Get("/hello", "Accept-Encoding: gzip\r\n");
+  REQUIRE(gzip.status == 200);
+  REQUIRE(gzip.Header("content-encoding") == "gzip");
+  auto gzip_etag = gzip.Header("etag");
+  REQUIRE(gzip_etag == http::EncodingEtag(etag, "gzip"));
+  REQUIRE(Get("/hello", "Accept-Encoding: gzip\r\nIf-None-Match: " +
+                            gzip_etag + "\r\n")
+              .status == 304);
+  // The identity validator doesn't match the gzip body
+  REQUIRE(Get("/hello",
+              "Accept-Encoding: gzip\r\nIf-None-Match: " + etag + "\r\n")
+              .status == 200);
+
+  server->Stop();
+  runner.join();
+}
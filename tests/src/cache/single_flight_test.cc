@@ -0,0 +1,241 @@
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "piconaut/cache/single_flight.h"
+
+using namespace piconaut;
+
+namespace {
+
+// Event loop of the parked requests, run here instead of a server.
+// One for every case, h2o has no way to destroy it.
+struct TestLoop {
+  TestLoop() : loop(h2o_evloop_create()), ctx(), conn() {
+    ctx.loop = loop;
+    conn.ctx = &ctx;
+    // Registers its wakeup before the loop runs, as the server does
+    utils::LoopQueue::ForLoop(loop);
+  }
+
+  // Run until `done` or the deadline, false when it didn't happen.
+  template <typename Predicate>
+  bool RunUntil(Predicate done) {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!done()) {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+      h2o_evloop_run(loop, 10);
+    }
+    return true;
+  }
+
+  h2o_evloop_t* loop;
+  h2o_context_t ctx;
+  h2o_conn_t conn;
+};
+
+// Request parked on the test loop, only what Park reads.
+struct FakeRequest {
+  explicit FakeRequest(TestLoop& loop) : native() {
+    h2o_mem_init_pool(&native.pool);
+    native.conn = &loop.conn;
+  }
+
+  ~FakeRequest() {
+    Dispose();
+  }
+
+  void Dispose() {
+    if (disposed)
+      return;
+    disposed = true;
+    h2o_mem_clear_pool(&native.pool);
+  }
+
+  h2o_req_t native;
+  bool disposed = false;
+};
+
+// What the follower was resumed with.
+struct Resumed {
+  int count = 0;
+  h2o_req_t* req = nullptr;
+  cache::CachedResponsePtr result;
+
+  cache::SingleFlight::Resume Callback() {
+    return [this](h2o_req_t* resumed_req, cache::CachedResponsePtr resumed) {
+      ++count;
+      req = resumed_req;
+      result = std::move(resumed);
+    };
+  }
+};
+
+TestLoop& SharedLoop() {
+  static auto loop = new TestLoop();
+  return *loop;
+}
+
+cache::CacheKey Key(const std::string& text) {
+  return cache::CacheKey{42, text};
+}
+
+cache::CachedResponsePtr Response(const std::string& body) {
+  auto response = std::make_shared<cache::CachedResponse>();
+  response->status = 200;
+  response->content_type = "text/plain";
+  response->body = std::make_shared<std::string>(body);
+  return response;
+}
+
+}  // namespace
+
+TEST_CASE("[SingleFlight] Join leads or follows", "[SingleFlight]") {
+  cache::SingleFlight flights;
+
+  auto leader = flights.Join(Key("/items"));
+  REQUIRE(leader.Leader());
+  auto follower = flights.Join(Key("/items"));
+  REQUIRE_FALSE(follower.Leader());
+
+  // Same hash, other text: a flight of its own
+  auto other = flights.Join(Key("/other"));
+  REQUIRE(other.Leader());
+
+  leader.Publish(nullptr);
+  // Landed, the next request starts a new flight
+  REQUIRE(flights.Join(Key("/items")).Leader());
+}
+
+TEST_CASE("[SingleFlight] Followers get the leader response on their loop",
+          "[SingleFlight]") {
+  auto& loop = SharedLoop();
+  cache::SingleFlight flights;
+  auto leader = flights.Join(Key("/items"));
+
+  FakeRequest first(loop);
+  FakeRequest second(loop);
+  Resumed first_resumed;
+  Resumed second_resumed;
+  flights.Join(Key("/items"))
+      .Park(&first.native, std::chrono::seconds(10), first_resumed.Callback());
+  flights.Join(Key("/items"))
+      .Park(&second.native, std::chrono::seconds(10),
+            second_resumed.Callback());
+  REQUIRE(first_resumed.count == 0);
+
+  // The leader runs on another loop
+  auto response = Response("shared");
+  std::thread([&leader, &response]() { leader.Publish(response); }).join();
+  REQUIRE(first_resumed.count == 0);
+
+  REQUIRE(loop.RunUntil([&]() {
+    return first_resumed.count && second_resumed.count;
+  }));
+  REQUIRE(first_resumed.req == &first.native);
+  REQUIRE(second_resumed.req == &second.native);
+  // No copy per follower
+  REQUIRE(first_resumed.result == response);
+  REQUIRE(second_resumed.result == response);
+
+  // Resumed once, the timer is gone
+  h2o_evloop_run(loop.loop, 10);
+  REQUIRE(first_resumed.count == 1);
+}
+
+TEST_CASE("[SingleFlight] Landed between Join and Park", "[SingleFlight]") {
+  auto& loop = SharedLoop();
+  cache::SingleFlight flights;
+  auto leader = flights.Join(Key("/items"));
+  auto follower = flights.Join(Key("/items"));
+
+  auto response = Response("landed");
+  leader.Publish(response);
+
+  // Nothing to wait for, resumed before Park returns
+  FakeRequest req(loop);
+  Resumed resumed;
+  follower.Park(&req.native, std::chrono::seconds(10), resumed.Callback());
+  REQUIRE(resumed.count == 1);
+  REQUIRE(resumed.result == response);
+
+  h2o_evloop_run(loop.loop, 10);
+  REQUIRE(resumed.count == 1);
+}
+
+TEST_CASE("[SingleFlight] Leader without a response", "[SingleFlight]") {
+  auto& loop = SharedLoop();
+  cache::SingleFlight flights;
+  FakeRequest req(loop);
+  Resumed resumed;
+
+  {
+    // e.g. the handler threw, the ticket goes away unpublished
+    auto leader = flights.Join(Key("/items"));
+    flights.Join(Key("/items"))
+        .Park(&req.native, std::chrono::seconds(10), resumed.Callback());
+  }
+
+  REQUIRE(loop.RunUntil([&]() { return resumed.count > 0; }));
+  REQUIRE(resumed.result == nullptr);
+}
+
+TEST_CASE("[SingleFlight] Follower gives up after max_wait",
+          "[SingleFlight]") {
+  auto& loop = SharedLoop();
+  cache::SingleFlight flights;
+  auto leader = flights.Join(Key("/items"));
+
+  FakeRequest req(loop);
+  Resumed resumed;
+  flights.Join(Key("/items"))
+      .Park(&req.native, std::chrono::milliseconds(20), resumed.Callback());
+
+  REQUIRE(loop.RunUntil([&]() { return resumed.count > 0; }));
+  REQUIRE(resumed.result == nullptr);
+
+  // Landing late doesn't resume it again
+  leader.Publish(Response("late"));
+  h2o_evloop_run(loop.loop, 10);
+  REQUIRE(resumed.count == 1);
+}
+
+TEST_CASE("[SingleFlight] Follower disposed while parked", "[SingleFlight]") {
+  auto& loop = SharedLoop();
+  cache::SingleFlight flights;
+  auto leader = flights.Join(Key("/items"));
+
+  FakeRequest req(loop);
+  Resumed resumed;
+  flights.Join(Key("/items"))
+      .Park(&req.native, std::chrono::milliseconds(20), resumed.Callback());
+
+  // Client gone
+  req.Dispose();
+  leader.Publish(Response("nobody"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  h2o_evloop_run(loop.loop, 10);
+  h2o_evloop_run(loop.loop, 10);
+  REQUIRE(resumed.count == 0);
+}
+
+TEST_CASE("[SingleFlight] Shared response from a capture", "[SingleFlight]") {
+  http::ResponseCapture capture;
+  REQUIRE(cache::SingleFlight::FromCapture(capture) == nullptr);
+
+  capture.captured = true;
+  capture.status = 201;
+  capture.content_type = "application/json";
+  capture.body = "{}";
+  capture.headers.emplace_back("location", "/items/1");
+  auto response = cache::SingleFlight::FromCapture(capture);
+  REQUIRE(response->status == 201);
+  REQUIRE(response->content_type == "application/json");
+  REQUIRE(*response->body == "{}");
+  REQUIRE(response->headers.size() == 1);
+}
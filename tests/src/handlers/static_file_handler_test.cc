@@ -0,0 +1,96 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstddef>
+#include <string>
+
+#include "piconaut/handlers/static_file_handler.h"
+
+using namespace piconaut;
+
+namespace {
+
+struct Range {
+  bool satisfiable;
+  size_t start;
+  size_t length;
+};
+
+Range Parse(const std::string& header, size_t size) {
+  Range range{false, SIZE_MAX, SIZE_MAX};
+  range.satisfiable =
+      handlers::ParseRange(header, size, range.start, range.length);
+  return range;
+}
+
+}  // namespace
+
+TEST_CASE("[StaticFileHandler] Path traversal", "[StaticFileHandler]") {
+  REQUIRE(handlers::IsSafePath("index.html"));
+  REQUIRE(handlers::IsSafePath("css/site.css"));
+  REQUIRE(handlers::IsSafePath("a/..b/c"));
+  REQUIRE(handlers::IsSafePath("..."));
+
+  REQUIRE_FALSE(handlers::IsSafePath(".."));
+  REQUIRE_FALSE(handlers::IsSafePath("../etc/passwd"));
+  REQUIRE_FALSE(handlers::IsSafePath("css/../../etc/passwd"));
+  REQUIRE_FALSE(handlers::IsSafePath("css/.."));
+  REQUIRE_FALSE(handlers::IsSafePath(std::string("index.html\0.txt", 15)));
+}
+
+TEST_CASE("[StaticFileHandler] Range header", "[StaticFileHandler]") {
+  SECTION("First and last byte") {
+    auto range = Parse("bytes=0-99", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 0);
+    REQUIRE(range.length == 100);
+  }
+
+  SECTION("Open ended") {
+    auto range = Parse("bytes=100-", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 100);
+    REQUIRE(range.length == 900);
+  }
+
+  SECTION("Last byte past the end is clamped") {
+    auto range = Parse("bytes=990-5000", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 990);
+    REQUIRE(range.length == 10);
+  }
+
+  SECTION("Suffix") {
+    auto range = Parse("bytes=-100", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 900);
+    REQUIRE(range.length == 100);
+
+    // Larger than the file, the whole file
+    range = Parse("bytes=-5000", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 0);
+    REQUIRE(range.length == 1000);
+  }
+
+  SECTION("Multiple ranges and other units get the full body") {
+    auto range = Parse("bytes=0-1,5-6", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 0);
+    REQUIRE(range.length == 1000);
+
+    range = Parse("items=0-1", 1000);
+    REQUIRE(range.satisfiable);
+    REQUIRE(range.start == 0);
+    REQUIRE(range.length == 1000);
+  }
+
+  SECTION("Unsatisfiable") {
+    REQUIRE_FALSE(Parse("bytes=1000-", 1000).satisfiable);
+    REQUIRE_FALSE(Parse("bytes=5-2", 1000).satisfiable);
+    REQUIRE_FALSE(Parse("bytes=-0", 1000).satisfiable);
+    REQUIRE_FALSE(Parse("bytes=-", 1000).satisfiable);
+    REQUIRE_FALSE(Parse("bytes=10", 1000).satisfiable);
+    REQUIRE_FALSE(Parse("bytes=-5", 0).satisfiable);
+    REQUIRE_FALSE(Parse("bytes=0-", 0).satisfiable);
+  }
+}
@@ -0,0 +1,185 @@
+#include <catch2/catch_all.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "piconaut/http/compression.h"
+
+using namespace piconaut;
+
+namespace {
+
+http::CompressionType Negotiate(const http::CompressionPolicy& policy,
+                                const char* accept_encoding) {
+  return http::NegotiateCompression(policy, accept_encoding,
+                                    strlen(accept_encoding));
+}
+
+std::string Gunzip(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    return std::string();
+
+  std::string out;
+  char buffer[4096];
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  int ret;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    ret = inflate(&stream, Z_NO_FLUSH);
+    out.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (ret == Z_OK);
+  inflateEnd(&stream);
+  return ret == Z_STREAM_END ? out : std::string();
+}
+
+// Compressible but not trivially, levels give different sizes
+std::string JsonBody(size_t items) {
+  std::string body = "[";
+  for (size_t i = 0; i < items; ++i) {
+    if (i)
+      body += ",";
+    body += "{\"id\":" + std::to_string(i * 7919 % 10007) +
+            ",\"name\":\"item-" + std::to_string(i * 31 % 977) +
+            "\",\"active\":" + (i % 3 ? "true" : "false") + "}";
+  }
+  return body + "]";
+}
+
+std::string Compress(http::GzipEncoder& encoder, int level,
+                     const std::string& body) {
+  std::string out;
+  if (!encoder.Begin(level) ||
+      !encoder.Encode(body.data(), body.size(), true, out))
+    return std::string();
+  return out;
+}
+
+}  // namespace
+
+TEST_CASE("[Compression] Negotiate the encoding", "[Compression]") {
+  http::CompressionPolicy policy;
+
+  REQUIRE(Negotiate(policy, "gzip") == http::CompressionType::GZIP);
+  REQUIRE(Negotiate(policy, "deflate, gzip") == http::CompressionType::GZIP);
+  REQUIRE(Negotiate(policy, "GZip;q=0.8") == http::CompressionType::GZIP);
+  REQUIRE(Negotiate(policy, "identity,gzip ,br") ==
+          http::CompressionType::GZIP);
+
+  // Whole tokens only
+  REQUIRE(Negotiate(policy, "x-gzip") == http::CompressionType::NONE);
+  REQUIRE(Negotiate(policy, "gzipped") == http::CompressionType::NONE);
+  REQUIRE(Negotiate(policy, "deflate") == http::CompressionType::NONE);
+  REQUIRE(Negotiate(policy, "") == http::CompressionType::NONE);
+  REQUIRE(http::NegotiateCompression(policy, nullptr, 0) ==
+          http::CompressionType::NONE);
+
+  SECTION("Disabled") {
+    policy.type = http::CompressionType::NONE;
+    REQUIRE(Negotiate(policy, "gzip") == http::CompressionType::NONE);
+  }
+
+  SECTION("Brotli preferred") {
+    policy.type = http::CompressionType::BROTLI;
+    REQUIRE(Negotiate(policy, "gzip") == http::CompressionType::GZIP);
+#if PICONAUT_USE_BROTLI
+    REQUIRE(Negotiate(policy, "gzip, br") == http::CompressionType::BROTLI);
+#else
+    // Not built in, gzip is the fallback
+    REQUIRE(Negotiate(policy, "gzip, br") == http::CompressionType::GZIP);
+    REQUIRE(Negotiate(policy, "br") == http::CompressionType::NONE);
+#endif
+  }
+
+  SECTION("Gzip preferred doesn't pick brotli") {
+    REQUIRE(Negotiate(policy, "br") == http::CompressionType::NONE);
+  }
+}
+
+TEST_CASE("[Compression] Content type allowlist", "[Compression]") {
+  http::CompressionPolicy policy;
+  auto compressible = [&policy](const char* content_type) {
+    return policy.IsCompressible(content_type, strlen(content_type));
+  };
+
+  REQUIRE(compressible("application/json"));
+  REQUIRE(compressible("text/html; charset=utf-8"));
+  REQUIRE(compressible("Text/CSS"));
+  REQUIRE_FALSE(compressible("image/png"));
+  REQUIRE_FALSE(compressible("application/octet-stream"));
+  REQUIRE_FALSE(compressible("text"));
+}
+
+TEST_CASE("[Compression] ETag of an encoding", "[Compression]") {
+  REQUIRE(http::EncodingEtag("\"abc\"", "gzip") == "\"abc-gzip\"");
+  REQUIRE(http::EncodingEtag("W/\"abc\"", "br") == "W/\"abc-br\"");
+  // Not a quoted validator, left alone
+  REQUIRE(http::EncodingEtag("abc", "gzip") == "abc");
+  REQUIRE(http::EncodingEtag("\"", "gzip") == "\"");
+  REQUIRE(http::EncodingEtag("", "gzip").empty());
+}
+
+TEST_CASE("[Compression] Gzip encoder reused across levels",
+          "[Compression]") {
+  http::GzipEncoder encoder;
+  auto body = JsonBody(2000);
+
+  auto fast = Compress(encoder, 1, body);
+  auto best = Compress(encoder, Z_BEST_COMPRESSION, body);
+  // Back to the first level, the same stream as a fresh encoder
+  auto again = Compress(encoder, 1, body);
+
+  REQUIRE(Gunzip(fast) == body);
+  REQUIRE(Gunzip(best) == body);
+  REQUIRE(again == fast);
+  REQUIRE(best.size() < fast.size());
+
+  http::GzipEncoder fresh;
+  REQUIRE(Compress(fresh, Z_BEST_COMPRESSION, body) == best);
+
+  SECTION("Streamed in chunks") {
+    REQUIRE(encoder.Begin(6));
+    std::string out;
+    size_t step = body.size() / 3;
+    REQUIRE(encoder.Encode(body.data(), step, false, out));
+    // Sync flushed, what was written so far can go out
+    auto flushed = out.size();
+    REQUIRE(flushed > 0);
+    REQUIRE(encoder.Encode(body.data() + step, step, false, out));
+    REQUIRE(encoder.Encode(body.data() + 2 * step, body.size() - 2 * step,
+                           true, out));
+    REQUIRE(out.size() > flushed);
+    REQUIRE(Gunzip(out) == body);
+  }
+
+  SECTION("One shot into a caller buffer") {
+    REQUIRE(encoder.Begin(1));
+    std::vector<char> out(encoder.Bound(body.size()));
+    auto size = encoder.EncodeAll(body.data(), body.size(), out.data(),
+                                  out.size());
+    REQUIRE(size > 0);
+    REQUIRE(std::string(out.data(), size) == fast);
+  }
+
+  SECTION("Thread local encoder") {
+    auto& local = http::GzipEncoder::ThreadLocal();
+    REQUIRE(&local == &http::GzipEncoder::ThreadLocal());
+    REQUIRE(Gunzip(Compress(local, 9, body)) == body);
+    REQUIRE(Gunzip(Compress(local, 1, body)) == body);
+  }
+}
+
+TEST_CASE("[Compression] Encode before Begin fails", "[Compression]") {
+  http::GzipEncoder encoder;
+  std::string out;
+  REQUIRE_FALSE(encoder.Encode("abc", 3, true, out));
+  char buffer[64];
+  REQUIRE(encoder.EncodeAll("abc", 3, buffer, sizeof(buffer)) == 0);
+}
@@ -0,0 +1,164 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "piconaut/http/cors.h"
+
+using namespace piconaut;
+
+namespace {
+
+// h2o request with a pool, enough to read request headers and collect
+// the response headers Cors adds.
+struct FakeRequest {
+  explicit FakeRequest(const char* method) : native() {
+    h2o_mem_init_pool(&native.pool);
+    native.method = h2o_iovec_init(method, strlen(method));
+  }
+
+  ~FakeRequest() {
+    h2o_mem_clear_pool(&native.pool);
+  }
+
+  void Header(const char* name, const char* value) {
+    h2o_add_header_by_str(&native.pool, &native.headers, name, strlen(name),
+                          1, nullptr, value, strlen(value));
+  }
+
+  std::string ResponseHeader(const char* name) const {
+    ssize_t index =
+        h2o_find_header_by_str(&native.res.headers, name, strlen(name), -1);
+    if (index == -1)
+      return std::string();
+    const auto& value = native.res.headers.entries[index].value;
+    return std::string(value.base, value.len);
+  }
+
+  h2o_req_t native;
+};
+
+http::CorsPolicy AppPolicy() {
+  http::CorsPolicy policy;
+  policy.allowed_origins = {"https://app.example.com"};
+  policy.exposed_headers = {"X-Request-Id"};
+  return policy;
+}
+
+}  // namespace
+
+TEST_CASE("[Cors] Preflight from an allowed origin", "[Cors]") {
+  http::Cors cors(AppPolicy());
+  FakeRequest fake("OPTIONS");
+  fake.Header("origin", "https://app.example.com");
+  fake.Header("access-control-request-method", "PUT");
+  http::Request req(&fake.native);
+
+  REQUIRE(http::Cors::IsPreflight(req));
+  REQUIRE(cors.PreflightHeaders(req) == 204);
+  REQUIRE(fake.ResponseHeader("access-control-allow-origin") ==
+          "https://app.example.com");
+  REQUIRE(fake.ResponseHeader("access-control-allow-methods") ==
+          "GET, HEAD, POST, PUT, PATCH, DELETE");
+  REQUIRE(fake.ResponseHeader("access-control-allow-headers") ==
+          "Content-Type, Authorization");
+  REQUIRE(fake.ResponseHeader("access-control-max-age") == "600");
+  REQUIRE(fake.ResponseHeader("vary") == "origin");
+}
+
+TEST_CASE("[Cors] Preflight from a foreign origin", "[Cors]") {
+  http::Cors cors(AppPolicy());
+  FakeRequest fake("OPTIONS");
+  fake.Header("origin", "https://evil.example.com");
+  fake.Header("access-control-request-method", "PUT");
+  http::Request req(&fake.native);
+
+  REQUIRE(cors.PreflightHeaders(req) == 403);
+  REQUIRE(fake.ResponseHeader("access-control-allow-origin").empty());
+  REQUIRE(fake.ResponseHeader("vary") == "origin");
+}
+
+TEST_CASE("[Cors] Preflight echo requested headers for \"*\"", "[Cors]") {
+  auto policy = AppPolicy();
+  policy.allowed_headers = {"*"};
+  http::Cors cors(policy);
+  FakeRequest fake("OPTIONS");
+  fake.Header("origin", "https://app.example.com");
+  fake.Header("access-control-request-method", "POST");
+  fake.Header("access-control-request-headers", "x-trace");
+  http::Request req(&fake.native);
+
+  REQUIRE(cors.PreflightHeaders(req) == 204);
+  REQUIRE(fake.ResponseHeader("access-control-allow-headers") == "x-trace");
+}
+
+TEST_CASE("[Cors] Not a preflight", "[Cors]") {
+  FakeRequest options("OPTIONS");
+  options.Header("origin", "https://app.example.com");
+  REQUIRE_FALSE(http::Cors::IsPreflight(http::Request(&options.native)));
+
+  FakeRequest get("GET");
+  get.Header("origin", "https://app.example.com");
+  get.Header("access-control-request-method", "GET");
+  REQUIRE_FALSE(http::Cors::IsPreflight(http::Request(&get.native)));
+}
+
+TEST_CASE("[Cors] Simple request", "[Cors]") {
+  http::Cors cors(AppPolicy());
+
+  SECTION("Allowed origin") {
+    FakeRequest fake("GET");
+    fake.Header("origin", "https://app.example.com");
+    cors.Apply(http::Request(&fake.native));
+    REQUIRE(fake.ResponseHeader("access-control-allow-origin") ==
+            "https://app.example.com");
+    REQUIRE(fake.ResponseHeader("access-control-expose-headers") ==
+            "X-Request-Id");
+    REQUIRE(fake.ResponseHeader("access-control-allow-credentials").empty());
+    REQUIRE(fake.ResponseHeader("vary") == "origin");
+  }
+
+  SECTION("Foreign origin still vary") {
+    FakeRequest fake("GET");
+    fake.Header("origin", "https://evil.example.com");
+    cors.Apply(http::Request(&fake.native));
+    REQUIRE(fake.ResponseHeader("access-control-allow-origin").empty());
+    REQUIRE(fake.ResponseHeader("vary") == "origin");
+  }
+
+  SECTION("No origin still vary") {
+    FakeRequest fake("GET");
+    cors.Apply(http::Request(&fake.native));
+    REQUIRE(fake.ResponseHeader("access-control-allow-origin").empty());
+    REQUIRE(fake.ResponseHeader("vary") == "origin");
+  }
+}
+
+TEST_CASE("[Cors] Any origin", "[Cors]") {
+  http::CorsPolicy policy;
+  policy.allowed_origins = {"*"};
+  http::Cors cors(policy);
+
+  FakeRequest fake("GET");
+  fake.Header("origin", "https://any.example.com");
+  cors.Apply(http::Request(&fake.native));
+  REQUIRE(fake.ResponseHeader("access-control-allow-origin") == "*");
+  REQUIRE(fake.ResponseHeader("vary").empty());
+}
+
+TEST_CASE("[Cors] Credentials", "[Cors]") {
+  auto policy = AppPolicy();
+  policy.allow_credentials = true;
+  http::Cors cors(policy);
+
+  FakeRequest fake("GET");
+  fake.Header("origin", "https://app.example.com");
+  cors.Apply(http::Request(&fake.native));
+  REQUIRE(fake.ResponseHeader("access-control-allow-origin") ==
+          "https://app.example.com");
+  REQUIRE(fake.ResponseHeader("access-control-allow-credentials") == "true");
+
+  policy.allowed_origins.push_back("*");
+  REQUIRE_THROWS_AS(http::Cors(policy), std::invalid_argument);
+}
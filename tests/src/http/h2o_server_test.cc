@@ -0,0 +1,114 @@
+#include <catch2/catch_all.hpp>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "piconaut/http/http_single_server.h"
+
+using namespace piconaut;
+
+namespace {
+
+constexpr int kPort = 18461;
+
+class PingHandler : public handlers::HandlerBase {
+ public:
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const std::unordered_map<std::string, std::string>&
+                         params) const override {
+    res.Send("pong", 200);
+  }
+};
+
+// Connected socket to the test port, -1 when refused.
+int Connect() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool WaitListening() {
+  for (int i = 0; i < 250; ++i) {
+    int fd = Connect();
+    if (fd >= 0) {
+      close(fd);
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return false;
+}
+
+// Whole HTTP/1.1 response of a GET, the server closes the connection.
+std::string Get(const std::string& path) {
+  int fd = Connect();
+  if (fd < 0)
+    return std::string();
+  std::string request = "GET " + path +
+                        " HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                        "Connection: close\r\n\r\n";
+  if (write(fd, request.data(), request.size()) !=
+      static_cast<ssize_t>(request.size())) {
+    close(fd);
+    return std::string();
+  }
+
+  std::string response;
+  char buffer[1024];
+  ssize_t read_bytes;
+  while ((read_bytes = read(fd, buffer, sizeof(buffer))) > 0)
+    response.append(buffer, static_cast<size_t>(read_bytes));
+  close(fd);
+  return response;
+}
+
+}  // namespace
+
+TEST_CASE("[H2OServer] Starts and stops several event loops",
+          "[H2OServer]") {
+  auto server = std::make_unique<http::H2OServer>("127.0.0.1", kPort);
+  http::Config config;
+  config.EventLoops(2);
+  server->SetConfig(config);
+  server->RegisterHandler("/ping", std::make_shared<PingHandler>());
+
+  std::thread runner([&server]() { server->Start(); });
+  REQUIRE(WaitListening());
+
+  // Connections land on either loop
+  for (int i = 0; i < 8; ++i) {
+    auto response = Get("/ping");
+    REQUIRE(response.find("200") != std::string::npos);
+    REQUIRE(response.find("pong") != std::string::npos);
+  }
+
+  server->Stop();
+  // Start returns once every loop left
+  runner.join();
+  REQUIRE(Connect() == -1);
+
+  // Again from the destructor is a no-op
+  server->Stop();
+  server.reset();
+}
+
+TEST_CASE("[H2OServer] Stop before Start", "[H2OServer]") {
+  http::H2OServer server("127.0.0.1", kPort);
+  server.Stop();
+  server.Stop();
+}
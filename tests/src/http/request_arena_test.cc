@@ -0,0 +1,76 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "piconaut/http/request_arena.h"
+
+using namespace piconaut;
+
+namespace {
+
+struct Pool {
+  Pool() {
+    h2o_mem_init_pool(&pool);
+  }
+  ~Pool() {
+    h2o_mem_clear_pool(&pool);
+  }
+  h2o_mem_pool_t pool;
+};
+
+bool Aligned(const void* ptr, size_t align) {
+  return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+}
+
+struct alignas(16) Wide {
+  int64_t a;
+  int64_t b;
+};
+
+}  // namespace
+
+TEST_CASE("[RequestArena] Aligns after odd pool offsets", "[RequestArena]") {
+  Pool pool;
+  http::RequestArena arena(&pool.pool);
+
+  // What Response::AddHeader leaves behind
+  h2o_strdup(&pool.pool, "x-odd", 5);
+
+  SECTION("Allocate") {
+    REQUIRE(Aligned(arena.Allocate(3), http::kArenaAlignment));
+    h2o_strdup(&pool.pool, "abc", 3);
+    REQUIRE(Aligned(arena.Allocate(24), http::kArenaAlignment));
+  }
+
+  SECTION("Create") {
+    auto wide = arena.Create<Wide>(Wide{1, 2});
+    REQUIRE(Aligned(wide, alignof(Wide)));
+    REQUIRE(wide->b == 2);
+
+    h2o_strdup(&pool.pool, "abc", 3);
+    auto text = arena.Create<std::string>("destroyed with the pool");
+    REQUIRE(Aligned(text, alignof(std::string)));
+  }
+
+  SECTION("ArenaAllocator") {
+    std::vector<double, http::ArenaAllocator<double>> values(
+        (http::ArenaAllocator<double>(arena)));
+    for (int i = 0; i < 100; ++i) {
+      values.push_back(i);
+      REQUIRE(Aligned(values.data(), alignof(double)));
+      h2o_strdup(&pool.pool, "a", 1);
+    }
+    REQUIRE(values[99] == 99);
+  }
+}
+
+TEST_CASE("[RequestArena] Copies strings null terminated", "[RequestArena]") {
+  Pool pool;
+  http::RequestArena arena(&pool.pool);
+
+  auto copy = arena.CopyString("hello world", 5);
+  REQUIRE(std::string(copy) == "hello");
+  REQUIRE(copy.data()[5] == '\0');
+}
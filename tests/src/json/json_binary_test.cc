@@ -0,0 +1,113 @@
+#include <catch2/catch_all.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "piconaut/formats/binary/binary_writer.h"
+#include "piconaut/formats/format.h"
+#include "piconaut/formats/json/value.h"
+#include "piconaut/formats/json/value_builder.h"
+#include "piconaut/formats/serialize.h"
+
+using namespace piconaut;
+
+namespace binary_test {
+
+struct Item {
+  std::string name;
+  int64_t count;
+  std::optional<double> price;
+  std::vector<std::string> tags;
+};
+PICONAUT_JSON_FIELDS(Item, name, count, price, tags)
+
+}  // namespace binary_test
+
+TEST_CASE("[Binary] MessagePack Encoding Test", "[Binary]") {
+  formats::binary::BinaryWriter writer(formats::Format::kMsgPack);
+  writer.Object(2).Member("a", 1).Member("b", -200).EndObject();
+  auto bytes = writer.Finish();
+
+  // fixmap(2) "a" 1 "b" int16(-200)
+  const unsigned char expected[] = {0x82, 0xa1, 'a', 0x01, 0xa1,
+                                    'b',  0xd1, 0xff, 0x38};
+  REQUIRE(bytes.View() ==
+          std::string_view(reinterpret_cast<const char*>(expected),
+                           sizeof(expected)));
+
+  // misuse is rejected, counts depend on it
+  writer.Object(1);
+  REQUIRE_THROWS_AS(writer.Value(1), std::logic_error);
+}
+
+TEST_CASE("[Binary] Round Trip Test", "[Binary]") {
+  static const formats::json::Path kName("/user/name");
+  static const formats::json::Path kAge("/user/age");
+  static const formats::json::Path kScore("/score");
+
+  formats::json::ValueBuilder json;
+  json["user"]["name"] = "piconaut";
+  json["user"]["age"] = -42;
+  json["score"] = 0.1;
+
+  for (auto format : {formats::Format::kMsgPack, formats::Format::kCbor}) {
+    auto bytes = json.Serialize(format);
+    auto value =
+        formats::json::Value::Decode(format, bytes.Data(), bytes.Size());
+    REQUIRE(value.GetString(kName) == std::string_view("piconaut"));
+    REQUIRE(value.GetInt64(kAge) == -42);
+    REQUIRE(value.GetDouble(kScore) == 0.1);
+
+    // json text transcoded gives the same document
+    auto text = json.SerializeToBytes();
+    auto transcoded = formats::binary::Transcode(text.View(), format);
+    auto again = formats::json::Value::Decode(format, transcoded.Data(),
+                                              transcoded.Size());
+    REQUIRE(again.GetInt64(kAge) == -42);
+
+    REQUIRE_THROWS_AS(
+        formats::json::Value::Decode(format, bytes.Data(), bytes.Size() - 1),
+        formats::json::ParseError);
+  }
+}
+
+TEST_CASE("[Binary] Struct Reflection Test", "[Binary]") {
+  static const formats::json::Path kName("/0/name");
+  static const formats::json::Path kTag("/0/tags/1");
+  static const formats::json::Path kPrice("/1/price");
+
+  std::vector<binary_test::Item> items = {
+      {"apple", 3, std::nullopt, {"fruit", "red"}},
+      {"pear", 1, 2.5, {}},
+  };
+
+  auto bytes = formats::Serialize(items, formats::Format::kCbor);
+  auto value = formats::json::Value::Decode(formats::Format::kCbor,
+                                            bytes.Data(), bytes.Size());
+  REQUIRE(value.GetString(kName) == std::string_view("apple"));
+  REQUIRE(value.GetString(kTag) == std::string_view("red"));
+  REQUIRE(value.GetDouble(kPrice) == 2.5);
+  REQUIRE_FALSE(value.Has(formats::json::Path("/0/price")));
+}
+
+TEST_CASE("[Binary] Negotiation Test", "[Binary]") {
+  auto negotiate = [](std::string_view accept) {
+    return formats::NegotiateFormat(accept.data(), accept.size());
+  };
+
+  REQUIRE(negotiate("") == formats::Format::kJson);
+  REQUIRE(negotiate("*/*") == formats::Format::kJson);
+  REQUIRE(negotiate("application/msgpack") == formats::Format::kMsgPack);
+  REQUIRE(negotiate("application/json, application/cbor") ==
+          formats::Format::kJson);
+  REQUIRE(negotiate("application/json;q=0.5, application/cbor") ==
+          formats::Format::kCbor);
+  REQUIRE(negotiate("text/html, application/x-msgpack;q=0.9, */*;q=0.1") ==
+          formats::Format::kMsgPack);
+
+  std::string content_type = "application/cbor; charset=binary";
+  REQUIRE(formats::FormatFromContentType(content_type.data(),
+                                         content_type.size()) ==
+          formats::Format::kCbor);
+}
@@ -2,7 +2,15 @@
 
 #include <catch2/catch_all.hpp>
 
+#include <list>
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "piconaut/formats/json/value_builder.h"
+#include "piconaut/formats/json/value_builder_pool.h"
+#include "piconaut/formats/json/size_hint.h"
+#include "piconaut/formats/json/json_key.h"
 
 using namespace piconaut;
 TEST_CASE("[JsonBuilder] Single Level Test", "[JsonBuilder]") {
@@ -42,4 +50,142 @@ TEST_CASE("[JsonBuilder] Multi Level Test", "[JsonBuilder]") {
 
   std::cout << "Json:\n" << str_pretty << std::endl;
   REQUIRE(answer == str_json);
-}
\ No newline at end of file
+}
+
+TEST_CASE("[JsonBuilder] Seeded Allocator Test", "[JsonBuilder]") {
+  auto answer = "{\"key1\":\"value1\",\"object\":{\"status\":1}}";
+  alignas(void*) char seed[4096];
+  formats::json::ValueBuilder json(seed, sizeof(seed));
+  json["key1"] = "value1";
+  json["object"].CreateJsonObject();
+  json["object"]["status"] = 1;
+
+  auto val = json.SerializeToBytes();
+  REQUIRE(answer == val.ToString());
+}
+
+TEST_CASE("[JsonBuilder] Reset Reuse Test", "[JsonBuilder]") {
+  formats::json::ValueBuilder json;
+  json["key1"] = "value1";
+  json["object"].CreateJsonObject();
+  json["object"]["status"] = 1;
+  REQUIRE(json.SerializeToBytes().ToString() ==
+          "{\"key1\":\"value1\",\"object\":{\"status\":1}}");
+
+  json.Reset();
+  REQUIRE(json.SerializeToBytes().ToString() == "{}");
+
+  json["other"] = true;
+  REQUIRE(json.SerializeToBytes().ToString() == "{\"other\":true}");
+}
+
+TEST_CASE("[JsonBuilder] Pool Reuse Test", "[JsonBuilder]") {
+  formats::json::ValueBuilder* first = nullptr;
+  {
+    auto json = formats::json::ValueBuilderPool::Acquire();
+    json["key1"] = "value1";
+    first = &json.Get();
+  }
+
+  auto json = formats::json::ValueBuilderPool::Acquire();
+  REQUIRE(&json.Get() == first);
+  REQUIRE(json->SerializeToBytes().ToString() == "{}");
+}
+
+TEST_CASE("[JsonBuilder] Bulk Array Test", "[JsonBuilder]") {
+  formats::json::ValueBuilder json;
+  std::vector<std::string> names{"alpha", "a string longer than sso buffer"};
+
+  json["ids"] = std::vector<int>{1, 2, 3};
+  json["names"] = std::move(names);
+  json["flags"] = std::vector<bool>{true, false};
+  json["none"] = std::optional<int>();
+
+  std::list<double> scores{1.5, 2.5};
+  json["scores"].Assign(scores);
+
+  REQUIRE(json.SerializeToBytes().ToString() ==
+          "{\"ids\":[1,2,3],\"names\":[\"alpha\",\"a string longer than sso "
+          "buffer\"],\"flags\":[true,false],\"none\":null,\"scores\":[1.5,"
+          "2.5]}");
+
+  // copy owns its strings, adopted ones are not shared
+  formats::json::ValueBuilder copy(json);
+  json.Reset();
+  REQUIRE(copy.SerializeToBytes().ToString().find("sso buffer") !=
+          std::string::npos);
+}
+
+TEST_CASE("[JsonBuilder] Json Buffer Test", "[JsonBuilder]") {
+  formats::json::ValueBuilder json;
+  json["key1"] = "value1";
+
+  // small output stays inline
+  auto small = json.SerializeToBytes();
+  REQUIRE(small.IsInline());
+  REQUIRE(small.View() == "{\"key1\":\"value1\"}");
+
+  // hinted output starts in a recycled chunk, moves don't copy it
+  auto large = json.SerializeToBytes(64 * 1024);
+  REQUIRE_FALSE(large.IsInline());
+  REQUIRE(large.Capacity() >= 64 * 1024);
+  const char* chunk = large.Data();
+  formats::json::JsonBuffer moved(std::move(large));
+  REQUIRE(moved.Data() == chunk);
+  REQUIRE(moved.View() == small.View());
+}
+
+TEST_CASE("[JsonBuilder] Size Hint Test", "[JsonBuilder]") {
+  formats::json::SizeEstimate estimate;
+  REQUIRE(estimate.Hint() == 0);
+
+  std::string large(8 * 1024, 'x');
+  {
+    formats::json::SizeHintScope scope(&estimate);
+    formats::json::ValueBuilder json;
+    json["payload"] = large;
+    auto first = json.SerializeToBytes();
+    REQUIRE(estimate.Samples() == 1);
+    REQUIRE(estimate.Hint() >= first.Size());
+
+    // next serialization is reserved up front from the estimate
+    auto second = json.SerializeToBytes();
+    REQUIRE(second.Capacity() >= estimate.Hint());
+  }
+
+  // outside the scope nothing is recorded
+  formats::json::ValueBuilder json;
+  json["key"] = 1;
+  json.SerializeToBytes();
+  REQUIRE(estimate.Samples() == 2);
+}
+
+TEST_CASE("[JsonBuilder] Literal Key Test", "[JsonBuilder]") {
+  static constexpr formats::json::JsonKey kStatus("status");
+  static_assert(kStatus.Size() == 6, "literal length is compile time");
+
+  formats::json::ValueBuilder json;
+  json[kStatus] = 200;
+  json["message"] = "ok";
+  std::string runtime_key = "runtime";
+  json[runtime_key] = true;
+  json[std::string_view("view")] = 1;
+  json[PICONAUT_JSON_KEY("macro")] = 2;
+  // char array key is copied up to its terminator, not its array size
+  const char padded[16] = "pad";
+  json[padded] = 3;
+
+  // wide object goes through the hash index
+  for (int i = 0; i < 40; ++i)
+    json["k" + std::to_string(i)] = i;
+  json["k7"] = 70;
+  json[kStatus] = 201;
+
+  auto out = json.SerializeToBytes().ToString();
+  REQUIRE(out.find("\"status\":201") != std::string::npos);
+  REQUIRE(out.find("\"k7\":70") != std::string::npos);
+  REQUIRE(out.find("\"runtime\":true") != std::string::npos);
+  REQUIRE(out.find("\"k39\":39") != std::string::npos);
+  REQUIRE(out.find("\"macro\":2") != std::string::npos);
+  REQUIRE(out.find("\"pad\":3") != std::string::npos);
+}
@@ -0,0 +1,42 @@
+#include <catch2/catch_all.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "piconaut/formats/json/lazy_reader.h"
+
+using namespace piconaut;
+
+TEST_CASE("[JsonLazyReader] Field Lookup Test", "[JsonLazyReader]") {
+  std::string text =
+      "{\"skip\":{\"a\":[1,2,{\"b\":\"}]\\\"\"}]},\"event\":\"push\","
+      "\"data\":{\"id\":12345678901,\"score\":-1.5e2,\"ok\":true,"
+      "\"tags\":[\"a\\n\",\"b\"],\"none\":null},\"list\":[1,2,3]}";
+
+  formats::json::LazyReader json(text);
+  REQUIRE(json["event"].As<std::string_view>() == "push");
+  REQUIRE(json["data"]["id"].As<int64_t>() == 12345678901LL);
+  REQUIRE(json["data"]["score"].As<double>() == -150.0);
+  REQUIRE(json["data"]["ok"].As<bool>());
+  REQUIRE(json["data"]["tags"].As<std::vector<std::string>>() ==
+          std::vector<std::string>{"a\n", "b"});
+  REQUIRE_FALSE(json["data"]["none"].As<std::optional<int>>().has_value());
+  REQUIRE(json["list"][2].As<int>() == 3);
+  REQUIRE(json["list"][3].IsMissing());
+  REQUIRE(json["missing"].IsMissing());
+
+  // lookup after a later member wraps around
+  auto& root = json.Root();
+  REQUIRE(root["list"].IsArray());
+  REQUIRE(root["skip"]["a"][2]["b"].As<std::string>() == "}]\"");
+  REQUIRE_THROWS_AS(root["event"].As<int>(), std::runtime_error);
+}
+
+TEST_CASE("[JsonLazyReader] Malformed Test", "[JsonLazyReader]") {
+  REQUIRE_THROWS_AS(formats::json::LazyReader("  "),
+                    formats::json::ParseError);
+
+  formats::json::LazyReader json("{\"a\":[1,2");
+  REQUIRE_THROWS_AS(json["b"], formats::json::ParseError);
+}
@@ -0,0 +1,47 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "piconaut/formats/json/value.h"
+
+using namespace piconaut;
+
+TEST_CASE("[JsonValue] Insitu Parse Test", "[JsonValue]") {
+  std::string body =
+      "{\"user\":{\"name\":\"john\",\"age\":30,\"active\":true},"
+      "\"score\":4.5}";
+  std::vector<char> text(body.begin(), body.end());
+  text.push_back('\0');
+
+  auto json = formats::json::Value::ParseInsitu(text.data(), body.size());
+
+  static const formats::json::Path kName("/user/name");
+  static const formats::json::Path kAge("/user/age");
+  static const formats::json::Path kActive("/user/active");
+  static const formats::json::Path kScore("/score");
+  static const formats::json::Path kMissing("/user/email");
+
+  auto name = json.GetString(kName);
+  REQUIRE(name.has_value());
+  REQUIRE(*name == "john");
+  // zero copy, the view points into the parsed text
+  REQUIRE(name->data() >= text.data());
+  REQUIRE(name->data() < text.data() + text.size());
+
+  REQUIRE(json.GetInt64(kAge) == 30);
+  REQUIRE(json.GetBool(kActive) == true);
+  REQUIRE(json.GetDouble(kScore) == 4.5);
+  REQUIRE_FALSE(json.Has(kMissing));
+  REQUIRE_FALSE(json.GetString(kAge).has_value());
+}
+
+TEST_CASE("[JsonValue] Parse Error Test", "[JsonValue]") {
+  REQUIRE_THROWS_AS(formats::json::Value::Parse("{\"key\":"),
+                    formats::json::ParseError);
+  REQUIRE_THROWS_AS(formats::json::Value::Parse(""),
+                    formats::json::ParseError);
+  REQUIRE_THROWS_AS(formats::json::Path("no-leading-slash"),
+                    std::invalid_argument);
+}
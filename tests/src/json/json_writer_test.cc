@@ -0,0 +1,95 @@
+#include <catch2/catch_all.hpp>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "piconaut/formats/json/json_fields.h"
+#include "piconaut/formats/json/json_writer.h"
+
+using namespace piconaut;
+
+TEST_CASE("[JsonWriter] Streaming Object Test", "[JsonWriter]") {
+  formats::json::JsonWriter json;
+  json.Object()
+      .Member("key1", "value1")
+      .Member("status", 200)
+      .Key("object")
+      .Object()
+      .Member("enabled", true)
+      .Key("empty")
+      .Null()
+      .EndObject()
+      .Key("items")
+      .Array()
+      .Value(1)
+      .Value("two")
+      .Raw("{\"three\":3}")
+      .EndArray()
+      .EndObject();
+
+  REQUIRE(json.IsComplete());
+  auto buffer = json.Finish();
+  REQUIRE(buffer.ToString() ==
+          "{\"key1\":\"value1\",\"status\":200,\"object\":{\"enabled\":true,"
+          "\"empty\":null},\"items\":[1,\"two\",{\"three\":3}]}");
+
+  // writer is reusable after Finish()
+  json.Array().EndArray();
+  REQUIRE(json.Finish().ToString() == "[]");
+  REQUIRE(buffer.ToString().size() == buffer.Size());
+}
+
+TEST_CASE("[JsonWriter] Incomplete Document Test", "[JsonWriter]") {
+  formats::json::JsonWriter json;
+  json.Object().Member("key1", "value1");
+  REQUIRE_FALSE(json.IsComplete());
+  REQUIRE_THROWS_AS(json.Finish(), std::runtime_error);
+
+#ifndef NDEBUG
+  json.Reset();
+  json.Object();
+  REQUIRE_THROWS_AS(json.Value(1), std::logic_error);
+  REQUIRE_THROWS_AS(json.EndArray(), std::logic_error);
+#endif
+}
+
+namespace json_fields_test {
+
+struct Address {
+  std::string city;
+  std::optional<std::string> zip;
+};
+PICONAUT_JSON_FIELDS(Address, city, zip)
+
+struct User {
+  int64_t id;
+  std::string name;
+  std::vector<std::string> roles;
+  std::map<std::string, int> quota;
+  Address address;
+};
+PICONAUT_JSON_FIELDS(User, id, name, roles, quota, address)
+
+}  // namespace json_fields_test
+
+TEST_CASE("[JsonWriter] Json Fields Test", "[JsonWriter]") {
+  json_fields_test::User user{
+      7, "john", {"admin", "dev"}, {{"disk", 10}}, {"Jakarta", std::nullopt}};
+
+  REQUIRE(formats::json::ToJson(user).ToString() ==
+          "{\"id\":7,\"name\":\"john\",\"roles\":[\"admin\",\"dev\"],"
+          "\"quota\":{\"disk\":10},\"address\":{\"city\":\"Jakarta\"}}");
+
+  std::vector<json_fields_test::Address> addresses{{"Bandung", "40111"}};
+  REQUIRE(formats::json::ToJson(addresses).ToString() ==
+          "[{\"city\":\"Bandung\",\"zip\":\"40111\"}]");
+}
+
+TEST_CASE("[JsonWriter] Stream Values Test", "[JsonWriter]") {
+  std::vector<int> ids{1, 2, 3};
+  formats::json::JsonWriter json;
+  json.Object().Key("ids").Values(ids).EndObject();
+  REQUIRE(json.Finish().ToString() == "{\"ids\":[1,2,3]}");
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "piconaut/metrics/latency_histogram.h"
+
+using namespace piconaut;
+
+using Histogram = metrics::LatencyHistogram;
+
+TEST_CASE("[LatencyHistogram] Small values are exact", "[LatencyHistogram]") {
+  for (uint64_t micros = 0; micros < 2 * Histogram::kSubBuckets; ++micros) {
+    REQUIRE(Histogram::IndexOf(micros) == micros);
+    REQUIRE(Histogram::UpperBound(micros) == micros);
+  }
+
+  // First log-linear bucket is two wide
+  REQUIRE(Histogram::IndexOf(32) == 32);
+  REQUIRE(Histogram::IndexOf(33) == 32);
+  REQUIRE(Histogram::UpperBound(32) == 33);
+  REQUIRE(Histogram::IndexOf(34) == 33);
+}
+
+TEST_CASE("[LatencyHistogram] Buckets cover every value within 1/16",
+          "[LatencyHistogram]") {
+  for (size_t index = 1; index < Histogram::kBucketCount; ++index) {
+    // Bounds only grow, no gap between buckets
+    REQUIRE(Histogram::UpperBound(index) > Histogram::UpperBound(index - 1));
+    uint64_t lower = Histogram::UpperBound(index - 1) + 1;
+    uint64_t upper = Histogram::UpperBound(index);
+    REQUIRE(Histogram::IndexOf(lower) == index);
+    REQUIRE(Histogram::IndexOf(upper) == index);
+    REQUIRE(upper - lower <= lower / Histogram::kSubBuckets);
+  }
+
+  // ~12 days, then everything lands in the last bucket
+  uint64_t last = Histogram::UpperBound(Histogram::kBucketCount - 1);
+  REQUIRE(last == (uint64_t(1) << 40) - 1);
+  REQUIRE(Histogram::IndexOf(last + 1) == Histogram::kBucketCount - 1);
+  REQUIRE(Histogram::IndexOf(UINT64_MAX) == Histogram::kBucketCount - 1);
+}
+
+TEST_CASE("[LatencyHistogram] Record", "[LatencyHistogram]") {
+  Histogram histogram;
+  histogram.Record(5);
+  histogram.Record(1000);
+  histogram.Record(1001);
+
+  REQUIRE(histogram.Total() == 3);
+  REQUIRE(histogram.SumMicros() == 2006);
+  REQUIRE(histogram.Count(5) == 1);
+  REQUIRE(histogram.Count(Histogram::IndexOf(1000)) == 2);
+}
+
+TEST_CASE("[LatencyHistogram] Threads of the shared slot don't lose samples",
+          "[LatencyHistogram]") {
+  Histogram histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&histogram]() {
+      for (int n = 0; n < 10000; ++n)
+        histogram.Record(100);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  REQUIRE(histogram.Total() == 40000);
+  REQUIRE(histogram.SumMicros() == 4000000);
+  REQUIRE(histogram.Count(Histogram::IndexOf(100)) == 40000);
+}
+
+TEST_CASE("[HistogramSnapshot] Quantiles", "[HistogramSnapshot]") {
+  metrics::HistogramSnapshot snapshot;
+  REQUIRE(snapshot.ValueAtQuantile(0.5) == 0);
+
+  // 1..100us split over two workers
+  Histogram odd;
+  Histogram even;
+  for (uint64_t micros = 1; micros <= 100; ++micros)
+    (micros % 2 ? odd : even).Record(micros);
+  snapshot.Merge(odd);
+  snapshot.Merge(even);
+  REQUIRE(snapshot.Total() == 100);
+  REQUIRE(snapshot.SumMicros() == 5050);
+
+  // Upper bound of the bucket holding the sample of that rank
+  REQUIRE(snapshot.ValueAtQuantile(0.0) == 1);
+  REQUIRE(snapshot.ValueAtQuantile(0.1) == 10);
+  REQUIRE(snapshot.ValueAtQuantile(0.5) == 51);
+  REQUIRE(snapshot.ValueAtQuantile(0.99) == 99);
+  REQUIRE(snapshot.ValueAtQuantile(1.0) == 103);
+  // Out of range quantiles are clamped
+  REQUIRE(snapshot.ValueAtQuantile(-1.0) == 1);
+  REQUIRE(snapshot.ValueAtQuantile(2.0) == 103);
+
+  for (double q : {0.25, 0.5, 0.75, 0.9, 0.999}) {
+    auto exact = static_cast<uint64_t>(q * 100 + 0.999);
+    auto value = snapshot.ValueAtQuantile(q);
+    REQUIRE(value >= exact);
+    REQUIRE(value - exact <= exact / Histogram::kSubBuckets);
+  }
+
+  // Bucket granularity: 50 shares its bucket with 51
+  REQUIRE(snapshot.CountAtOrBelow(0) == 0);
+  REQUIRE(snapshot.CountAtOrBelow(31) == 31);
+  REQUIRE(snapshot.CountAtOrBelow(50) == 49);
+  REQUIRE(snapshot.CountAtOrBelow(51) == 51);
+  REQUIRE(snapshot.CountAtOrBelow(1000) == 100);
+}
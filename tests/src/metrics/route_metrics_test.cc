@@ -0,0 +1,88 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdint>
+
+#include "piconaut/metrics/route_metrics.h"
+
+using namespace piconaut;
+
+namespace {
+
+// Request with a pool, only what RequestScope reads.
+struct FakeRequest {
+  FakeRequest() : native() {
+    h2o_mem_init_pool(&native.pool);
+    native.res.content_length = SIZE_MAX;
+  }
+
+  ~FakeRequest() {
+    Dispose();
+  }
+
+  void Dispose() {
+    if (disposed)
+      return;
+    disposed = true;
+    h2o_mem_clear_pool(&native.pool);
+  }
+
+  h2o_req_t native;
+  bool disposed = false;
+};
+
+uint64_t StatusCount(const metrics::RouteSnapshot& snapshot, int status) {
+  for (const auto& item : snapshot.statuses) {
+    if (item.first == status)
+      return item.second;
+  }
+  return 0;
+}
+
+}  // namespace
+
+TEST_CASE("[RequestScope] Counts the answered request at scope exit",
+          "[RequestScope]") {
+  metrics::RouteMetrics route;
+  FakeRequest req;
+  {
+    metrics::RequestScope scope(&route, &req.native);
+    req.native.res.status = 200;
+    req.native.res.content_length = 5;
+  }
+
+  auto snapshot = route.Snapshot();
+  REQUIRE(StatusCount(snapshot, 200) == 1);
+  REQUIRE(snapshot.bytes == 5);
+  REQUIRE(snapshot.latency.Total() == 1);
+}
+
+TEST_CASE("[RequestScope] Counts the unanswered request at disposal",
+          "[RequestScope]") {
+  metrics::RouteMetrics route;
+  FakeRequest req;
+  {
+    // Returns before any response, e.g. a parked single flight follower
+    metrics::RequestScope scope(&route, &req.native);
+  }
+  REQUIRE(route.Snapshot().latency.Total() == 0);
+
+  req.native.res.status = 304;
+  req.Dispose();
+  auto snapshot = route.Snapshot();
+  REQUIRE(StatusCount(snapshot, 304) == 1);
+  REQUIRE(StatusCount(snapshot, 0) == 0);
+  REQUIRE(snapshot.latency.Total() == 1);
+}
+
+TEST_CASE("[RequestScope] Counts on the route set last", "[RequestScope]") {
+  metrics::RouteMetrics unmatched;
+  metrics::RouteMetrics route;
+  FakeRequest req;
+  {
+    metrics::RequestScope scope(&unmatched, &req.native);
+    scope.Target(&route);
+    req.native.res.status = 404;
+  }
+  REQUIRE(unmatched.Snapshot().statuses.empty());
+  REQUIRE(StatusCount(route.Snapshot(), 404) == 1);
+}
@@ -0,0 +1,425 @@
+#include <catch2/catch_all.hpp>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/opensslv.h>
+#include <openssl/rsa.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "piconaut/middleware/jwt_verifier.h"
+
+using namespace piconaut;
+
+namespace {
+
+constexpr int64_t kNow = 1700000000;
+
+struct PkeyDeleter {
+  void operator()(EVP_PKEY* pkey) const {
+    EVP_PKEY_free(pkey);
+  }
+};
+using PkeyPtr = std::unique_ptr<EVP_PKEY, PkeyDeleter>;
+
+std::string Base64Url(const std::string& in) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  std::string out;
+  uint32_t bits = 0;
+  int count = 0;
+  for (unsigned char c : in) {
+    bits = (bits << 8) | c;
+    count += 8;
+    while (count >= 6) {
+      count -= 6;
+      out.push_back(kAlphabet[(bits >> count) & 0x3f]);
+    }
+  }
+  if (count > 0)
+    out.push_back(kAlphabet[(bits << (6 - count)) & 0x3f]);
+  return out;
+}
+
+// Big endian bytes of `bn`, left padded to `size` when given.
+std::string BignumBytes(const BIGNUM* bn, size_t size = 0) {
+  std::string bytes(std::max<size_t>(size, BN_num_bytes(bn)), '\0');
+  BN_bn2binpad(bn, reinterpret_cast<unsigned char*>(&bytes[0]),
+               static_cast<int>(bytes.size()));
+  return bytes;
+}
+
+PkeyPtr GenerateRsa(int bits) {
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+  EVP_PKEY* pkey = nullptr;
+  if (ctx && EVP_PKEY_keygen_init(ctx) == 1 &&
+      EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) == 1)
+    EVP_PKEY_keygen(ctx, &pkey);
+  EVP_PKEY_CTX_free(ctx);
+  if (!pkey)
+    throw std::runtime_error("RSA keygen failed");
+  return PkeyPtr(pkey);
+}
+
+PkeyPtr GenerateP256() {
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  EVP_PKEY* pkey = nullptr;
+  if (ctx && EVP_PKEY_keygen_init(ctx) == 1 &&
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) == 1)
+    EVP_PKEY_keygen(ctx, &pkey);
+  EVP_PKEY_CTX_free(ctx);
+  if (!pkey)
+    throw std::runtime_error("EC keygen failed");
+  return PkeyPtr(pkey);
+}
+
+std::string RsaJwk(EVP_PKEY* pkey, const std::string& kid) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  BIGNUM* n = nullptr;
+  BIGNUM* e = nullptr;
+  EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_RSA_N, &n);
+  EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_RSA_E, &e);
+  std::string jwk = "{\"kty\":\"RSA\",\"kid\":\"" + kid + "\",\"n\":\"" +
+                    Base64Url(BignumBytes(n)) + "\",\"e\":\"" +
+                    Base64Url(BignumBytes(e)) + "\"}";
+  BN_free(n);
+  BN_free(e);
+  return jwk;
+#else
+  const BIGNUM* n = nullptr;
+  const BIGNUM* e = nullptr;
+  RSA_get0_key(EVP_PKEY_get0_RSA(pkey), &n, &e, nullptr);
+  return "{\"kty\":\"RSA\",\"kid\":\"" + kid + "\",\"n\":\"" +
+         Base64Url(BignumBytes(n)) + "\",\"e\":\"" +
+         Base64Url(BignumBytes(e)) + "\"}";
+#endif
+}
+
+std::string EcJwk(EVP_PKEY* pkey, const std::string& kid) {
+  BIGNUM* x = BN_new();
+  BIGNUM* y = BN_new();
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_EC_PUB_X, &x);
+  EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_EC_PUB_Y, &y);
+#else
+  const EC_KEY* ec = EVP_PKEY_get0_EC_KEY(pkey);
+  EC_POINT_get_affine_coordinates_GFp(EC_KEY_get0_group(ec),
+                                      EC_KEY_get0_public_key(ec), x, y,
+                                      nullptr);
+#endif
+  std::string jwk = "{\"kty\":\"EC\",\"crv\":\"P-256\",\"kid\":\"" + kid +
+                    "\",\"x\":\"" + Base64Url(BignumBytes(x, 32)) +
+                    "\",\"y\":\"" + Base64Url(BignumBytes(y, 32)) + "\"}";
+  BN_free(x);
+  BN_free(y);
+  return jwk;
+}
+
+std::string OctJwk(const std::string& secret, const std::string& kid) {
+  return "{\"kty\":\"oct\",\"kid\":\"" + kid + "\",\"k\":\"" +
+         Base64Url(secret) + "\"}";
+}
+
+std::string DigestSign(EVP_PKEY* pkey, const std::string& input) {
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  size_t size = 0;
+  std::string signature;
+  if (ctx &&
+      EVP_DigestSignInit(ctx, nullptr, EVP_sha256(), nullptr, pkey) == 1 &&
+      EVP_DigestSign(ctx, nullptr, &size,
+                     reinterpret_cast<const unsigned char*>(input.data()),
+                     input.size()) == 1) {
+    signature.resize(size);
+    EVP_DigestSign(ctx, reinterpret_cast<unsigned char*>(&signature[0]),
+                   &size, reinterpret_cast<const unsigned char*>(input.data()),
+                   input.size());
+    signature.resize(size);
+  }
+  EVP_MD_CTX_free(ctx);
+  return signature;
+}
+
+// DER ECDSA-Sig-Value to the JWS r || s form.
+std::string RawEcdsa(const std::string& der) {
+  auto cursor = reinterpret_cast<const unsigned char*>(der.data());
+  ECDSA_SIG* sig = d2i_ECDSA_SIG(nullptr, &cursor,
+                                 static_cast<long>(der.size()));
+  const BIGNUM* r = nullptr;
+  const BIGNUM* s = nullptr;
+  ECDSA_SIG_get0(sig, &r, &s);
+  std::string raw = BignumBytes(r, 32) + BignumBytes(s, 32);
+  ECDSA_SIG_free(sig);
+  return raw;
+}
+
+std::string Hmac(const std::string& secret, const std::string& input) {
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+  HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+       reinterpret_cast<const unsigned char*>(input.data()), input.size(),
+       mac, &size);
+  return std::string(reinterpret_cast<char*>(mac), size);
+}
+
+std::string Claims(int64_t exp) {
+  return "{\"sub\":\"ada\",\"exp\":" + std::to_string(exp) + "}";
+}
+
+std::string Token(const std::string& header, const std::string& claims,
+                  const std::string& signature) {
+  return Base64Url(header) + "." + Base64Url(claims) + "." +
+         Base64Url(signature);
+}
+
+std::string SignHs256(const std::string& secret, const std::string& claims,
+                      const std::string& kid = "hs") {
+  auto input = Base64Url("{\"alg\":\"HS256\",\"kid\":\"" + kid + "\"}") +
+               "." + Base64Url(claims);
+  return input + "." + Base64Url(Hmac(secret, input));
+}
+
+std::string SignRs256(EVP_PKEY* pkey, const std::string& claims,
+                      const std::string& kid = "rs") {
+  auto input = Base64Url("{\"alg\":\"RS256\",\"kid\":\"" + kid + "\"}") +
+               "." + Base64Url(claims);
+  return input + "." + Base64Url(DigestSign(pkey, input));
+}
+
+std::string SignEs256(EVP_PKEY* pkey, const std::string& claims,
+                      const std::string& kid = "es") {
+  auto input = Base64Url("{\"alg\":\"ES256\",\"kid\":\"" + kid + "\"}") +
+               "." + Base64Url(claims);
+  return input + "." + Base64Url(RawEcdsa(DigestSign(pkey, input)));
+}
+
+// JWKS file removed with the test.
+class JwksFile {
+ public:
+  explicit JwksFile(const std::vector<std::string>& keys)
+                  : path_("piconaut_jwks_test_" +
+                          std::to_string(reinterpret_cast<uintptr_t>(this)) +
+                          ".json") {
+    Write(keys);
+  }
+
+  ~JwksFile() {
+    std::remove(path_.c_str());
+  }
+
+  void Write(const std::vector<std::string>& keys) const {
+    std::string text = "{\"keys\":[";
+    for (size_t i = 0; i < keys.size(); ++i)
+      text += (i ? "," : "") + keys[i];
+    text += "]}";
+    std::ofstream(path_, std::ios::trunc) << text;
+  }
+
+  middleware::JwtOptions Options() const {
+    middleware::JwtOptions options;
+    options.jwks_path = path_;
+    options.reload_interval = std::chrono::seconds(0);
+    return options;
+  }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace
+
+TEST_CASE("[JwtVerifier] HS256", "[JwtVerifier]") {
+  JwksFile jwks({OctJwk("top-secret-key-0123456789abcdef", "hs")});
+  middleware::JwtVerifier verifier(jwks.Options());
+
+  auto token = SignHs256("top-secret-key-0123456789abcdef", Claims(kNow + 60));
+  REQUIRE(verifier.Verify(token, kNow) == middleware::JwtStatus::kOk);
+
+  auto forged = SignHs256("another-secret", Claims(kNow + 60));
+  REQUIRE(verifier.Verify(forged, kNow) ==
+          middleware::JwtStatus::kBadSignature);
+
+  // Payload swapped under the original signature
+  auto tampered = token;
+  auto first = tampered.find('.');
+  auto second = tampered.find('.', first + 1);
+  tampered.replace(first + 1, second - first - 1,
+                   Base64Url(Claims(kNow + 3600)));
+  REQUIRE(verifier.Verify(tampered, kNow) ==
+          middleware::JwtStatus::kBadSignature);
+
+  REQUIRE(verifier.Verify("not-a-token", kNow) ==
+          middleware::JwtStatus::kMalformed);
+}
+
+TEST_CASE("[JwtVerifier] RS256", "[JwtVerifier]") {
+  auto key = GenerateRsa(2048);
+  auto other = GenerateRsa(2048);
+  JwksFile jwks({RsaJwk(key.get(), "rs")});
+  middleware::JwtVerifier verifier(jwks.Options());
+
+  REQUIRE(verifier.Verify(SignRs256(key.get(), Claims(kNow + 60)), kNow) ==
+          middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(SignRs256(other.get(), Claims(kNow + 60)), kNow) ==
+          middleware::JwtStatus::kBadSignature);
+  REQUIRE(verifier.Verify(SignRs256(key.get(), Claims(kNow + 60), "missing"),
+                          kNow) == middleware::JwtStatus::kUnknownKey);
+}
+
+TEST_CASE("[JwtVerifier] RSA keys under 2048 bits are ignored",
+          "[JwtVerifier]") {
+  auto weak = GenerateRsa(1024);
+  auto strong = GenerateRsa(2048);
+
+  JwksFile only_weak({RsaJwk(weak.get(), "weak")});
+  REQUIRE_THROWS_AS(middleware::JwtVerifier(only_weak.Options()),
+                    std::runtime_error);
+
+  JwksFile mixed({RsaJwk(weak.get(), "weak"), RsaJwk(strong.get(), "rs")});
+  middleware::JwtVerifier verifier(mixed.Options());
+  REQUIRE(verifier.KeyCount() == 1);
+  REQUIRE(verifier.Verify(SignRs256(weak.get(), Claims(kNow + 60), "weak"),
+                          kNow) == middleware::JwtStatus::kUnknownKey);
+}
+
+TEST_CASE("[JwtVerifier] ES256", "[JwtVerifier]") {
+  auto key = GenerateP256();
+  auto other = GenerateP256();
+  JwksFile jwks({EcJwk(key.get(), "es")});
+  middleware::JwtVerifier verifier(jwks.Options());
+
+  REQUIRE(verifier.Verify(SignEs256(key.get(), Claims(kNow + 60)), kNow) ==
+          middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(SignEs256(other.get(), Claims(kNow + 60)), kNow) ==
+          middleware::JwtStatus::kBadSignature);
+}
+
+TEST_CASE("[JwtVerifier] Algorithm and key type mismatch", "[JwtVerifier]") {
+  auto key = GenerateRsa(2048);
+  auto jwk = RsaJwk(key.get(), "rs");
+  JwksFile jwks({jwk});
+  middleware::JwtVerifier verifier(jwks.Options());
+
+  SECTION("HS256 signed with the RSA public key as secret") {
+    auto token = SignHs256(jwk, Claims(kNow + 60), "rs");
+    REQUIRE(verifier.Verify(token, kNow) == middleware::JwtStatus::kUnknownKey);
+  }
+
+  SECTION("alg none") {
+    auto token = Token("{\"alg\":\"none\"}", Claims(kNow + 60), "");
+    REQUIRE(verifier.Verify(token, kNow) ==
+            middleware::JwtStatus::kUnsupportedAlgorithm);
+  }
+
+  SECTION("JWK declaring an alg of another key type") {
+    JwksFile declared({"{\"kty\":\"oct\",\"alg\":\"RS256\",\"k\":\"" +
+                           Base64Url("secret") + "\"}",
+                       jwk});
+    middleware::JwtVerifier mixed(declared.Options());
+    REQUIRE(mixed.KeyCount() == 1);
+  }
+}
+
+TEST_CASE("[JwtVerifier] exp, nbf and leeway", "[JwtVerifier]") {
+  const std::string secret = "top-secret-key-0123456789abcdef";
+  JwksFile jwks({OctJwk(secret, "hs")});
+  auto options = jwks.Options();
+  options.leeway = std::chrono::seconds(30);
+  options.cache_size = 0;
+  middleware::JwtVerifier verifier(options);
+
+  auto expired = SignHs256(secret, Claims(kNow - 10));
+  REQUIRE(verifier.Verify(expired, kNow) == middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(expired, kNow + 20) ==
+          middleware::JwtStatus::kExpired);
+
+  auto nbf = SignHs256(secret, "{\"exp\":" + std::to_string(kNow + 600) +
+                                   ",\"nbf\":" + std::to_string(kNow + 20) +
+                                   "}");
+  REQUIRE(verifier.Verify(nbf, kNow) == middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(nbf, kNow - 20) ==
+          middleware::JwtStatus::kNotYetValid);
+
+  auto no_exp = SignHs256(secret, "{\"sub\":\"ada\"}");
+  REQUIRE(verifier.Verify(no_exp, kNow) == middleware::JwtStatus::kMalformed);
+}
+
+TEST_CASE("[JwtVerifier] Issuer and audience", "[JwtVerifier]") {
+  const std::string secret = "top-secret-key-0123456789abcdef";
+  JwksFile jwks({OctJwk(secret, "hs")});
+  auto options = jwks.Options();
+  options.issuer = "https://auth.example.com";
+  options.audience = "orders-api";
+  middleware::JwtVerifier verifier(options);
+
+  auto claims = [](const std::string& iss, const std::string& aud) {
+    return "{\"exp\":" + std::to_string(kNow + 60) + ",\"iss\":\"" + iss +
+           "\",\"aud\":" + aud + "}";
+  };
+  REQUIRE(verifier.Verify(
+              SignHs256(secret, claims("https://auth.example.com",
+                                       "\"orders-api\"")),
+              kNow) == middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(
+              SignHs256(secret, claims("https://auth.example.com",
+                                       "[\"billing\",\"orders-api\"]")),
+              kNow) == middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(
+              SignHs256(secret, claims("https://evil.example.com",
+                                       "\"orders-api\"")),
+              kNow) == middleware::JwtStatus::kBadIssuer);
+  REQUIRE(verifier.Verify(SignHs256(secret, claims("https://auth.example.com",
+                                                   "[\"billing\"]")),
+                          kNow) == middleware::JwtStatus::kBadAudience);
+}
+
+TEST_CASE("[JwtVerifier] Cached token expires", "[JwtVerifier]") {
+  const std::string secret = "top-secret-key-0123456789abcdef";
+  JwksFile jwks({OctJwk(secret, "hs")});
+  auto options = jwks.Options();
+  options.leeway = std::chrono::seconds(0);
+  middleware::JwtVerifier verifier(options);
+
+  auto token = SignHs256(secret, Claims(kNow + 60));
+  REQUIRE(verifier.Verify(token, kNow) == middleware::JwtStatus::kOk);
+  // Second check is a cache hit
+  REQUIRE(verifier.Verify(token, kNow + 30) == middleware::JwtStatus::kOk);
+  REQUIRE(verifier.Verify(token, kNow + 60) ==
+          middleware::JwtStatus::kExpired);
+}
+
+TEST_CASE("[JwtVerifier] Reload invalidates cached tokens", "[JwtVerifier]") {
+  JwksFile jwks({OctJwk("first-secret-0123456789abcdef", "hs")});
+  middleware::JwtVerifier verifier(jwks.Options());
+
+  auto token = SignHs256("first-secret-0123456789abcdef", Claims(kNow + 60));
+  REQUIRE(verifier.Verify(token, kNow) == middleware::JwtStatus::kOk);
+  auto generation = verifier.Generation();
+
+  // Same kid, rotated secret
+  jwks.Write({OctJwk("second-secret-0123456789abcdef", "hs")});
+  verifier.Reload();
+  REQUIRE(verifier.Generation() == generation + 1);
+  REQUIRE(verifier.Verify(token, kNow) ==
+          middleware::JwtStatus::kBadSignature);
+
+  // A broken file keeps the rotated keys
+  jwks.Write({});
+  REQUIRE_THROWS_AS(verifier.Reload(), std::runtime_error);
+  REQUIRE(verifier.Verify(SignHs256("second-secret-0123456789abcdef",
+                                    Claims(kNow + 60)),
+                          kNow) == middleware::JwtStatus::kOk);
+}
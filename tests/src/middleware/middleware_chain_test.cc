@@ -0,0 +1,154 @@
+#include <catch2/catch_all.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "piconaut/handlers/global_dispatcher_handler.h"
+#include "piconaut/middleware/middleware_chain.h"
+
+using namespace piconaut;
+
+namespace {
+
+using Trace = std::vector<std::string>;
+
+// Bare h2o request, enough for routing and the middleware chain.
+struct FakeRequest {
+  explicit FakeRequest(const std::string& request_path)
+                  : path(request_path), native() {
+    native.path_normalized = h2o_iovec_init(path.data(), path.size());
+    native.method = h2o_iovec_init(H2O_STRLIT("GET"));
+  }
+
+  std::string path;
+  h2o_req_t native;
+};
+
+class RecordMiddleware : public middleware::MiddlewareBase {
+ public:
+  RecordMiddleware(std::string name, Trace& trace, bool pass = true)
+                  : name_(std::move(name)), trace_(trace), pass_(pass) {}
+
+  void Handle(const http::Request& req, const http::Response& res,
+              middleware::Next next) override {
+    trace_.push_back(name_);
+    if (pass_)
+      next();
+  }
+
+ private:
+  std::string name_;
+  Trace& trace_;
+  bool pass_;
+};
+
+class RecordHandler : public handlers::HandlerBase {
+ public:
+  RecordHandler(std::string name, Trace& trace)
+                  : name_(std::move(name)), trace_(trace) {}
+
+  void HandleRequest(const http::Request& req, const http::Response& res,
+                     const std::unordered_map<std::string, std::string>&
+                         params) const override {
+    trace_.push_back(name_);
+  }
+
+ private:
+  std::string name_;
+  Trace& trace_;
+};
+
+}  // namespace
+
+TEST_CASE("[MiddlewareChain] Runs in order then terminal",
+          "[MiddlewareChain]") {
+  Trace trace;
+  middleware::MiddlewareChain chain;
+  chain.Add(std::make_shared<RecordMiddleware>("first", trace));
+  chain.Add(std::make_shared<RecordMiddleware>("second", trace));
+
+  FakeRequest fake("/");
+  http::Request req(&fake.native);
+  http::Response res(&fake.native);
+  chain.Run(req, res, [&](const http::Request&, const http::Response&) {
+    trace.push_back("terminal");
+  });
+
+  REQUIRE(trace == Trace{"first", "second", "terminal"});
+}
+
+TEST_CASE("[MiddlewareChain] Short-circuit skips the rest",
+          "[MiddlewareChain]") {
+  Trace trace;
+  middleware::MiddlewareChain chain;
+  chain.Add(std::make_shared<RecordMiddleware>("first", trace));
+  chain.Add(std::make_shared<RecordMiddleware>("stop", trace, false));
+  chain.Add(std::make_shared<RecordMiddleware>("never", trace));
+
+  FakeRequest fake("/");
+  http::Request req(&fake.native);
+  http::Response res(&fake.native);
+  chain.Run(req, res, [&](const http::Request&, const http::Response&) {
+    trace.push_back("terminal");
+  });
+
+  REQUIRE(trace == Trace{"first", "stop"});
+}
+
+TEST_CASE("[MiddlewareChain] Prefix match on segment boundary",
+          "[MiddlewareChain]") {
+  REQUIRE(middleware::IsUnderPrefix("/api", "/api"));
+  REQUIRE(middleware::IsUnderPrefix("/api/users", "/api"));
+  REQUIRE(middleware::IsUnderPrefix("/api/users", "/api/"));
+  REQUIRE_FALSE(middleware::IsUnderPrefix("/apix", "/api"));
+  REQUIRE_FALSE(middleware::IsUnderPrefix("/ap", "/api"));
+  REQUIRE_FALSE(middleware::IsUnderPrefix("/users", "/api"));
+  REQUIRE(middleware::IsUnderPrefix("/apix", "/"));
+  REQUIRE(middleware::IsUnderPrefix("/apix", ""));
+}
+
+TEST_CASE("[MiddlewareChain] Global, prefix then route order",
+          "[MiddlewareChain]") {
+  Trace trace;
+  handlers::GlobalDispatcherHandler dispatcher;
+  dispatcher.RegisterRouteHandler(
+      "/api/users", std::make_shared<RecordHandler>("users", trace));
+  dispatcher.RegisterRouteHandler(
+      "/apix", std::make_shared<RecordHandler>("apix", trace));
+
+  // Registered out of order, the flattened stack is still
+  // global -> outer prefix -> inner prefix -> route
+  dispatcher.UseRouteMiddleware(
+      "/api/users", std::make_shared<RecordMiddleware>("route", trace));
+  dispatcher.UsePrefixMiddleware(
+      "/api/users", std::make_shared<RecordMiddleware>("inner", trace));
+  dispatcher.UsePrefixMiddleware(
+      "/api", std::make_shared<RecordMiddleware>("outer", trace));
+  dispatcher.UseMiddleware(std::make_shared<RecordMiddleware>("global", trace));
+  dispatcher.Freeze();
+
+  SECTION("Route under the prefixes") {
+    FakeRequest fake("/api/users");
+    http::Request req(&fake.native);
+    http::Response res(&fake.native);
+    dispatcher.__HandleImpl(req, res);
+    REQUIRE(trace == Trace{"global", "outer", "inner", "route", "users"});
+  }
+
+  SECTION("Sibling path doesn't match the prefix") {
+    FakeRequest fake("/apix");
+    http::Request req(&fake.native);
+    http::Response res(&fake.native);
+    dispatcher.__HandleImpl(req, res);
+    REQUIRE(trace == Trace{"global", "apix"});
+  }
+
+  SECTION("Registration is rejected once frozen") {
+    REQUIRE_THROWS_AS(
+        dispatcher.UseMiddleware(
+            std::make_shared<RecordMiddleware>("late", trace)),
+        std::logic_error);
+  }
+}
@@ -0,0 +1,127 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdint>
+
+#include "piconaut/routers/concurrency_limiter.h"
+
+using namespace piconaut;
+
+namespace {
+
+constexpr uint64_t kFastNs = 1000000;
+constexpr uint64_t kSlowNs = 20 * kFastNs;
+
+routers::ConcurrencyPolicy TestPolicy() {
+  routers::ConcurrencyPolicy policy;
+  policy.initial_limit = 4;
+  policy.min_limit = 1;
+  policy.max_limit = 64;
+  // Update on every release
+  policy.window = 1;
+  return policy;
+}
+
+// Take every slot, then give them back with `latency_ns`.
+void SaturateRound(routers::ConcurrencyLimiter& limiter, uint64_t latency_ns) {
+  size_t taken = 0;
+  while (limiter.TryAcquire())
+    ++taken;
+  for (size_t i = 0; i < taken; ++i)
+    limiter.Release(latency_ns);
+}
+
+}  // namespace
+
+TEST_CASE("[ConcurrencyLimiter] Rejects past the limit",
+          "[ConcurrencyLimiter]") {
+  auto policy = TestPolicy();
+  policy.initial_limit = 2;
+  routers::ConcurrencyLimiter limiter(policy);
+
+  routers::ConcurrencyPermit first(&limiter);
+  routers::ConcurrencyPermit second(&limiter);
+  REQUIRE(first.Granted());
+  REQUIRE(second.Granted());
+  REQUIRE(limiter.InFlight() == 2);
+
+  {
+    // What the dispatcher answers with 503
+    routers::ConcurrencyPermit third(&limiter);
+    REQUIRE_FALSE(third.Granted());
+  }
+  REQUIRE_FALSE(limiter.TryAcquire());
+  REQUIRE(limiter.Rejected() == 2);
+  REQUIRE(limiter.InFlight() == 2);
+}
+
+TEST_CASE("[ConcurrencyLimiter] Permit release", "[ConcurrencyLimiter]") {
+  routers::ConcurrencyLimiter limiter(TestPolicy());
+
+  SECTION("At scope exit") {
+    {
+      routers::ConcurrencyPermit permit(&limiter);
+      REQUIRE(limiter.InFlight() == 1);
+    }
+    REQUIRE(limiter.InFlight() == 0);
+  }
+
+  SECTION("With the request pool") {
+    h2o_mem_pool_t pool;
+    h2o_mem_init_pool(&pool);
+    {
+      routers::ConcurrencyPermit permit(&limiter);
+      permit.BindTo(&pool);
+      REQUIRE(permit.Granted());
+    }
+    REQUIRE(limiter.InFlight() == 1);
+    h2o_mem_clear_pool(&pool);
+    REQUIRE(limiter.InFlight() == 0);
+  }
+
+  SECTION("Without limiter") {
+    routers::ConcurrencyPermit permit(nullptr);
+    REQUIRE(permit.Granted());
+  }
+}
+
+TEST_CASE("[ConcurrencyLimiter] Grows while used and latency holds",
+          "[ConcurrencyLimiter]") {
+  routers::ConcurrencyLimiter limiter(TestPolicy());
+  REQUIRE(limiter.Limit() == 4);
+
+  for (int i = 0; i < 20; ++i)
+    SaturateRound(limiter, kFastNs);
+  REQUIRE(limiter.Limit() > 4);
+  REQUIRE(limiter.InFlight() == 0);
+}
+
+TEST_CASE("[ConcurrencyLimiter] Doesn't grow when underused",
+          "[ConcurrencyLimiter]") {
+  routers::ConcurrencyLimiter limiter(TestPolicy());
+
+  // One request at a time never use half of the limit
+  for (int i = 0; i < 50; ++i) {
+    REQUIRE(limiter.TryAcquire());
+    limiter.Release(kFastNs);
+  }
+  REQUIRE(limiter.Limit() == 4);
+}
+
+TEST_CASE("[ConcurrencyLimiter] Shrinks when latency grows",
+          "[ConcurrencyLimiter]") {
+  routers::ConcurrencyLimiter limiter(TestPolicy());
+  for (int i = 0; i < 20; ++i)
+    SaturateRound(limiter, kFastNs);
+  auto grown = limiter.Limit();
+
+  for (int i = 0; i < 5; ++i)
+    SaturateRound(limiter, kSlowNs);
+  REQUIRE(limiter.Limit() < grown);
+
+  // Never below min_limit
+  for (int i = 0; i < 100; ++i)
+    SaturateRound(limiter, kSlowNs * (i + 2));
+  REQUIRE(limiter.Limit() >= 1);
+  REQUIRE(limiter.TryAcquire());
+  limiter.Release(kFastNs);
+}
@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "piconaut/utils/worker.h"
+
+using namespace piconaut;
+
+TEST_CASE("[Worker] Threads without a claim share one slot", "[Worker]") {
+  REQUIRE(utils::WorkerSlot() == utils::kSharedSlot);
+  REQUIRE(utils::OnSharedSlot());
+
+  size_t other = 0;
+  std::thread([&other]() { other = utils::WorkerSlot(); }).join();
+  REQUIRE(other == utils::kSharedSlot);
+}
+
+TEST_CASE("[Worker] Claimed slots are owned until released", "[Worker]") {
+  size_t claimed = utils::ClaimWorkerSlot();
+  REQUIRE(claimed != utils::kSharedSlot);
+  REQUIRE(utils::WorkerSlot() == claimed);
+  // Idempotent
+  REQUIRE(utils::ClaimWorkerSlot() == claimed);
+
+  size_t other = utils::kSharedSlot;
+  std::thread([&other]() {
+    other = utils::ClaimWorkerSlot();
+    utils::ReleaseWorkerSlot();
+  }).join();
+  REQUIRE(other != claimed);
+
+  utils::ReleaseWorkerSlot();
+  REQUIRE(utils::OnSharedSlot());
+}
+
+TEST_CASE("[Worker] Falls back to the shared slot when all are taken",
+          "[Worker]") {
+  std::vector<size_t> slots;
+  for (size_t i = 0; i < utils::kMaxWorkers; ++i) {
+    size_t slot = utils::kSharedSlot;
+    // Kept claimed, the thread exits without release
+    std::thread([&slot]() { slot = utils::ClaimWorkerSlot(); }).join();
+    slots.push_back(slot);
+  }
+
+  std::set<size_t> owned;
+  for (auto slot : slots) {
+    if (slot != utils::kSharedSlot)
+      owned.insert(slot);
+  }
+  REQUIRE(owned.size() == utils::kSharedSlot);
+  REQUIRE(slots.back() == utils::kSharedSlot);
+  REQUIRE(utils::ClaimWorkerSlot() == utils::kSharedSlot);
+
+  // Give them back for the other tests
+  for (auto slot : owned) {
+    utils::detail::ClaimedWorkerSlots().fetch_and(~(uint64_t(1) << slot));
+  }
+}
+
+TEST_CASE("[Worker] Shared slot counters don't lose updates", "[Worker]") {
+  std::atomic<uint64_t> counter{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&counter]() {
+      for (int n = 0; n < 100000; ++n)
+        utils::SlotAdd(counter, 1);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  REQUIRE(counter.load() == 400000);
+}